@@ -0,0 +1,106 @@
+#ifndef REGEX_AHO_CORASICK_H
+#define REGEX_AHO_CORASICK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "literal.h"
+
+// The root of the trie, which matches the empty string
+#define AHO_CORASICK_ROOT 0
+
+/**
+ * Represents an Aho-Corasick automaton, which searches for many literals at
+ * once. The trie of the literals is turned into a DFA by following the
+ * failure links ahead of time.
+ *
+ * Bytes that do not appear in any literal behave the same, so the
+ * transition table is indexed by byte class instead of byte, which keeps it
+ * small for large sets of literals.
+ *
+ * Members
+ *     - n_states: The number of states, one for each prefix of a literal
+ *     - n_classes: The number of byte classes
+ *     - classes: The byte class of each byte. Class 0 holds every byte that
+ *                does not appear in any literal.
+ *     - table: Transition table, with n_classes entries per state
+ *     - depth: The length of the prefix each state stands for
+ *     - branch: The index of the first literal equal to each state's
+ *               prefix, -1 if there is none
+ *     - out_len: The length of the longest literal ending each state's
+ *                prefix, 0 if there is none
+ */
+typedef struct AhoCorasick {
+    size_t n_states;
+    size_t n_classes;
+    uint8_t classes[256];
+    uint32_t* table;
+    uint32_t* depth;
+    int32_t* branch;
+    uint32_t* out_len;
+} AhoCorasick;
+
+/**
+ * Create a heap allocated Aho-Corasick automaton for the given literals
+ *
+ * @param  literals The literals to search for, in order. Their index is
+ *                  reported as the branch that matched.
+ *
+ * @return A pointer to a heap allocated automaton on success,
+ *         NULL on failure, or if there are no literals or any is empty
+ */
+AhoCorasick* aho_corasick_create(const LiteralSet* literals);
+
+/**
+ * Releases the memory used by the given Aho-Corasick automaton
+ *
+ * @param ac The automaton to deallocate
+ */
+void aho_corasick_free(AhoCorasick* ac);
+
+/**
+ * Find which literal the whole of the given string is equal to
+ *
+ * @param  ac     The automaton to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return The index of the first literal equal to the string,
+ *         -1 if there is none or the input is invalid
+ */
+ssize_t aho_corasick_match(const AhoCorasick* ac, const char* string, size_t len);
+
+/**
+ * Count the non-overlapping occurrences of the literals in the given string.
+ * An occurrence is counted as soon as it ends, and the next may only start
+ * after it.
+ *
+ * @param  ac     The automaton to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The number of occurrences found
+ */
+size_t aho_corasick_count(const AhoCorasick* ac, const char* string, size_t len);
+
+/**
+ * Find the first occurrence of any literal in the given string.
+ *
+ * The occurrence that ends first is located, and the longest literal ending
+ * there is taken. From where it starts, the longest literal starting there
+ * is then reported.
+ *
+ * @param  ac     The automaton to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ * @param  start  Set to the offset of the first byte of the occurrence
+ * @param  end    Set to the offset just past its last byte
+ *
+ * @return The index of the literal found, -1 if there is none or the input
+ *         is invalid
+ */
+ssize_t aho_corasick_find(const AhoCorasick* ac, const char* string, size_t len,
+                          size_t* start, size_t* end);
+
+#endif // REGEX_AHO_CORASICK_H
@@ -1,6 +1,11 @@
 #ifndef REGEX_AST_H
 #define REGEX_AST_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+// The maximum length of the strings matched by patterns with repetitions
+#define AST_UNBOUNDED SIZE_MAX
 
 /**
  * Lists the types of AST Nodes
@@ -77,6 +82,35 @@ int ast_node_init(ASTNode* node, ASTNodeType type);
  */
 void ast_node_free(ASTNode* node);
 
+/**
+ * Mirror the AST in place, so that it matches the reverse of every string
+ * it matched before. Mirroring twice restores the original AST.
+ *
+ * @param node The root of the AST to mirror
+ */
+void ast_reverse(ASTNode* node);
+
+/**
+ * Copy an AST, so the copy can be changed while the original is shared
+ *
+ * @param  node The root of the AST to copy
+ *
+ * @return The root of a heap allocated copy on success, NULL on failure
+ */
+ASTNode* ast_copy(const ASTNode* node);
+
+/**
+ * Compute the shortest and longest length of the strings the AST matches
+ *
+ * @param  node The root of the AST to measure
+ * @param  min  Set to the length of the shortest string matched
+ * @param  max  Set to the length of the longest string matched,
+ *              or AST_UNBOUNDED if there is no limit
+ *
+ * @return 0 on success, -1 on failure
+ */
+int ast_length_bounds(const ASTNode* node, size_t* min, size_t* max);
+
 /**
  * @param  node The node to convert to string
  *
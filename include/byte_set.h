@@ -0,0 +1,70 @@
+#ifndef REGEX_BYTE_SET_H
+#define REGEX_BYTE_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "ast.h"
+
+/**
+ * Represents a set of bytes as a 256 bit bitmap
+ *
+ * Members
+ *     - bits: Bit `c % 64` of word `c / 64` is set if byte `c` is in the set
+ */
+typedef struct ByteSet {
+    uint64_t bits[4];
+} ByteSet;
+
+/**
+ * Add a byte to the given set
+ *
+ * @param set The set to add to
+ * @param c   The byte to add
+ */
+void byte_set_add(ByteSet* set, unsigned char c);
+
+/**
+ * Check whether a byte is in the given set
+ *
+ * @param  set The set to look in
+ * @param  c   The byte to look for
+ *
+ * @return true if the byte is in the set, false otherwise
+ */
+bool byte_set_contains(const ByteSet* set, unsigned char c);
+
+/**
+ * Count the bytes in the given set
+ *
+ * @param  set The set to count
+ *
+ * @return The number of bytes in the set
+ */
+size_t byte_set_count(const ByteSet* set);
+
+/**
+ * Find the first byte of the given string that is in the set
+ *
+ * @param  set    The set of bytes to look for
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The offset of the first such byte, -1 if there is none
+ */
+ssize_t byte_set_find(const ByteSet* set, const char* string, size_t len);
+
+/**
+ * Compute the set of bytes that non-empty matches of the AST start with.
+ * Applied to a reversed AST, this is the set of bytes they end with.
+ *
+ * @param  root The root of the abstract syntax tree
+ * @param  set  Set to the bytes the matches start with
+ *
+ * @return 0 on success, -1 on failure
+ */
+int byte_set_first(const ASTNode* root, ByteSet* set);
+
+#endif // REGEX_BYTE_SET_H
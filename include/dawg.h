@@ -0,0 +1,202 @@
+#ifndef REGEX_DAWG_H
+#define REGEX_DAWG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Keywords may be at most this long
+#define DAWG_MAX_KEYWORD_LEN 4096
+
+/**
+ * Represents a minimal acyclic deterministic automaton accepting a set of
+ * keywords, also known as a DAWG (Directed Acyclic Word Graph). Keywords
+ * sharing a suffix share the states spelling it, as well as those for a
+ * shared prefix.
+ *
+ * The transitions of every state are stored one after another, sorted by
+ * byte, with those of state `s` from edge_starts[s] up to
+ * edge_starts[s + 1].
+ *
+ * Members
+ *     - n_states: The number of states
+ *     - n_edges: The number of transitions
+ *     - root: The start state
+ *     - edge_starts: Where the transitions of every state start, with one
+ *                    extra entry at the end
+ *     - labels: The byte every transition is taken on
+ *     - targets: The state every transition leads to
+ *     - finals: Bitset of the accepting states
+ *     - n_keywords: The number of distinct keywords
+ *     - min_len: The length of the shortest keyword
+ *     - max_len: The length of the longest keyword
+ */
+typedef struct Dawg {
+    size_t n_states;
+    size_t n_edges;
+    uint32_t root;
+    uint32_t* edge_starts;
+    unsigned char* labels;
+    uint32_t* targets;
+    uint64_t* finals;
+    size_t n_keywords;
+    size_t min_len;
+    size_t max_len;
+} Dawg;
+
+/**
+ * A state on the path of the last keyword added, which may still gain
+ * transitions
+ *
+ * Members
+ *     - is_final: Whether a keyword ends in this state
+ *     - n_edges: The number of transitions
+ *     - labels: The byte every transition is taken on, in increasing order
+ *     - targets: The state every transition leads to. The target of the
+ *                last transition is the next state on the path, and is only
+ *                known once that state is registered.
+ */
+typedef struct DawgPathState {
+    bool is_final;
+    size_t n_edges;
+    unsigned char labels[256];
+    uint32_t targets[256];
+} DawgPathState;
+
+/**
+ * Builds a DAWG from keywords added in sorted order, using the incremental
+ * algorithm of Daciuk et al. Only the path of the last keyword is mutable.
+ * When a keyword leaves that path, the states it leaves behind can no
+ * longer change, and are merged with an equivalent registered state or
+ * registered themselves. The automaton is minimal at every step, so memory
+ * stays proportional to its final size.
+ *
+ * Members
+ *     - dawg: The automaton under construction, holding the registered
+ *             states
+ *     - states_cap: The capacity of the per state arrays of `dawg`
+ *     - edges_cap: The capacity of the per transition arrays of `dawg`
+ *     - path: The states on the path of the last keyword added
+ *     - path_cap: The capacity of `path`
+ *     - last: The last keyword added
+ *     - last_len: The length of the last keyword
+ *     - buckets: Open addressing hash table of registered states
+ *     - n_buckets: The number of buckets, a power of two
+ */
+typedef struct DawgBuilder {
+    Dawg* dawg;
+    size_t states_cap;
+    size_t edges_cap;
+    DawgPathState* path;
+    size_t path_cap;
+    char* last;
+    size_t last_len;
+    uint32_t* buckets;
+    size_t n_buckets;
+} DawgBuilder;
+
+/**
+ * Initialize the given builder
+ *
+ * @param  builder The builder to initialize
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dawg_builder_init(DawgBuilder* builder);
+
+/**
+ * Add a keyword to the automaton being built. Keywords must be added in
+ * increasing order, comparing bytes as unsigned with `memcmp`, and a
+ * keyword that is a prefix of another comes first. Adding the last keyword
+ * again has no effect.
+ *
+ * @param  builder The builder to add to
+ * @param  keyword The keyword, which may contain any byte
+ * @param  len     The length of the keyword, at most DAWG_MAX_KEYWORD_LEN
+ *
+ * @return 0 on success, -1 on failure, or if the keyword is out of order
+ */
+int dawg_builder_add(DawgBuilder* builder, const char* keyword, size_t len);
+
+/**
+ * Register the remaining states, and take the finished automaton out of the
+ * builder. The builder is released either way.
+ *
+ * @param  builder The builder to finish
+ *
+ * @return A pointer to a heap allocated DAWG on success, NULL on failure
+ */
+Dawg* dawg_builder_finish(DawgBuilder* builder);
+
+/**
+ * Releases the memory used by the given builder, and the automaton under
+ * construction
+ *
+ * @param builder The builder to deallocate
+ */
+void dawg_builder_free(DawgBuilder* builder);
+
+/**
+ * Create a heap allocated DAWG accepting exactly the given keywords
+ *
+ * @param  keywords   NUL terminated keywords, in the order required by
+ *                    `dawg_builder_add`
+ * @param  n_keywords The number of keywords
+ *
+ * @return A pointer to a heap allocated DAWG on success,
+ *         NULL on failure, or if the keywords are not sorted
+ */
+Dawg* dawg_create(char* const* keywords, size_t n_keywords);
+
+/**
+ * Releases the memory used by the given DAWG
+ *
+ * @param dawg The DAWG to deallocate
+ */
+void dawg_free(Dawg* dawg);
+
+/**
+ * Check whether the whole of the given string is a keyword
+ *
+ * @param  dawg   The DAWG to look in
+ * @param  string The string to look for
+ * @param  len    The length of the string
+ *
+ * @return true if the string is a keyword, false otherwise
+ */
+bool dawg_contains(const Dawg* dawg, const char* string, size_t len);
+
+/**
+ * Count the non-overlapping occurrences of non-empty keywords in the given
+ * string. An occurrence is counted as soon as it ends, and the next may
+ * only start after it.
+ *
+ * @param  dawg   The DAWG to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The number of occurrences found, -1 on failure
+ */
+ssize_t dawg_count(const Dawg* dawg, const char* string, size_t len);
+
+/**
+ * Find the first occurrence of a non-empty keyword in the given string.
+ *
+ * The occurrence that ends first is located, and the longest keyword ending
+ * there is taken. From where it starts, the longest keyword starting there
+ * is then reported.
+ *
+ * @param  dawg   The DAWG to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ * @param  start  Set to the offset of the first byte of the occurrence
+ * @param  end    Set to the offset just past its last byte
+ *
+ * @return 1 if an occurrence was found, 0 if there is none,
+ *         -1 on failure
+ */
+int dawg_find(const Dawg* dawg, const char* string, size_t len,
+              size_t* start, size_t* end);
+
+#endif // REGEX_DAWG_H
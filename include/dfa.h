@@ -0,0 +1,298 @@
+#ifndef REGEX_DFA_H
+#define REGEX_DFA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "nfa.h"
+
+// Every DFA state has one transition for each possible input byte.
+// Bytes the NFA has no transitions for simply lead to the dead state.
+#define DFA_ALPHABET_SIZE 256
+
+// The subset construction can blow up exponentially, so we give up after
+// this many states. Patterns that need more are matched using the NFA.
+// At 1KiB per row, this caps the transition table at 4MiB.
+#define DFA_MAX_STATES 4096
+
+// State 0 always represents the empty set of NFA states.
+// In an anchored DFA, no further input can lead to a match once it is
+// reached. In an unanchored DFA, it is the start state, meaning no match is
+// in progress.
+#define DFA_DEAD_STATE 0
+
+/**
+ * Lists the kinds of DFAs that can be constructed from an NFA
+ *
+ *     - DFA_ANCHORED: Matches must span the whole input.
+ *     - DFA_UNANCHORED: Matches may start at any position. Reaching an
+ *                       accepting state means that a non-empty match ends
+ *                       at the byte just consumed. Where it started is not
+ *                       tracked.
+ */
+typedef enum DFAMode {
+    DFA_ANCHORED,
+    DFA_UNANCHORED,
+} DFAMode;
+
+/**
+ * Represents a Deterministic Finite Automata
+ *
+ * Members
+ *     - n_states: The number of states, including the dead state
+ *     - start_state: The state matching begins in
+ *     - table: Transition table, with DFA_ALPHABET_SIZE entries per state.
+ *              The next state from `s` on byte `c` is
+ *              table[s * DFA_ALPHABET_SIZE + c]
+ *     - is_final: Whether or not each state is an accepting state
+ *     - origin: The number each state had when the DFA was constructed.
+ *               This changes only when the states are renumbered.
+ *     - accepts: For DFAs created by `dfa_create_set`, the parts of the NFA
+ *                accepting in each state, as a bitset of `accept_words`
+ *                words per state. NULL for other DFAs.
+ *     - accept_words: The number of words in each state's bitset
+ */
+typedef struct DFA {
+    size_t n_states;
+    uint32_t start_state;
+    uint32_t* table;
+    bool* is_final;
+    uint32_t* origin;
+    uint64_t* accepts;
+    size_t accept_words;
+} DFA;
+
+/**
+ * Create a heap allocated DFA equivalent to the given NFA, using the
+ * subset construction. The result is minimized.
+ *
+ * @param  nfa  The NFA to convert
+ * @param  mode Whether matches must start at the beginning of the input
+ *
+ * @return A pointer to a heap allocated DFA on success,
+ *         NULL on failure, or if the DFA would need more than
+ *         DFA_MAX_STATES states
+ */
+DFA* dfa_create(NFA* nfa, DFAMode mode);
+
+/**
+ * Create a heap allocated DFA equivalent to the given NFA, like
+ * `dfa_create`, but expanding subsets of NFA states on several threads.
+ * The threads share one hash table of the subsets found so far. The result
+ * is the same as that of `dfa_create`. Whether threads pay for themselves
+ * depends on the machine and the NFA, and `make bench` times both.
+ *
+ * @param  nfa       The NFA to convert
+ * @param  mode      Whether matches must start at the beginning of the input
+ * @param  n_threads The number of threads to use, 0 for one per processor
+ *
+ * @return A pointer to a heap allocated DFA on success,
+ *         NULL on failure, or if the DFA would need more than
+ *         DFA_MAX_STATES states
+ */
+DFA* dfa_create_parallel(NFA* nfa, DFAMode mode, size_t n_threads);
+
+/**
+ * Create a heap allocated anchored DFA for an NFA whose start state has an
+ * epsilon transition to the start of each of several NFAs, and nothing else.
+ * Each state records which of those parts accept in it, so one pass over
+ * the input tells every part matching it. States are only merged when they
+ * agree on the parts accepting in them.
+ *
+ * @param  nfa       The combined NFA to convert
+ * @param  parts     The NFAs combined in `nfa`. Bit i of a state's
+ *                   `accepts` is set when parts[i] accepts in it. Entries
+ *                   may be NULL, leaving their bit unused.
+ * @param  n_parts   The number of parts
+ * @param  n_threads The number of threads to use, as in
+ *                   `dfa_create_parallel`
+ *
+ * @return A pointer to a heap allocated DFA on success,
+ *         NULL on failure, or if the DFA would need more than
+ *         DFA_MAX_STATES states
+ */
+DFA* dfa_create_set(NFA* nfa, NFA* const* parts, size_t n_parts, size_t n_threads);
+
+/**
+ * Merge equivalent states of the given DFA, so it has the fewest states
+ * accepting the same strings. States are renumbered breadth first from the
+ * start state, with the dead state kept at the front.
+ *
+ * @param  dfa The DFA to minimize
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dfa_minimize(DFA* dfa);
+
+/**
+ * Releases the memory used by the given DFA
+ *
+ * @param dfa The DFA to deallocate
+ */
+void dfa_free(DFA* dfa);
+
+/**
+ * Perform a regex match using the given DFA on the given string
+ *
+ * @param  dfa    The DFA to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return true if the whole string is accepted by the DFA, false otherwise
+ */
+bool dfa_match(const DFA* dfa, const char* string, size_t len);
+
+/**
+ * Count the non-overlapping matches in the given string, using an
+ * unanchored DFA. A match is counted as soon as it ends, and the next match
+ * may only start after it.
+ *
+ * @param  dfa    The unanchored DFA to match with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The number of matches found
+ */
+size_t dfa_count(const DFA* dfa, const char* string, size_t len);
+
+/**
+ * Find the end of the first non-empty match in the given string, using an
+ * unanchored DFA.
+ *
+ * @param  dfa    The unanchored DFA to match with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The offset just past the last byte of the match,
+ *         -1 if there is no match or the input is invalid
+ */
+ssize_t dfa_find_end(const DFA* dfa, const char* string, size_t len);
+
+/**
+ * Find the end of the first non-empty match in the given string, using an
+ * unanchored DFA, but give up as soon as no match is in progress. Any match
+ * found starts before that point.
+ *
+ * @param  dfa    The unanchored DFA to match with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ * @param  idle   Set to the offset the DFA gave up at, or to len if it
+ *                reached the end of the string. Untouched on a match.
+ *
+ * @return The offset just past the last byte of the match,
+ *         -1 if there is no match or the input is invalid
+ */
+ssize_t dfa_find_end_until_idle(const DFA* dfa, const char* string, size_t len,
+                                size_t* idle);
+
+/**
+ * Find where the longest non-empty match ending at the given offset starts,
+ * by running an anchored DFA for the reversed pattern backwards.
+ *
+ * @param  reverse The anchored DFA of the reversed pattern
+ * @param  string  The string to search
+ * @param  end     The offset just past the last byte of the match
+ *
+ * @return The offset of the first byte of the match,
+ *         -1 if no match ends there or the input is invalid
+ */
+ssize_t dfa_find_start(const DFA* reverse, const char* string, size_t end);
+
+/**
+ * Find where the longest non-empty match ending at the given offset starts,
+ * like `dfa_find_start`, but without looking at bytes before `min_start`.
+ *
+ * @param  reverse   The anchored DFA of the reversed pattern
+ * @param  string    The string to search
+ * @param  min_start The offset of the first byte that may be looked at
+ * @param  end       The offset just past the last byte of the match
+ * @param  exhausted Set to whether the DFA could still continue when it
+ *                   reached `min_start`, in which case a match may start
+ *                   earlier than the one returned
+ *
+ * @return The offset of the first byte of the longest match starting at or
+ *         after `min_start`, -1 if there is none or the input is invalid
+ */
+ssize_t dfa_find_start_after(const DFA* reverse, const char* string, size_t min_start,
+                             size_t end, bool* exhausted);
+
+/**
+ * Find the length of the longest non-empty match at the start of the given
+ * string, using an anchored DFA.
+ *
+ * @param  dfa    The anchored DFA to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return The length of the match, -1 if there is no match or the input
+ *         is invalid
+ */
+ssize_t dfa_longest_match(const DFA* dfa, const char* string, size_t len);
+
+/**
+ * Check whether every string accepted by one anchored DFA is accepted by
+ * another. The product of the two automata is explored breadth first from
+ * the pair of start states, looking for a pair where `a` accepts and `b`
+ * does not.
+ *
+ * @param  a The DFA whose strings are checked
+ * @param  b The DFA that must accept them
+ *
+ * @return 1 if L(a) is a subset of L(b), 0 if not, -1 on failure
+ */
+int dfa_is_subset(const DFA* a, const DFA* b);
+
+/**
+ * Check whether two anchored DFAs accept the same strings, by exploring
+ * their product for a pair of states where only one of them accepts.
+ *
+ * @param  a The first DFA
+ * @param  b The second DFA
+ *
+ * @return 1 if L(a) equals L(b), 0 if not, -1 on failure
+ */
+int dfa_is_equivalent(const DFA* a, const DFA* b);
+
+/**
+ * Run the given string through the DFA, counting visits to each state. An
+ * anchored DFA stops at the dead state, an unanchored one runs over the
+ * whole string.
+ *
+ * @param  dfa    The DFA to profile
+ * @param  string The sample string
+ * @param  len    The length of the sample string
+ * @param  counts Array of dfa->n_states counters to accumulate visits in
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dfa_profile(const DFA* dfa, const char* string, size_t len, size_t* counts);
+
+/**
+ * Compute a state order with the most visited states first.
+ * The dead state always stays at the front.
+ *
+ * @param  dfa    The DFA the visits were counted on
+ * @param  counts Visits for each state, as filled in by `dfa_profile`
+ * @param  order  Array of dfa->n_states entries to fill. order[i] is the
+ *                number the state placed at position i had when the DFA
+ *                was constructed.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dfa_hot_order(const DFA* dfa, const size_t* counts, size_t* order);
+
+/**
+ * Renumber the states of the DFA, and rearrange the transition table to
+ * match.
+ *
+ * @param  dfa   The DFA to renumber
+ * @param  order The new order of states, as returned by `dfa_hot_order`.
+ *               Must be a permutation of the states that keeps the dead
+ *               state at the front.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int dfa_renumber(DFA* dfa, const size_t* order);
+
+#endif // REGEX_DFA_H
@@ -0,0 +1,95 @@
+#ifndef REGEX_GLUSHKOV_H
+#define REGEX_GLUSHKOV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ast.h"
+
+// Sets of positions are stored in a single word. Bit 0 is the initial state,
+// every other bit is a character of the pattern.
+#define GLUSHKOV_MAX_POSITIONS 63
+
+// Number of rows kept by the approximate matcher, one per number of errors
+#define GLUSHKOV_MAX_ERRORS 15
+
+typedef uint64_t PositionSet;
+
+/**
+ * Represents the Glushkov automaton of a pattern, which has one state for
+ * every character in the pattern (its positions), plus an initial state.
+ * All transitions into a position are on that position's character, which
+ * lets sets of states be advanced with a few bitwise operations.
+ *
+ * Members
+ *     - n_positions: The number of characters in the pattern
+ *     - masks: The positions labelled with each byte
+ *     - follow: follow[p] is the set of positions that may come after
+ *               position `p`. follow[0] are the positions a match may
+ *               start with.
+ *     - accepting: The positions a match may end with, including the
+ *                  initial state if the pattern matches the empty string
+ *     - n_chunks: The number of bytes needed to hold a set of positions
+ *     - step: For every byte `j` of a position set and every value `v` it
+ *             may have, step[j][v] is the union of the follow sets of the
+ *             positions in `v`.
+ */
+typedef struct Glushkov {
+    size_t n_positions;
+    PositionSet masks[256];
+    PositionSet follow[GLUSHKOV_MAX_POSITIONS + 1];
+    PositionSet accepting;
+    size_t n_chunks;
+    PositionSet (*step)[256];
+} Glushkov;
+
+/**
+ * Create the Glushkov automaton for the AST rooted at root
+ *
+ * @param  root The root of the abstract syntax tree
+ *
+ * @return A pointer to a heap allocated Glushkov automaton on success,
+ *         NULL on failure, or if the pattern has more than
+ *         GLUSHKOV_MAX_POSITIONS characters
+ */
+Glushkov* glushkov_create(ASTNode* root);
+
+/**
+ * Releases the memory used by the given Glushkov automaton
+ *
+ * @param glushkov The automaton to deallocate
+ */
+void glushkov_free(Glushkov* glushkov);
+
+/**
+ * Compute every position reachable in one transition from the given set
+ *
+ * @param  glushkov The automaton to step through
+ * @param  states   The set of positions to step from
+ *
+ * @return The union of the follow sets of the given positions
+ */
+PositionSet glushkov_step(const Glushkov* glushkov, PositionSet states);
+
+/**
+ * Test whether the given string matches the pattern with at most
+ * `max_errors` inserted, deleted or substituted characters.
+ *
+ * This is the bit-parallel simulation of Wu and Manber, run over the
+ * positions of the Glushkov automaton. One set of positions is kept for
+ * every number of errors.
+ *
+ * @param  glushkov   The automaton to match with
+ * @param  string     The string to match
+ * @param  len        The length of the string
+ * @param  max_errors The number of errors allowed, at most
+ *                    GLUSHKOV_MAX_ERRORS
+ *
+ * @return true if the string matches within the allowed errors,
+ *         false otherwise or if the input is invalid
+ */
+bool glushkov_match_approx(const Glushkov* glushkov, const char* string,
+                           size_t len, unsigned int max_errors);
+
+#endif // REGEX_GLUSHKOV_H
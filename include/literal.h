@@ -0,0 +1,211 @@
+#ifndef REGEX_LITERAL_H
+#define REGEX_LITERAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "ast.h"
+
+// Sets of literals derived from a pattern are given up on once they grow
+// past this many strings, as scanning for all of them would cost too much
+#define LITERAL_SET_MAX 16
+
+/**
+ * Represents a fixed string of bytes derived from a pattern
+ *
+ * Members
+ *     - bytes: The bytes of the string, not NUL terminated.
+ *              NULL if the string is empty.
+ *     - len: The number of bytes in the string
+ */
+typedef struct Literal {
+    char* bytes;
+    size_t len;
+} Literal;
+
+/**
+ * Represents a collection of literals
+ *
+ * Members
+ *     - literals: The literals in the collection. NULL if it is empty.
+ *     - n: The number of literals in the collection
+ */
+typedef struct LiteralSet {
+    Literal* literals;
+    size_t n;
+} LiteralSet;
+
+/**
+ * Searches for a single literal with the Boyer-Moore-Horspool algorithm
+ *
+ * Members
+ *     - needle: The literal to search for
+ *     - shift: How far the search window may move, given the byte of the
+ *              haystack under the last byte of the window
+ */
+typedef struct Horspool {
+    Literal needle;
+    size_t shift[256];
+} Horspool;
+
+/**
+ * Check whether the AST rooted at root only matches a single string, as it
+ * contains nothing but characters and concatenations
+ *
+ * @param  root The root of the abstract syntax tree
+ *
+ * @return true if the pattern is a plain string, false otherwise
+ */
+bool literal_is_pure(ASTNode* root);
+
+/**
+ * Compute the longest string that every match of the AST rooted at root
+ * starts with.
+ *
+ * @param  root The root of the abstract syntax tree
+ * @param  out  The literal to store the prefix in. The prefix is empty if
+ *              matches may start with different bytes.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int literal_prefix(ASTNode* root, Literal* out);
+
+/**
+ * Compute a set of non-empty strings, one of which every match of the AST
+ * rooted at root starts with.
+ *
+ * @param  root The root of the abstract syntax tree
+ * @param  out  The set to store the distinct strings in. The set is empty
+ *              if there is no such set of at most LITERAL_SET_MAX strings.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int literal_starts(ASTNode* root, LiteralSet* out);
+
+/**
+ * Compute a set of strings, at least one of which appears in every match of
+ * the AST rooted at root.
+ *
+ * @param  root The root of the abstract syntax tree
+ * @param  out  The set to store the distinct strings in. The set is empty
+ *              if there is no such set of at most LITERAL_SET_MAX strings.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int literal_required(ASTNode* root, LiteralSet* out);
+
+/**
+ * Collect the branches of the AST rooted at root, if it is an alternation
+ * of at least two plain strings
+ *
+ * @param  root The root of the abstract syntax tree
+ * @param  out  Set to the strings of the branches, from left to right.
+ *              Empty if the pattern is not an alternation of plain strings.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int literal_branches(ASTNode* root, LiteralSet* out);
+
+/**
+ * Releases the memory used by the given literal
+ *
+ * @param literal The literal to deallocate
+ */
+void literal_free(Literal* literal);
+
+/**
+ * Releases the memory used by the given set of literals, and the literals
+ * in it
+ *
+ * @param set The set to deallocate
+ */
+void literal_set_free(LiteralSet* set);
+
+/**
+ * Add a copy of the given bytes to the set, unless they are in it already
+ *
+ * @param  set   The set to add to
+ * @param  bytes The bytes to add
+ * @param  len   The number of bytes
+ *
+ * @return true on success, false if the set already holds LITERAL_SET_MAX
+ *         literals or memory runs out
+ */
+bool literal_set_add(LiteralSet* set, const char* bytes, size_t len);
+
+/**
+ * Add every literal in one set to another
+ *
+ * @param  to   The set to add to
+ * @param  from The set whose literals are added
+ *
+ * @return true on success, false if `to` grows too large or memory runs out
+ */
+bool literal_set_union(LiteralSet* to, const LiteralSet* from);
+
+/**
+ * Add every literal of `left` followed by every literal of `right` to a set
+ *
+ * @param  out   The set to add the joined literals to
+ * @param  left  The literals to start with
+ * @param  right The literals to end with
+ *
+ * @return true on success, false if `out` grows too large or memory runs
+ *         out
+ */
+bool literal_set_product(LiteralSet* out, const LiteralSet* left, const LiteralSet* right);
+
+/**
+ * Find the first occurrence of the literal in the given string
+ *
+ * @param  literal The literal to search for
+ * @param  string  The string to search
+ * @param  len     The length of the string
+ *
+ * @return The offset of the first occurrence, -1 if there is none
+ */
+ssize_t literal_find(const Literal* literal, const char* string, size_t len);
+
+/**
+ * Find the first occurrence of any literal in the set in the given string
+ *
+ * @param  set    The literals to search for
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The offset of the first occurrence, -1 if there is none or the
+ *         set is empty
+ */
+ssize_t literal_set_find(const LiteralSet* set, const char* string, size_t len);
+
+/**
+ * Create a heap allocated Horspool searcher for the given literal
+ *
+ * @param  needle The literal to search for, which is copied
+ *
+ * @return A pointer to a heap allocated searcher on success,
+ *         NULL on failure or if the literal is empty
+ */
+Horspool* horspool_create(const Literal* needle);
+
+/**
+ * Releases the memory used by the given Horspool searcher
+ *
+ * @param horspool The searcher to deallocate
+ */
+void horspool_free(Horspool* horspool);
+
+/**
+ * Find the first occurrence of the searcher's literal in the given string
+ *
+ * @param  horspool The searcher to search with
+ * @param  string   The string to search
+ * @param  len      The length of the string
+ *
+ * @return The offset of the first occurrence, -1 if there is none or the
+ *         input is invalid
+ */
+ssize_t horspool_find(const Horspool* horspool, const char* string, size_t len);
+
+#endif // REGEX_LITERAL_H
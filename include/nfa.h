@@ -3,10 +3,15 @@
 
 #include "nfa_state.h"
 #include <stdbool.h>
+#include <sys/types.h>
 
+// The states of an NFA built by the converter, and their transitions, all
+// live in its arena. Its arena is empty when the states were made some other
+// way, and they are then found and released one by one.
 typedef struct NFA {
     NFAState* start_state;
     NFAStateList* final_states;
+    NFAArena arena;
 } NFA;
 
 CREATE_LIST_TYPE_FOR(NFAState*, NFAStateSet)
@@ -41,6 +46,16 @@ int nfa_init(NFA* nfa, NFAState* start_state, NFAStateList* final_states);
  */
 void nfa_free(NFA* nfa);
 
+/**
+ * Collect every state reachable from the start state of the given NFA
+ *
+ * @param  nfa The NFA to collect states from
+ *
+ * @return A heap allocated list of states on success, NULL on failure.
+ *         The list (but not the states) must be released by the caller.
+ */
+NFAStateList* nfa_states(NFA* nfa);
+
 /**
  * Perform a regex match using the given NFA on the given string
  * 
@@ -51,4 +66,57 @@ void nfa_free(NFA* nfa);
  */
 bool nfa_match(NFA* nfa, const char* string);
 
+/**
+ * Perform a regex match using the given NFA on the given bytes, which may
+ * include NUL
+ *
+ * @param  nfa    The NFA to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return true if the whole string matches the grammar of the NFA,
+ *         false otherwise
+ */
+bool nfa_match_len(NFA* nfa, const char* string, size_t len);
+
+/**
+ * Find the end of the first non-empty match in the given string.
+ * Matches may start at any position, and the match that ends first is
+ * the one found.
+ *
+ * @param  nfa    The NFA to match with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ *
+ * @return The offset just past the last byte of the match,
+ *         -1 if there is no match or the input is invalid
+ */
+ssize_t nfa_find_end(NFA* nfa, const char* string, size_t len);
+
+/**
+ * Find where the longest non-empty match ending at the given offset starts,
+ * by running the NFA of the reversed pattern backwards.
+ *
+ * @param  reverse The NFA of the reversed pattern
+ * @param  string  The string to search
+ * @param  end     The offset just past the last byte of the match
+ *
+ * @return The offset of the first byte of the match,
+ *         -1 if no match ends there or the input is invalid
+ */
+ssize_t nfa_find_start(NFA* reverse, const char* string, size_t end);
+
+/**
+ * Find the length of the longest non-empty match at the start of the given
+ * string.
+ *
+ * @param  nfa    The NFA to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return The length of the match, -1 if there is no match or the input
+ *         is invalid
+ */
+ssize_t nfa_longest_match(NFA* nfa, const char* string, size_t len);
+
 #endif // REGEX_NFA_H
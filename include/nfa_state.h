@@ -1,6 +1,7 @@
 #ifndef REGEX_STATE_H
 #define REGEX_STATE_H
 
+#include <stddef.h>
 #include <sys/types.h>
 #include <stdbool.h>
 
@@ -21,6 +22,7 @@
 #define MAX_N_TRANSITIONS 96
 
 typedef struct NFAStateList NFAStateList;
+typedef struct NFAArenaBlock NFAArenaBlock;
 
 /**
  * Represents a state in the NFA
@@ -34,7 +36,6 @@ typedef struct NFAState {
     unsigned long long int ID;
     bool is_final;
     bool should_free;
-    bool visited;
     NFAStateList* transitions[MAX_N_TRANSITIONS];
 } NFAState;
 
@@ -48,6 +49,23 @@ typedef struct NFAState {
  */
 CREATE_LIST_TYPE_FOR(NFAState*, NFAStateList)
 
+/**
+ * Memory the states of one NFA and their transitions are taken from, so
+ * that they are laid out next to each other and released all at once.
+ * Memory comes in blocks, each twice the size of the one before, and
+ * nothing is given back before the whole arena is.
+ *
+ * Members
+ *    - blocks: The newest block, which links to the ones before it
+ *    - used: The number of bytes taken from the newest block
+ *    - n_states: The number of states created in the arena
+ */
+typedef struct NFAArena {
+    NFAArenaBlock* blocks;
+    size_t used;
+    size_t n_states;
+} NFAArena;
+
 /**
  * Create and initialize a heap allocated NFA State
  *
@@ -98,6 +116,49 @@ void state_ptr_free(NFAState** state);
  */
 int add_transition(NFAState* from, NFAState* to, char on);
 
+/**
+ * Initialize the given arena, which holds nothing yet
+ *
+ * @param  arena The arena to initialize
+ *
+ * @return 0 on success, -1 on failure
+ */
+int nfa_arena_init(NFAArena* arena);
+
+/**
+ * Release the memory used by the given arena, and so every state and
+ * transition in it
+ *
+ * @param arena The arena to deallocate
+ */
+void nfa_arena_free(NFAArena* arena);
+
+/**
+ * Create and initialize an NFA State in the given arena. The state lives
+ * as long as the arena, and must not be passed to state_free.
+ *
+ * @param  arena    The arena to take the state from
+ * @param  is_final true means the state is an accepting state, false otherwise
+ *
+ * @return A pointer to the state on success, NULL on failure
+ */
+NFAState* arena_state_create(NFAArena* arena, bool is_final);
+
+/**
+ * Add a link between the `from` state and the `to` state for the `on`
+ * character, taking the memory for it from the given arena. Transitions
+ * of a state must either all come from add_transition, or all from the
+ * arena.
+ *
+ * @param  arena The arena to take the memory from
+ * @param  from  State to transition from
+ * @param  to    State to transition to
+ * @param  on    The character on which to transition
+ *
+ * @return The number of transitions on `on` on success, -1 on failure
+ */
+int arena_add_transition(NFAArena* arena, NFAState* from, NFAState* to, char on);
+
 /**
  * Get the transition for the `on` character for the given NFA State
  *
@@ -0,0 +1,83 @@
+#ifndef REGEX_PERFECT_HASH_H
+#define REGEX_PERFECT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "literal.h"
+
+// Keys are hashed into buckets of about this many, which are placed one
+// bucket at a time. Larger buckets need less memory but are harder to place.
+#define PERFECT_HASH_BUCKET_SIZE 4
+
+// The construction gives up after trying this many seeds for the hash
+#define PERFECT_HASH_MAX_SEEDS 16
+
+/**
+ * Represents a minimal perfect hash of a set of strings, built with the
+ * hash and displace method of CHD (Belazzougui, Botelho and Dietzfelbinger).
+ * There is one slot for each distinct key. A key's hash picks its bucket,
+ * and the displacements of the bucket move its keys to slots no other key
+ * has. Buckets are placed largest first, while most slots are free, by
+ * mixing a pilot into the hash of their keys as in PTHash. Buckets of one
+ * key come last, and are offset straight to a free slot. A lookup hashes
+ * the string once, and compares it with the one key in the slot it leads
+ * to.
+ *
+ * The keys are stored one after another in slot order, with the key in
+ * slot `s` from offsets[s] up to offsets[s + 1].
+ *
+ * Members
+ *     - n_slots: The number of distinct keys, one in each slot
+ *     - n_buckets: The number of buckets
+ *     - seed: The seed of the hash, for which every bucket could be placed
+ *     - displacements: The pilot and the offset of every bucket, at
+ *                      displacements[2 * b] and displacements[2 * b + 1]
+ *     - offsets: Where the key in every slot starts in `bytes`, with one
+ *                extra entry at the end
+ *     - bytes: The keys, one after another
+ *     - values: The index of the first key given that is equal to the key
+ *               in every slot
+ */
+typedef struct PerfectHash {
+    size_t n_slots;
+    size_t n_buckets;
+    uint64_t seed;
+    uint32_t* displacements;
+    size_t* offsets;
+    char* bytes;
+    uint32_t* values;
+} PerfectHash;
+
+/**
+ * Create a heap allocated minimal perfect hash of the given keys. Keys
+ * equal to an earlier one share its slot.
+ *
+ * @param  keys The keys to hash, which may contain any byte
+ *
+ * @return A pointer to a heap allocated perfect hash on success,
+ *         NULL on failure, or if there are no keys
+ */
+PerfectHash* perfect_hash_create(const LiteralSet* keys);
+
+/**
+ * Releases the memory used by the given perfect hash
+ *
+ * @param hash The perfect hash to deallocate
+ */
+void perfect_hash_free(PerfectHash* hash);
+
+/**
+ * Find which key the whole of the given string is equal to
+ *
+ * @param  hash   The perfect hash to look in
+ * @param  string The string to look for
+ * @param  len    The length of the string
+ *
+ * @return The index of the first key equal to the string,
+ *         -1 if there is none or the input is invalid
+ */
+ssize_t perfect_hash_lookup(const PerfectHash* hash, const char* string, size_t len);
+
+#endif // REGEX_PERFECT_HASH_H
@@ -1,6 +1,11 @@
 #ifndef REGEX_PORTABILITY_H
 #define REGEX_PORTABILITY_H
 
+// Needed for memmem with glibc. Must come before any system header.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -14,6 +19,8 @@ int n_processors_online();
     #define WIN32_LEAN_AND_MEAN
     #include <windows.h>
     char* strdup(const char* source);
+    void* memmem(const void* haystack, size_t haystack_len,
+                 const void* needle, size_t needle_len);
 
 #elif __unix__ // all unices not caught above
     #include <unistd.h>
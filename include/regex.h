@@ -1,31 +1,176 @@
 #ifndef REGEX_MAIN_H
 #define REGEX_MAIN_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <sys/types.h>
 
+#include "aho_corasick.h"
 #include "ast.h"
+#include "byte_set.h"
 #include "converter.h"
+#include "dawg.h"
+#include "dfa.h"
+#include "glushkov.h"
 #include "lexer.h"
+#include "literal.h"
 #include "nfa.h"
 #include "nfa_state.h"
 #include "parser.h"
+#include "perfect_hash.h"
+#include "regex_set.h"
+#include "shuffle.h"
+#include "teddy.h"
 #include "token.h"
 
+// Searches skip to the bytes that may start a match when there are at most
+// this many of them, otherwise checking every byte costs as much as matching
+#define REGEX_MAX_SKIP_BYTES 32
+
+// Batches of inputs are matched in blocks of this many against one regex at
+// a time, so its automaton stays in cache across the block
+#define REGEX_MATRIX_BLOCK 256
+
+// Bits of `Regex.built`, for the automata that are only built by the first
+// call needing them
+#define REGEX_BUILT_SEARCH 0x1
+#define REGEX_BUILT_REVERSE 0x2
+#define REGEX_BUILT_GLUSHKOV 0x4
+
 /**
  * Represents a Regex pattern
  *
  * Members
  *     - nfa: The internal Non-deterministic finite automata.
- *            This field is NULL until the regex is compiled.
+ *            This field is NULL until the regex is compiled, and stays NULL
+ *            for patterns that are plain strings or alternations of them,
+ *            along with every other automaton except `glushkov`.
+ *     - dfa: A Deterministic finite automata equivalent to the `nfa`, used
+ *            for matching when available. This field is NULL if the regex
+ *            is not compiled, or if the pattern needs too many states.
+ *     - search_dfa: An unanchored DFA equivalent to the `nfa`, used to find
+ *                   where matches end when searching. It is built by the
+ *                   first search, so regexes only ever matched against
+ *                   whole inputs never pay for it. This field is NULL until
+ *                   then, or if the pattern needs too many states.
+ *     - reverse_nfa: An NFA for the reversed pattern, used to find where
+ *                    matches start. This field is only set when the pattern
+ *                    needs too many states for `reverse_dfa`.
+ *     - reverse_dfa: An anchored DFA for the reversed pattern, used to find
+ *                    where matches start by scanning backwards from where
+ *                    they end. Like `search_dfa`, it is built by the first
+ *                    search needing it, and is NULL until then, or if the
+ *                    pattern needs too many states.
+ *     - shuffle: A shuffle mask encoding of the `dfa`, used for matching
+ *                when the `dfa` has at most SHUFFLE_MAX_STATES states.
+ *                This field is NULL otherwise.
+ *     - glushkov: The position automaton of the pattern, used for
+ *                 approximate matching. It is built by the first call to
+ *                 `regex_match_approx`, and is NULL until then, or if the
+ *                 pattern has more than GLUSHKOV_MAX_POSITIONS characters.
+ *     - ast: The AST of the pattern, kept to build the automata that are
+ *            only built when first needed. NULL if the regex is not
+ *            compiled, or if it is a dictionary.
+ *     - prefix: The longest string every match starts with. Searches only
+ *               run the automaton from where it occurs. Empty if the regex
+ *               is not compiled, or if there is no such string.
+ *     - suffix: The longest string every match ends with. Whole inputs not
+ *               ending with it are rejected without running any automaton.
+ *               Empty if the regex is not compiled, or if there is no such
+ *               string.
+ *     - first_bytes: The bytes non-empty matches may start with. Whole
+ *                    inputs starting with another byte are rejected, and
+ *                    searches skip to these bytes when there are at most
+ *                    REGEX_MAX_SKIP_BYTES of them. Empty if the regex is not
+ *                    compiled, or if the pattern is made of plain strings.
+ *     - last_bytes: The bytes non-empty matches may end with. Whole inputs
+ *                   ending with another byte are rejected. Empty if the
+ *                   regex is not compiled, or if the pattern is made of
+ *                   plain strings.
+ *     - required: Strings at least one of which appears in every match.
+ *                 Inputs containing none of them are rejected without
+ *                 running any automaton. Empty if the regex is not
+ *                 compiled, or if there is no small enough set of them.
+ *     - start_scanner: A vectorized scanner for a few strings every match
+ *                      starts with, used like `prefix` when there is no
+ *                      single one. NULL otherwise.
+ *     - required_scanner: A vectorized scanner for the `required` strings,
+ *                         used when there are at least two. NULL otherwise.
+ *     - literal: A searcher for the pattern, used instead of any automaton
+ *                if the pattern is a plain string. NULL otherwise.
+ *     - keywords: An Aho-Corasick automaton for the branches, used instead
+ *                 of any other automaton if the pattern is an alternation of
+ *                 plain strings. NULL otherwise.
+ *     - exact: A minimal perfect hash of the branches, used instead of
+ *              `keywords` to match whole inputs, with one hash and one
+ *              comparison. NULL if `keywords` is, or if no perfect hash
+ *              could be found.
+ *     - dictionary: A minimal automaton for a list of keywords, used
+ *                   instead of any other automaton if the regex was
+ *                   compiled with `regex_compile_dictionary`. NULL
+ *                   otherwise.
+ *     - min_len: The length of the shortest match. Shorter inputs are
+ *                rejected, and searches stop once fewer bytes are left.
+ *     - max_len: The length of the longest match, or AST_UNBOUNDED if the
+ *                pattern repeats. Longer inputs are rejected when matching
+ *                the whole input.
+ *     - built: The REGEX_BUILT_* bits of the automata that were built, or
+ *              could not be. Several threads may search with one regex at
+ *              once, and each builds what is missing, with only the first
+ *              to finish keeping its automaton.
  *     - is_compiled: Whether or not the regex has been compiled.
  *     - pattern: The regex pattern that was compiled to create the `nfa`.
+ *                NULL for dictionaries.
  */
 typedef struct Regex {
     NFA* nfa;
+    DFA* dfa;
+    DFA* _Atomic search_dfa;
+    NFA* _Atomic reverse_nfa;
+    DFA* _Atomic reverse_dfa;
+    ShuffleDFA* shuffle;
+    Glushkov* _Atomic glushkov;
+    ASTNode* ast;
+    Literal prefix;
+    Literal suffix;
+    ByteSet first_bytes;
+    ByteSet last_bytes;
+    LiteralSet required;
+    Teddy* start_scanner;
+    Teddy* required_scanner;
+    Horspool* literal;
+    AhoCorasick* keywords;
+    PerfectHash* exact;
+    Dawg* dictionary;
+    size_t min_len;
+    size_t max_len;
+    _Atomic unsigned int built;
     bool is_compiled;
     char* pattern;
 } Regex;
 
+/**
+ * A region of a buffer, as returned by `regex_split`
+ *
+ * Members
+ *     - offset: The offset of the first byte of the region
+ *     - length: The number of bytes in the region
+ */
+typedef struct RegexSlice {
+    size_t offset;
+    size_t length;
+} RegexSlice;
+
+/**
+ * Callback receiving the fields found by `regex_split_each`
+ *
+ * @param  slice The field that was found
+ * @param  ctx   The context pointer given to `regex_split_each`
+ *
+ * @return 0 to continue splitting, non-zero to stop
+ */
+typedef int (*regex_slice_cb)(RegexSlice slice, void* ctx);
+
 /**
  * Create a heap allocated and initialized regex buffer.
  *
@@ -57,6 +202,84 @@ int regex_init(Regex* regex_buf, char* pattern);
  */
 int regex_compile(Regex* regex_buf, char* pattern);
 
+/**
+ * Compile many patterns at once, spreading them across several threads.
+ * Threads take the next few patterns as they finish, so a few expensive
+ * patterns do not hold back the rest.
+ *
+ * @param  patterns   The patterns to compile, which must stay valid for as
+ *                    long as the regexes are used
+ * @param  n_patterns The number of patterns
+ * @param  regexes    Array of n_patterns entries to fill, in the order of
+ *                    the patterns. regexes[i] is set to a heap allocated
+ *                    regex for patterns[i], or to NULL if it is invalid.
+ * @param  n_threads  The number of threads to use, or 0 to use one for
+ *                    each processor. `make bench` times the speedup of each
+ *                    thread count on the machine it runs on.
+ *
+ * @return The number of patterns that could not be compiled on success,
+ *         -1 on failure
+ */
+ssize_t regex_compile_all(char* const* patterns, size_t n_patterns, Regex** regexes,
+                          size_t n_threads);
+
+/**
+ * Compile a regex matching exactly the keywords of the given dictionary,
+ * as if it were the alternation of all of them. Building the dictionary
+ * with `dawg_create` or a `DawgBuilder` avoids parsing the alternation,
+ * which is impractical for millions of keywords. Searches only find
+ * non-empty keywords.
+ *
+ * @param  regex_buf  A pointer to the a regex buffer
+ * @param  dictionary A heap allocated DAWG of the keywords. The regex takes
+ *                    ownership of it on success.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int regex_compile_dictionary(Regex* regex_buf, Dawg* dictionary);
+
+/**
+ * Compile a given regex pattern, laying out its automata in the given
+ * state order.
+ *
+ * @param  regex_buf  A pointer to the a regex buffer
+ * @param  pattern    The regex pattern
+ * @param  order      A state order previously returned by `regex_profile`
+ *                    for the same pattern. Can be NULL to use the default
+ *                    order. An order of only the anchored automaton leaves
+ *                    the search automaton as it is.
+ * @param  order_size The number of entries in `order`
+ *
+ * @return 0 on success, -1 on failure or if the order does not fit the
+ *         compiled automata, 1 if the pattern is already compiled
+ */
+int regex_compile_with_order(Regex* regex_buf, char* pattern,
+                             const size_t* order, size_t order_size);
+
+/**
+ * Run a sample corpus through the given regex, and renumber the states of its
+ * automata so the most visited states sit together at the front of their
+ * transition tables. Both the anchored automaton used to match whole inputs
+ * and the unanchored one searches run are profiled, and the shuffle masks
+ * are rebuilt from the renumbered anchored automaton.
+ *
+ * @param  regex_buf  The compiled regex to profile
+ * @param  samples    The sample strings to run through the regex
+ * @param  n_samples  The number of sample strings
+ * @param  order_buf  Buffer to store the resulting state order in, which can
+ *                    later be passed to `regex_compile_with_order`.
+ *                    Can be NULL if the order need not be saved.
+ * @param  order_size The size of the `order_buf` array. The buffer is only
+ *                    filled if it can hold the whole order.
+ *
+ * @return The number of states in the order on success, 0 if the regex has
+ *         no transition table to reorder, -1 on failure. The order lists
+ *         the states of the anchored automaton, followed by those of the
+ *         search automaton if there is one.
+ */
+ssize_t regex_profile(Regex* regex_buf, char** samples, size_t n_samples,
+                      size_t* order_buf, size_t order_size);
+
 /**
  * Test whether the given string matches the given regex.
  *
@@ -68,6 +291,185 @@ int regex_compile(Regex* regex_buf, char* pattern);
  */
 bool regex_match(Regex* regex_buf, char* string);
 
+/**
+ * Find which branch of the given regex the whole string matches, for
+ * patterns that are alternations of plain strings.
+ *
+ * @param  regex_buf  The regex buffer to match with
+ * @param  string     The string to match
+ *
+ * @return The index of the first branch equal to the string, counting from
+ *         the left. -1 if there is none, the input is invalid, or the
+ *         pattern is not an alternation of plain strings.
+ */
+ssize_t regex_match_branch(Regex* regex_buf, char* string);
+
+/**
+ * Test whether the given string matches the given regex with at most
+ * `max_errors` inserted, deleted or substituted characters.
+ *
+ * @param  regex_buf  The regex buffer to match with
+ * @param  string     The string to match
+ * @param  max_errors The number of errors allowed, at most
+ *                    GLUSHKOV_MAX_ERRORS
+ *
+ * @return 1 if the string matches within the allowed errors, 0 if it
+ *         doesn't, -1 if the input is invalid or the pattern has more than
+ *         GLUSHKOV_MAX_POSITIONS characters
+ */
+int regex_match_approx(const Regex* regex_buf, const char* string,
+                       unsigned int max_errors);
+
+/**
+ * Count the non-overlapping occurrences of the given regex in a buffer.
+ *
+ * Matches are counted as soon as they end, and the next match may only start
+ * after the previous one ends. For example, "a+" occurs 3 times in "aaa".
+ * Empty matches are not counted. This only needs an automaton telling where
+ * matches end, but differs from `regex_replace` and `regex_split`, which
+ * extend every match as far as it goes and see a single "a+" in "aaa".
+ *
+ * @param  regex_buf The regex to search for
+ * @param  data      The buffer to search
+ * @param  len       The length of the buffer
+ *
+ * @return The number of matches on success, -1 on failure
+ */
+ssize_t regex_count(const Regex* regex_buf, const void* data, size_t len);
+
+/**
+ * Replace every occurrence of the given regex in a buffer, writing the result
+ * into a caller provided buffer in a single left to right pass.
+ *
+ * The match that ends first is located, and extended to start as early as
+ * possible. From that start, it is extended to end as late as possible, so
+ * "a+" replaces "aaa" in one piece. The search then continues after it.
+ * Empty matches are not replaced. `regex_count` stops at the first end of
+ * every match instead, so it may count more matches than are replaced.
+ *
+ * @param  regex_buf The regex to search for
+ * @param  in        The buffer to search
+ * @param  in_len    The length of the input buffer
+ * @param  repl      The replacement text, inserted literally
+ * @param  out_buf   The buffer to write the result into. The result is not
+ *                   NUL-terminated. Can be NULL if `out_cap` is 0.
+ * @param  out_cap   The capacity of the output buffer
+ * @param  out_len   Set to the length of the whole result, even if it did
+ *                   not fit in the output buffer
+ *
+ * @return 0 on success, 1 if the result did not fit (the output buffer holds
+ *         its first `out_cap` bytes, and `out_len` the size needed),
+ *         -1 on failure
+ */
+int regex_replace(const Regex* regex_buf, const void* in, size_t in_len,
+                  const char* repl, char* out_buf, size_t out_cap, size_t* out_len);
+
+/**
+ * Split a buffer into fields separated by occurrences of the given regex.
+ * Fields are reported as slices of the original buffer, nothing is copied.
+ *
+ * Separators are found the same way as matches in `regex_replace`.
+ * A buffer with `n` separators has `n + 1` fields, some of which may be
+ * empty.
+ *
+ * @param  regex_buf  The regex matching the separators
+ * @param  in         The buffer to split
+ * @param  in_len     The length of the buffer
+ * @param  slices     The array to store the fields in.
+ *                    Can be NULL if `max_slices` is 0.
+ * @param  max_slices The size of the `slices` array. Fields after the first
+ *                    `max_slices` are counted but not stored.
+ *
+ * @return The number of fields in the buffer on success, -1 on failure
+ */
+ssize_t regex_split(const Regex* regex_buf, const void* in, size_t in_len,
+                    RegexSlice* slices, size_t max_slices);
+
+/**
+ * Split a buffer into fields separated by occurrences of the given regex,
+ * passing every field to a callback as soon as it is found.
+ *
+ * @param  regex_buf The regex matching the separators
+ * @param  in        The buffer to split
+ * @param  in_len    The length of the buffer
+ * @param  cb        The callback to receive each field
+ * @param  ctx       A context pointer passed through to the callback
+ *
+ * @return The number of fields passed to the callback on success,
+ *         -1 on failure
+ */
+ssize_t regex_split_each(const Regex* regex_buf, const void* in, size_t in_len,
+                         regex_slice_cb cb, void* ctx);
+
+/**
+ * Match every input of a batch against every regex, and record the results
+ * in a bit matrix. The work is split into tiles of REGEX_MATRIX_BLOCK
+ * inputs by 64 regexes, which are spread across several threads.
+ *
+ * @param  regexes   The compiled regexes. NULL entries match nothing.
+ * @param  n_regexes The number of regexes
+ * @param  data      The inputs, one after another. Inputs may contain NUL.
+ * @param  offsets   n_inputs + 1 non-decreasing offsets into `data`.
+ *                   Input `i` is the bytes from offsets[i] up to
+ *                   offsets[i + 1].
+ * @param  n_inputs  The number of inputs
+ * @param  matrix    The matrix to fill, with one row of
+ *                   REGEX_SET_WORDS(n_regexes) words per input. Bit `j % 64`
+ *                   of word `j / 64` of row `i` is set if input `i` matches
+ *                   regex `j` as a whole, and cleared otherwise.
+ * @param  n_threads The number of threads to use, or 0 to use one for
+ *                   each processor
+ *
+ * @return 0 on success, -1 on failure
+ */
+int regex_match_matrix(Regex* const* regexes, size_t n_regexes, const char* data,
+                       const size_t* offsets, size_t n_inputs, uint64_t* matrix,
+                       size_t n_threads);
+
+/**
+ * Check whether every string matched by one regex as a whole is matched by
+ * another, using the product of their anchored DFAs. Regexes compiled into
+ * plain string searches are determinized for the comparison.
+ *
+ * @param  a The regex whose strings are checked
+ * @param  b The regex that must match them
+ *
+ * @return 1 if L(a) is a subset of L(b), 0 if not, -1 on failure, or if
+ *         either regex needs more than DFA_MAX_STATES states or was
+ *         compiled from a dictionary
+ */
+int regex_is_subset(const Regex* a, const Regex* b);
+
+/**
+ * Check whether two regexes match exactly the same strings as a whole,
+ * using the product of their anchored DFAs, like `regex_is_subset`.
+ *
+ * @param  a The first regex
+ * @param  b The second regex
+ *
+ * @return 1 if L(a) equals L(b), 0 if not, -1 on failure, or if either
+ *         regex cannot be compared
+ */
+int regex_is_equivalent(const Regex* a, const Regex* b);
+
+/**
+ * Find the regexes of a set that are redundant, because every string they
+ * match is matched by another regex of the set. Of several equivalent
+ * regexes, the first is kept. The regexes kept match the same strings as
+ * the whole set.
+ *
+ * Regexes that `regex_is_subset` cannot compare are always kept.
+ *
+ * @param  regexes   The compiled regexes. NULL entries match nothing, and
+ *                   are never kept.
+ * @param  n_regexes The number of regexes
+ * @param  keep      Array of n_regexes entries to fill. keep[i] is set to
+ *                   whether regex `i` is needed.
+ *
+ * @return The number of regexes kept on success, -1 on failure
+ */
+ssize_t regex_prune(Regex* const* regexes, size_t n_regexes, bool* keep);
+
 /**
  * Release the memory used by the given regex structure
  *
@@ -0,0 +1,152 @@
+#ifndef REGEX_HANDLE_H
+#define REGEX_HANDLE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "regex.h"
+
+// The epoch of a reader outside of any read section
+#define REGEX_HANDLE_QUIESCENT 0
+
+/**
+ * A thread reading through a handle. Each reader thread registers once,
+ * and wraps every batch of matches in `regex_reader_enter` and
+ * `regex_reader_exit`.
+ *
+ * Members
+ *     - epoch: The epoch the reader entered its read section in, or
+ *              REGEX_HANDLE_QUIESCENT outside of one
+ *     - in_use: Whether a thread has registered this reader
+ *     - next: The next reader registered with the handle
+ */
+typedef struct RegexReader {
+    _Atomic uint64_t epoch;
+    atomic_bool in_use;
+    struct RegexReader* next;
+} RegexReader;
+
+/**
+ * A regex that was replaced, and is released once no reader can still be
+ * using it
+ *
+ * Members
+ *     - regex: The replaced regex
+ *     - epoch: The epoch it was replaced in. Readers that entered in a
+ *              later epoch cannot have seen it.
+ *     - next: The next regex waiting to be released
+ */
+typedef struct RegexRetired {
+    Regex* regex;
+    uint64_t epoch;
+    struct RegexRetired* next;
+} RegexRetired;
+
+/**
+ * Holds a compiled regex that can be replaced while other threads match
+ * with it. Readers never block: entering a read section publishes the
+ * current epoch and loads the regex, both single atomic operations.
+ * Writers swap in a new regex atomically, and release the old one once
+ * every reader that could have loaded it has left its read section, using
+ * epoch based reclamation.
+ *
+ * Members
+ *     - current: The regex readers load
+ *     - epoch: The current epoch, advanced by every swap
+ *     - readers: The readers registered with the handle, newest first.
+ *                Readers are only released with the handle.
+ *     - retired: The replaced regexes not released yet, newest first
+ *     - writer: Held by the writer swapping or releasing regexes
+ */
+typedef struct RegexHandle {
+    _Atomic(Regex*) current;
+    _Atomic uint64_t epoch;
+    _Atomic(RegexReader*) readers;
+    RegexRetired* retired;
+    atomic_flag writer;
+} RegexHandle;
+
+/**
+ * Initialize the given handle
+ *
+ * @param  handle The handle to initialize
+ * @param  regex  A heap allocated regex, owned by the handle from now on.
+ *                May be NULL.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int regex_handle_init(RegexHandle* handle, Regex* regex);
+
+/**
+ * Releases the memory used by the given handle, its regexes and its
+ * readers. No reader may use it anymore.
+ *
+ * @param handle The handle to deallocate
+ */
+void regex_handle_free(RegexHandle* handle);
+
+/**
+ * Register the calling thread as a reader of the handle. Readers given up
+ * with `regex_reader_unregister` are reused.
+ *
+ * @param  handle The handle to read through
+ *
+ * @return A reader for the calling thread on success, NULL on failure
+ */
+RegexReader* regex_reader_register(RegexHandle* handle);
+
+/**
+ * Give up a reader, which must be outside of a read section
+ *
+ * @param reader The reader to give up
+ */
+void regex_reader_unregister(RegexReader* reader);
+
+/**
+ * Enter a read section, and load the current regex. The regex stays valid
+ * until `regex_reader_exit`, even if it is replaced in the meantime. It is
+ * shared with other readers, and must only be matched with.
+ *
+ * @param  handle The handle to read through
+ * @param  reader The reader of the calling thread
+ *
+ * @return The current regex, NULL if there is none or on failure
+ */
+Regex* regex_reader_enter(RegexHandle* handle, RegexReader* reader);
+
+/**
+ * Leave a read section. The regex loaded when entering it must not be used
+ * anymore.
+ *
+ * @param reader The reader of the calling thread
+ */
+void regex_reader_exit(RegexReader* reader);
+
+/**
+ * Replace the regex of the handle. Readers entering from now on see the new
+ * regex, and the old one is released once the readers that may be using it
+ * have left their read sections. Concurrent writers wait for each other,
+ * but never for readers.
+ *
+ * @param  handle The handle to update
+ * @param  regex  A heap allocated regex, owned by the handle from now on.
+ *                May be NULL.
+ *
+ * @return The number of replaced regexes still waiting to be released,
+ *         -1 on failure, in which case the handle is unchanged
+ */
+ssize_t regex_handle_swap(RegexHandle* handle, Regex* regex);
+
+/**
+ * Release the replaced regexes no reader can still be using
+ *
+ * @param  handle The handle to clean up
+ *
+ * @return The number of replaced regexes still waiting to be released,
+ *         -1 on failure
+ */
+ssize_t regex_handle_reclaim(RegexHandle* handle);
+
+#endif // REGEX_HANDLE_H
@@ -0,0 +1,248 @@
+#ifndef REGEX_SET_H
+#define REGEX_SET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "dfa.h"
+#include "literal.h"
+#include "nfa.h"
+#include "perfect_hash.h"
+
+// The number of words in a bitset with one bit for each of `n` patterns
+#define REGEX_SET_WORDS(n) (((n) + 63) / 64)
+
+/**
+ * A transition of the combined NFA on a byte, used when the set is matched
+ * without a DFA
+ *
+ * Members
+ *     - byte: The byte the transition is taken on
+ *     - target: The position of the state it leads to
+ */
+typedef struct RegexSetMove {
+    unsigned char byte;
+    uint32_t target;
+} RegexSetMove;
+
+/**
+ * Represents several patterns compiled into one automaton, which tells every
+ * pattern matching an input in a single pass over it. The patterns are
+ * combined under a new start state with an epsilon transition to each of
+ * them, and their accepting states are tagged with the pattern's id.
+ *
+ * Patterns can be added and removed after the set is created. The states of
+ * every pattern are flattened into their own block of the arrays used to
+ * simulate the combined NFA, so adding a pattern appends a block, and
+ * removing one retires it. The DFA is a cache over the patterns present
+ * when it was built: patterns removed since are masked out of its results,
+ * and patterns added since are simulated next to it. It is only rebuilt,
+ * and retired blocks only dropped, once updates have touched about as many
+ * states as the set has, so an update costs time proportional to the
+ * pattern changed, amortized. When every pattern is a plain string, a
+ * perfect hash of the strings takes the place of the DFA.
+ *
+ * Members
+ *     - nfas: The NFA of every pattern, by id. NULL for unused ids.
+ *     - n_patterns: The number of ids in use, including those of patterns
+ *                   removed since, which may be given to patterns added
+ *                   later
+ *     - patterns_cap: The capacity of the per pattern arrays
+ *     - n_live: The number of patterns in the set
+ *     - free_ids: The ids of removed patterns, to be reused
+ *     - n_free: The number of ids in `free_ids`
+ *     - nfa: The NFAs the `dfa` was built from, combined under one start
+ *            state. Only the start state belongs to it, the rest belong to
+ *            `nfas`.
+ *     - dfa: An anchored DFA for the `nfa`, with the patterns accepting in
+ *            every state. NULL if the patterns need too many states.
+ *     - literals: The string every pattern matches, for patterns that are
+ *                 plain strings. Empty for the other patterns.
+ *     - exact: A minimal perfect hash of the `literals` of the covered
+ *              patterns, used instead of the `dfa` when every pattern is a
+ *              plain string. NULL otherwise.
+ *     - exact_ids: The pattern every key of `exact` was given for
+ *     - exact_next: The next key of `exact` equal to every key,
+ *                   UINT32_MAX for the last of them
+ *     - covered: Bitset of the patterns the `dfa` or `exact` is used for
+ *     - pending: Bitset of the patterns simulated instead, because they
+ *                were added after the `dfa` was built or it could not be
+ *     - churn: The number of states added or removed since the `dfa` was
+ *              last built
+ *     - rebuild_at: The churn at which the `dfa` is rebuilt
+ *     - starts: The position of the start state of every pattern,
+ *               UINT32_MAX for unused ids
+ *     - sizes: The number of states of every pattern
+ *     - n_states: The number of states in the blocks, including retired
+ *                 ones. States are numbered by their position.
+ *     - states_cap: The capacity of the per state arrays
+ *     - retired_states: The number of states in retired blocks
+ *     - tags: The pattern every accepting state belongs to, UINT32_MAX for
+ *             the other states
+ *     - closure_starts: Where the epsilon closure of every state starts in
+ *                       `closures`, with one extra entry at the end
+ *     - closures: The epsilon closures of every state, one after another
+ *     - n_closures: The number of entries in `closures`
+ *     - closures_cap: The capacity of `closures`
+ *     - move_starts: Where the transitions of every state start in `moves`,
+ *                    with one extra entry at the end
+ *     - moves: The transitions of every state on bytes, one after another
+ *     - n_moves: The number of entries in `moves`
+ *     - moves_cap: The capacity of `moves`
+ */
+typedef struct RegexSet {
+    NFA** nfas;
+    size_t n_patterns;
+    size_t patterns_cap;
+    size_t n_live;
+    uint32_t* free_ids;
+    size_t n_free;
+    NFA nfa;
+    DFA* dfa;
+    Literal* literals;
+    PerfectHash* exact;
+    uint32_t* exact_ids;
+    uint32_t* exact_next;
+    uint64_t* covered;
+    uint64_t* pending;
+    size_t churn;
+    size_t rebuild_at;
+    uint32_t* starts;
+    uint32_t* sizes;
+    size_t n_states;
+    size_t states_cap;
+    size_t retired_states;
+    uint32_t* tags;
+    uint32_t* closure_starts;
+    uint32_t* closures;
+    size_t n_closures;
+    size_t closures_cap;
+    uint32_t* move_starts;
+    RegexSetMove* moves;
+    size_t n_moves;
+    size_t moves_cap;
+} RegexSet;
+
+/**
+ * Scratch space for simulating the patterns of a set not covered by its
+ * DFA. Sets are only read while matching, so any number of threads may
+ * match one set at once, each with its own scratch space. It grows to the
+ * largest set it was used with, and is reused from one match to the next.
+ *
+ * Members
+ *     - current: The states reached by the bytes read so far
+ *     - next: The states reached by the next byte
+ *     - seen: Bitset of the states added to `next`, all clear between
+ *             matches
+ *     - capacity: The number of states there is room for
+ */
+typedef struct RegexSetScratch {
+    uint32_t* current;
+    uint32_t* next;
+    uint64_t* seen;
+    size_t capacity;
+} RegexSetScratch;
+
+/**
+ * Create a heap allocated set of the given patterns
+ *
+ * @param  patterns   The patterns to compile. The position of each pattern
+ *                    is its id, and its bit in the sets of patterns
+ *                    matched.
+ * @param  n_patterns The number of patterns
+ *
+ * @return A pointer to a heap allocated set on success,
+ *         NULL on failure, or if any pattern is invalid
+ */
+RegexSet* regex_set_create(char** patterns, size_t n_patterns);
+
+/**
+ * Compile the given patterns into a set
+ *
+ * @param  set        The set to initialize
+ * @param  patterns   The patterns to compile
+ * @param  n_patterns The number of patterns
+ *
+ * @return 0 on success, -1 on failure, or if any pattern is invalid
+ */
+int regex_set_init(RegexSet* set, char** patterns, size_t n_patterns);
+
+/**
+ * Add a pattern to the set
+ *
+ * @param  set     The set to add to
+ * @param  pattern The pattern to add
+ *
+ * @return The id of the pattern on success, which is its bit in the sets of
+ *         patterns matched, -1 on failure, or if the pattern is invalid
+ */
+ssize_t regex_set_add(RegexSet* set, char* pattern);
+
+/**
+ * Remove a pattern from the set. Its id may be given to a pattern added
+ * later.
+ *
+ * @param  set The set to remove from
+ * @param  id  The id of the pattern
+ *
+ * @return 0 on success, -1 if there is no pattern with that id
+ */
+int regex_set_remove(RegexSet* set, size_t id);
+
+/**
+ * Releases the memory used by the given set
+ *
+ * @param set The set to deallocate
+ */
+void regex_set_free(RegexSet* set);
+
+/**
+ * Find every pattern of the set matching the whole of the given string.
+ * Scratch space is allocated for this call alone, which
+ * `regex_set_match_with` avoids.
+ *
+ * @param  set     The set to match with
+ * @param  string  The string to match
+ * @param  len     The length of the string
+ * @param  matched Bitset of REGEX_SET_WORDS(set->n_patterns) words. Bit
+ *                 `i % 64` of word `i / 64` is set if pattern `i` matches,
+ *                 and cleared otherwise.
+ *
+ * @return The number of patterns matching, -1 on failure
+ */
+ssize_t regex_set_match(const RegexSet* set, const char* string, size_t len,
+                        uint64_t* matched);
+
+/**
+ * Find every pattern of the set matching the whole of the given string,
+ * like `regex_set_match`, with the caller's scratch space
+ *
+ * @param  set     The set to match with
+ * @param  scratch Scratch space only used by this thread, initialized with
+ *                 `regex_set_scratch_init`
+ * @param  string  The string to match
+ * @param  len     The length of the string
+ * @param  matched Bitset as in `regex_set_match`
+ *
+ * @return The number of patterns matching, -1 on failure
+ */
+ssize_t regex_set_match_with(const RegexSet* set, RegexSetScratch* scratch, const char* string,
+                             size_t len, uint64_t* matched);
+
+/**
+ * Initialize empty scratch space, which grows as it is used
+ *
+ * @param scratch The scratch space to initialize
+ */
+void regex_set_scratch_init(RegexSetScratch* scratch);
+
+/**
+ * Releases the memory used by the given scratch space
+ *
+ * @param scratch The scratch space to deallocate
+ */
+void regex_set_scratch_free(RegexSetScratch* scratch);
+
+#endif // REGEX_SET_H
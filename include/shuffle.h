@@ -0,0 +1,57 @@
+#ifndef REGEX_SHUFFLE_H
+#define REGEX_SHUFFLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "dfa.h"
+
+// A state fits in one lane of a 16 byte vector
+#define SHUFFLE_MAX_STATES 16
+
+/**
+ * A DFA with at most SHUFFLE_MAX_STATES states, encoded as one byte shuffle
+ * mask per input byte.
+ *
+ * Lane `s` of masks[c] holds the next state from state `s` on byte `c`.
+ * With the current state broadcast to every lane, shuffling masks[c] by
+ * the state vector yields the next state in every lane. This takes a
+ * single PSHUFB per input byte, with no dependent table lookups.
+ *
+ * Members
+ *     - masks: The shuffle mask for every input byte
+ *     - start_state: The state matching begins in
+ *     - accepting: Bit `s` is set if state `s` is an accepting state
+ *     - use_simd: Whether or not the CPU supports the shuffle instruction
+ */
+typedef struct ShuffleDFA {
+    _Alignas(16) uint8_t masks[DFA_ALPHABET_SIZE][SHUFFLE_MAX_STATES];
+    uint8_t start_state;
+    uint16_t accepting;
+    bool use_simd;
+} ShuffleDFA;
+
+/**
+ * Create a heap allocated shuffle encoding of the given DFA
+ *
+ * @param  dfa The DFA to encode
+ *
+ * @return A pointer to a heap allocated ShuffleDFA on success,
+ *         NULL on failure or if the DFA has more than SHUFFLE_MAX_STATES
+ *         states. The result is released with `free`.
+ */
+ShuffleDFA* shuffle_dfa_create(const DFA* dfa);
+
+/**
+ * Perform a regex match using the given shuffle DFA on the given string
+ *
+ * @param  dfa    The shuffle DFA to match with
+ * @param  string The string to match
+ * @param  len    The length of the string
+ *
+ * @return true if the whole string is accepted by the DFA, false otherwise
+ */
+bool shuffle_dfa_match(const ShuffleDFA* dfa, const char* string, size_t len);
+
+#endif // REGEX_SHUFFLE_H
@@ -0,0 +1,78 @@
+#ifndef REGEX_TEDDY_H
+#define REGEX_TEDDY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "literal.h"
+
+// Literals are spread over this many buckets, one bit each in a byte
+#define TEDDY_BUCKETS 8
+
+// Literals are tracked with a bit each in every bucket
+#define TEDDY_MAX_LITERALS 64
+
+// How many leading bytes of the literals are compared with shuffles
+#define TEDDY_MAX_MASK_LEN 3
+
+/**
+ * A multi-literal candidate finder, in the style of the Teddy algorithm.
+ *
+ * Each literal is put in a bucket. For each of the first `mask_len` bytes of
+ * the literals, two 16 byte tables map the low and high nibble of a byte to
+ * the buckets having a literal with that nibble at that position. A byte
+ * shuffle looks up 16 input bytes in a table at once, so the buckets that
+ * may start at each of 16 positions are found with a few instructions.
+ * Candidates are then verified against the literals of their buckets.
+ *
+ * Members
+ *     - lo: For each leading byte, the buckets by low nibble
+ *     - hi: For each leading byte, the buckets by high nibble
+ *     - mask_len: The number of leading bytes compared, at most the length
+ *                 of the shortest literal
+ *     - literals: Copies of the literals searched for
+ *     - buckets: For each bucket, bit `i` is set if literal `i` is in it
+ *     - use_simd: Whether or not the CPU supports the shuffle instruction
+ */
+typedef struct Teddy {
+    _Alignas(16) uint8_t lo[TEDDY_MAX_MASK_LEN][16];
+    _Alignas(16) uint8_t hi[TEDDY_MAX_MASK_LEN][16];
+    size_t mask_len;
+    LiteralSet literals;
+    uint64_t buckets[TEDDY_BUCKETS];
+    bool use_simd;
+} Teddy;
+
+/**
+ * Create a heap allocated Teddy searcher for the given literals
+ *
+ * @param  literals The literals to search for, which are copied
+ *
+ * @return A pointer to a heap allocated searcher on success,
+ *         NULL on failure, or if there are no literals, more than
+ *         TEDDY_MAX_LITERALS, or any of them is empty
+ */
+Teddy* teddy_create(const LiteralSet* literals);
+
+/**
+ * Releases the memory used by the given Teddy searcher
+ *
+ * @param teddy The searcher to deallocate
+ */
+void teddy_free(Teddy* teddy);
+
+/**
+ * Find the first position in the given string where any literal starts
+ *
+ * @param  teddy  The searcher to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ * @param  which  If not NULL, set to the index of a literal found there
+ *
+ * @return The offset of the first occurrence, -1 if there is none or the
+ *         input is invalid
+ */
+ssize_t teddy_find(const Teddy* teddy, const char* string, size_t len, size_t* which);
+
+#endif // REGEX_TEDDY_H
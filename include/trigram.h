@@ -0,0 +1,208 @@
+#ifndef REGEX_TRIGRAM_H
+#define REGEX_TRIGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "ast.h"
+#include "literal.h"
+
+// Trigrams are packed into the low 24 bits of an integer, first byte highest
+#define TRIGRAM_COUNT (1 << 24)
+
+// Identifies index files, and the version of their layout
+#define TRIGRAM_INDEX_MAGIC "RXTI"
+#define TRIGRAM_INDEX_VERSION 1
+
+/**
+ * Lists the types of trigram queries
+ */
+typedef enum TrigramQueryType {
+    // Every document may match
+    TRIGRAM_ALL,
+
+    // Documents must contain all of the trigrams, and match all subqueries
+    TRIGRAM_AND,
+
+    // Documents must contain any of the trigrams, or match any subquery
+    TRIGRAM_OR,
+} TrigramQueryType;
+
+/**
+ * Represents a boolean query over the trigrams of a document. Every document
+ * a pattern matches in satisfies the query planned for the pattern, so only
+ * the documents satisfying it need to be searched.
+ *
+ * Members
+ *     - type: How the trigrams and subqueries are combined
+ *     - trigrams: The trigrams of the query
+ *     - n_trigrams: The number of trigrams
+ *     - subqueries: Heap allocated queries nested in this one
+ *     - n_subqueries: The number of subqueries
+ */
+typedef struct TrigramQuery {
+    TrigramQueryType type;
+    uint32_t* trigrams;
+    size_t n_trigrams;
+    struct TrigramQuery** subqueries;
+    size_t n_subqueries;
+} TrigramQuery;
+
+/**
+ * The start of an index file. The file is laid out so it can be mapped into
+ * memory and used as is, with every section aligned for its entries:
+ *
+ *     header | entries | docs | postings | names
+ *
+ * Members
+ *     - magic: TRIGRAM_INDEX_MAGIC, not NUL terminated
+ *     - version: TRIGRAM_INDEX_VERSION
+ *     - n_docs: The number of documents indexed
+ *     - n_trigrams: The number of distinct trigrams found in them
+ *     - docs_offset: The offset of the document table
+ *     - postings_offset: The offset of the posting lists
+ *     - names_offset: The offset of the document names
+ *     - size: The size of the whole file
+ */
+typedef struct TrigramIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_docs;
+    uint32_t n_trigrams;
+    uint64_t docs_offset;
+    uint64_t postings_offset;
+    uint64_t names_offset;
+    uint64_t size;
+} TrigramIndexHeader;
+
+/**
+ * An entry of the trigram table, which is sorted by trigram
+ *
+ * Members
+ *     - trigram: The trigram
+ *     - n_docs: The number of documents containing it
+ *     - postings: The position of its posting list in the postings, which
+ *                 holds the ids of those documents in increasing order
+ */
+typedef struct TrigramEntry {
+    uint32_t trigram;
+    uint32_t n_docs;
+    uint64_t postings;
+} TrigramEntry;
+
+/**
+ * An entry of the document table, indexed by document id
+ *
+ * Members
+ *     - name: The offset of the NUL terminated name in the names section
+ *     - name_len: The length of the name
+ */
+typedef struct TrigramDoc {
+    uint64_t name;
+    uint64_t name_len;
+} TrigramDoc;
+
+/**
+ * Represents an index file mapped into memory
+ *
+ * Members
+ *     - map: The start of the mapping
+ *     - size: The size of the mapping
+ *     - header: The header of the file
+ *     - entries: The trigram table
+ *     - docs: The document table
+ *     - postings: The posting lists of every trigram, one after another
+ *     - names: The names of the documents
+ */
+typedef struct TrigramIndex {
+    void* map;
+    size_t size;
+    const TrigramIndexHeader* header;
+    const TrigramEntry* entries;
+    const TrigramDoc* docs;
+    const uint32_t* postings;
+    const char* names;
+} TrigramIndex;
+
+/**
+ * Plan the trigram query for the pattern of the given AST.
+ *
+ * The strings each sub-pattern matches exactly are tracked while they are
+ * few enough, along with the strings its matches start and end with.
+ * Trigrams of these, including those spanning concatenated sub-patterns,
+ * become the query.
+ *
+ * @param  root The root of the abstract syntax tree
+ *
+ * @return A pointer to a heap allocated query on success,
+ *         NULL on failure
+ */
+TrigramQuery* trigram_query_create(const ASTNode* root);
+
+/**
+ * Releases the memory used by the given query, and its subqueries
+ *
+ * @param query The query to deallocate
+ */
+void trigram_query_free(TrigramQuery* query);
+
+/**
+ * Build an index of the trigrams in the given files, and write it to a file.
+ * The files are read and their trigrams collected on several threads.
+ *
+ * @param  path      The path to write the index to
+ * @param  files     The paths of the files to index. The position of each
+ *                   file is its document id.
+ * @param  n_files   The number of files
+ * @param  n_threads The number of threads to use, or 0 to use one for
+ *                   each processor
+ *
+ * @return 0 on success, -1 on failure, or if any file cannot be read
+ */
+int trigram_index_build(const char* path, char* const* files, size_t n_files,
+                        size_t n_threads);
+
+/**
+ * Map the index in the given file into memory
+ *
+ * @param  path The path of the index file
+ *
+ * @return A pointer to a heap allocated index on success,
+ *         NULL on failure, or if the file is not a valid index
+ */
+TrigramIndex* trigram_index_open(const char* path);
+
+/**
+ * Unmaps the given index
+ *
+ * @param index The index to release
+ */
+void trigram_index_free(TrigramIndex* index);
+
+/**
+ * Find the documents that satisfy the given query
+ *
+ * @param  index The index to look in
+ * @param  query The query to evaluate
+ * @param  docs  Set to a heap allocated array of the ids of the documents,
+ *               in increasing order, which the caller frees
+ *
+ * @return The number of documents found, -1 on failure
+ */
+ssize_t trigram_index_candidates(const TrigramIndex* index, const TrigramQuery* query,
+                                 uint32_t** docs);
+
+/**
+ * Get the name of a document in the index
+ *
+ * @param  index The index to look in
+ * @param  doc   The id of the document
+ *
+ * @return The NUL terminated name of the document, NULL if there is no
+ *         such document
+ */
+const char* trigram_index_doc_name(const TrigramIndex* index, uint32_t doc);
+
+#endif // REGEX_TRIGRAM_H
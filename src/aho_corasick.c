@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "aho_corasick.h"
+
+// Marks trie edges that have not been added yet
+#define NO_STATE UINT32_MAX
+
+// Create a heap allocated Aho-Corasick automaton for the given literals
+AhoCorasick* aho_corasick_create(const LiteralSet* literals) {
+    if (literals == NULL || literals->n == 0) {
+        return NULL;
+    }
+
+    // Every byte that appears in a literal gets its own class
+    AhoCorasick* ac = calloc(1, sizeof(AhoCorasick));
+    if (ac == NULL) {
+        return NULL;
+    }
+
+    size_t max_states = 1;
+    ac->n_classes = 1;
+
+    for (size_t i = 0; i < literals->n; i++) {
+        const Literal* literal = &literals->literals[i];
+        if (literal->len == 0) {
+            free(ac);
+            return NULL;
+        }
+
+        max_states += literal->len;
+        for (size_t j = 0; j < literal->len; j++) {
+            unsigned char c = literal->bytes[j];
+            if (ac->classes[c] == 0) {
+                ac->classes[c] = ac->n_classes++;
+            }
+        }
+    }
+
+    size_t n_classes = ac->n_classes;
+    ac->table = malloc(sizeof(uint32_t) * max_states * n_classes);
+    ac->depth = malloc(sizeof(uint32_t) * max_states);
+    ac->branch = malloc(sizeof(int32_t) * max_states);
+    ac->out_len = malloc(sizeof(uint32_t) * max_states);
+    uint32_t* fail = malloc(sizeof(uint32_t) * max_states);
+    uint32_t* queue = malloc(sizeof(uint32_t) * max_states);
+
+    if (ac->table == NULL || ac->depth == NULL || ac->branch == NULL
+        || ac->out_len == NULL || fail == NULL || queue == NULL) {
+        free(fail);
+        free(queue);
+        aho_corasick_free(ac);
+        free(ac);
+        return NULL;
+    }
+
+    // Build the trie
+    for (size_t i = 0; i < max_states * n_classes; i++) {
+        ac->table[i] = NO_STATE;
+    }
+
+    ac->n_states = 1;
+    ac->depth[AHO_CORASICK_ROOT] = 0;
+    ac->branch[AHO_CORASICK_ROOT] = -1;
+
+    for (size_t i = 0; i < literals->n; i++) {
+        const Literal* literal = &literals->literals[i];
+        uint32_t state = AHO_CORASICK_ROOT;
+
+        for (size_t j = 0; j < literal->len; j++) {
+            uint32_t* next = &ac->table[state * n_classes + ac->classes[(unsigned char) literal->bytes[j]]];
+
+            if (*next == NO_STATE) {
+                *next = ac->n_states++;
+                ac->depth[*next] = j + 1;
+                ac->branch[*next] = -1;
+            }
+
+            state = *next;
+        }
+
+        // Earlier branches win over later copies of the same literal
+        if (ac->branch[state] < 0) {
+            ac->branch[state] = i;
+        }
+    }
+
+    // Fill in the missing edges breadth first, by following failure links.
+    // The failure link of a state is the state for the longest proper
+    // suffix of its prefix, which is always shallower.
+    size_t head = 0, tail = 0;
+    queue[tail++] = AHO_CORASICK_ROOT;
+    fail[AHO_CORASICK_ROOT] = AHO_CORASICK_ROOT;
+    ac->out_len[AHO_CORASICK_ROOT] = 0;
+
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        uint32_t* row = &ac->table[state * n_classes];
+        const uint32_t* fail_row = &ac->table[fail[state] * n_classes];
+
+        for (size_t k = 0; k < n_classes; k++) {
+            if (row[k] == NO_STATE) {
+                row[k] = state == AHO_CORASICK_ROOT ? AHO_CORASICK_ROOT : fail_row[k];
+                continue;
+            }
+
+            uint32_t child = row[k];
+            fail[child] = state == AHO_CORASICK_ROOT ? AHO_CORASICK_ROOT : fail_row[k];
+            ac->out_len[child] = ac->branch[child] >= 0
+                ? ac->depth[child]
+                : ac->out_len[fail[child]];
+            queue[tail++] = child;
+        }
+    }
+
+    free(fail);
+    free(queue);
+
+    return ac;
+}
+
+// Releases the memory used by the given Aho-Corasick automaton
+void aho_corasick_free(AhoCorasick* ac) {
+    if (ac == NULL) {
+        return;
+    }
+
+    free(ac->table);
+    free(ac->depth);
+    free(ac->branch);
+    free(ac->out_len);
+
+    ac->table = NULL;
+    ac->depth = NULL;
+    ac->branch = NULL;
+    ac->out_len = NULL;
+}
+
+// Transition from the given state on the given byte
+static inline uint32_t step(const AhoCorasick* ac, uint32_t state, unsigned char c) {
+    return ac->table[state * ac->n_classes + ac->classes[c]];
+}
+
+// Find which literal the whole of the given string is equal to
+ssize_t aho_corasick_match(const AhoCorasick* ac, const char* string, size_t len) {
+    if (ac == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    uint32_t state = AHO_CORASICK_ROOT;
+
+    for (size_t i = 0; i < len; i++) {
+        state = step(ac, state, bytes[i]);
+
+        // Falling off the trie means no literal starts with the string
+        if (ac->depth[state] != i + 1) {
+            return -1;
+        }
+    }
+
+    return ac->branch[state];
+}
+
+// Count the non-overlapping occurrences of the literals
+size_t aho_corasick_count(const AhoCorasick* ac, const char* string, size_t len) {
+    if (ac == NULL || string == NULL) {
+        return 0;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    uint32_t state = AHO_CORASICK_ROOT;
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        state = step(ac, state, bytes[i]);
+
+        if (ac->out_len[state] > 0) {
+            count++;
+            state = AHO_CORASICK_ROOT;
+        }
+    }
+
+    return count;
+}
+
+// Find the first occurrence of any literal
+ssize_t aho_corasick_find(const AhoCorasick* ac, const char* string, size_t len,
+                          size_t* start, size_t* end) {
+    if (ac == NULL || string == NULL || start == NULL || end == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    uint32_t state = AHO_CORASICK_ROOT;
+    size_t i = 0;
+
+    while (i < len) {
+        state = step(ac, state, bytes[i++]);
+        if (ac->out_len[state] > 0) {
+            break;
+        }
+    }
+
+    if (ac->out_len[state] == 0) {
+        return -1;
+    }
+
+    // Extend to the longest literal starting at the same place
+    size_t from = i - ac->out_len[state];
+    ssize_t branch = -1;
+
+    state = AHO_CORASICK_ROOT;
+    for (size_t j = from; j < len; j++) {
+        state = step(ac, state, bytes[j]);
+        if (ac->depth[state] != j - from + 1) {
+            break;
+        }
+
+        if (ac->branch[state] >= 0) {
+            branch = ac->branch[state];
+            *end = j + 1;
+        }
+    }
+
+    *start = from;
+    return branch;
+}
@@ -62,6 +62,115 @@ void ast_node_free(ASTNode* node) {
     free(node);
 }
 
+// Mirror the AST, so it matches the reverse of the strings it used to match
+void ast_reverse(ASTNode* node) {
+    if (node == NULL || node->type == CHAR_NODE) {
+        return;
+    }
+
+    ast_reverse(node->child1);
+
+    if (node->type == OR_NODE || node->type == CONCAT_NODE) {
+        ast_reverse(node->extra.child2);
+    }
+
+    // Only the order of concatenation matters for the direction of a match
+    if (node->type == CONCAT_NODE) {
+        ASTNode* temp = node->child1;
+        node->child1 = node->extra.child2;
+        node->extra.child2 = temp;
+    }
+}
+
+// Copy an AST
+ASTNode* ast_copy(const ASTNode* node) {
+    if (node == NULL) {
+        return NULL;
+    }
+
+    ASTNode* copy = ast_node_create(node->type);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    if (node->type == CHAR_NODE) {
+        copy->extra.character = node->extra.character;
+        return copy;
+    }
+
+    copy->child1 = ast_copy(node->child1);
+    if (copy->child1 == NULL) {
+        ast_node_free(copy);
+        return NULL;
+    }
+
+    if (node->type == OR_NODE || node->type == CONCAT_NODE) {
+        copy->extra.child2 = ast_copy(node->extra.child2);
+        if (copy->extra.child2 == NULL) {
+            ast_node_free(copy);
+            return NULL;
+        }
+    }
+
+    return copy;
+}
+
+// Add two lengths, where any unbounded length makes the sum unbounded
+static inline size_t add_lengths(size_t a, size_t b) {
+    return a > AST_UNBOUNDED - b ? AST_UNBOUNDED : a + b;
+}
+
+// Compute the shortest and longest length of the strings the AST matches
+int ast_length_bounds(const ASTNode* node, size_t* min, size_t* max) {
+    if (node == NULL || min == NULL || max == NULL) {
+        return -1;
+    }
+
+    if (node->type == CHAR_NODE) {
+        *min = 1;
+        *max = 1;
+        return 0;
+    }
+
+    size_t min1, max1;
+    if (ast_length_bounds(node->child1, &min1, &max1) < 0) {
+        return -1;
+    }
+
+    size_t min2 = 0, max2 = 0;
+    if ((node->type == OR_NODE || node->type == CONCAT_NODE)
+        && ast_length_bounds(node->extra.child2, &min2, &max2) < 0) {
+        return -1;
+    }
+
+    switch (node->type) {
+    case STAR_NODE:
+        *min = 0;
+        *max = max1 == 0 ? 0 : AST_UNBOUNDED;
+        break;
+    case PLUS_NODE:
+        *min = min1;
+        *max = max1 == 0 ? 0 : AST_UNBOUNDED;
+        break;
+    case QUESTION_NODE:
+        *min = 0;
+        *max = max1;
+        break;
+    case OR_NODE:
+        *min = min1 < min2 ? min1 : min2;
+        *max = max1 > max2 ? max1 : max2;
+        break;
+    case CONCAT_NODE:
+        *min = add_lengths(min1, min2);
+        *max = add_lengths(max1, max2);
+        break;
+    default:
+        return -1;
+    }
+
+    return 0;
+}
+
 char* str_ast_node(ASTNode* node) {
     return ast_str[node->type];
 }
@@ -0,0 +1,74 @@
+#include "byte_set.h"
+
+// Add a byte to the given set
+void byte_set_add(ByteSet* set, unsigned char c) {
+    set->bits[c >> 6] |= (uint64_t) 1 << (c & 63);
+}
+
+// Check whether a byte is in the given set
+bool byte_set_contains(const ByteSet* set, unsigned char c) {
+    return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+// Count the bytes in the given set
+size_t byte_set_count(const ByteSet* set) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        count += __builtin_popcountll(set->bits[i]);
+    }
+
+    return count;
+}
+
+// Find the first byte of the given string that is in the set
+ssize_t byte_set_find(const ByteSet* set, const char* string, size_t len) {
+    if (set == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+
+    for (size_t i = 0; i < len; i++) {
+        if ((set->bits[bytes[i] >> 6] >> (bytes[i] & 63)) & 1) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Add the bytes that non-empty matches of the node start with to the set
+// and return whether the node matches the empty string
+static bool first(const ASTNode* node, ByteSet* set) {
+    switch (node->type) {
+    case CHAR_NODE:
+        byte_set_add(set, node->extra.character);
+        return false;
+    case STAR_NODE:
+    case QUESTION_NODE:
+        first(node->child1, set);
+        return true;
+    case PLUS_NODE:
+        return first(node->child1, set);
+    case OR_NODE:;
+        bool left = first(node->child1, set);
+        bool right = first(node->extra.child2, set);
+        return left || right;
+    default:
+        // Whatever follows an operand that may be empty can start a match
+        return first(node->child1, set) && first(node->extra.child2, set);
+    }
+}
+
+// Compute the set of bytes that non-empty matches of the AST start with
+int byte_set_first(const ASTNode* root, ByteSet* set) {
+    if (root == NULL || set == NULL) {
+        return -1;
+    }
+
+    *set = (ByteSet) {.bits = {0}};
+    first(root, set);
+
+    return 0;
+}
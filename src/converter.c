@@ -3,9 +3,12 @@
 #include "nfa_state.h"
 #include "converter.h"
 
+// The states of a child NFA live in the arena, only the NFA itself and its
+// list of final states are released here
 #define FREE_NFA(nfa) do {\
-/* This is the Release NFA memory on error */\
-nfa_free(nfa);\
+NFAStateList_free((nfa)->final_states, NULL);\
+free((nfa)->final_states);\
+free((nfa));\
 } while(0);
 
 #define FREE_NFAS(nfa1, nfa2) FREE_NFA((nfa1)); FREE_NFA((nfa2));
@@ -13,22 +16,16 @@ nfa_free(nfa);\
 #define NFA_CREATE do {\
 /* Create list of final states,only one state here */\
 if (NFAStateList_add(final_states, &final) < 0) {\
-    return free_resources(start, final, final_states);\
+    return free_resources(final_states);\
 }\
 nfa = nfa_create(start, final_states);\
 } while(0)
 
-#define NFA_PARTIAL_FREE(nfa) do {\
-NFAStateList_free((nfa)->final_states, NULL);\
-free((nfa)->final_states);\
-free((nfa));\
-} while(0);
-
 // 3/6 nodes have repeated code to create a nfa and release child resources.
 // Fill it in with a macro to keep code dry
 #define NFA_CREATE_SINGLE_CHILD do {\
 NFA_CREATE;\
-NFA_PARTIAL_FREE(child_nfa);\
+FREE_NFA(child_nfa);\
 } while(0)
 
 typedef NFAState* State;
@@ -36,16 +33,10 @@ typedef NFAStateList* StateList;
 
 static const char EPSILON = '\0';
 
+// States are left in the arena, which is released as a whole if the
+// conversion fails
 static inline
-void* free_resources(State start, State final, StateList list) {
-    if (start != NULL) {
-        state_free(start);
-    }
-
-    if (final != NULL) {
-        state_free(final);
-    }
-
+void* free_resources(StateList list) {
     if (list != NULL) {
         NFAStateList_free(list, NULL);
         free(list);
@@ -55,7 +46,7 @@ void* free_resources(State start, State final, StateList list) {
 }
 
 static
-int epsilon_from_final_states(NFA* from_nfa, State to_state, bool to_child) {
+int epsilon_from_final_states(NFAArena* arena, NFA* from_nfa, State to_state, bool to_child) {
     StateList child_final_states = from_nfa->final_states;
     for (size_t i = 0; i < child_final_states->size; i++) {
         State state = child_final_states->list[i];
@@ -69,7 +60,7 @@ int epsilon_from_final_states(NFA* from_nfa, State to_state, bool to_child) {
 
         // Every final state of the child nfa can epsilon transition
         // to our final state.
-        if (add_transition(state, to_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, state, to_state, EPSILON) < 0) {
             return -1;
         }
 
@@ -77,7 +68,7 @@ int epsilon_from_final_states(NFA* from_nfa, State to_state, bool to_child) {
             // Every final state of the child nfa can epsilon transition
             // back to the child's start state for 1 or more repetitions.
             // This is the property of the (*) and (+) metacharacters in regex.
-            if (add_transition(state, from_nfa->start_state, EPSILON) < 0) {
+            if (arena_add_transition(arena, state, from_nfa->start_state, EPSILON) < 0) {
                 return -1;
             }
         }
@@ -86,25 +77,73 @@ int epsilon_from_final_states(NFA* from_nfa, State to_state, bool to_child) {
     return 0;
 }
 
-// Convert AST to NFA
-NFA* convert_ast_to_nfa(ASTNode* root) {
-    if (root == NULL) {
+static NFA* convert(NFAArena* arena, ASTNode* root);
+
+////////////////////////////////////////////////////////////////////////////////
+/*
+    A concatenation is a special case, that needs no start and final states
+    of its own. We will simply use the left child's start state and the right
+    child's final states to create our combined NFA
+
+    1. Add epsilon transition from parent's start to the
+       left child's start state.
+    2. Add epsilon transitions from left child's final states to the
+       right child's start state.
+*/
+////////////////////////////////////////////////////////////////////////////////
+static NFA* convert_concat(NFAArena* arena, ASTNode* root) {
+    NFA* left_nfa = convert(arena, root->child1);
+    if (left_nfa == NULL) {
+        return NULL;
+    }
+
+    NFA* right_nfa = convert(arena, root->extra.child2);
+    if (right_nfa == NULL) {
+        FREE_NFA(left_nfa);
+        return NULL;
+    }
+
+    // Add transitions from left nfa's final states to the right nfa's start
+    // No self links though.
+    if (epsilon_from_final_states(arena, left_nfa, right_nfa->start_state, false) < 0) {
+        FREE_NFAS(left_nfa, right_nfa);
         return NULL;
     }
 
-    State start = state_create(false);
-    if (start == NULL) {
+    NFA* nfa = nfa_create(left_nfa->start_state, right_nfa->final_states);
+
+    // We can free the left nfa's as normal
+    FREE_NFA(left_nfa)
+
+    // However we actually need the final states of the right_nfa, unless
+    // the combined NFA could not be created
+    if (nfa == NULL) {
+        FREE_NFA(right_nfa);
+    } else {
+        free(right_nfa);
+    }
+    return nfa;
+}
+
+// Convert an AST to an NFA, with its states in the given arena
+static NFA* convert(NFAArena* arena, ASTNode* root) {
+    if (root == NULL) {
         return NULL;
     }
 
-    State final = state_create(true);
-    if (final == NULL) {
-        return free_resources(start, NULL, NULL);
+    if (root->type == CONCAT_NODE) {
+        return convert_concat(arena, root);
+    }
+
+    State start = arena_state_create(arena, false);
+    State final = arena_state_create(arena, true);
+    if (start == NULL || final == NULL) {
+        return NULL;
     }
 
     StateList final_states = NFAStateList_create(1);
     if (final_states == NULL) {
-        return free_resources(start, final, NULL);
+        return NULL;
     }
 
     NFA* nfa = NULL;
@@ -124,13 +163,13 @@ NFA* convert_ast_to_nfa(ASTNode* root) {
 ////////////////////////////////////////////////////////////////////////////////
     case CHAR_NODE:
         // Add a transition on the node's character
-        if (add_transition(start, final, root->extra.character) < 0) {
-            return free_resources(start, final, final_states);
+        if (arena_add_transition(arena, start, final, root->extra.character) < 0) {
+            return free_resources(final_states);
         }
 
         // Create list of final states,only one state here
         if (NFAStateList_add(final_states, &final) < 0) {
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Create the NFA
@@ -148,8 +187,8 @@ NFA* convert_ast_to_nfa(ASTNode* root) {
 
     We use the states created by the "child" NFA, but discard the NFA itself.
     References to all the states are still maintained via transitions from
-    the parent NFA. Cleanup of these references is done via a DFS search of
-    states through the transitions.
+    the parent NFA. Every state lives in the arena shared by the whole
+    conversion, and is released with it.
 
     Our tests rigorously verify using ASan and Valgrind that no references
     are lost, and no memory is leaked, directly or indirectly.
@@ -157,80 +196,80 @@ NFA* convert_ast_to_nfa(ASTNode* root) {
 ////////////////////////////////////////////////////////////////////////////////
 
     case STAR_NODE:
-        child_nfa = convert_ast_to_nfa(root->child1);
+        child_nfa = convert(arena, root->child1);
         if (child_nfa == NULL) {
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add link to parent NFA's start state. Zero repetition case
-        if (add_transition(start, final, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, final, EPSILON) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add link to child NFA's start state
-        if (add_transition(start, child_nfa->start_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, child_nfa->start_state, EPSILON) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transitions from child's final states to our final state
-        if (epsilon_from_final_states(child_nfa, final, true) < 0) {
+        if (epsilon_from_final_states(arena, child_nfa, final, true) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         NFA_CREATE_SINGLE_CHILD;
         break;
 
     case PLUS_NODE:
-        child_nfa = convert_ast_to_nfa(root->child1);
+        child_nfa = convert(arena, root->child1);
         if (child_nfa == NULL) {
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Note: No link to parent NFA's start state, the (+) metacharacter
         // requires at least 1 occurence of the child pattern
 
         // Add link to child NFA's start state
-        if (add_transition(start, child_nfa->start_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, child_nfa->start_state, EPSILON) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transitions from child's final states to our final state
-        if (epsilon_from_final_states(child_nfa, final, true) < 0) {
+        if (epsilon_from_final_states(arena, child_nfa, final, true) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         NFA_CREATE_SINGLE_CHILD;
         break;
 
     case QUESTION_NODE:
-        child_nfa = convert_ast_to_nfa(root->child1);
+        child_nfa = convert(arena, root->child1);
         if (child_nfa == NULL) {
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add link to parent NFA's start state. Zero repetition case
-        if (add_transition(start, final, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, final, EPSILON) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add link to child NFA's start state
-        if (add_transition(start, child_nfa->start_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, child_nfa->start_state, EPSILON) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transitions from child's final states to our final state
         // But not to the child itself, the (?) metacharacter requires
         // zero or one occurences only
-        if (epsilon_from_final_states(child_nfa, final, false) < 0) {
+        if (epsilon_from_final_states(arena, child_nfa, final, false) < 0) {
             FREE_NFA(child_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         NFA_CREATE_SINGLE_CHILD;
@@ -250,102 +289,72 @@ NFA* convert_ast_to_nfa(ASTNode* root) {
 ////////////////////////////////////////////////////////////////////////////////
 
     case OR_NODE:
-        left_nfa = convert_ast_to_nfa(root->child1);
+        left_nfa = convert(arena, root->child1);
         if (left_nfa == NULL) {
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
-        right_nfa = convert_ast_to_nfa(root->extra.child2);
+        right_nfa = convert(arena, root->extra.child2);
         if (right_nfa == NULL) {
             FREE_NFA(left_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transition from parent's start to left child's start
-        if (add_transition(start, left_nfa->start_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, left_nfa->start_state, EPSILON) < 0) {
             FREE_NFAS(left_nfa, right_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transition from parent's start to right child's start
-        if (add_transition(start, right_nfa->start_state, EPSILON) < 0) {
+        if (arena_add_transition(arena, start, right_nfa->start_state, EPSILON) < 0) {
             FREE_NFAS(left_nfa, right_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transition from left child's final states to
         // parent's final. Do not link from final to start in the child
-        if (epsilon_from_final_states(left_nfa, final, false) < 0) {
+        if (epsilon_from_final_states(arena, left_nfa, final, false) < 0) {
             FREE_NFAS(left_nfa, right_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         // Add epsilon transition from right child's final states to
         // parent's final. Do not link from final to start in the child
-        if (epsilon_from_final_states(right_nfa, final, false) < 0) {
+        if (epsilon_from_final_states(arena, right_nfa, final, false) < 0) {
             FREE_NFAS(left_nfa, right_nfa);
-            return free_resources(start, final, final_states);
+            return free_resources(final_states);
         }
 
         NFA_CREATE;
-        NFA_PARTIAL_FREE(left_nfa);
-        NFA_PARTIAL_FREE(right_nfa);
-        break;
-
-////////////////////////////////////////////////////////////////////////////////
-/*
-    This is a special case where we actually will not use the start and final
-    states initialized above. We will simply use the left child's start state
-    and the right child's final states to create our combined NFA
-
-    1. Add epsilon transition from parent's start to the
-       left child's start state.
-    2. Add epsilon transitions from left child's final states to the
-       right child's start state.
-*/
-////////////////////////////////////////////////////////////////////////////////
-
-    case CONCAT_NODE:
-        // Release initialized resource as we do not need them
-        free_resources(start, final, final_states);
-
-        left_nfa = convert_ast_to_nfa(root->child1);
-        if (left_nfa == NULL) {
-            return NULL;
-        }
-
-        right_nfa = convert_ast_to_nfa(root->extra.child2);
-        if (right_nfa == NULL) {
-            FREE_NFA(left_nfa);
-            return NULL;
-        }
-
-        // Add transitions from left nfa's final states to the right nfa's start
-        // No self links though.
-        if (epsilon_from_final_states(left_nfa, right_nfa->start_state, false) < 0) {
-            FREE_NFAS(left_nfa, right_nfa);
-            return NULL;
-        }
-
-        nfa = nfa_create(left_nfa->start_state, right_nfa->final_states);
-
-        // Freeing here is a little tricky.
-        // We can free the left nfa's as normal
-        NFA_PARTIAL_FREE(left_nfa)
-
-        // However we actually need the internals of the right_nfa
-        // But, we can free the structure itself.
-        free(right_nfa);
+        FREE_NFA(left_nfa);
+        FREE_NFA(right_nfa);
         break;
 
     default:
         // Ideally should never get here
-        return free_resources(start, final, final_states);
+        return free_resources(final_states);
     }
 
     if (nfa == NULL) {
-        return free_resources(start, final, final_states);
+        return free_resources(final_states);
+    }
+
+    return nfa;
+}
+
+// Convert AST to NFA
+NFA* convert_ast_to_nfa(ASTNode* root) {
+    NFAArena arena;
+    nfa_arena_init(&arena);
+
+    NFA* nfa = convert(&arena, root);
+    if (nfa == NULL) {
+        nfa_arena_free(&arena);
+        return NULL;
     }
 
+    // The NFA owns every state made along the way
+    nfa->arena = arena;
     return nfa;
 }
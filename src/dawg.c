@@ -0,0 +1,548 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dawg.h"
+
+#define WORD_BITS 64
+#define EMPTY_BUCKET UINT32_MAX
+
+// The target of the last transition of a path state, until it is known
+#define PENDING UINT32_MAX
+
+static inline void set_bit(uint64_t* set, size_t i) {
+    set[i / WORD_BITS] |= (uint64_t) 1 << (i % WORD_BITS);
+}
+
+static inline bool has_bit(const uint64_t* set, size_t i) {
+    return (set[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+static size_t hash_state(bool is_final, const unsigned char* labels, const uint32_t* targets,
+                         size_t n_edges) {
+    // FNV-1a over the transitions of the state
+    uint64_t hash = 14695981039346656037ULL ^ is_final;
+    for (size_t i = 0; i < n_edges; i++) {
+        hash ^= (uint64_t) targets[i] << 8 | labels[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) (hash ^ (hash >> 32));
+}
+
+// Whether a registered state has the same transitions as a path state
+static bool same_state(const Dawg* dawg, uint32_t id, const DawgPathState* state) {
+    size_t first = dawg->edge_starts[id];
+    size_t n_edges = dawg->edge_starts[id + 1] - first;
+
+    return has_bit(dawg->finals, id) == state->is_final && n_edges == state->n_edges
+        && memcmp(&dawg->labels[first], state->labels, n_edges) == 0
+        && memcmp(&dawg->targets[first], state->targets, sizeof(uint32_t) * n_edges) == 0;
+}
+
+// Initialize the given builder
+int dawg_builder_init(DawgBuilder* builder) {
+    if (builder == NULL) {
+        return -1;
+    }
+
+    *builder = (DawgBuilder) {
+        .dawg = calloc(1, sizeof(Dawg)),
+        .states_cap = 64,
+        .edges_cap = 64,
+        .path = malloc(sizeof(DawgPathState) * 16),
+        .path_cap = 16,
+        .last = malloc(16),
+        .last_len = 0,
+        .buckets = malloc(sizeof(uint32_t) * 128),
+        .n_buckets = 128,
+    };
+
+    Dawg* dawg = builder->dawg;
+    if (dawg == NULL || builder->path == NULL || builder->last == NULL
+        || builder->buckets == NULL) {
+        dawg_builder_free(builder);
+        return -1;
+    }
+
+    dawg->edge_starts = malloc(sizeof(uint32_t) * (builder->states_cap + 1));
+    dawg->labels = malloc(builder->edges_cap);
+    dawg->targets = malloc(sizeof(uint32_t) * builder->edges_cap);
+    dawg->finals = calloc(builder->states_cap / WORD_BITS, sizeof(uint64_t));
+
+    if (dawg->edge_starts == NULL || dawg->labels == NULL || dawg->targets == NULL
+        || dawg->finals == NULL) {
+        dawg_builder_free(builder);
+        return -1;
+    }
+
+    dawg->edge_starts[0] = 0;
+    memset(builder->buckets, 0xFF, sizeof(uint32_t) * builder->n_buckets);
+    builder->path[0].is_final = false;
+    builder->path[0].n_edges = 0;
+
+    return 0;
+}
+
+static int grow_hash_table(DawgBuilder* builder) {
+    const Dawg* dawg = builder->dawg;
+    size_t n_buckets = builder->n_buckets * 2;
+    uint32_t* buckets = malloc(sizeof(uint32_t) * n_buckets);
+    if (buckets == NULL) {
+        return -1;
+    }
+
+    memset(buckets, 0xFF, sizeof(uint32_t) * n_buckets);
+
+    for (size_t id = 0; id < dawg->n_states; id++) {
+        size_t first = dawg->edge_starts[id];
+        size_t h = hash_state(has_bit(dawg->finals, id), &dawg->labels[first],
+                              &dawg->targets[first], dawg->edge_starts[id + 1] - first);
+        while (buckets[h & (n_buckets - 1)] != EMPTY_BUCKET) {
+            h++;
+        }
+        buckets[h & (n_buckets - 1)] = id;
+    }
+
+    free(builder->buckets);
+    builder->buckets = buckets;
+    builder->n_buckets = n_buckets;
+    return 0;
+}
+
+// Append a path state to the registered states
+static int64_t add_state(DawgBuilder* builder, const DawgPathState* state) {
+    Dawg* dawg = builder->dawg;
+
+    if (dawg->n_states >= UINT32_MAX - 1) {
+        return -1;
+    }
+
+    if (dawg->n_states == builder->states_cap) {
+        size_t cap = builder->states_cap * 2;
+
+        uint32_t* edge_starts = realloc(dawg->edge_starts, sizeof(uint32_t) * (cap + 1));
+        if (edge_starts == NULL) {
+            return -1;
+        }
+        dawg->edge_starts = edge_starts;
+
+        uint64_t* finals = realloc(dawg->finals, sizeof(uint64_t) * cap / WORD_BITS);
+        if (finals == NULL) {
+            return -1;
+        }
+        memset(&finals[builder->states_cap / WORD_BITS], 0,
+               sizeof(uint64_t) * (cap - builder->states_cap) / WORD_BITS);
+        dawg->finals = finals;
+
+        builder->states_cap = cap;
+    }
+
+    if (dawg->n_edges + state->n_edges > builder->edges_cap) {
+        size_t cap = builder->edges_cap * 2 + state->n_edges;
+
+        unsigned char* labels = realloc(dawg->labels, cap);
+        if (labels == NULL) {
+            return -1;
+        }
+        dawg->labels = labels;
+
+        uint32_t* targets = realloc(dawg->targets, sizeof(uint32_t) * cap);
+        if (targets == NULL) {
+            return -1;
+        }
+        dawg->targets = targets;
+
+        builder->edges_cap = cap;
+    }
+
+    if (dawg->n_edges + state->n_edges > UINT32_MAX) {
+        return -1;
+    }
+
+    size_t id = dawg->n_states++;
+    memcpy(&dawg->labels[dawg->n_edges], state->labels, state->n_edges);
+    memcpy(&dawg->targets[dawg->n_edges], state->targets, sizeof(uint32_t) * state->n_edges);
+    dawg->n_edges += state->n_edges;
+    dawg->edge_starts[id + 1] = dawg->n_edges;
+
+    if (state->is_final) {
+        set_bit(dawg->finals, id);
+    }
+
+    return id;
+}
+
+// Find the registered state equivalent to a path state, registering the
+// path state if there is none
+static int64_t register_state(DawgBuilder* builder, const DawgPathState* state) {
+    size_t h = hash_state(state->is_final, state->labels, state->targets, state->n_edges);
+
+    for (;; h++) {
+        uint32_t id = builder->buckets[h & (builder->n_buckets - 1)];
+        if (id == EMPTY_BUCKET) {
+            break;
+        }
+
+        if (same_state(builder->dawg, id, state)) {
+            return id;
+        }
+    }
+
+    int64_t id = add_state(builder, state);
+    if (id < 0) {
+        return -1;
+    }
+
+    builder->buckets[h & (builder->n_buckets - 1)] = id;
+
+    // Keep the load factor at or below a half
+    if (2 * builder->dawg->n_states > builder->n_buckets && grow_hash_table(builder) < 0) {
+        return -1;
+    }
+
+    return id;
+}
+
+// Register the path states deeper than `depth`, from the deepest up
+static int register_path(DawgBuilder* builder, size_t depth) {
+    for (size_t d = builder->last_len; d > depth; d--) {
+        int64_t id = register_state(builder, &builder->path[d]);
+        if (id < 0) {
+            return -1;
+        }
+
+        DawgPathState* parent = &builder->path[d - 1];
+        parent->targets[parent->n_edges - 1] = id;
+    }
+
+    return 0;
+}
+
+// Add a keyword to the automaton being built
+int dawg_builder_add(DawgBuilder* builder, const char* keyword, size_t len) {
+    if (builder == NULL || builder->dawg == NULL || (keyword == NULL && len > 0)
+        || len > DAWG_MAX_KEYWORD_LEN) {
+        return -1;
+    }
+
+    Dawg* dawg = builder->dawg;
+    size_t last_len = builder->last_len;
+    size_t shorter = last_len < len ? last_len : len;
+
+    // The keywords in order share a prefix with the one before, and
+    // branch off it on a larger byte
+    size_t prefix = 0;
+    while (prefix < shorter && builder->last[prefix] == keyword[prefix]) {
+        prefix++;
+    }
+
+    if (dawg->n_keywords > 0) {
+        if (prefix == len && prefix == last_len) {
+            return 0;
+        }
+
+        if (prefix == len || (prefix < shorter
+                              && (unsigned char) builder->last[prefix] > (unsigned char) keyword[prefix])) {
+            return -1;
+        }
+    }
+
+    if (len + 1 > builder->path_cap) {
+        size_t cap = builder->path_cap;
+        while (cap < len + 1) {
+            cap *= 2;
+        }
+
+        DawgPathState* path = realloc(builder->path, sizeof(DawgPathState) * cap);
+        if (path == NULL) {
+            return -1;
+        }
+        builder->path = path;
+
+        char* last = realloc(builder->last, cap);
+        if (last == NULL) {
+            return -1;
+        }
+        builder->last = last;
+
+        builder->path_cap = cap;
+    }
+
+    // The states past the shared prefix can no longer change
+    if (register_path(builder, prefix) < 0) {
+        return -1;
+    }
+
+    for (size_t d = prefix; d < len; d++) {
+        DawgPathState* state = &builder->path[d];
+        state->labels[state->n_edges] = keyword[d];
+        state->targets[state->n_edges] = PENDING;
+        state->n_edges++;
+
+        // Only the used part of a path state is ever read
+        builder->path[d + 1].is_final = false;
+        builder->path[d + 1].n_edges = 0;
+    }
+    builder->path[len].is_final = true;
+
+    if (len > 0) {
+        memcpy(builder->last, keyword, len);
+    }
+    builder->last_len = len;
+
+    if (dawg->n_keywords == 0 || len < dawg->min_len) {
+        dawg->min_len = len;
+    }
+    if (len > dawg->max_len) {
+        dawg->max_len = len;
+    }
+    dawg->n_keywords++;
+
+    return 0;
+}
+
+// Register the remaining states, and take the finished automaton
+Dawg* dawg_builder_finish(DawgBuilder* builder) {
+    if (builder == NULL || builder->dawg == NULL) {
+        return NULL;
+    }
+
+    int64_t root = -1;
+    if (register_path(builder, 0) == 0) {
+        root = register_state(builder, &builder->path[0]);
+    }
+
+    Dawg* dawg = NULL;
+    if (root >= 0) {
+        dawg = builder->dawg;
+        dawg->root = root;
+        builder->dawg = NULL;
+    }
+
+    dawg_builder_free(builder);
+    return dawg;
+}
+
+// Releases the memory used by the given builder
+void dawg_builder_free(DawgBuilder* builder) {
+    if (builder == NULL) {
+        return;
+    }
+
+    dawg_free(builder->dawg);
+    free(builder->dawg);
+    free(builder->path);
+    free(builder->last);
+    free(builder->buckets);
+
+    builder->dawg = NULL;
+    builder->path = NULL;
+    builder->last = NULL;
+    builder->buckets = NULL;
+}
+
+// Create a DAWG accepting exactly the given keywords
+Dawg* dawg_create(char* const* keywords, size_t n_keywords) {
+    if (keywords == NULL && n_keywords > 0) {
+        return NULL;
+    }
+
+    DawgBuilder builder;
+    if (dawg_builder_init(&builder) < 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n_keywords; i++) {
+        if (keywords[i] == NULL
+            || dawg_builder_add(&builder, keywords[i], strlen(keywords[i])) < 0) {
+            dawg_builder_free(&builder);
+            return NULL;
+        }
+    }
+
+    return dawg_builder_finish(&builder);
+}
+
+// Releases the memory used by the given DAWG
+void dawg_free(Dawg* dawg) {
+    if (dawg == NULL) {
+        return;
+    }
+
+    free(dawg->edge_starts);
+    free(dawg->labels);
+    free(dawg->targets);
+    free(dawg->finals);
+
+    dawg->edge_starts = NULL;
+    dawg->labels = NULL;
+    dawg->targets = NULL;
+    dawg->finals = NULL;
+    dawg->n_states = 0;
+    dawg->n_edges = 0;
+}
+
+// The state reached from `state` on byte `c`, or -1 if there is none
+static inline int64_t step(const Dawg* dawg, uint32_t state, unsigned char c) {
+    size_t low = dawg->edge_starts[state];
+    size_t high = dawg->edge_starts[state + 1];
+
+    // Transitions are sorted by byte
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (dawg->labels[mid] < c) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low < dawg->edge_starts[state + 1] && dawg->labels[low] == c) {
+        return dawg->targets[low];
+    }
+
+    return -1;
+}
+
+// Check whether the whole of the given string is a keyword
+bool dawg_contains(const Dawg* dawg, const char* string, size_t len) {
+    if (dawg == NULL || string == NULL || dawg->n_states == 0) {
+        return false;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    int64_t state = dawg->root;
+
+    for (size_t i = 0; i < len && state >= 0; i++) {
+        state = step(dawg, state, bytes[i]);
+    }
+
+    return state >= 0 && has_bit(dawg->finals, state);
+}
+
+/**
+ * Find where the first non-empty keyword in the given string ends.
+ *
+ * A walk through the automaton is started at every offset, and kept while
+ * it can still reach a keyword. Walks are kept in the order they started,
+ * so the first to accept at an offset is the longest keyword ending there.
+ *
+ * @param  dawg   The DAWG to search with
+ * @param  string The string to search
+ * @param  len    The length of the string
+ * @param  walks  Space for dawg->max_len + 1 walks
+ * @param  starts Space for dawg->max_len + 1 offsets
+ * @param  start  Set to the offset the keyword starts at
+ *
+ * @return The offset just past the keyword, -1 if there is none
+ */
+static ssize_t find_end(const Dawg* dawg, const char* string, size_t len,
+                        uint32_t* walks, size_t* starts, size_t* start) {
+    const unsigned char* bytes = (const unsigned char*) string;
+    size_t n_walks = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        walks[n_walks] = dawg->root;
+        starts[n_walks] = i;
+        n_walks++;
+
+        size_t kept = 0;
+        for (size_t j = 0; j < n_walks; j++) {
+            int64_t next = step(dawg, walks[j], bytes[i]);
+            if (next < 0) {
+                continue;
+            }
+
+            if (has_bit(dawg->finals, next)) {
+                *start = starts[j];
+                return i + 1;
+            }
+
+            walks[kept] = next;
+            starts[kept] = starts[j];
+            kept++;
+        }
+        n_walks = kept;
+    }
+
+    return -1;
+}
+
+// Count the non-overlapping occurrences of non-empty keywords
+ssize_t dawg_count(const Dawg* dawg, const char* string, size_t len) {
+    if (dawg == NULL || string == NULL) {
+        return -1;
+    }
+
+    if (dawg->n_states == 0 || dawg->max_len == 0) {
+        return 0;
+    }
+
+    uint32_t* walks = malloc(sizeof(uint32_t) * (dawg->max_len + 1));
+    size_t* starts = malloc(sizeof(size_t) * (dawg->max_len + 1));
+    ssize_t count = -1;
+
+    if (walks != NULL && starts != NULL) {
+        size_t start;
+        ssize_t end;
+        count = 0;
+
+        while (len > 0 && (end = find_end(dawg, string, len, walks, starts, &start)) > 0) {
+            count++;
+            string += end;
+            len -= end;
+        }
+    }
+
+    free(walks);
+    free(starts);
+    return count;
+}
+
+// Find the first occurrence of a non-empty keyword
+int dawg_find(const Dawg* dawg, const char* string, size_t len,
+              size_t* start, size_t* end) {
+    if (dawg == NULL || string == NULL || start == NULL || end == NULL) {
+        return -1;
+    }
+
+    if (dawg->n_states == 0 || dawg->max_len == 0) {
+        return 0;
+    }
+
+    uint32_t* walks = malloc(sizeof(uint32_t) * (dawg->max_len + 1));
+    size_t* starts = malloc(sizeof(size_t) * (dawg->max_len + 1));
+    if (walks == NULL || starts == NULL) {
+        free(walks);
+        free(starts);
+        return -1;
+    }
+
+    size_t match_start;
+    ssize_t match_end = find_end(dawg, string, len, walks, starts, &match_start);
+
+    free(walks);
+    free(starts);
+
+    if (match_end < 0) {
+        return 0;
+    }
+
+    // Extend to the longest keyword starting at the same offset
+    const unsigned char* bytes = (const unsigned char*) string;
+    int64_t state = dawg->root;
+
+    for (size_t i = match_start; i < len; i++) {
+        state = step(dawg, state, bytes[i]);
+        if (state < 0) {
+            break;
+        }
+
+        if (has_bit(dawg->finals, state) && (ssize_t) i + 1 > match_end) {
+            match_end = i + 1;
+        }
+    }
+
+    *start = match_start;
+    *end = match_end;
+    return 1;
+}
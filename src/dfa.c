@@ -0,0 +1,1546 @@
+#include "portability.h"
+
+#include <stdatomic.h>
+
+#include "dfa.h"
+#include "nfa.h"
+#include "nfa_state.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+// The NFA only has transitions on printable characters
+#define FIRST_PRINTABLE 0x20
+#define LAST_PRINTABLE 0x7E
+#define N_PRINTABLE (LAST_PRINTABLE - FIRST_PRINTABLE + 1)
+
+#define WORD_BITS 64
+#define EMPTY_BUCKET UINT32_MAX
+
+typedef uint64_t Word;
+
+/**
+ * Working memory for the subset construction
+ *
+ * Members
+ *     - states: All NFA states, sorted by ID. A state's position in this
+ *               list is its bit in a subset
+ *     - n_words: Number of words used by each subset
+ *     - closures: The epsilon closure of every NFA state
+ *     - finals: The subset of accepting NFA states
+ *     - sets: The subset of NFA states for every DFA state
+ *     - buckets: Open addressing hash table of indices into `sets`
+ *     - injected: States added to every subset before taking a transition.
+ *                 This is the closure of the start state for unanchored
+ *                 DFAs, and NULL otherwise.
+ *     - tags: The part of the NFA every state belongs to, when the DFA
+ *             records which parts accept. NULL otherwise.
+ *     - dfa: The DFA under construction
+ */
+typedef struct Builder {
+    NFAStateList* states;
+    size_t n_words;
+    Word* closures;
+    Word* finals;
+
+    Word* sets;
+
+    uint32_t* buckets;
+    size_t n_buckets;
+
+    const Word* injected;
+
+    uint32_t* tags;
+
+    DFA* dfa;
+    size_t table_capacity;
+} Builder;
+
+static int state_id_cmp(const void* a, const void* b) {
+    const NFAState* x = *(const NFAState**) a;
+    const NFAState* y = *(const NFAState**) b;
+    return (x->ID > y->ID) - (x->ID < y->ID);
+}
+
+// Position of the given NFA state in the sorted state list
+static size_t state_index(Builder* b, NFAState* state) {
+    NFAState** found = bsearch(&state, b->states->list, b->states->size,
+                               sizeof(NFAState*), state_id_cmp);
+    return found - b->states->list;
+}
+
+static inline void set_bit(Word* set, size_t i) {
+    set[i / WORD_BITS] |= (Word) 1 << (i % WORD_BITS);
+}
+
+static inline bool has_bit(const Word* set, size_t i) {
+    return (set[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+static size_t hash_set(const Word* set, size_t n_words) {
+    // FNV-1a over the words of the set
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < n_words; i++) {
+        hash ^= set[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) (hash ^ (hash >> 32));
+}
+
+// Fill in the epsilon closure of every NFA state
+static int compute_closures(Builder* b) {
+    size_t n = b->states->size;
+    size_t* stack = malloc(sizeof(size_t) * n);
+    if (stack == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        Word* closure = &b->closures[i * b->n_words];
+        size_t top = 0;
+
+        set_bit(closure, i);
+        stack[top++] = i;
+
+        while (top > 0) {
+            NFAState* state = b->states->list[stack[--top]];
+            NFAStateList* epsilon = get_transition(state, '\0');
+            if (epsilon == NULL) {
+                continue;
+            }
+
+            for (size_t j = 0; j < epsilon->size; j++) {
+                size_t k = state_index(b, epsilon->list[j]);
+                if (!has_bit(closure, k)) {
+                    set_bit(closure, k);
+                    stack[top++] = k;
+                }
+            }
+        }
+
+        if (b->states->list[i]->is_final) {
+            set_bit(b->finals, i);
+        }
+    }
+
+    free(stack);
+    return 0;
+}
+
+static int grow_hash_table(Builder* b) {
+    size_t n_buckets = b->n_buckets * 2;
+    uint32_t* buckets = malloc(sizeof(uint32_t) * n_buckets);
+    if (buckets == NULL) {
+        return -1;
+    }
+
+    memset(buckets, 0xFF, sizeof(uint32_t) * n_buckets);
+
+    for (size_t i = 0; i < b->dfa->n_states; i++) {
+        size_t h = hash_set(&b->sets[i * b->n_words], b->n_words);
+        while (buckets[h & (n_buckets - 1)] != EMPTY_BUCKET) {
+            h++;
+        }
+        buckets[h & (n_buckets - 1)] = i;
+    }
+
+    free(b->buckets);
+    b->buckets = buckets;
+    b->n_buckets = n_buckets;
+    return 0;
+}
+
+// Whether the given subset accepts, filling in the parts accepting in it
+// when they are recorded
+static bool describe_set(Builder* b, const Word* set, Word* accepts) {
+    bool is_final = false;
+    for (size_t i = 0; i < b->n_words; i++) {
+        if (set[i] & b->finals[i]) {
+            is_final = true;
+            break;
+        }
+    }
+
+    // Record the parts that accepting members belong to
+    if (accepts != NULL) {
+        memset(accepts, 0, sizeof(Word) * b->dfa->accept_words);
+
+        for (size_t i = 0; is_final && i < b->states->size; i++) {
+            if (has_bit(set, i) && has_bit(b->finals, i)) {
+                set_bit(accepts, b->tags[i]);
+            }
+        }
+    }
+
+    return is_final;
+}
+
+// Append a new DFA state for the given subset
+static int add_dfa_state(Builder* b, const Word* set) {
+    DFA* dfa = b->dfa;
+
+    if (dfa->n_states >= DFA_MAX_STATES) {
+        return -1;
+    }
+
+    if (dfa->n_states == b->table_capacity) {
+        size_t cap = b->table_capacity * 2;
+        Word* sets = realloc(b->sets, sizeof(Word) * b->n_words * cap);
+        if (sets == NULL) {
+            return -1;
+        }
+        b->sets = sets;
+
+        uint32_t* table = realloc(dfa->table, sizeof(uint32_t) * DFA_ALPHABET_SIZE * cap);
+        if (table == NULL) {
+            return -1;
+        }
+        dfa->table = table;
+
+        bool* is_final = realloc(dfa->is_final, sizeof(bool) * cap);
+        if (is_final == NULL) {
+            return -1;
+        }
+        dfa->is_final = is_final;
+
+        if (b->tags != NULL) {
+            Word* accepts = realloc(dfa->accepts, sizeof(Word) * dfa->accept_words * cap);
+            if (accepts == NULL) {
+                return -1;
+            }
+            dfa->accepts = accepts;
+        }
+
+        b->table_capacity = cap;
+    }
+
+    size_t id = dfa->n_states++;
+    memcpy(&b->sets[id * b->n_words], set, sizeof(Word) * b->n_words);
+
+    Word* accepts = b->tags != NULL ? &dfa->accepts[id * dfa->accept_words] : NULL;
+    dfa->is_final[id] = describe_set(b, set, accepts);
+
+    // Every byte leads to the dead state until the row is filled in
+    memset(&dfa->table[id * DFA_ALPHABET_SIZE], 0, sizeof(uint32_t) * DFA_ALPHABET_SIZE);
+
+    return id;
+}
+
+// Find the DFA state for the given subset, creating it if necessary
+static int intern_set(Builder* b, const Word* set) {
+    size_t bytes = sizeof(Word) * b->n_words;
+    size_t h = hash_set(set, b->n_words);
+
+    for (;; h++) {
+        uint32_t id = b->buckets[h & (b->n_buckets - 1)];
+        if (id == EMPTY_BUCKET) {
+            break;
+        }
+
+        if (memcmp(&b->sets[id * b->n_words], set, bytes) == 0) {
+            return id;
+        }
+    }
+
+    int id = add_dfa_state(b, set);
+    if (id < 0) {
+        return -1;
+    }
+
+    b->buckets[h & (b->n_buckets - 1)] = id;
+
+    // Keep the load factor at or below a half
+    if (2 * b->dfa->n_states > b->n_buckets && grow_hash_table(b) < 0) {
+        return -1;
+    }
+
+    return id;
+}
+
+// Compute the subset reached from the given one on every character, with
+// N_PRINTABLE subsets in `next`
+static void gather_successors(Builder* b, const Word* from, Word* next) {
+    size_t n_words = b->n_words;
+    memset(next, 0, sizeof(Word) * n_words * N_PRINTABLE);
+
+    // Gather the targets of every member state at once, so each member's
+    // transition lists are only walked once
+    for (size_t i = 0; i < b->states->size; i++) {
+        bool member = has_bit(from, i)
+            || (b->injected != NULL && has_bit(b->injected, i));
+        if (!member) {
+            continue;
+        }
+
+        NFAState* state = b->states->list[i];
+        for (int c = FIRST_PRINTABLE; c <= LAST_PRINTABLE; c++) {
+            NFAStateList* targets = get_transition(state, (char) c);
+            if (targets == NULL) {
+                continue;
+            }
+
+            Word* set = &next[(c - FIRST_PRINTABLE) * n_words];
+            for (size_t j = 0; j < targets->size; j++) {
+                const Word* closure = &b->closures[state_index(b, targets->list[j]) * n_words];
+                for (size_t w = 0; w < n_words; w++) {
+                    set[w] |= closure[w];
+                }
+            }
+        }
+    }
+}
+
+// Compute the transitions out of the given DFA state, on every character
+static int expand_state(Builder* b, size_t id, Word* next) {
+    size_t n_words = b->n_words;
+    gather_successors(b, &b->sets[id * n_words], next);
+
+    for (int c = FIRST_PRINTABLE; c <= LAST_PRINTABLE; c++) {
+        int target = intern_set(b, &next[(c - FIRST_PRINTABLE) * n_words]);
+        if (target < 0) {
+            return -1;
+        }
+
+        // The table may have moved while interning
+        b->dfa->table[id * DFA_ALPHABET_SIZE + c] = target;
+    }
+
+    return 0;
+}
+
+static void builder_free(Builder* b) {
+    NFAStateList_free(b->states, NULL);
+    free(b->states);
+    free(b->closures);
+    free(b->finals);
+    free(b->sets);
+    free(b->buckets);
+    free(b->tags);
+}
+
+// Find the part every NFA state belongs to
+static int compute_tags(Builder* b, NFA* const* parts, size_t n_parts) {
+    b->tags = calloc(b->states->size, sizeof(uint32_t));
+    if (b->tags == NULL) {
+        return -1;
+    }
+
+    for (size_t p = 0; p < n_parts; p++) {
+        if (parts[p] == NULL) {
+            continue;
+        }
+
+        NFAStateList* states = nfa_states(parts[p]);
+        if (states == NULL) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < states->size; i++) {
+            b->tags[state_index(b, states->list[i])] = p;
+        }
+
+        NFAStateList_free(states, NULL);
+        free(states);
+    }
+
+    return 0;
+}
+
+/**
+ * Run the subset construction, numbering states in the order they are
+ * found
+ *
+ * @param  b             The builder, with the closures computed
+ * @param  start_closure The subset of the start state, NULL if the DFA is
+ *                       unanchored
+ * @param  scratch       Room for N_PRINTABLE + 1 subsets
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int explore(Builder* b, const Word* start_closure, Word* scratch) {
+    DFA* dfa = b->dfa;
+
+    // The empty set is interned first, making it the dead state
+    Word* empty = &scratch[b->n_words * N_PRINTABLE];
+    if (intern_set(b, empty) != DFA_DEAD_STATE) {
+        return -1;
+    }
+
+    if (start_closure == NULL) {
+        dfa->start_state = DFA_DEAD_STATE;
+    } else {
+        int start = intern_set(b, start_closure);
+        if (start < 0) {
+            return -1;
+        }
+        dfa->start_state = start;
+    }
+
+    // States are numbered in the order they are discovered, so walking the
+    // ids in order is a breadth first traversal. In anchored DFAs, the dead
+    // state's row is already complete.
+    for (size_t id = start_closure == NULL ? 0 : 1; id < dfa->n_states; id++) {
+        if (expand_state(b, id, scratch) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+#ifndef WIN32_LEAN_AND_MEAN
+
+// The states found by the parallel subset construction are stored in blocks
+// of this many, allocated as they are needed, so storage never moves under
+// the threads reading it
+#define BLOCK_STATES 64
+#define N_BLOCKS (DFA_MAX_STATES / BLOCK_STATES)
+
+// The hash table is never resized, so it has room for every state at a
+// load factor of a half
+#define N_SHARED_BUCKETS (2 * DFA_MAX_STATES)
+
+// Marks a bucket claimed by a thread still adding the state it will hold.
+// Threads probing a busy bucket yield until it is filled in, so a thread
+// preempted while holding one stalls them, which `make bench` times.
+#define BUSY_BUCKET (UINT32_MAX - 1)
+
+/**
+ * Storage for a block of states of the parallel subset construction
+ *
+ * Members
+ *     - sets: The subset of NFA states for every state
+ *     - rows: The transitions out of every state, DFA_ALPHABET_SIZE each
+ *     - is_final: Whether each state is an accepting state
+ *     - accepts: The parts accepting in every state, when they are recorded
+ *     - ready: Whether each state's subset has been filled in
+ */
+typedef struct StateBlock {
+    Word* sets;
+    uint32_t* rows;
+    bool is_final[BLOCK_STATES];
+    Word* accepts;
+    atomic_bool ready[BLOCK_STATES];
+} StateBlock;
+
+/**
+ * Shared by the threads of the parallel subset construction. Threads take
+ * the next state to expand from a counter, and intern the subsets it leads
+ * to in a hash table whose buckets are claimed with compare and swap.
+ *
+ * Members
+ *     - b: The closures and other read only data of the construction
+ *     - blocks: The storage of the states found so far
+ *     - buckets: Open addressing hash table of state numbers
+ *     - n_states: The number of states given a number so far
+ *     - next: The next state to expand
+ *     - n_expanded: The number of states whose row is complete. The
+ *                   construction is over once every state is expanded.
+ *     - failed: Set by any thread that runs out of memory or states
+ */
+typedef struct SharedBuilder {
+    Builder* b;
+    _Atomic(StateBlock*) blocks[N_BLOCKS];
+    _Atomic uint32_t buckets[N_SHARED_BUCKETS];
+    atomic_size_t n_states;
+    atomic_size_t next;
+    atomic_size_t n_expanded;
+    atomic_bool failed;
+} SharedBuilder;
+
+typedef struct SharedWorker {
+    SharedBuilder* shared;
+    Word* scratch;
+} SharedWorker;
+
+static void block_free(StateBlock* block) {
+    if (block != NULL) {
+        free(block->sets);
+        free(block->rows);
+        free(block->accepts);
+        free(block);
+    }
+}
+
+// Find the block holding the given state, allocating it if no other thread
+// has yet
+static StateBlock* get_block(SharedBuilder* s, size_t id) {
+    _Atomic(StateBlock*)* slot = &s->blocks[id / BLOCK_STATES];
+    StateBlock* block = atomic_load(slot);
+    if (block != NULL) {
+        return block;
+    }
+
+    block = calloc(1, sizeof(StateBlock));
+    if (block == NULL) {
+        return NULL;
+    }
+
+    size_t accept_words = s->b->dfa->accept_words;
+    block->sets = malloc(sizeof(Word) * s->b->n_words * BLOCK_STATES);
+    block->rows = calloc(DFA_ALPHABET_SIZE * BLOCK_STATES, sizeof(uint32_t));
+    block->accepts = s->b->tags != NULL ? malloc(sizeof(Word) * accept_words * BLOCK_STATES) : NULL;
+
+    if (block->sets == NULL || block->rows == NULL || (s->b->tags != NULL && block->accepts == NULL)) {
+        block_free(block);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < BLOCK_STATES; i++) {
+        atomic_init(&block->ready[i], false);
+    }
+
+    // Another thread may have allocated it in the meantime
+    StateBlock* expected = NULL;
+    if (!atomic_compare_exchange_strong(slot, &expected, block)) {
+        block_free(block);
+        return expected;
+    }
+
+    return block;
+}
+
+// The subset of a state that is ready
+static const Word* shared_set(SharedBuilder* s, size_t id) {
+    StateBlock* block = atomic_load(&s->blocks[id / BLOCK_STATES]);
+    return &block->sets[id % BLOCK_STATES * s->b->n_words];
+}
+
+// Give the given subset a new state number, and fill in the state
+static int add_shared_state(SharedBuilder* s, const Word* set) {
+    size_t id = atomic_fetch_add(&s->n_states, 1);
+    StateBlock* block = id < DFA_MAX_STATES ? get_block(s, id) : NULL;
+    if (block == NULL) {
+        atomic_store(&s->failed, true);
+        return -1;
+    }
+
+    size_t i = id % BLOCK_STATES;
+    size_t accept_words = s->b->dfa->accept_words;
+    memcpy(&block->sets[i * s->b->n_words], set, sizeof(Word) * s->b->n_words);
+
+    Word* accepts = block->accepts != NULL ? &block->accepts[i * accept_words] : NULL;
+    block->is_final[i] = describe_set(s->b, set, accepts);
+
+    atomic_store(&block->ready[i], true);
+    return id;
+}
+
+// Find the state for the given subset, creating it if necessary. Equal
+// subsets hash to the same bucket chain, and a thread adding a state holds
+// its bucket busy until the state is ready, so every subset gets exactly one
+// state.
+static int intern_shared(SharedBuilder* s, const Word* set) {
+    size_t bytes = sizeof(Word) * s->b->n_words;
+
+    for (size_t h = hash_set(set, s->b->n_words);; h++) {
+        _Atomic uint32_t* bucket = &s->buckets[h & (N_SHARED_BUCKETS - 1)];
+        uint32_t id = atomic_load(bucket);
+
+        if (id == EMPTY_BUCKET && atomic_compare_exchange_strong(bucket, &id, BUSY_BUCKET)) {
+            int added = add_shared_state(s, set);
+            if (added >= 0) {
+                atomic_store(bucket, added);
+            }
+            return added;
+        }
+
+        // The bucket is taken, possibly by a state still being added
+        while (id == BUSY_BUCKET) {
+            if (atomic_load(&s->failed)) {
+                return -1;
+            }
+            sched_yield();
+            id = atomic_load(bucket);
+        }
+
+        if (memcmp(shared_set(s, id), set, bytes) == 0) {
+            return id;
+        }
+    }
+}
+
+// Compute the transitions out of the given state, on every character
+static int expand_shared_state(SharedBuilder* s, size_t id, Word* next) {
+    // The state may have been numbered, but not yet filled in
+    StateBlock* block;
+    while ((block = atomic_load(&s->blocks[id / BLOCK_STATES])) == NULL
+           || !atomic_load(&block->ready[id % BLOCK_STATES])) {
+        if (atomic_load(&s->failed)) {
+            return -1;
+        }
+        sched_yield();
+    }
+
+    gather_successors(s->b, shared_set(s, id), next);
+
+    uint32_t* row = &block->rows[id % BLOCK_STATES * DFA_ALPHABET_SIZE];
+    for (int c = FIRST_PRINTABLE; c <= LAST_PRINTABLE; c++) {
+        int target = intern_shared(s, &next[(c - FIRST_PRINTABLE) * s->b->n_words]);
+        if (target < 0) {
+            return -1;
+        }
+        row[c] = target;
+    }
+
+    return 0;
+}
+
+// Expand states until every state found is expanded
+static void* expand_shared_states(void* arg) {
+    SharedWorker* worker = arg;
+    SharedBuilder* s = worker->shared;
+
+    while (!atomic_load(&s->failed)) {
+        size_t id = atomic_load(&s->next);
+        if (id < atomic_load(&s->n_states)) {
+            if (!atomic_compare_exchange_weak(&s->next, &id, id + 1)) {
+                continue;
+            }
+
+            if (expand_shared_state(s, id, worker->scratch) < 0) {
+                atomic_store(&s->failed, true);
+                return NULL;
+            }
+
+            atomic_fetch_add(&s->n_expanded, 1);
+            continue;
+        }
+
+        // States are numbered before the expansion finding them completes,
+        // so once every numbered state is expanded no more can appear
+        size_t n_expanded = atomic_load(&s->n_expanded);
+        if (n_expanded == atomic_load(&s->n_states)) {
+            return NULL;
+        }
+
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+// Copy the states found by the threads into the DFA, replacing its tables
+static int collect_shared_states(SharedBuilder* s) {
+    DFA* dfa = s->b->dfa;
+    size_t n_states = atomic_load(&s->n_states);
+    size_t accept_words = dfa->accept_words;
+
+    uint32_t* table = malloc(sizeof(uint32_t) * DFA_ALPHABET_SIZE * n_states);
+    bool* is_final = malloc(sizeof(bool) * n_states);
+    Word* accepts = s->b->tags != NULL ? malloc(sizeof(Word) * accept_words * n_states) : NULL;
+
+    if (table == NULL || is_final == NULL || (s->b->tags != NULL && accepts == NULL)) {
+        free(table);
+        free(is_final);
+        free(accepts);
+        return -1;
+    }
+
+    for (size_t id = 0; id < n_states; id++) {
+        StateBlock* block = atomic_load(&s->blocks[id / BLOCK_STATES]);
+        size_t i = id % BLOCK_STATES;
+
+        memcpy(&table[id * DFA_ALPHABET_SIZE], &block->rows[i * DFA_ALPHABET_SIZE],
+               sizeof(uint32_t) * DFA_ALPHABET_SIZE);
+        is_final[id] = block->is_final[i];
+        if (accepts != NULL) {
+            memcpy(&accepts[id * accept_words], &block->accepts[i * accept_words],
+                   sizeof(Word) * accept_words);
+        }
+    }
+
+    free(dfa->table);
+    free(dfa->is_final);
+    free(dfa->accepts);
+    dfa->table = table;
+    dfa->is_final = is_final;
+    dfa->accepts = accepts;
+    dfa->n_states = n_states;
+    return 0;
+}
+
+/**
+ * Run the subset construction on several threads. Every thread takes the
+ * next state to expand, so the states found by one are soon expanded by
+ * the others. States are numbered in whatever order the threads find them,
+ * but minimizing renumbers them breadth first, giving the same DFA as the
+ * serial construction.
+ *
+ * @param  b             The builder, with the closures computed
+ * @param  start_closure The subset of the start state, NULL if the DFA is
+ *                       unanchored
+ * @param  n_threads     The number of threads to use
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int explore_parallel(Builder* b, const Word* start_closure, size_t n_threads) {
+    SharedBuilder* s = calloc(1, sizeof(SharedBuilder));
+    SharedWorker* workers = calloc(n_threads, sizeof(SharedWorker));
+    Word* scratch = calloc(b->n_words * (N_PRINTABLE * n_threads + 1), sizeof(Word));
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    bool* started = calloc(n_threads, sizeof(bool));
+    int status = -1;
+
+    if (s == NULL || workers == NULL || scratch == NULL || threads == NULL || started == NULL) {
+        goto done;
+    }
+
+    s->b = b;
+    for (size_t i = 0; i < N_BLOCKS; i++) {
+        atomic_init(&s->blocks[i], NULL);
+    }
+    for (size_t i = 0; i < N_SHARED_BUCKETS; i++) {
+        atomic_init(&s->buckets[i], EMPTY_BUCKET);
+    }
+    atomic_init(&s->n_states, 0);
+    atomic_init(&s->failed, false);
+
+    // The dead state and the start state are numbered as in the serial
+    // construction. An anchored DFA's dead state has no row to fill in.
+    Word* empty = &scratch[b->n_words * N_PRINTABLE * n_threads];
+    if (intern_shared(s, empty) != DFA_DEAD_STATE
+        || (start_closure != NULL && intern_shared(s, start_closure) < 0)) {
+        goto done;
+    }
+
+    b->dfa->start_state = start_closure != NULL ? 1 : DFA_DEAD_STATE;
+    atomic_init(&s->next, start_closure != NULL ? 1 : 0);
+    atomic_init(&s->n_expanded, start_closure != NULL ? 1 : 0);
+
+    for (size_t i = 0; i < n_threads; i++) {
+        workers[i] = (SharedWorker) {
+            .shared = s,
+            .scratch = &scratch[b->n_words * N_PRINTABLE * i],
+        };
+    }
+
+    for (size_t i = 1; i < n_threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL, expand_shared_states, &workers[i]) == 0;
+    }
+
+    // The calling thread expands states too, so the construction finishes
+    // even if no thread could be started
+    expand_shared_states(&workers[0]);
+
+    for (size_t i = 1; i < n_threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    if (!atomic_load(&s->failed)) {
+        status = collect_shared_states(s);
+    }
+
+done:
+    if (s != NULL) {
+        for (size_t i = 0; i < N_BLOCKS; i++) {
+            block_free(atomic_load(&s->blocks[i]));
+        }
+    }
+
+    free(s);
+    free(workers);
+    free(scratch);
+    free(threads);
+    free(started);
+    return status;
+}
+
+#endif // WIN32_LEAN_AND_MEAN
+
+/**
+ * Run the subset construction on the given NFA, and minimize the result
+ *
+ * @param  nfa       The NFA to convert
+ * @param  mode      Whether matches must start at the beginning of the input
+ * @param  parts     The NFAs the start state of `nfa` leads to, whose
+ *                   accepting states are recorded. NULL if only whether a
+ *                   state accepts is needed.
+ * @param  n_parts   The number of parts
+ * @param  n_threads The number of threads to use, 0 for one per processor
+ *
+ * @return A pointer to a heap allocated DFA on success, NULL on failure
+ */
+static DFA* build(NFA* nfa, DFAMode mode, NFA* const* parts, size_t n_parts,
+                  size_t n_threads) {
+    DFA* dfa = calloc(1, sizeof(DFA));
+    if (dfa == NULL) {
+        return NULL;
+    }
+
+    Builder b = {
+        .states = nfa_states(nfa),
+        .dfa = dfa,
+        .table_capacity = 16,
+        .n_buckets = 32,
+    };
+
+    if (b.states == NULL) {
+        free(dfa);
+        return NULL;
+    }
+
+    qsort(b.states->list, b.states->size, sizeof(NFAState*), state_id_cmp);
+
+    b.n_words = (b.states->size + WORD_BITS - 1) / WORD_BITS;
+    b.closures = calloc(b.states->size * b.n_words, sizeof(Word));
+    b.finals = calloc(b.n_words, sizeof(Word));
+    b.sets = malloc(sizeof(Word) * b.n_words * b.table_capacity);
+    b.buckets = malloc(sizeof(uint32_t) * b.n_buckets);
+    dfa->table = malloc(sizeof(uint32_t) * DFA_ALPHABET_SIZE * b.table_capacity);
+    dfa->is_final = malloc(sizeof(bool) * b.table_capacity);
+
+    Word* scratch = calloc(b.n_words * (N_PRINTABLE + 1), sizeof(Word));
+
+    if (b.closures == NULL || b.finals == NULL || b.sets == NULL
+        || b.buckets == NULL || dfa->table == NULL || dfa->is_final == NULL
+        || scratch == NULL || compute_closures(&b) < 0) {
+        goto fail;
+    }
+
+    if (parts != NULL) {
+        dfa->accept_words = (n_parts + WORD_BITS - 1) / WORD_BITS;
+        dfa->accepts = malloc(sizeof(Word) * dfa->accept_words * b.table_capacity);
+        if (dfa->accepts == NULL || compute_tags(&b, parts, n_parts) < 0) {
+            goto fail;
+        }
+    }
+
+    memset(b.buckets, 0xFF, sizeof(uint32_t) * b.n_buckets);
+
+    if (n_threads == 0) {
+        int n_processors = n_processors_online();
+        n_threads = n_processors > 0 ? n_processors : 1;
+    }
+
+    // An unanchored DFA starts with no match in progress, and begins a new
+    // one on every byte. This makes the empty set its start state.
+    const Word* start_closure = &b.closures[state_index(&b, nfa->start_state) * b.n_words];
+    if (mode == DFA_UNANCHORED) {
+        b.injected = start_closure;
+        start_closure = NULL;
+    }
+
+#ifndef WIN32_LEAN_AND_MEAN
+    int explored = n_threads > 1
+        ? explore_parallel(&b, start_closure, n_threads)
+        : explore(&b, start_closure, scratch);
+#else
+    int explored = explore(&b, start_closure, scratch);
+#endif
+
+    if (explored < 0) {
+        goto fail;
+    }
+
+    dfa->origin = malloc(sizeof(uint32_t) * dfa->n_states);
+    if (dfa->origin == NULL || dfa_minimize(dfa) < 0) {
+        goto fail;
+    }
+
+    free(scratch);
+    builder_free(&b);
+    return dfa;
+
+fail:
+    free(scratch);
+    builder_free(&b);
+    dfa_free(dfa);
+    free(dfa);
+    return NULL;
+}
+
+// Create a DFA equivalent to the given NFA
+DFA* dfa_create(NFA* nfa, DFAMode mode) {
+    if (nfa == NULL) {
+        return NULL;
+    }
+
+    return build(nfa, mode, NULL, 0, 1);
+}
+
+// Create a DFA equivalent to the given NFA, expanding states on several
+// threads
+DFA* dfa_create_parallel(NFA* nfa, DFAMode mode, size_t n_threads) {
+    if (nfa == NULL) {
+        return NULL;
+    }
+
+    return build(nfa, mode, NULL, 0, n_threads);
+}
+
+// Create an anchored DFA for an NFA made of several parts, recording which
+// parts accept in each state
+DFA* dfa_create_set(NFA* nfa, NFA* const* parts, size_t n_parts, size_t n_threads) {
+    if (nfa == NULL || parts == NULL || n_parts == 0) {
+        return NULL;
+    }
+
+    return build(nfa, DFA_ANCHORED, parts, n_parts, n_threads);
+}
+
+// Compares two states of a DFA being minimized, given the class of every
+// state
+typedef int (*state_cmp_cb)(const DFA* dfa, const uint32_t* classes, uint32_t x, uint32_t y);
+
+// Order states by their class, then by the classes of their successors
+static int signature_cmp(const DFA* dfa, const uint32_t* classes, uint32_t x, uint32_t y) {
+    const uint32_t* table = dfa->table;
+
+    if (classes[x] != classes[y]) {
+        return classes[x] < classes[y] ? -1 : 1;
+    }
+
+    for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+        uint32_t cx = classes[table[x * DFA_ALPHABET_SIZE + c]];
+        uint32_t cy = classes[table[y * DFA_ALPHABET_SIZE + c]];
+        if (cx != cy) {
+            return cx < cy ? -1 : 1;
+        }
+    }
+
+    return (x > y) - (x < y);
+}
+
+// Order states by the parts accepting in them
+static int accepts_cmp(const DFA* dfa, const uint32_t* classes, uint32_t x, uint32_t y) {
+    (void) classes;
+    size_t words = dfa->accept_words;
+    return memcmp(&dfa->accepts[x * words], &dfa->accepts[y * words], sizeof(Word) * words);
+}
+
+/**
+ * Sort states with a bottom up merge sort. Unlike qsort, the comparison is
+ * given the tables it compares.
+ *
+ * @param states  The states to sort
+ * @param scratch Room for `n` states
+ * @param n       The number of states
+ * @param cmp     The comparison
+ * @param dfa     The DFA the states are in
+ * @param classes The class of every state
+ */
+static void sort_states(uint32_t* states, uint32_t* scratch, size_t n, state_cmp_cb cmp,
+                        const DFA* dfa, const uint32_t* classes) {
+    uint32_t* from = states;
+    uint32_t* to = scratch;
+
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+
+            while (i < mid && j < hi) {
+                to[k++] = cmp(dfa, classes, from[j], from[i]) < 0 ? from[j++] : from[i++];
+            }
+            while (i < mid) {
+                to[k++] = from[i++];
+            }
+            while (j < hi) {
+                to[k++] = from[j++];
+            }
+        }
+
+        uint32_t* temp = from;
+        from = to;
+        to = temp;
+    }
+
+    if (from != states) {
+        memcpy(states, from, sizeof(uint32_t) * n);
+    }
+}
+
+static bool same_signature(const uint32_t* classes, const uint32_t* table, uint32_t x, uint32_t y) {
+    if (classes[x] != classes[y]) {
+        return false;
+    }
+
+    const uint32_t* row_x = &table[x * DFA_ALPHABET_SIZE];
+    const uint32_t* row_y = &table[y * DFA_ALPHABET_SIZE];
+    for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+        if (classes[row_x[c]] != classes[row_y[c]]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Merge equivalent states of the given DFA
+int dfa_minimize(DFA* dfa) {
+    if (dfa == NULL) {
+        return -1;
+    }
+
+    size_t n = dfa->n_states;
+    uint32_t* classes = malloc(sizeof(uint32_t) * n);
+    uint32_t* next = malloc(sizeof(uint32_t) * n);
+    uint32_t* sorted = malloc(sizeof(uint32_t) * n);
+    uint32_t* new_id = malloc(sizeof(uint32_t) * n);
+    uint32_t* queue = malloc(sizeof(uint32_t) * n);
+
+    if (classes == NULL || next == NULL || sorted == NULL || new_id == NULL || queue == NULL) {
+        goto fail;
+    }
+
+    // Moore's algorithm: start by splitting accepting and other states, then
+    // keep splitting classes whose members disagree on a successor's class
+    size_t n_classes = 0;
+    for (size_t i = 0; i < n; i++) {
+        classes[i] = dfa->is_final[i];
+        sorted[i] = i;
+    }
+
+    // `queue` is not needed until the classes are numbered, so the sorts
+    // use it as scratch space until then
+
+    // States accepting for different parts must stay apart
+    if (dfa->accepts != NULL) {
+        sort_states(sorted, queue, n, accepts_cmp, dfa, classes);
+
+        classes[sorted[0]] = 0;
+        for (size_t i = 1; i < n; i++) {
+            classes[sorted[i]] = classes[sorted[i - 1]]
+                + (accepts_cmp(dfa, classes, sorted[i - 1], sorted[i]) != 0);
+        }
+    }
+
+    for (;;) {
+        sort_states(sorted, queue, n, signature_cmp, dfa, classes);
+
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0 && !same_signature(classes, dfa->table, sorted[i - 1], sorted[i])) {
+                count++;
+            }
+            next[sorted[i]] = count;
+        }
+        count++;
+
+        uint32_t* temp = classes;
+        classes = next;
+        next = temp;
+
+        if (count == n_classes) {
+            break;
+        }
+        n_classes = count;
+    }
+
+    // Number the classes breadth first from the start state, keeping the
+    // class of the dead state at the front
+    for (size_t i = 0; i < n; i++) {
+        new_id[i] = UINT32_MAX;
+    }
+
+    size_t head = 0, tail = 0;
+    uint32_t roots[] = {DFA_DEAD_STATE, dfa->start_state};
+    for (size_t r = 0; r < 2; r++) {
+        if (new_id[classes[roots[r]]] == UINT32_MAX) {
+            new_id[classes[roots[r]]] = tail;
+            queue[tail++] = roots[r];
+        }
+    }
+
+    while (head < tail) {
+        const uint32_t* row = &dfa->table[queue[head++] * DFA_ALPHABET_SIZE];
+        for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+            if (new_id[classes[row[c]]] == UINT32_MAX) {
+                new_id[classes[row[c]]] = tail;
+                queue[tail++] = row[c];
+            }
+        }
+    }
+
+    // `queue` now holds one representative for each reachable class
+    size_t n_states = tail;
+    size_t words = dfa->accept_words;
+    uint32_t* table = malloc(sizeof(uint32_t) * DFA_ALPHABET_SIZE * n_states);
+    bool* is_final = malloc(sizeof(bool) * n_states);
+    Word* accepts = NULL;
+    if (dfa->accepts != NULL) {
+        accepts = malloc(sizeof(Word) * words * n_states);
+    }
+
+    if (table == NULL || is_final == NULL || (dfa->accepts != NULL && accepts == NULL)) {
+        free(table);
+        free(is_final);
+        free(accepts);
+        goto fail;
+    }
+
+    for (size_t i = 0; i < n_states; i++) {
+        const uint32_t* old_row = &dfa->table[queue[i] * DFA_ALPHABET_SIZE];
+        for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+            table[i * DFA_ALPHABET_SIZE + c] = new_id[classes[old_row[c]]];
+        }
+        is_final[i] = dfa->is_final[queue[i]];
+        dfa->origin[i] = i;
+
+        if (accepts != NULL) {
+            memcpy(&accepts[i * words], &dfa->accepts[queue[i] * words], sizeof(Word) * words);
+        }
+    }
+
+    free(dfa->table);
+    free(dfa->is_final);
+    free(dfa->accepts);
+
+    dfa->table = table;
+    dfa->is_final = is_final;
+    dfa->accepts = accepts;
+    dfa->start_state = new_id[classes[dfa->start_state]];
+    dfa->n_states = n_states;
+
+    free(classes);
+    free(next);
+    free(sorted);
+    free(new_id);
+    free(queue);
+    return 0;
+
+fail:
+    free(classes);
+    free(next);
+    free(sorted);
+    free(new_id);
+    free(queue);
+    return -1;
+}
+
+// Releases the memory used by the given DFA
+void dfa_free(DFA* dfa) {
+    if (dfa == NULL) {
+        return;
+    }
+
+    free(dfa->table);
+    free(dfa->is_final);
+    free(dfa->origin);
+    free(dfa->accepts);
+
+    dfa->table = NULL;
+    dfa->is_final = NULL;
+    dfa->origin = NULL;
+    dfa->accepts = NULL;
+    dfa->n_states = 0;
+}
+
+// Count the non-overlapping matches in the given string
+size_t dfa_count(const DFA* dfa, const char* string, size_t len) {
+    if (dfa == NULL || string == NULL) {
+        return 0;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = dfa->table;
+    const bool* is_final = dfa->is_final;
+    uint32_t state = dfa->start_state;
+    size_t count = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+
+        // A match just ended, the next one may only start after it
+        if (is_final[state]) {
+            count++;
+            state = dfa->start_state;
+        }
+    }
+
+    return count;
+}
+
+// Find the end of the first match in the given string
+ssize_t dfa_find_end(const DFA* dfa, const char* string, size_t len) {
+    if (dfa == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = dfa->table;
+    uint32_t state = dfa->start_state;
+
+    for (size_t i = 0; i < len; i++) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        if (dfa->is_final[state]) {
+            return i + 1;
+        }
+    }
+
+    return -1;
+}
+
+// Find the end of the first match, stopping once no match is in progress
+ssize_t dfa_find_end_until_idle(const DFA* dfa, const char* string, size_t len,
+                                size_t* idle) {
+    if (dfa == NULL || string == NULL || idle == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = dfa->table;
+    uint32_t state = dfa->start_state;
+
+    for (size_t i = 0; i < len; i++) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        if (dfa->is_final[state]) {
+            return i + 1;
+        }
+
+        if (state == DFA_DEAD_STATE) {
+            *idle = i + 1;
+            return -1;
+        }
+    }
+
+    *idle = len;
+    return -1;
+}
+
+// Find where the longest match ending at `end` starts
+ssize_t dfa_find_start(const DFA* reverse, const char* string, size_t end) {
+    if (reverse == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = reverse->table;
+    uint32_t state = reverse->start_state;
+    ssize_t start = -1;
+
+    for (size_t i = end; i > 0; i--) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i - 1]];
+        if (state == DFA_DEAD_STATE) {
+            break;
+        }
+
+        // Keep going, an earlier start makes a longer match
+        if (reverse->is_final[state]) {
+            start = i - 1;
+        }
+    }
+
+    return start;
+}
+
+// Find where the longest match ending at `end` starts, looking no further
+// back than `min_start`
+ssize_t dfa_find_start_after(const DFA* reverse, const char* string, size_t min_start,
+                             size_t end, bool* exhausted) {
+    if (reverse == NULL || string == NULL || exhausted == NULL || min_start > end) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = reverse->table;
+    uint32_t state = reverse->start_state;
+    ssize_t start = -1;
+
+    *exhausted = false;
+
+    for (size_t i = end; i > min_start; i--) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i - 1]];
+        if (state == DFA_DEAD_STATE) {
+            return start;
+        }
+
+        if (reverse->is_final[state]) {
+            start = i - 1;
+        }
+    }
+
+    *exhausted = true;
+    return start;
+}
+
+// Find the length of the longest match at the start of the given string
+ssize_t dfa_longest_match(const DFA* dfa, const char* string, size_t len) {
+    if (dfa == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = dfa->table;
+    uint32_t state = dfa->start_state;
+    ssize_t longest = -1;
+
+    for (size_t i = 0; i < len; i++) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        if (state == DFA_DEAD_STATE) {
+            break;
+        }
+
+        if (dfa->is_final[state]) {
+            longest = i + 1;
+        }
+    }
+
+    return longest;
+}
+
+// Perform a regex match using the given DFA on the given string
+bool dfa_match(const DFA* dfa, const char* string, size_t len) {
+    if (dfa == NULL || string == NULL) {
+        return false;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const uint32_t* table = dfa->table;
+    uint32_t state = dfa->start_state;
+
+    for (size_t i = 0; i < len; i++) {
+        state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        if (state == DFA_DEAD_STATE) {
+            return false;
+        }
+    }
+
+    return dfa->is_final[state];
+}
+
+// Search the product of two anchored DFAs, breadth first from the pair of
+// start states, for a pair where `a` accepts and `b` does not. When
+// `symmetric`, a pair where `b` accepts and `a` does not counts too.
+// Returns 1 if such a pair is reachable, 0 if not, -1 on failure.
+static int find_difference(const DFA* a, const DFA* b, bool symmetric) {
+    size_t n_b = b->n_states;
+    size_t n_pairs = a->n_states * n_b;
+
+    // Pair (x, y) is numbered x * n_b + y
+    Word* seen = calloc((n_pairs + WORD_BITS - 1) / WORD_BITS, sizeof(Word));
+    size_t queue_cap = 64;
+    size_t* queue = malloc(sizeof(size_t) * queue_cap);
+    if (seen == NULL || queue == NULL) {
+        free(seen);
+        free(queue);
+        return -1;
+    }
+
+    size_t head = 0;
+    size_t tail = 0;
+    size_t start = (size_t) a->start_state * n_b + b->start_state;
+    set_bit(seen, start);
+    queue[tail++] = start;
+
+    int result = 0;
+
+    while (head < tail) {
+        size_t pair = queue[head++];
+        uint32_t x = pair / n_b;
+        uint32_t y = pair % n_b;
+
+        if ((a->is_final[x] && !b->is_final[y])
+            || (symmetric && b->is_final[y] && !a->is_final[x])) {
+            result = 1;
+            break;
+        }
+
+        // The dead state of `a` accepts nothing, so neither does anything
+        // reached from it. The same goes for `b` when comparing both ways.
+        if (x == DFA_DEAD_STATE && (!symmetric || y == DFA_DEAD_STATE)) {
+            continue;
+        }
+
+        const uint32_t* row_a = &a->table[x * DFA_ALPHABET_SIZE];
+        const uint32_t* row_b = &b->table[y * DFA_ALPHABET_SIZE];
+
+        for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+            size_t next = (size_t) row_a[c] * n_b + row_b[c];
+            if (has_bit(seen, next)) {
+                continue;
+            }
+            set_bit(seen, next);
+
+            if (tail == queue_cap) {
+                // Every pair is queued at most once
+                size_t cap = queue_cap * 2 < n_pairs ? queue_cap * 2 : n_pairs;
+                size_t* grown = realloc(queue, sizeof(size_t) * cap);
+                if (grown == NULL) {
+                    result = -1;
+                    goto done;
+                }
+                queue = grown;
+                queue_cap = cap;
+            }
+            queue[tail++] = next;
+        }
+    }
+
+done:
+    free(seen);
+    free(queue);
+    return result;
+}
+
+// Check whether every string accepted by `a` is accepted by `b`
+int dfa_is_subset(const DFA* a, const DFA* b) {
+    if (a == NULL || b == NULL) {
+        return -1;
+    }
+
+    int difference = find_difference(a, b, false);
+    return difference < 0 ? -1 : !difference;
+}
+
+// Check whether two DFAs accept the same strings
+int dfa_is_equivalent(const DFA* a, const DFA* b) {
+    if (a == NULL || b == NULL) {
+        return -1;
+    }
+
+    int difference = find_difference(a, b, true);
+    return difference < 0 ? -1 : !difference;
+}
+
+// Run the given string through the DFA, counting visits to each state
+int dfa_profile(const DFA* dfa, const char* string, size_t len, size_t* counts) {
+    if (dfa == NULL || string == NULL || counts == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    uint32_t state = dfa->start_state;
+    counts[state]++;
+
+    // An unanchored DFA starts in the dead state, and keeps scanning from
+    // it, so only an anchored one stops there
+    bool anchored = dfa->start_state != DFA_DEAD_STATE;
+
+    for (size_t i = 0; i < len && (!anchored || state != DFA_DEAD_STATE); i++) {
+        state = dfa->table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        counts[state]++;
+    }
+
+    return 0;
+}
+
+// Used to sort states by their visit counts
+typedef struct StateVisits {
+    size_t state;
+    size_t visits;
+} StateVisits;
+
+static int visits_cmp(const void* a, const void* b) {
+    const StateVisits* x = a;
+    const StateVisits* y = b;
+
+    if (x->visits != y->visits) {
+        return x->visits < y->visits ? 1 : -1;
+    }
+
+    // Keep the current order between states with the same visits
+    return (x->state > y->state) - (x->state < y->state);
+}
+
+// Compute a state order with the most visited states first
+int dfa_hot_order(const DFA* dfa, const size_t* counts, size_t* order) {
+    if (dfa == NULL || counts == NULL || order == NULL) {
+        return -1;
+    }
+
+    size_t n = dfa->n_states;
+    StateVisits* visits = malloc(sizeof(StateVisits) * n);
+    if (visits == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        visits[i] = (StateVisits) {.state = i, .visits = counts[i]};
+    }
+
+    // The dead state is pinned at the front, sort everything after it
+    qsort(&visits[1], n - 1, sizeof(StateVisits), visits_cmp);
+
+    // Report the order in terms of the original numbering, so it can be
+    // applied to a freshly constructed DFA
+    for (size_t i = 0; i < n; i++) {
+        order[i] = dfa->origin[visits[i].state];
+    }
+
+    free(visits);
+    return 0;
+}
+
+// Renumber the states of the DFA, and rearrange the transition table
+int dfa_renumber(DFA* dfa, const size_t* order) {
+    if (dfa == NULL || order == NULL || order[0] != DFA_DEAD_STATE) {
+        return -1;
+    }
+
+    size_t n = dfa->n_states;
+
+    // current[i] is the current number of the state originally numbered i
+    // new_id[i] is the number the state currently numbered i will have
+    uint32_t* current = malloc(sizeof(uint32_t) * n);
+    uint32_t* new_id = malloc(sizeof(uint32_t) * n);
+    uint32_t* table = malloc(sizeof(uint32_t) * DFA_ALPHABET_SIZE * n);
+    bool* is_final = malloc(sizeof(bool) * n);
+    size_t words = dfa->accept_words;
+    Word* accepts = NULL;
+    if (dfa->accepts != NULL) {
+        accepts = malloc(sizeof(Word) * words * n);
+    }
+
+    if (current == NULL || new_id == NULL || table == NULL || is_final == NULL
+        || (dfa->accepts != NULL && accepts == NULL)) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        current[dfa->origin[i]] = i;
+        new_id[i] = UINT32_MAX;
+    }
+
+    // Make sure the order is a permutation
+    for (size_t i = 0; i < n; i++) {
+        if (order[i] >= n || new_id[current[order[i]]] != UINT32_MAX) {
+            goto fail;
+        }
+        new_id[current[order[i]]] = i;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t old = current[order[i]];
+        const uint32_t* old_row = &dfa->table[old * DFA_ALPHABET_SIZE];
+        uint32_t* row = &table[i * DFA_ALPHABET_SIZE];
+
+        for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+            row[c] = new_id[old_row[c]];
+        }
+
+        is_final[i] = dfa->is_final[old];
+        dfa->origin[i] = order[i];
+
+        if (accepts != NULL) {
+            memcpy(&accepts[i * words], &dfa->accepts[old * words], sizeof(Word) * words);
+        }
+    }
+
+    free(dfa->table);
+    free(dfa->is_final);
+    free(dfa->accepts);
+
+    dfa->table = table;
+    dfa->is_final = is_final;
+    dfa->accepts = accepts;
+    dfa->start_state = new_id[dfa->start_state];
+
+    free(current);
+    free(new_id);
+    return 0;
+
+fail:
+    free(current);
+    free(new_id);
+    free(table);
+    free(is_final);
+    free(accepts);
+    return -1;
+}
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+
+#include "ast.h"
+#include "glushkov.h"
+
+#define BIT(p) ((PositionSet) 1 << (p))
+
+/**
+ * Properties of a sub-pattern, used to build the follow sets
+ *
+ * Members
+ *     - nullable: Whether or not the sub-pattern matches the empty string
+ *     - first: The positions a match of the sub-pattern may start with
+ *     - last: The positions a match of the sub-pattern may end with
+ */
+typedef struct Positions {
+    bool nullable;
+    PositionSet first;
+    PositionSet last;
+} Positions;
+
+// Every position in `from` may be followed by every position in `to`
+static void link_positions(Glushkov* glushkov, PositionSet from, PositionSet to) {
+    for (size_t p = 1; p <= glushkov->n_positions; p++) {
+        if (from & BIT(p)) {
+            glushkov->follow[p] |= to;
+        }
+    }
+}
+
+/**
+ * Number the positions of the AST from left to right, and fill in their
+ * follow sets.
+ *
+ * @return 0 on success, -1 if there are too many positions
+ */
+static int visit(Glushkov* glushkov, ASTNode* node, Positions* out) {
+    Positions left, right;
+
+    switch (node->type) {
+    case CHAR_NODE:;
+        if (glushkov->n_positions == GLUSHKOV_MAX_POSITIONS) {
+            return -1;
+        }
+
+        size_t p = ++glushkov->n_positions;
+        glushkov->masks[(unsigned char) node->extra.character] |= BIT(p);
+        *out = (Positions) {.nullable = false, .first = BIT(p), .last = BIT(p)};
+        return 0;
+
+    case STAR_NODE:
+    case PLUS_NODE:
+    case QUESTION_NODE:
+        if (visit(glushkov, node->child1, &left) < 0) {
+            return -1;
+        }
+
+        // Repetitions may go from the end of the child back to its start
+        if (node->type != QUESTION_NODE) {
+            link_positions(glushkov, left.last, left.first);
+        }
+
+        *out = left;
+        out->nullable = left.nullable || node->type != PLUS_NODE;
+        return 0;
+
+    case OR_NODE:
+        if (visit(glushkov, node->child1, &left) < 0
+            || visit(glushkov, node->extra.child2, &right) < 0) {
+            return -1;
+        }
+
+        *out = (Positions) {
+            .nullable = left.nullable || right.nullable,
+            .first = left.first | right.first,
+            .last = left.last | right.last,
+        };
+        return 0;
+
+    case CONCAT_NODE:
+        if (visit(glushkov, node->child1, &left) < 0
+            || visit(glushkov, node->extra.child2, &right) < 0) {
+            return -1;
+        }
+
+        link_positions(glushkov, left.last, right.first);
+
+        *out = (Positions) {
+            .nullable = left.nullable && right.nullable,
+            .first = left.first | (left.nullable ? right.first : 0),
+            .last = right.last | (right.nullable ? left.last : 0),
+        };
+        return 0;
+
+    default:
+        return -1;
+    }
+}
+
+// Create the Glushkov automaton for the AST rooted at root
+Glushkov* glushkov_create(ASTNode* root) {
+    if (root == NULL) {
+        return NULL;
+    }
+
+    Glushkov* glushkov = calloc(1, sizeof(Glushkov));
+    if (glushkov == NULL) {
+        return NULL;
+    }
+
+    Positions positions;
+    if (visit(glushkov, root, &positions) < 0) {
+        free(glushkov);
+        return NULL;
+    }
+
+    glushkov->follow[0] = positions.first;
+    glushkov->accepting = positions.last | (positions.nullable ? BIT(0) : 0);
+
+    // Precompute the union of follow sets for every value of every byte of
+    // a position set, so a step is one lookup per byte
+    glushkov->n_chunks = (glushkov->n_positions + 1 + 7) / 8;
+    glushkov->step = calloc(glushkov->n_chunks, sizeof(*glushkov->step));
+    if (glushkov->step == NULL) {
+        free(glushkov);
+        return NULL;
+    }
+
+    for (size_t j = 0; j < glushkov->n_chunks; j++) {
+        for (int v = 1; v < 256; v++) {
+            // Reuse the entry without the lowest set bit
+            int low = __builtin_ctz(v);
+            size_t p = 8 * j + low;
+            PositionSet follow = p <= glushkov->n_positions ? glushkov->follow[p] : 0;
+            glushkov->step[j][v] = glushkov->step[j][v & (v - 1)] | follow;
+        }
+    }
+
+    return glushkov;
+}
+
+// Releases the memory used by the given Glushkov automaton
+void glushkov_free(Glushkov* glushkov) {
+    if (glushkov == NULL) {
+        return;
+    }
+
+    free(glushkov->step);
+    glushkov->step = NULL;
+}
+
+// Compute every position reachable in one transition from the given set
+PositionSet glushkov_step(const Glushkov* glushkov, PositionSet states) {
+    PositionSet next = 0;
+
+    for (size_t j = 0; j < glushkov->n_chunks; j++) {
+        next |= glushkov->step[j][(states >> (8 * j)) & 0xFF];
+    }
+
+    return next;
+}
+
+// Test whether the string matches the pattern within the allowed errors
+bool glushkov_match_approx(const Glushkov* glushkov, const char* string,
+                           size_t len, unsigned int max_errors) {
+    if (glushkov == NULL || string == NULL || max_errors > GLUSHKOV_MAX_ERRORS) {
+        return false;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    size_t k = max_errors;
+
+    // rows[i] holds the positions reachable with at most i errors
+    PositionSet rows[GLUSHKOV_MAX_ERRORS + 1];
+
+    // Before reading anything, only deletions of pattern characters are
+    // possible, each costs one error
+    rows[0] = BIT(0);
+    for (size_t i = 1; i <= k; i++) {
+        rows[i] = rows[i - 1] | glushkov_step(glushkov, rows[i - 1]);
+    }
+
+    for (size_t n = 0; n < len; n++) {
+        PositionSet mask = glushkov->masks[bytes[n]];
+
+        // The previous row, and its step, before they are overwritten
+        PositionSet previous = rows[0];
+        PositionSet previous_step = glushkov_step(glushkov, previous);
+
+        rows[0] = previous_step & mask;
+
+        for (size_t i = 1; i <= k; i++) {
+            PositionSet current = rows[i];
+            PositionSet current_step = glushkov_step(glushkov, current);
+
+            rows[i] = (current_step & mask)                 // match
+                | previous                                  // insertion
+                | previous_step                             // substitution
+                | rows[i - 1]                               // fewer errors
+                | glushkov_step(glushkov, rows[i - 1]);     // deletion
+
+            previous = current;
+            previous_step = current_step;
+        }
+    }
+
+    return (rows[k] & glushkov->accepting) != 0;
+}
@@ -0,0 +1,739 @@
+#include "portability.h"
+
+#include "literal.h"
+
+// Count the characters in the AST, which bounds the length of any literal
+// derived from it
+static size_t count_chars(ASTNode* node) {
+    switch (node->type) {
+    case CHAR_NODE:
+        return 1;
+    case OR_NODE:
+    case CONCAT_NODE:
+        return count_chars(node->child1) + count_chars(node->extra.child2);
+    default:
+        return count_chars(node->child1);
+    }
+}
+
+/**
+ * Write the prefix of every match of the node to buf, which must have room
+ * for all of its characters.
+ *
+ * @param  exact Set to whether the node matches only its prefix, in which
+ *               case whatever follows the node continues the prefix
+ *
+ * @return The length of the prefix
+ */
+static size_t prefix(ASTNode* node, char* buf, bool* exact) {
+    size_t n, m;
+    bool right_exact;
+
+    switch (node->type) {
+    case CHAR_NODE:
+        buf[0] = node->extra.character;
+        *exact = true;
+        return 1;
+
+    case CONCAT_NODE:
+        n = prefix(node->child1, buf, exact);
+        if (!*exact) {
+            return n;
+        }
+
+        return n + prefix(node->extra.child2, &buf[n], exact);
+
+    case OR_NODE:;
+        // The prefix of the right branch goes to scratch space, and the
+        // common part of both is kept
+        char* other = malloc(count_chars(node->extra.child2));
+        if (other == NULL) {
+            *exact = false;
+            return 0;
+        }
+
+        n = prefix(node->child1, buf, exact);
+        m = prefix(node->extra.child2, other, &right_exact);
+
+        size_t common = 0;
+        while (common < n && common < m && buf[common] == other[common]) {
+            common++;
+        }
+
+        *exact = *exact && right_exact && common == n && common == m;
+        free(other);
+        return common;
+
+    case PLUS_NODE:
+        n = prefix(node->child1, buf, exact);
+        *exact = false;
+        return n;
+
+    default:
+        // Stars and options may match nothing at all
+        *exact = false;
+        return 0;
+    }
+}
+
+// Check whether the AST only matches a single string
+bool literal_is_pure(ASTNode* root) {
+    if (root == NULL) {
+        return false;
+    }
+
+    switch (root->type) {
+    case CHAR_NODE:
+        return true;
+    case CONCAT_NODE:
+        return literal_is_pure(root->child1) && literal_is_pure(root->extra.child2);
+    default:
+        return false;
+    }
+}
+
+// Compute the longest string that every match starts with
+int literal_prefix(ASTNode* root, Literal* out) {
+    if (root == NULL || out == NULL) {
+        return -1;
+    }
+
+    *out = (Literal) {.bytes = NULL, .len = 0};
+
+    char* buf = malloc(count_chars(root));
+    if (buf == NULL) {
+        return -1;
+    }
+
+    bool exact;
+    size_t len = prefix(root, buf, &exact);
+
+    if (len == 0) {
+        free(buf);
+        return 0;
+    }
+
+    *out = (Literal) {.bytes = buf, .len = len};
+    return 0;
+}
+
+/**
+ * What is known about the strings matched by a sub-pattern
+ *
+ * Members
+ *     - exact_known: Whether `exact` holds every string the sub-pattern
+ *                    matches
+ *     - exact: The strings the sub-pattern matches, if known
+ *     - required: Strings at least one of which appears in every match of
+ *                 the sub-pattern. Empty if nothing is required.
+ */
+typedef struct Facts {
+    bool exact_known;
+    LiteralSet exact;
+    LiteralSet required;
+} Facts;
+
+// Add a copy of the given bytes to the set, unless they are in it already
+bool literal_set_add(LiteralSet* set, const char* bytes, size_t len) {
+    for (size_t i = 0; i < set->n; i++) {
+        if (set->literals[i].len == len && (len == 0 || memcmp(set->literals[i].bytes, bytes, len) == 0)) {
+            return true;
+        }
+    }
+
+    if (set->n == LITERAL_SET_MAX) {
+        return false;
+    }
+
+    if (set->literals == NULL) {
+        set->literals = malloc(sizeof(Literal) * LITERAL_SET_MAX);
+        if (set->literals == NULL) {
+            return false;
+        }
+    }
+
+    char* copy = NULL;
+    if (len > 0) {
+        copy = malloc(len);
+        if (copy == NULL) {
+            return false;
+        }
+        memcpy(copy, bytes, len);
+    }
+
+    set->literals[set->n++] = (Literal) {.bytes = copy, .len = len};
+    return true;
+}
+
+// Add every literal in `from` to `to`
+bool literal_set_union(LiteralSet* to, const LiteralSet* from) {
+    for (size_t i = 0; i < from->n; i++) {
+        if (!literal_set_add(to, from->literals[i].bytes, from->literals[i].len)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Length of the shortest literal in the set, which bounds how selective
+// scanning for it is
+static size_t min_len(const LiteralSet* set) {
+    if (set->n == 0) {
+        return 0;
+    }
+
+    size_t len = set->literals[0].len;
+    for (size_t i = 1; i < set->n; i++) {
+        if (set->literals[i].len < len) {
+            len = set->literals[i].len;
+        }
+    }
+
+    return len;
+}
+
+// An empty string is found everywhere, so requiring it requires nothing
+static void drop_if_trivial(LiteralSet* set) {
+    if (set->n > 0 && min_len(set) == 0) {
+        literal_set_free(set);
+    }
+}
+
+// Forget the exact strings matched by a sub-pattern
+static void forget_exact(Facts* facts) {
+    literal_set_free(&facts->exact);
+    facts->exact_known = false;
+}
+
+// Keep the more selective of two required sets, releasing the other
+static LiteralSet pick_required(LiteralSet* a, LiteralSet* b) {
+    size_t a_len = min_len(a);
+    size_t b_len = min_len(b);
+
+    if (a_len > b_len || (a_len == b_len && a->n > 0 && a->n <= b->n)) {
+        literal_set_free(b);
+        return *a;
+    }
+
+    literal_set_free(a);
+    return *b;
+}
+
+// Every string of `left` followed by every string of `right`
+bool literal_set_product(LiteralSet* out, const LiteralSet* left, const LiteralSet* right) {
+    if (left->n * right->n > LITERAL_SET_MAX) {
+        return false;
+    }
+
+    for (size_t i = 0; i < left->n; i++) {
+        for (size_t j = 0; j < right->n; j++) {
+            const Literal* l = &left->literals[i];
+            const Literal* r = &right->literals[j];
+
+            char* bytes = malloc(l->len + r->len + 1);
+            if (bytes == NULL) {
+                return false;
+            }
+
+            memcpy(bytes, l->bytes == NULL ? "" : l->bytes, l->len);
+            memcpy(&bytes[l->len], r->bytes == NULL ? "" : r->bytes, r->len);
+
+            bool added = literal_set_add(out, bytes, l->len + r->len);
+            free(bytes);
+
+            if (!added) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void analyze(ASTNode* node, Facts* out);
+
+// Count the operands of a chain of concatenations
+static size_t count_operands(ASTNode* node) {
+    if (node->type != CONCAT_NODE) {
+        return 1;
+    }
+
+    return count_operands(node->child1) + count_operands(node->extra.child2);
+}
+
+// Collect the operands of a chain of concatenations, from left to right
+static void collect_operands(ASTNode* node, ASTNode** operands, size_t* n) {
+    if (node->type != CONCAT_NODE) {
+        operands[(*n)++] = node;
+        return;
+    }
+
+    collect_operands(node->child1, operands, n);
+    collect_operands(node->extra.child2, operands, n);
+}
+
+/**
+ * Compute the facts about a chain of concatenations.
+ *
+ * The parser nests concatenations to the left, so the whole chain is
+ * flattened first. Runs of operands that match a few exact strings are then
+ * joined into longer strings, and the most selective run is required.
+ */
+static void analyze_concat(ASTNode* node, Facts* out) {
+    size_t n = 0;
+    ASTNode** operands = malloc(sizeof(ASTNode*) * count_operands(node));
+    if (operands == NULL) {
+        return;
+    }
+
+    collect_operands(node, operands, &n);
+
+    // The exact strings of the current run of operands
+    LiteralSet run = {.literals = NULL, .n = 0};
+    bool in_run = false;
+    bool all_exact = true;
+
+    for (size_t i = 0; i < n; i++) {
+        Facts operand;
+        analyze(operands[i], &operand);
+
+        if (operand.exact_known && in_run) {
+            LiteralSet joined = {.literals = NULL, .n = 0};
+            if (literal_set_product(&joined, &run, &operand.exact)) {
+                literal_set_free(&run);
+                run = joined;
+                forget_exact(&operand);
+                literal_set_free(&operand.required);
+                continue;
+            }
+
+            literal_set_free(&joined);
+        }
+
+        // The run ends here, and is one of the candidates to require
+        if (in_run) {
+            all_exact = false;
+            drop_if_trivial(&run);
+            out->required = pick_required(&out->required, &run);
+        }
+
+        in_run = operand.exact_known;
+        run = operand.exact;
+        all_exact = all_exact && operand.exact_known;
+
+        if (!in_run) {
+            forget_exact(&operand);
+            run = (LiteralSet) {.literals = NULL, .n = 0};
+        }
+
+        out->required = pick_required(&out->required, &operand.required);
+    }
+
+    if (in_run && all_exact) {
+        out->exact_known = true;
+        out->exact = run;
+        literal_set_free(&out->required);
+    } else if (in_run) {
+        drop_if_trivial(&run);
+        out->required = pick_required(&out->required, &run);
+    }
+
+    free(operands);
+}
+
+/**
+ * Compute the facts about a node from the facts about its children.
+ * Whenever a set grows too large, or memory runs out, the facts are
+ * weakened instead, which is always safe.
+ */
+static void analyze(ASTNode* node, Facts* out) {
+    Facts left, right;
+    *out = (Facts) {
+        .exact_known = false,
+        .exact = {.literals = NULL, .n = 0},
+        .required = {.literals = NULL, .n = 0},
+    };
+
+    switch (node->type) {
+    case CHAR_NODE:
+        out->exact_known = literal_set_add(&out->exact, &node->extra.character, 1);
+        if (!out->exact_known) {
+            forget_exact(out);
+        }
+        break;
+
+    case CONCAT_NODE:
+        analyze_concat(node, out);
+        break;
+
+    case OR_NODE:
+        analyze(node->child1, &left);
+        analyze(node->extra.child2, &right);
+
+        out->exact_known = left.exact_known && right.exact_known
+            && literal_set_union(&out->exact, &left.exact) && literal_set_union(&out->exact, &right.exact);
+
+        if (!out->exact_known) {
+            forget_exact(out);
+
+            // Either branch may match, so either branch's strings will do
+            if (left.required.n > 0 && right.required.n > 0
+                && (!literal_set_union(&out->required, &left.required)
+                    || !literal_set_union(&out->required, &right.required))) {
+                literal_set_free(&out->required);
+            }
+        }
+
+        forget_exact(&left);
+        forget_exact(&right);
+        literal_set_free(&left.required);
+        literal_set_free(&right.required);
+        break;
+
+    case QUESTION_NODE:
+        analyze(node->child1, &left);
+        literal_set_free(&left.required);
+
+        out->exact_known = left.exact_known && literal_set_union(&out->exact, &left.exact)
+            && literal_set_add(&out->exact, "", 0);
+        if (!out->exact_known) {
+            forget_exact(out);
+        }
+
+        forget_exact(&left);
+        break;
+
+    case PLUS_NODE:
+        // Every match contains at least one match of the child
+        analyze(node->child1, &left);
+        forget_exact(&left);
+        out->required = left.required;
+        break;
+
+    default:
+        break;
+    }
+
+    // Whatever is matched exactly is also required
+    if (out->exact_known && out->required.n == 0
+        && !literal_set_union(&out->required, &out->exact)) {
+        literal_set_free(&out->required);
+    }
+
+    drop_if_trivial(&out->required);
+}
+
+/**
+ * Compute the strings every match of the node starts with.
+ *
+ * @param  out   Set to the strings. If it holds the empty string, matches
+ *               may start with anything.
+ * @param  exact Set to whether the node matches exactly the strings in
+ *               `out`, in which case whatever follows may extend them
+ */
+static void starts(ASTNode* node, LiteralSet* out, bool* exact) {
+    LiteralSet left, right;
+    bool left_exact, right_exact;
+
+    *out = (LiteralSet) {.literals = NULL, .n = 0};
+    *exact = false;
+
+    switch (node->type) {
+    case CHAR_NODE:
+        *exact = literal_set_add(out, &node->extra.character, 1);
+        break;
+
+    case CONCAT_NODE:;
+        ASTNode** operands = malloc(sizeof(ASTNode*) * count_operands(node));
+        size_t n = 0;
+
+        if (operands == NULL || !literal_set_add(out, "", 0)) {
+            free(operands);
+            break;
+        }
+
+        // Extend the strings with the next operand, until one does not
+        // match exactly or there would be too many strings
+        collect_operands(node, operands, &n);
+        *exact = true;
+
+        for (size_t i = 0; i < n && *exact; i++) {
+            starts(operands[i], &right, &right_exact);
+
+            LiteralSet joined = {.literals = NULL, .n = 0};
+            if (literal_set_product(&joined, out, &right)) {
+                literal_set_free(out);
+                *out = joined;
+                *exact = right_exact;
+            } else {
+                literal_set_free(&joined);
+                *exact = false;
+            }
+
+            literal_set_free(&right);
+        }
+
+        free(operands);
+        break;
+
+    case OR_NODE:
+        starts(node->child1, &left, &left_exact);
+        starts(node->extra.child2, &right, &right_exact);
+
+        *exact = left_exact && right_exact;
+        if (!literal_set_union(out, &left) || !literal_set_union(out, &right)) {
+            literal_set_free(out);
+            *exact = false;
+        }
+
+        literal_set_free(&left);
+        literal_set_free(&right);
+        break;
+
+    case QUESTION_NODE:
+        starts(node->child1, &left, &left_exact);
+
+        *exact = left_exact;
+        if (!literal_set_union(out, &left)) {
+            literal_set_free(out);
+            *exact = false;
+        }
+
+        literal_set_free(&left);
+        break;
+
+    case PLUS_NODE:
+        starts(node->child1, out, exact);
+        *exact = false;
+        break;
+
+    default:
+        break;
+    }
+
+    // Stars and options may also match nothing at all
+    if (node->type == STAR_NODE || node->type == QUESTION_NODE) {
+        if (!literal_set_add(out, "", 0)) {
+            literal_set_free(out);
+            *exact = false;
+        }
+    }
+
+    // An empty set stands for having given up
+    if (out->n == 0) {
+        literal_set_add(out, "", 0);
+        *exact = false;
+    }
+}
+
+// Compute a set of strings, one of which every match starts with
+int literal_starts(ASTNode* root, LiteralSet* out) {
+    if (root == NULL || out == NULL) {
+        return -1;
+    }
+
+    bool exact;
+    starts(root, out, &exact);
+    drop_if_trivial(out);
+
+    return 0;
+}
+
+// Compute a set of strings, one of which appears in every match
+int literal_required(ASTNode* root, LiteralSet* out) {
+    if (root == NULL || out == NULL) {
+        return -1;
+    }
+
+    Facts facts;
+    analyze(root, &facts);
+    forget_exact(&facts);
+
+    *out = facts.required;
+    return 0;
+}
+
+// Count the branches of a chain of alternations, or return 0 if any of them
+// is not a plain string
+static size_t count_branches(ASTNode* node) {
+    if (node->type != OR_NODE) {
+        return literal_is_pure(node) ? 1 : 0;
+    }
+
+    size_t left = count_branches(node->child1);
+    size_t right = count_branches(node->extra.child2);
+    return left == 0 || right == 0 ? 0 : left + right;
+}
+
+// Collect the strings of the branches, from left to right
+static bool collect_branches(ASTNode* node, LiteralSet* out) {
+    if (node->type == OR_NODE) {
+        return collect_branches(node->child1, out)
+            && collect_branches(node->extra.child2, out);
+    }
+
+    Literal* literal = &out->literals[out->n];
+    if (literal_prefix(node, literal) < 0) {
+        return false;
+    }
+
+    out->n++;
+    return true;
+}
+
+// Collect the branches of an alternation of plain strings
+int literal_branches(ASTNode* root, LiteralSet* out) {
+    if (root == NULL || out == NULL) {
+        return -1;
+    }
+
+    *out = (LiteralSet) {.literals = NULL, .n = 0};
+
+    size_t n = count_branches(root);
+    if (n < 2) {
+        return 0;
+    }
+
+    out->literals = malloc(sizeof(Literal) * n);
+    if (out->literals == NULL) {
+        return -1;
+    }
+
+    if (!collect_branches(root, out)) {
+        literal_set_free(out);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Releases the memory used by the given literal
+void literal_free(Literal* literal) {
+    if (literal == NULL) {
+        return;
+    }
+
+    free(literal->bytes);
+    literal->bytes = NULL;
+    literal->len = 0;
+}
+
+// Releases the memory used by the given set of literals
+void literal_set_free(LiteralSet* set) {
+    if (set == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < set->n; i++) {
+        literal_free(&set->literals[i]);
+    }
+
+    free(set->literals);
+    set->literals = NULL;
+    set->n = 0;
+}
+
+// Find the first occurrence of the literal in the given string
+ssize_t literal_find(const Literal* literal, const char* string, size_t len) {
+    if (literal == NULL || string == NULL || literal->len > len) {
+        return -1;
+    }
+
+    if (literal->len == 0) {
+        return 0;
+    }
+
+    // Both of these are vectorized by the C library
+    const char* found = literal->len == 1
+        ? memchr(string, literal->bytes[0], len)
+        : memmem(string, len, literal->bytes, literal->len);
+
+    return found == NULL ? -1 : found - string;
+}
+
+// Find the first occurrence of any literal in the set in the given string
+ssize_t literal_set_find(const LiteralSet* set, const char* string, size_t len) {
+    if (set == NULL || string == NULL) {
+        return -1;
+    }
+
+    ssize_t first = -1;
+
+    for (size_t i = 0; i < set->n; i++) {
+        // Only the part before the best occurrence so far needs searching
+        size_t limit = first < 0 ? len : (size_t) first + set->literals[i].len - 1;
+        if (limit > len) {
+            limit = len;
+        }
+
+        ssize_t found = literal_find(&set->literals[i], string, limit);
+        if (found >= 0 && (first < 0 || found < first)) {
+            first = found;
+        }
+    }
+
+    return first;
+}
+
+// Create a heap allocated Horspool searcher for the given literal
+Horspool* horspool_create(const Literal* needle) {
+    if (needle == NULL || needle->len == 0) {
+        return NULL;
+    }
+
+    Horspool* horspool = malloc(sizeof(Horspool));
+    char* bytes = malloc(needle->len);
+
+    if (horspool == NULL || bytes == NULL) {
+        free(horspool);
+        free(bytes);
+        return NULL;
+    }
+
+    memcpy(bytes, needle->bytes, needle->len);
+    horspool->needle = (Literal) {.bytes = bytes, .len = needle->len};
+
+    // Bytes not in the needle let the window move past them entirely.
+    // The last byte of the needle is left out, so the window always moves.
+    size_t last = needle->len - 1;
+    for (int c = 0; c < 256; c++) {
+        horspool->shift[c] = needle->len;
+    }
+
+    for (size_t i = 0; i < last; i++) {
+        horspool->shift[(unsigned char) bytes[i]] = last - i;
+    }
+
+    return horspool;
+}
+
+// Releases the memory used by the given Horspool searcher
+void horspool_free(Horspool* horspool) {
+    if (horspool == NULL) {
+        return;
+    }
+
+    literal_free(&horspool->needle);
+}
+
+// Find the first occurrence of the searcher's literal in the given string
+ssize_t horspool_find(const Horspool* horspool, const char* string, size_t len) {
+    if (horspool == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    const char* needle = horspool->needle.bytes;
+    size_t n = horspool->needle.len;
+    size_t last = n - 1;
+
+    for (size_t pos = 0; pos + n <= len; pos += horspool->shift[bytes[pos + last]]) {
+        if (bytes[pos + last] == (unsigned char) needle[last]
+            && memcmp(&bytes[pos], needle, last) == 0) {
+            return pos;
+        }
+    }
+
+    return -1;
+}
@@ -13,42 +13,134 @@ NFA* nfa_create(NFAState* start_state, NFAStateList* final_states) {
     }
     nfa->start_state = start_state;
     nfa->final_states = final_states;
+    nfa_arena_init(&nfa->arena);
     return nfa;
 }
 
 /**
- * Gathers all the states from a given start state
+ * The states found so far by a walk of an NFA, in an open addressing table
+ * keyed by the state IDs. Walks keep their own table rather than marking
+ * the states, so the NFA is only read, and may be walked by several
+ * threads at once.
  *
- * Uses depth first search on the state's transitions to gather states
- * I am okay with using recursion here for simplicity.
- *
- * @param list  The list to place the gathered states in
- * @param state The state to start the search from
+ * Members
+ *    - slots: The states found, NULL for empty slots
+ *    - capacity: The number of slots, a power of two
+ *    - size: The number of states found
  */
-void gather_states(NFAStateList* list, NFAState* state) {
-    if (list == NULL || state == NULL) {
-        return;
+typedef struct SeenStates {
+    NFAState** slots;
+    size_t capacity;
+    size_t size;
+} SeenStates;
+
+static int seen_init(SeenStates* seen, size_t n_states) {
+    seen->capacity = 16;
+    while (seen->capacity < 2 * n_states) {
+        seen->capacity *= 2;
     }
 
-    // Set like add
-    if (state->visited) {
-        return;
+    seen->size = 0;
+    seen->slots = calloc(seen->capacity, sizeof(NFAState*));
+    return seen->slots == NULL ? -1 : 0;
+}
+
+static size_t seen_slot(const SeenStates* seen, const NFAState* state) {
+    size_t slot = (state->ID * 0x9E3779B97F4A7C15ULL) >> 32 & (seen->capacity - 1);
+    while (seen->slots[slot] != NULL && seen->slots[slot] != state) {
+        slot = (slot + 1) & (seen->capacity - 1);
+    }
+    return slot;
+}
+
+/**
+ * Add a state to the table, growing it once it is half full
+ *
+ * @param  seen  The table to add to
+ * @param  state The state to add
+ *
+ * @return 1 if the state was added, 0 if it was already there,
+ *         -1 on failure
+ */
+static int seen_add(SeenStates* seen, NFAState* state) {
+    size_t slot = seen_slot(seen, state);
+    if (seen->slots[slot] != NULL) {
+        return 0;
     }
 
-    NFAStateList_add(list, &state);
-    state->visited = true;
+    if (2 * (seen->size + 1) > seen->capacity) {
+        SeenStates grown = {
+            .slots = calloc(2 * seen->capacity, sizeof(NFAState*)),
+            .capacity = 2 * seen->capacity,
+            .size = seen->size,
+        };
+        if (grown.slots == NULL) {
+            return -1;
+        }
 
-    // Loop over the transition characters
-    for (int i = 0; i < MAX_N_TRANSITIONS; i++) {
-        if (state->transitions[i] == NULL) {
-            continue;
+        for (size_t i = 0; i < seen->capacity; i++) {
+            if (seen->slots[i] != NULL) {
+                grown.slots[seen_slot(&grown, seen->slots[i])] = seen->slots[i];
+            }
         }
 
-        // Loop over the possible transitions on a given characters
-        for (size_t j = 0; j < state->transitions[i]->size; j++) {
-            gather_states(list, state->transitions[i]->list[j]);
+        free(seen->slots);
+        *seen = grown;
+        slot = seen_slot(seen, state);
+    }
+
+    seen->slots[slot] = state;
+    seen->size++;
+    return 1;
+}
+
+// Collect every state reachable from the start state, with a depth first
+// search that keeps the states still to visit on a stack
+NFAStateList* nfa_states(NFA* nfa) {
+    if (nfa == NULL || nfa->start_state == NULL) {
+        return NULL;
+    }
+
+    // The arena knows how many states there are, otherwise there are at
+    // least start_state + len(final_state) states
+    size_t n_states = nfa->arena.n_states > 0 ? nfa->arena.n_states : 1 + nfa->final_states->size;
+    NFAStateList* states = NFAStateList_create(n_states);
+    NFAStateList* stack = NFAStateList_create(n_states);
+    SeenStates seen = {.slots = NULL};
+    bool ok = states != NULL && stack != NULL && seen_init(&seen, n_states) == 0
+              && seen_add(&seen, nfa->start_state) == 1
+              && NFAStateList_add(stack, &nfa->start_state) > 0;
+
+    while (ok && stack->size > 0) {
+        NFAState* state = stack->list[--stack->size];
+        ok = NFAStateList_add(states, &state) > 0;
+
+        // Loop over the transition characters
+        for (int i = 0; ok && i < MAX_N_TRANSITIONS; i++) {
+            if (state->transitions[i] == NULL) {
+                continue;
+            }
+
+            // Loop over the possible transitions on a given characters
+            for (size_t j = 0; ok && j < state->transitions[i]->size; j++) {
+                NFAState* next = state->transitions[i]->list[j];
+                int added = seen_add(&seen, next);
+                ok = added == 0 || (added == 1 && NFAStateList_add(stack, &next) > 0);
+            }
         }
     }
+
+    NFAStateList_free(stack, NULL);
+    free(stack);
+    free(seen.slots);
+
+    if (!ok) {
+        NFAStateList_free(states, NULL);
+        free(states);
+        return NULL;
+    }
+
+    return states;
 }
 
 void nfa_free(NFA* nfa) {
@@ -56,14 +148,16 @@ void nfa_free(NFA* nfa) {
         return;
     }
 
-    // there are at least start_state + len(final_state) states
-    // Initialize the list with that capacity
-    NFAStateList* gathered_states = NFAStateList_create(1 + nfa->final_states->size);
-    gather_states(gathered_states, nfa->start_state);
+    if (nfa->arena.blocks != NULL) {
+        // Every state and transition goes with the arena
+        nfa_arena_free(&nfa->arena);
+    } else {
+        NFAStateList* gathered_states = nfa_states(nfa);
 
-    // Free all the gathered states
-    NFAStateList_free(gathered_states, state_ptr_free);
-    free(gathered_states);
+        // Free all the gathered states
+        NFAStateList_free(gathered_states, state_ptr_free);
+        free(gathered_states);
+    }
 
     NFAStateList_free(nfa->final_states, NULL);
     free(nfa->final_states);
@@ -91,11 +185,212 @@ static void epsilon_closure(NFAStateSet* current_states, NFAStateSet* next_state
     }
 }
 
+// The NFA only has transitions on printable characters
+static inline bool has_transitions_on(char c) {
+    return c >= 0x20 && c <= 0x7E;
+}
+
+// Add a state to the set, unless it is already there
+static void set_add(NFAStateSet* set, NFAState* state) {
+    if (NFAStateSet_find(set, (const NFAState**)&state, state_ptr_cmp) == NULL) {
+        NFAStateSet_add(set, &state);
+    }
+}
+
+ssize_t nfa_find_end(NFA* nfa, const char* string, size_t len) {
+    if (nfa == NULL || string == NULL) {
+        return -1;
+    }
+
+    NFAStateSet* start_states = NFAStateSet_create(10);
+    NFAStateSet* current_states = NFAStateSet_create(10);
+    NFAStateSet* next_states = NFAStateSet_create(10);
+    ssize_t end = -1;
+
+    if (start_states == NULL || current_states == NULL || next_states == NULL) {
+        goto cleanup;
+    }
+
+    NFAStateSet_add(start_states, &nfa->start_state);
+    epsilon_closure(start_states, start_states);
+
+    for (size_t i = 0; i < len && end < 0; i++) {
+        char c = string[i];
+
+        if (!has_transitions_on(c)) {
+            // Every match in progress dies here
+            current_states->size = 0;
+            continue;
+        }
+
+        // A new match may begin at every position
+        for (size_t j = 0; j < start_states->size; j++) {
+            set_add(current_states, start_states->list[j]);
+        }
+
+        for (size_t j = 0; j < current_states->size; j++) {
+            NFAStateList* transitions = get_transition(current_states->list[j], c);
+            if (transitions == NULL) {
+                continue;
+            }
+
+            for (size_t k = 0; k < transitions->size; k++) {
+                set_add(next_states, transitions->list[k]);
+            }
+        }
+
+        epsilon_closure(next_states, next_states);
+
+        for (size_t j = 0; j < next_states->size; j++) {
+            if (next_states->list[j]->is_final) {
+                end = i + 1;
+                break;
+            }
+        }
+
+        NFAStateSet* temp = current_states;
+        current_states = next_states;
+        next_states = temp;
+        next_states->size = 0;
+    }
+
+cleanup:
+    NFAStateSet_free(start_states, NULL);
+    free(start_states);
+    NFAStateSet_free(current_states, NULL);
+    free(current_states);
+    NFAStateSet_free(next_states, NULL);
+    free(next_states);
+
+    return end;
+}
+
+ssize_t nfa_find_start(NFA* reverse, const char* string, size_t end) {
+    if (reverse == NULL || string == NULL) {
+        return -1;
+    }
+
+    NFAStateSet* current_states = NFAStateSet_create(10);
+    NFAStateSet* next_states = NFAStateSet_create(10);
+    ssize_t start = -1;
+
+    if (current_states == NULL || next_states == NULL) {
+        goto cleanup;
+    }
+
+    NFAStateSet_add(current_states, &reverse->start_state);
+    epsilon_closure(current_states, current_states);
+
+    for (size_t i = end; i > 0 && current_states->size > 0; i--) {
+        char c = string[i - 1];
+
+        if (has_transitions_on(c)) {
+            for (size_t j = 0; j < current_states->size; j++) {
+                NFAStateList* transitions = get_transition(current_states->list[j], c);
+                if (transitions == NULL) {
+                    continue;
+                }
+
+                for (size_t k = 0; k < transitions->size; k++) {
+                    set_add(next_states, transitions->list[k]);
+                }
+            }
+
+            epsilon_closure(next_states, next_states);
+        }
+
+        // Keep going, an earlier start makes a longer match
+        for (size_t j = 0; j < next_states->size; j++) {
+            if (next_states->list[j]->is_final) {
+                start = i - 1;
+                break;
+            }
+        }
+
+        NFAStateSet* temp = current_states;
+        current_states = next_states;
+        next_states = temp;
+        next_states->size = 0;
+    }
+
+cleanup:
+    NFAStateSet_free(current_states, NULL);
+    free(current_states);
+    NFAStateSet_free(next_states, NULL);
+    free(next_states);
+
+    return start;
+}
+
+ssize_t nfa_longest_match(NFA* nfa, const char* string, size_t len) {
+    if (nfa == NULL || string == NULL) {
+        return -1;
+    }
+
+    NFAStateSet* current_states = NFAStateSet_create(10);
+    NFAStateSet* next_states = NFAStateSet_create(10);
+    ssize_t longest = -1;
+
+    if (current_states == NULL || next_states == NULL) {
+        goto cleanup;
+    }
+
+    NFAStateSet_add(current_states, &nfa->start_state);
+    epsilon_closure(current_states, current_states);
+
+    for (size_t i = 0; i < len && current_states->size > 0; i++) {
+        char c = string[i];
+
+        if (has_transitions_on(c)) {
+            for (size_t j = 0; j < current_states->size; j++) {
+                NFAStateList* transitions = get_transition(current_states->list[j], c);
+                if (transitions == NULL) {
+                    continue;
+                }
+
+                for (size_t k = 0; k < transitions->size; k++) {
+                    set_add(next_states, transitions->list[k]);
+                }
+            }
+
+            epsilon_closure(next_states, next_states);
+        }
+
+        for (size_t j = 0; j < next_states->size; j++) {
+            if (next_states->list[j]->is_final) {
+                longest = i + 1;
+                break;
+            }
+        }
+
+        NFAStateSet* temp = current_states;
+        current_states = next_states;
+        next_states = temp;
+        next_states->size = 0;
+    }
+
+cleanup:
+    NFAStateSet_free(current_states, NULL);
+    free(current_states);
+    NFAStateSet_free(next_states, NULL);
+    free(next_states);
+
+    return longest;
+}
+
 bool nfa_match(NFA* nfa, const char* string) {
     if (nfa == NULL || string == NULL) {
         return false;
     }
 
+    return nfa_match_len(nfa, string, strlen(string));
+}
+
+bool nfa_match_len(NFA* nfa, const char* string, size_t len) {
+    if (nfa == NULL || string == NULL) {
+        return false;
+    }
+
     NFAStateSet* current_states = NFAStateSet_create(10);
     NFAStateSet* next_states = NFAStateSet_create(10);
 
@@ -110,9 +405,15 @@ bool nfa_match(NFA* nfa, const char* string) {
     epsilon_closure(current_states, current_states);
 
     // Process each character in the input string
-    for (size_t i = 0; i < strlen(string); i++) {
+    for (size_t i = 0; i < len; i++) {
         char c = string[i];
 
+        // The epsilon transitions are stored under NUL, no byte may take them
+        if (!has_transitions_on(c)) {
+            current_states->size = 0;
+            break;
+        }
+
         // For each current state, find all possible next states
         for (size_t j = 0; j < current_states->size; j++) {
             NFAState* state = current_states->list[j];
@@ -1,6 +1,26 @@
+#include <stdatomic.h>
+#include <stddef.h>
+
 #include "list.h"
 #include "nfa_state.h"
 
+// Each thread takes IDs from its own block, and only goes to the shared
+// counter when the block runs out
+#define ID_BLOCK_SIZE 1024
+
+// The first block of an arena is this big, about twenty states. Each block
+// after it is twice the size of the one before.
+#define FIRST_ARENA_BLOCK_SIZE (16 * 1024)
+
+// Transition lists in an arena start with room for this many states
+#define ARENA_LIST_CAPACITY 2
+
+struct NFAArenaBlock {
+    NFAArenaBlock* next;
+    size_t size;
+    max_align_t bytes[];
+};
+
 // Implementation for NFAStateList
 CREATE_LIST_IMPL_FOR(NFAState*, NFAStateList)
 
@@ -21,17 +41,31 @@ NFAState* state_create(bool is_final) {
     return state;
 }
 
+// Take a new ID, unique across threads. The IDs a thread takes keep
+// increasing, so the states of an NFA built by one thread are still
+// numbered in the order they were created.
+static unsigned long long int next_id() {
+    static _Atomic unsigned long long int id_ctr = 0;
+    static _Thread_local unsigned long long int next = 0;
+    static _Thread_local unsigned long long int end = 0;
+
+    if (next == end) {
+        next = atomic_fetch_add_explicit(&id_ctr, ID_BLOCK_SIZE, memory_order_relaxed);
+        end = next + ID_BLOCK_SIZE;
+    }
+
+    return next++;
+}
+
 // Initialize the given NFA State
 int state_init(NFAState* state, bool is_final) {
-    static unsigned long long int id_ctr = 0;
     if (state == NULL) {
         return -1;
     }
 
-    state->ID = id_ctr++;
+    state->ID = next_id();
     state->is_final = is_final;
     state->should_free = false;
-    state->visited = false;
 
     for (int i = 0; i < MAX_N_TRANSITIONS; i++) {
         state->transitions[i] = NULL;
@@ -108,3 +142,109 @@ NFAStateList* get_transition(NFAState* from, char on) {
 
     return from->transitions[index];
 }
+
+// Initialize the given arena, which holds nothing yet
+int nfa_arena_init(NFAArena* arena) {
+    if (arena == NULL) {
+        return -1;
+    }
+
+    *arena = (NFAArena) {.blocks = NULL, .used = 0, .n_states = 0};
+    return 0;
+}
+
+// Release the memory used by the given arena, one block at a time
+void nfa_arena_free(NFAArena* arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    while (arena->blocks != NULL) {
+        NFAArenaBlock* next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+
+    arena->used = 0;
+    arena->n_states = 0;
+}
+
+// Take the given number of bytes from the arena, starting a new block if
+// the newest one is full
+static void* arena_alloc(NFAArena* arena, size_t size) {
+    size = (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+
+    if (arena->blocks == NULL || arena->blocks->size - arena->used < size) {
+        size_t block_size = arena->blocks != NULL ? 2 * arena->blocks->size : FIRST_ARENA_BLOCK_SIZE;
+        while (block_size < size) {
+            block_size *= 2;
+        }
+
+        NFAArenaBlock* block = malloc(sizeof(NFAArenaBlock) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+
+        block->next = arena->blocks;
+        block->size = block_size;
+        arena->blocks = block;
+        arena->used = 0;
+    }
+
+    void* bytes = (char*) arena->blocks->bytes + arena->used;
+    arena->used += size;
+    return bytes;
+}
+
+// Create and initialize an NFA State in the given arena
+NFAState* arena_state_create(NFAArena* arena, bool is_final) {
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    NFAState* state = arena_alloc(arena, sizeof(NFAState));
+    if (state == NULL || state_init(state, is_final) != 0) {
+        return NULL;
+    }
+
+    arena->n_states++;
+    return state;
+}
+
+// Add a link between the `from` and `to` state for the `on` character,
+// with the list of transitions in the arena. A full list is moved to a new
+// array twice its size, and the old one left for the arena to release.
+int arena_add_transition(NFAArena* arena, NFAState* from, NFAState* to, char on) {
+    if (arena == NULL || from == NULL || to == NULL) {
+        return -1;
+    }
+
+    int index = char_hash(on);
+    if (index < 0 || index >= MAX_N_TRANSITIONS) {
+        return -1;  // Invalid character
+    }
+
+    NFAStateList* transitions = from->transitions[index];
+    if (transitions == NULL) {
+        transitions = arena_alloc(arena, sizeof(NFAStateList));
+        NFAState** list = arena_alloc(arena, sizeof(NFAState*) * ARENA_LIST_CAPACITY);
+        if (transitions == NULL || list == NULL) {
+            return -1;
+        }
+
+        *transitions = (NFAStateList) {.capacity = ARENA_LIST_CAPACITY, .size = 0, .list = list};
+        from->transitions[index] = transitions;
+    } else if (transitions->size == transitions->capacity) {
+        NFAState** list = arena_alloc(arena, sizeof(NFAState*) * 2 * transitions->capacity);
+        if (list == NULL) {
+            return -1;
+        }
+
+        memcpy(list, transitions->list, sizeof(NFAState*) * transitions->size);
+        transitions->list = list;
+        transitions->capacity *= 2;
+    }
+
+    transitions->list[transitions->size++] = to;
+    return transitions->size;
+}
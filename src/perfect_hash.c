@@ -0,0 +1,337 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perfect_hash.h"
+
+// Marks empty buckets of the table used to find equal keys
+#define EMPTY_BUCKET UINT32_MAX
+
+// A bucket is given up on after trying this many pilots, and a new seed
+// tried for the whole set
+#define MAX_TRIES (1 << 16)
+
+// Finalizer of MurmurHash3, spreading every bit of the input over the output
+static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Hash the given bytes, eight at a time
+static uint64_t hash_bytes(const char* bytes, size_t len, uint64_t seed) {
+    uint64_t hash = mix(seed ^ (len * 0x9E3779B97F4A7C15ULL));
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, &bytes[i], 8);
+        hash = mix(hash ^ word) + 0x9E3779B97F4A7C15ULL;
+    }
+
+    if (i < len) {
+        uint64_t word = 0;
+        memcpy(&word, &bytes[i], len - i);
+        hash = mix(hash ^ word);
+    }
+
+    return hash;
+}
+
+// The bucket a key with the given hash goes to
+static inline size_t bucket_of(uint64_t hash, size_t n_buckets) {
+    return (hash >> 32) % n_buckets;
+}
+
+// The slot a key with the given hash goes to, under the given displacements
+static inline size_t slot_of(uint64_t hash, uint32_t pilot, uint32_t offset, size_t n_slots) {
+    return (mix(hash ^ (pilot * 0x9E3779B97F4A7C15ULL)) % n_slots + offset) % n_slots;
+}
+
+static bool same_key(const Literal* a, const Literal* b) {
+    return a->len == b->len && (a->len == 0 || memcmp(a->bytes, b->bytes, a->len) == 0);
+}
+
+/**
+ * Find the first of every group of equal keys
+ *
+ * @param  keys     The keys to look through
+ * @param  distinct Filled with the index of the first key of every group,
+ *                  in increasing order
+ *
+ * @return The number of distinct keys, -1 on failure
+ */
+static ssize_t find_distinct(const LiteralSet* keys, uint32_t* distinct) {
+    size_t n_buckets = 2;
+    while (n_buckets < 2 * keys->n) {
+        n_buckets *= 2;
+    }
+
+    uint32_t* buckets = malloc(sizeof(uint32_t) * n_buckets);
+    if (buckets == NULL) {
+        return -1;
+    }
+    memset(buckets, 0xFF, sizeof(uint32_t) * n_buckets);
+
+    size_t n_distinct = 0;
+    for (size_t i = 0; i < keys->n; i++) {
+        const Literal* key = &keys->literals[i];
+        size_t h = hash_bytes(key->bytes, key->len, 0);
+
+        while (buckets[h & (n_buckets - 1)] != EMPTY_BUCKET
+               && !same_key(&keys->literals[buckets[h & (n_buckets - 1)]], key)) {
+            h++;
+        }
+
+        if (buckets[h & (n_buckets - 1)] == EMPTY_BUCKET) {
+            buckets[h & (n_buckets - 1)] = i;
+            distinct[n_distinct++] = i;
+        }
+    }
+
+    free(buckets);
+    return n_distinct;
+}
+
+/**
+ * Try to place every bucket with the given seed
+ *
+ * @param  hash     The perfect hash being built, with `seed` and the sizes
+ *                  set. Its displacements are filled in.
+ * @param  keys     The keys to hash
+ * @param  distinct The index of every distinct key, `n_slots` of them
+ * @param  slots    Filled with the index of the key in every slot
+ *
+ * @return 0 on success, 1 if some bucket could not be placed,
+ *         -1 on failure
+ */
+static int place_buckets(PerfectHash* hash, const LiteralSet* keys, const uint32_t* distinct,
+                         uint32_t* slots) {
+    size_t n = hash->n_slots;
+    size_t n_buckets = hash->n_buckets;
+
+    uint64_t* hashes = malloc(sizeof(uint64_t) * n);
+    uint32_t* starts = calloc(n_buckets + 1, sizeof(uint32_t));
+    uint32_t* members = malloc(sizeof(uint32_t) * n);
+    uint32_t* by_size = malloc(sizeof(uint32_t) * n_buckets);
+    uint32_t* size_starts = calloc(n + 2, sizeof(uint32_t));
+    size_t* placed = malloc(sizeof(size_t) * n);
+    int status = -1;
+
+    if (hashes == NULL || starts == NULL || members == NULL || by_size == NULL
+        || size_starts == NULL || placed == NULL) {
+        goto done;
+    }
+
+    // Group the keys by bucket
+    for (size_t i = 0; i < n; i++) {
+        const Literal* key = &keys->literals[distinct[i]];
+        hashes[i] = hash_bytes(key->bytes, key->len, hash->seed);
+        starts[bucket_of(hashes[i], n_buckets) + 1]++;
+    }
+    for (size_t b = 0; b < n_buckets; b++) {
+        starts[b + 1] += starts[b];
+    }
+    for (size_t i = 0; i < n; i++) {
+        members[starts[bucket_of(hashes[i], n_buckets)]++] = i;
+    }
+    for (size_t b = n_buckets; b > 0; b--) {
+        starts[b] = starts[b - 1];
+    }
+    starts[0] = 0;
+
+    // Place the largest buckets first, while most slots are free
+    for (size_t b = 0; b < n_buckets; b++) {
+        size_starts[n - (starts[b + 1] - starts[b]) + 1]++;
+    }
+    for (size_t s = 0; s <= n; s++) {
+        size_starts[s + 1] += size_starts[s];
+    }
+    for (size_t b = 0; b < n_buckets; b++) {
+        by_size[size_starts[n - (starts[b + 1] - starts[b])]++] = b;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        slots[i] = EMPTY_BUCKET;
+    }
+    size_t free_slot = 0;
+
+    for (size_t i = 0; i < n_buckets; i++) {
+        size_t b = by_size[i];
+        size_t size = starts[b + 1] - starts[b];
+        const uint32_t* bucket = &members[starts[b]];
+
+        hash->displacements[2 * b] = 0;
+        hash->displacements[2 * b + 1] = 0;
+        if (size == 0) {
+            continue;
+        }
+
+        // The buckets left at the end hold one key each, and are offset
+        // straight to the next free slot, however few are left
+        if (size == 1) {
+            while (slots[free_slot] != EMPTY_BUCKET) {
+                free_slot++;
+            }
+
+            size_t slot = slot_of(hashes[bucket[0]], 0, 0, n);
+            hash->displacements[2 * b + 1] = (free_slot + n - slot) % n;
+            slots[free_slot] = bucket[0];
+            continue;
+        }
+
+        bool found = false;
+        for (uint32_t pilot = 0; !found && pilot < MAX_TRIES; pilot++) {
+            // Every key must land on a free slot, and no two on the same
+            size_t k = 0;
+            for (; k < size; k++) {
+                placed[k] = slot_of(hashes[bucket[k]], pilot, 0, n);
+                if (slots[placed[k]] != EMPTY_BUCKET) {
+                    break;
+                }
+
+                slots[placed[k]] = bucket[k];
+            }
+
+            found = k == size;
+            if (!found) {
+                for (size_t j = 0; j < k; j++) {
+                    slots[placed[j]] = EMPTY_BUCKET;
+                }
+            } else {
+                hash->displacements[2 * b] = pilot;
+            }
+        }
+
+        if (!found) {
+            status = 1;
+            goto done;
+        }
+    }
+
+    status = 0;
+
+done:
+    free(hashes);
+    free(starts);
+    free(members);
+    free(by_size);
+    free(size_starts);
+    free(placed);
+    return status;
+}
+
+// Create a heap allocated minimal perfect hash of the given keys
+PerfectHash* perfect_hash_create(const LiteralSet* keys) {
+    if (keys == NULL || keys->n == 0 || keys->n >= UINT32_MAX) {
+        return NULL;
+    }
+
+    uint32_t* distinct = malloc(sizeof(uint32_t) * keys->n);
+    PerfectHash* hash = calloc(1, sizeof(PerfectHash));
+    if (distinct == NULL || hash == NULL) {
+        free(distinct);
+        free(hash);
+        return NULL;
+    }
+
+    ssize_t n = find_distinct(keys, distinct);
+    uint32_t* slots = n > 0 ? malloc(sizeof(uint32_t) * n) : NULL;
+    if (slots == NULL) {
+        goto fail;
+    }
+
+    hash->n_slots = n;
+    hash->n_buckets = (n + PERFECT_HASH_BUCKET_SIZE - 1) / PERFECT_HASH_BUCKET_SIZE;
+    hash->displacements = malloc(sizeof(uint32_t) * 2 * hash->n_buckets);
+    if (hash->displacements == NULL) {
+        goto fail;
+    }
+
+    // Keys that cannot be told apart by one hash can be by another
+    int placed = 1;
+    for (uint64_t seed = 0; placed == 1 && seed < PERFECT_HASH_MAX_SEEDS; seed++) {
+        hash->seed = seed;
+        placed = place_buckets(hash, keys, distinct, slots);
+    }
+
+    if (placed != 0) {
+        goto fail;
+    }
+
+    // Lay the keys out in slot order
+    size_t total = 0;
+    for (size_t i = 0; i < keys->n; i++) {
+        total += keys->literals[i].len;
+    }
+
+    hash->offsets = malloc(sizeof(size_t) * (n + 1));
+    hash->bytes = malloc(total > 0 ? total : 1);
+    hash->values = malloc(sizeof(uint32_t) * n);
+    if (hash->offsets == NULL || hash->bytes == NULL || hash->values == NULL) {
+        goto fail;
+    }
+
+    size_t offset = 0;
+    for (ssize_t s = 0; s < n; s++) {
+        const Literal* key = &keys->literals[distinct[slots[s]]];
+        hash->offsets[s] = offset;
+        hash->values[s] = distinct[slots[s]];
+        if (key->len > 0) {
+            memcpy(&hash->bytes[offset], key->bytes, key->len);
+        }
+        offset += key->len;
+    }
+    hash->offsets[n] = offset;
+
+    free(distinct);
+    free(slots);
+    return hash;
+
+fail:
+    free(distinct);
+    free(slots);
+    perfect_hash_free(hash);
+    free(hash);
+    return NULL;
+}
+
+// Releases the memory used by the given perfect hash
+void perfect_hash_free(PerfectHash* hash) {
+    if (hash == NULL) {
+        return;
+    }
+
+    free(hash->displacements);
+    free(hash->offsets);
+    free(hash->bytes);
+    free(hash->values);
+
+    hash->displacements = NULL;
+    hash->offsets = NULL;
+    hash->bytes = NULL;
+    hash->values = NULL;
+}
+
+// Find which key the whole of the given string is equal to
+ssize_t perfect_hash_lookup(const PerfectHash* hash, const char* string, size_t len) {
+    if (hash == NULL || string == NULL) {
+        return -1;
+    }
+
+    uint64_t h = hash_bytes(string, len, hash->seed);
+    size_t b = bucket_of(h, hash->n_buckets);
+    size_t slot = slot_of(h, hash->displacements[2 * b], hash->displacements[2 * b + 1],
+                          hash->n_slots);
+
+    size_t start = hash->offsets[slot];
+    if (hash->offsets[slot + 1] - start != len
+        || (len > 0 && memcmp(&hash->bytes[start], string, len) != 0)) {
+        return -1;
+    }
+
+    return hash->values[slot];
+}
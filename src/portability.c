@@ -15,6 +15,23 @@ char* strdup(const char* source) {
     return dest;
 }
 
+void* memmem(const void* haystack, size_t haystack_len,
+             const void* needle, size_t needle_len) {
+    const char* h = haystack;
+
+    if (needle_len == 0) {
+        return (void*) h;
+    }
+
+    for (size_t i = 0; i + needle_len <= haystack_len; i++) {
+        if (memcmp(&h[i], needle, needle_len) == 0) {
+            return (void*) &h[i];
+        }
+    }
+
+    return NULL;
+}
+
 #endif // WIN32_LEAN_AND_MEAN
 
 int n_processors_online() {
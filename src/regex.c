@@ -1,5 +1,16 @@
+#include "portability.h"
+
+#include <stdatomic.h>
+
 #include "regex.h"
 
+#ifndef WIN32_LEAN_AND_MEAN
+    #include <pthread.h>
+#endif
+
+// The number of patterns a thread takes at a time in `regex_compile_all`
+#define REGEX_COMPILE_CHUNK 8
+
 // Create a heap allocated and initialized regex buffer.
 Regex* regex_create(char* pattern) {
     Regex* buf = malloc(sizeof(Regex));
@@ -20,6 +31,27 @@ int regex_init(Regex* regex_buf, char* pattern) {
 
     *regex_buf = (Regex) {
         .nfa = NULL,
+        .dfa = NULL,
+        .search_dfa = NULL,
+        .reverse_nfa = NULL,
+        .reverse_dfa = NULL,
+        .shuffle = NULL,
+        .glushkov = NULL,
+        .ast = NULL,
+        .prefix = {.bytes = NULL, .len = 0},
+        .suffix = {.bytes = NULL, .len = 0},
+        .first_bytes = {.bits = {0}},
+        .last_bytes = {.bits = {0}},
+        .required = {.literals = NULL, .n = 0},
+        .start_scanner = NULL,
+        .required_scanner = NULL,
+        .literal = NULL,
+        .keywords = NULL,
+        .exact = NULL,
+        .dictionary = NULL,
+        .min_len = 0,
+        .max_len = AST_UNBOUNDED,
+        .built = 0,
         .is_compiled = false,
         .pattern = pattern,
     };
@@ -36,6 +68,316 @@ int regex_init(Regex* regex_buf, char* pattern) {
     return 0;
 }
 
+// Patterns compiled by one thread of `regex_compile_all`
+typedef struct CompileWorker {
+    char* const* patterns;
+    size_t n_patterns;
+    Regex** regexes;
+    atomic_size_t* next;
+    size_t n_failed;
+} CompileWorker;
+
+// Compile chunks of patterns until there are none left
+static void* compile_chunks(void* arg) {
+    CompileWorker* worker = arg;
+
+    while (true) {
+        size_t first = atomic_fetch_add(worker->next, REGEX_COMPILE_CHUNK);
+        if (first >= worker->n_patterns) {
+            return NULL;
+        }
+
+        size_t last = first + REGEX_COMPILE_CHUNK;
+        if (last > worker->n_patterns) {
+            last = worker->n_patterns;
+        }
+
+        for (size_t i = first; i < last; i++) {
+            worker->regexes[i] = worker->patterns[i] != NULL ? regex_create(worker->patterns[i]) : NULL;
+            worker->n_failed += worker->regexes[i] == NULL;
+        }
+    }
+}
+
+// Compile many patterns at once, spreading them across several threads
+ssize_t regex_compile_all(char* const* patterns, size_t n_patterns, Regex** regexes,
+                          size_t n_threads) {
+    if ((patterns == NULL || regexes == NULL) && n_patterns > 0) {
+        return -1;
+    }
+
+    if (n_threads == 0) {
+        int n_processors = n_processors_online();
+        n_threads = n_processors > 0 ? n_processors : 1;
+    }
+
+    size_t n_chunks = (n_patterns + REGEX_COMPILE_CHUNK - 1) / REGEX_COMPILE_CHUNK;
+    if (n_threads > n_chunks) {
+        n_threads = n_chunks > 0 ? n_chunks : 1;
+    }
+
+    CompileWorker* workers = malloc(sizeof(CompileWorker) * n_threads);
+    if (workers == NULL) {
+        return -1;
+    }
+
+    atomic_size_t next;
+    atomic_init(&next, 0);
+
+    for (size_t i = 0; i < n_threads; i++) {
+        workers[i] = (CompileWorker) {
+            .patterns = patterns,
+            .n_patterns = n_patterns,
+            .regexes = regexes,
+            .next = &next,
+            .n_failed = 0,
+        };
+    }
+
+#ifndef WIN32_LEAN_AND_MEAN
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    bool* started = calloc(n_threads, sizeof(bool));
+
+    if (threads == NULL || started == NULL) {
+        free(workers);
+        free(threads);
+        free(started);
+        return -1;
+    }
+
+    for (size_t i = 1; i < n_threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL, compile_chunks, &workers[i]) == 0;
+    }
+
+    // The calling thread compiles too, and whatever threads that could not
+    // be started would have
+    compile_chunks(&workers[0]);
+
+    for (size_t i = 1; i < n_threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    free(threads);
+    free(started);
+#else
+    compile_chunks(&workers[0]);
+#endif
+
+    ssize_t n_failed = 0;
+    for (size_t i = 0; i < n_threads; i++) {
+        n_failed += workers[i].n_failed;
+    }
+
+    free(workers);
+    return n_failed;
+}
+
+/**
+ * Compile a pattern that is a plain string, or an alternation of plain
+ * strings. Matching compares against the strings directly, so no automaton
+ * is built. The AST is kept for approximate matching.
+ *
+ * @param  regex_buf The regex buffer to initialize
+ * @param  pattern   The pattern that was parsed
+ * @param  root      The AST of the pattern, which is kept by the regex, or
+ *                   released on failure
+ *
+ * @return 0 on success, -1 on failure,
+ *         1 if the pattern is not made of plain strings
+ */
+static int compile_literal(Regex* regex_buf, char* pattern, ASTNode* root) {
+    Horspool* literal = NULL;
+    AhoCorasick* keywords = NULL;
+    PerfectHash* exact = NULL;
+
+    LiteralSet branches;
+    if (literal_branches(root, &branches) < 0) {
+        branches = (LiteralSet) {.literals = NULL, .n = 0};
+    }
+
+    // Whole inputs are looked up in a perfect hash of the branches, and the
+    // automaton is only run when searching
+    if (branches.n > 0) {
+        keywords = aho_corasick_create(&branches);
+        exact = perfect_hash_create(&branches);
+        literal_set_free(&branches);
+    } else if (literal_is_pure(root)) {
+        Literal needle;
+        if (literal_prefix(root, &needle) == 0) {
+            literal = horspool_create(&needle);
+            literal_free(&needle);
+        }
+    } else {
+        return 1;
+    }
+
+    if (literal == NULL && keywords == NULL) {
+        ast_node_free(root);
+        perfect_hash_free(exact);
+        free(exact);
+        return -1;
+    }
+
+    *regex_buf = (Regex) {
+        .nfa = NULL,
+        .dfa = NULL,
+        .search_dfa = NULL,
+        .reverse_nfa = NULL,
+        .reverse_dfa = NULL,
+        .shuffle = NULL,
+        .glushkov = NULL,
+        .ast = root,
+        .prefix = {.bytes = NULL, .len = 0},
+        .suffix = {.bytes = NULL, .len = 0},
+        .first_bytes = {.bits = {0}},
+        .last_bytes = {.bits = {0}},
+        .required = {.literals = NULL, .n = 0},
+        .start_scanner = NULL,
+        .required_scanner = NULL,
+        .literal = literal,
+        .keywords = keywords,
+        .exact = exact,
+        .dictionary = NULL,
+        .min_len = 0,
+        .max_len = AST_UNBOUNDED,
+        .built = 0,
+        .is_compiled = true,
+        .pattern = pattern,
+    };
+
+    return 0;
+}
+
+// Publish a DFA built on first use, unless another thread published one
+// first, in which case this one is released. Returns the published DFA.
+static DFA* publish_dfa(DFA* _Atomic* field, DFA* dfa) {
+    DFA* published = NULL;
+    if (dfa != NULL && !atomic_compare_exchange_strong_explicit(field, &published, dfa,
+                                                                memory_order_acq_rel,
+                                                                memory_order_acquire)) {
+        dfa_free(dfa);
+        free(dfa);
+        return published;
+    }
+
+    return dfa;
+}
+
+// Publish an NFA built on first use, like `publish_dfa`
+static NFA* publish_nfa(NFA* _Atomic* field, NFA* nfa) {
+    NFA* published = NULL;
+    if (nfa != NULL && !atomic_compare_exchange_strong_explicit(field, &published, nfa,
+                                                                memory_order_acq_rel,
+                                                                memory_order_acquire)) {
+        nfa_free(nfa);
+        free(nfa);
+        return published;
+    }
+
+    return nfa;
+}
+
+/**
+ * Find the unanchored DFA searches run, building it on first use. Threads
+ * racing to build it each build their own, and all but the first to
+ * publish it free theirs.
+ *
+ * @param  regex_buf The compiled regex to search with
+ *
+ * @return The DFA, NULL if the pattern needs too many states or has no
+ *         `nfa`
+ */
+static DFA* search_dfa_of(const Regex* regex_buf) {
+    // Only the lazily built fields are written, and only atomically
+    Regex* regex = (Regex*) regex_buf;
+
+    if (atomic_load_explicit(&regex->built, memory_order_acquire) & REGEX_BUILT_SEARCH) {
+        return atomic_load_explicit(&regex->search_dfa, memory_order_relaxed);
+    }
+
+    DFA* dfa = publish_dfa(&regex->search_dfa, dfa_create(regex->nfa, DFA_UNANCHORED));
+
+    atomic_fetch_or_explicit(&regex->built, REGEX_BUILT_SEARCH, memory_order_release);
+    return dfa;
+}
+
+/**
+ * Find the position automaton used for approximate matching, building it
+ * on first use like `search_dfa_of`.
+ *
+ * @param  regex_buf The compiled regex to match with
+ *
+ * @return The automaton, NULL if the pattern has too many characters
+ */
+static Glushkov* glushkov_of(const Regex* regex_buf) {
+    Regex* regex = (Regex*) regex_buf;
+
+    if (atomic_load_explicit(&regex->built, memory_order_acquire) & REGEX_BUILT_GLUSHKOV) {
+        return atomic_load_explicit(&regex->glushkov, memory_order_relaxed);
+    }
+
+    Glushkov* glushkov = glushkov_create(regex->ast);
+    Glushkov* published = NULL;
+    if (glushkov != NULL && !atomic_compare_exchange_strong_explicit(&regex->glushkov, &published,
+                                                                     glushkov,
+                                                                     memory_order_acq_rel,
+                                                                     memory_order_acquire)) {
+        glushkov_free(glushkov);
+        free(glushkov);
+        glushkov = published;
+    }
+
+    atomic_fetch_or_explicit(&regex->built, REGEX_BUILT_GLUSHKOV, memory_order_release);
+    return glushkov;
+}
+
+/**
+ * Find the automaton of the reversed pattern, which finds where matches
+ * start, building it on first use like `search_dfa_of`. The reversed NFA
+ * is only kept if it needs too many states to be determinized.
+ *
+ * @param  regex_buf   The compiled regex to search with
+ * @param  reverse_nfa Set to the reversed NFA if there is no DFA
+ *
+ * @return The reversed DFA, NULL if there is none
+ */
+static DFA* reverse_dfa_of(const Regex* regex_buf, NFA** reverse_nfa) {
+    Regex* regex = (Regex*) regex_buf;
+
+    if (atomic_load_explicit(&regex->built, memory_order_acquire) & REGEX_BUILT_REVERSE) {
+        *reverse_nfa = atomic_load_explicit(&regex->reverse_nfa, memory_order_relaxed);
+        return atomic_load_explicit(&regex->reverse_dfa, memory_order_relaxed);
+    }
+
+    // The AST is shared by every thread, so a copy of it is reversed
+    ASTNode* reversed = ast_copy(regex->ast);
+    ast_reverse(reversed);
+    NFA* nfa = reversed != NULL ? convert_ast_to_nfa(reversed) : NULL;
+    ast_node_free(reversed);
+
+    DFA* dfa = dfa_create(nfa, DFA_ANCHORED);
+    if (dfa != NULL) {
+        nfa_free(nfa);
+        free(nfa);
+        nfa = NULL;
+    }
+
+    dfa = publish_dfa(&regex->reverse_dfa, dfa);
+    nfa = publish_nfa(&regex->reverse_nfa, nfa);
+
+    atomic_fetch_or_explicit(&regex->built, REGEX_BUILT_REVERSE, memory_order_release);
+    *reverse_nfa = nfa;
+    return dfa;
+}
+
+// Whether the regex was compiled into something that can match
+static inline bool has_matcher(const Regex* regex_buf) {
+    return regex_buf->nfa != NULL || regex_buf->literal != NULL || regex_buf->keywords != NULL
+        || regex_buf->dictionary != NULL;
+}
+
 // Compile a given regex pattern.
 int regex_compile(Regex* regex_buf, char* pattern) {
     if (regex_buf == NULL || pattern == NULL) {
@@ -44,7 +386,7 @@ int regex_compile(Regex* regex_buf, char* pattern) {
 
     if (regex_buf->is_compiled) {
         // Skip compiling if already compiled with the same pattern
-        if (strcmp(regex_buf->pattern, pattern) == 0) {
+        if (regex_buf->pattern != NULL && strcmp(regex_buf->pattern, pattern) == 0) {
             return 1;
         }
 
@@ -75,19 +417,126 @@ int regex_compile(Regex* regex_buf, char* pattern) {
         return -1;
     }
 
+    // Inputs of a length no match can have are rejected without matching
+    size_t min_len, max_len;
+    if (ast_length_bounds(root, &min_len, &max_len) < 0) {
+        min_len = 0;
+        max_len = AST_UNBOUNDED;
+    }
+
+    // Plain strings, and alternations of them, are searched for directly
+    int result = compile_literal(regex_buf, pattern, root);
+    if (result < 0) {
+        return -1;
+    }
+
+    if (result == 0) {
+        regex_buf->min_len = min_len;
+        regex_buf->max_len = max_len;
+        return 0;
+    }
+
     // Create a NFA with the AST
     NFA* nfa = convert_ast_to_nfa(root);
 
-    // Release resources
-    ast_node_free(root);
+    // Searches skip ahead to where the fixed start of every match occurs.
+    // Without it, the automaton is run over every byte instead.
+    Literal prefix;
+    if (literal_prefix(root, &prefix) < 0) {
+        prefix = (Literal) {.bytes = NULL, .len = 0};
+    }
+
+    // Whole inputs are checked against the bytes matches start and end with
+    // before running any automaton
+    ByteSet first_bytes, last_bytes;
+    byte_set_first(root, &first_bytes);
+
+    // Without a single prefix, a few strings every match starts with are
+    // found with a vectorized scan instead
+    Teddy* start_scanner = NULL;
+    LiteralSet start_set;
+    if (prefix.len == 0 && literal_starts(root, &start_set) == 0) {
+        if (start_set.n >= 2) {
+            start_scanner = teddy_create(&start_set);
+        }
+        literal_set_free(&start_set);
+    }
+
+    // Inputs missing every one of these strings cannot match at all
+    LiteralSet required;
+    if (literal_required(root, &required) < 0) {
+        required = (LiteralSet) {.literals = NULL, .n = 0};
+    }
+
+    Teddy* required_scanner = NULL;
+    if (required.n >= 2) {
+        required_scanner = teddy_create(&required);
+    }
+
+    // The prefix and first bytes of the reversed pattern are the suffix and
+    // last bytes of the pattern, backwards
+    ast_reverse(root);
+    Literal suffix;
+    if (literal_prefix(root, &suffix) < 0) {
+        suffix = (Literal) {.bytes = NULL, .len = 0};
+    }
+
+    for (size_t i = 0; i < suffix.len / 2; i++) {
+        char temp = suffix.bytes[i];
+        suffix.bytes[i] = suffix.bytes[suffix.len - 1 - i];
+        suffix.bytes[suffix.len - 1 - i] = temp;
+    }
+
+    byte_set_first(root, &last_bytes);
+
+    // The AST is kept to build the automata only some searches need
+    ast_reverse(root);
 
     if (nfa == NULL) {
+        ast_node_free(root);
+        nfa_free(nfa);
+        free(nfa);
+        literal_free(&prefix);
+        literal_free(&suffix);
+        literal_set_free(&required);
+        teddy_free(start_scanner);
+        free(start_scanner);
+        teddy_free(required_scanner);
+        free(required_scanner);
         return -1;
     }
 
+    // Determinize the NFA for faster matching. This is allowed to fail for
+    // patterns that need too many states, the NFA is used for those instead.
+    DFA* dfa = dfa_create(nfa, DFA_ANCHORED);
+
+    // Tiny automata fit in a vector register, and are matched with shuffles
+    ShuffleDFA* shuffle = shuffle_dfa_create(dfa);
+
     // Initialize a compiled regex
     *regex_buf = (Regex) {
         .nfa = nfa,
+        .dfa = dfa,
+        .search_dfa = NULL,
+        .reverse_nfa = NULL,
+        .reverse_dfa = NULL,
+        .shuffle = shuffle,
+        .glushkov = NULL,
+        .ast = root,
+        .prefix = prefix,
+        .suffix = suffix,
+        .first_bytes = first_bytes,
+        .last_bytes = last_bytes,
+        .required = required,
+        .start_scanner = start_scanner,
+        .required_scanner = required_scanner,
+        .literal = NULL,
+        .keywords = NULL,
+        .exact = NULL,
+        .dictionary = NULL,
+        .min_len = min_len,
+        .max_len = max_len,
+        .built = 0,
         .is_compiled = true,
         .pattern = pattern,
     };
@@ -95,26 +544,1097 @@ int regex_compile(Regex* regex_buf, char* pattern) {
     return 0;
 }
 
+// Whether the buffer is long enough for a match, and contains one of the
+// strings every match needs
+static inline bool may_match(const Regex* regex_buf, const char* data, size_t len) {
+    if (len < regex_buf->min_len) {
+        return false;
+    }
+
+    if (regex_buf->required_scanner != NULL) {
+        return teddy_find(regex_buf->required_scanner, data, len, NULL) >= 0;
+    }
+
+    return regex_buf->required.n == 0 || literal_set_find(&regex_buf->required, data, len) >= 0;
+}
+
+// Test whether the whole of the given bytes match the given regex
+static bool match_bytes(const Regex* regex_buf, const char* string, size_t len) {
+    if (len < regex_buf->min_len || len > regex_buf->max_len) {
+        return false;
+    }
+
+    if (regex_buf->literal != NULL) {
+        const Literal* needle = &regex_buf->literal->needle;
+        return len == needle->len && memcmp(string, needle->bytes, len) == 0;
+    }
+
+    if (regex_buf->exact != NULL) {
+        return perfect_hash_lookup(regex_buf->exact, string, len) >= 0;
+    }
+
+    if (regex_buf->keywords != NULL) {
+        return aho_corasick_match(regex_buf->keywords, string, len) >= 0;
+    }
+
+    if (regex_buf->dictionary != NULL) {
+        return dawg_contains(regex_buf->dictionary, string, len);
+    }
+
+    if (regex_buf->nfa == NULL) {
+        return false;
+    }
+
+    if (len > 0 && (!byte_set_contains(&regex_buf->first_bytes, string[0])
+                    || !byte_set_contains(&regex_buf->last_bytes, string[len - 1]))) {
+        return false;
+    }
+
+    // Every match is at least as long as its prefix and suffix
+    const Literal* prefix = &regex_buf->prefix;
+    const Literal* suffix = &regex_buf->suffix;
+
+    if ((prefix->len > 0 && memcmp(string, prefix->bytes, prefix->len) != 0)
+        || (suffix->len > 0 && memcmp(&string[len - suffix->len], suffix->bytes, suffix->len) != 0)) {
+        return false;
+    }
+
+    if (!may_match(regex_buf, string, len)) {
+        return false;
+    }
+
+    if (regex_buf->shuffle != NULL) {
+        return shuffle_dfa_match(regex_buf->shuffle, string, len);
+    }
+
+    if (regex_buf->dfa != NULL) {
+        return dfa_match(regex_buf->dfa, string, len);
+    }
+
+    return nfa_match_len(regex_buf->nfa, string, len);
+}
+
 // Test whether the given string matches the given regex.
 bool regex_match(Regex* regex_buf, char* string) {
     if (regex_buf == NULL || string == NULL) {
         return false;
     }
 
-    if (!regex_buf->is_compiled || regex_buf->nfa == NULL) {
+    if (!regex_buf->is_compiled) {
         return false;
     }
 
-    return nfa_match(regex_buf->nfa, string);
+    return match_bytes(regex_buf, string, strlen(string));
 }
 
-// Release the memory used by the given regex structure
-void regex_free(Regex* regex_buf) {
-    if (regex_buf == NULL) {
-        return;
+// Find which branch of the given regex the whole string matches.
+ssize_t regex_match_branch(Regex* regex_buf, char* string) {
+    if (regex_buf == NULL || string == NULL || regex_buf->keywords == NULL) {
+        return -1;
     }
 
-    nfa_free(regex_buf->nfa);
-    free(regex_buf->nfa);
-    regex_buf->nfa = NULL;
+    if (regex_buf->exact != NULL) {
+        return perfect_hash_lookup(regex_buf->exact, string, strlen(string));
+    }
+
+    return aho_corasick_match(regex_buf->keywords, string, strlen(string));
+}
+
+// Test whether the given string matches the given regex within max_errors.
+int regex_match_approx(const Regex* regex_buf, const char* string,
+                       unsigned int max_errors) {
+    if (regex_buf == NULL || string == NULL || !regex_buf->is_compiled) {
+        return -1;
+    }
+
+    if (max_errors > GLUSHKOV_MAX_ERRORS) {
+        return -1;
+    }
+
+    Glushkov* glushkov = glushkov_of(regex_buf);
+    if (glushkov == NULL) {
+        return -1;
+    }
+
+    return glushkov_match_approx(glushkov, string, strlen(string), max_errors);
+}
+
+// Compile a regex matching exactly the keywords of the given dictionary
+int regex_compile_dictionary(Regex* regex_buf, Dawg* dictionary) {
+    if (regex_buf == NULL || dictionary == NULL) {
+        return -1;
+    }
+
+    if (regex_buf->is_compiled) {
+        regex_free(regex_buf);
+    }
+
+    *regex_buf = (Regex) {
+        .nfa = NULL,
+        .dfa = NULL,
+        .search_dfa = NULL,
+        .reverse_nfa = NULL,
+        .reverse_dfa = NULL,
+        .shuffle = NULL,
+        .glushkov = NULL,
+        .ast = NULL,
+        .prefix = {.bytes = NULL, .len = 0},
+        .suffix = {.bytes = NULL, .len = 0},
+        .first_bytes = {.bits = {0}},
+        .last_bytes = {.bits = {0}},
+        .required = {.literals = NULL, .n = 0},
+        .start_scanner = NULL,
+        .required_scanner = NULL,
+        .literal = NULL,
+        .keywords = NULL,
+        .exact = NULL,
+        .dictionary = dictionary,
+        .min_len = dictionary->min_len,
+        .max_len = dictionary->max_len,
+        .built = 0,
+        .is_compiled = true,
+        .pattern = NULL,
+    };
+
+    return 0;
+}
+
+/**
+ * Renumber the states of the regex's automata in the given order, and
+ * rebuild the shuffle masks from the renumbered `dfa`
+ *
+ * @param  regex_buf  The compiled regex to renumber
+ * @param  order      The order of the states of `dfa`, followed by the order
+ *                    of the states of `search_dfa` if it covers both
+ * @param  order_size The number of entries in `order`
+ *
+ * @return 0 on success, -1 on failure or if the order does not fit the
+ *         automata
+ */
+static int apply_order(Regex* regex_buf, const size_t* order, size_t order_size) {
+    DFA* dfa = regex_buf->dfa;
+    if (dfa == NULL) {
+        return -1;
+    }
+
+    size_t n_anchored = dfa->n_states;
+    DFA* search_dfa = order_size > n_anchored ? search_dfa_of(regex_buf) : NULL;
+    bool with_search = search_dfa != NULL && order_size == n_anchored + search_dfa->n_states;
+    if (order_size != n_anchored && !with_search) {
+        return -1;
+    }
+
+    if (dfa_renumber(dfa, order) < 0
+        || (with_search && dfa_renumber(search_dfa, &order[n_anchored]) < 0)) {
+        return -1;
+    }
+
+    if (regex_buf->shuffle != NULL) {
+        free(regex_buf->shuffle);
+        regex_buf->shuffle = shuffle_dfa_create(dfa);
+    }
+
+    return 0;
+}
+
+// Compile a given regex pattern, with its automaton in the given state order
+int regex_compile_with_order(Regex* regex_buf, char* pattern,
+                             const size_t* order, size_t order_size) {
+    int result = regex_compile(regex_buf, pattern);
+    if (result < 0 || order == NULL) {
+        return result;
+    }
+
+    if (apply_order(regex_buf, order, order_size) < 0) {
+        regex_free(regex_buf);
+        return -1;
+    }
+
+    return result;
+}
+
+// Renumber the regex's states so the most visited ones are at the front,
+// both in the anchored automaton and in the one searches run
+ssize_t regex_profile(Regex* regex_buf, char** samples, size_t n_samples,
+                      size_t* order_buf, size_t order_size) {
+    if (regex_buf == NULL || !regex_buf->is_compiled || (samples == NULL && n_samples > 0)) {
+        return -1;
+    }
+
+    DFA* dfa = regex_buf->dfa;
+    if (dfa == NULL) {
+        return 0;
+    }
+
+    // The counts and order of the search automaton follow those of `dfa`
+    DFA* search_dfa = search_dfa_of(regex_buf);
+    size_t n_anchored = dfa->n_states;
+    size_t n_states = n_anchored + (search_dfa != NULL ? search_dfa->n_states : 0);
+    size_t* counts = calloc(n_states, sizeof(size_t));
+    size_t* order = malloc(sizeof(size_t) * n_states);
+
+    if (counts == NULL || order == NULL) {
+        free(counts);
+        free(order);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_samples; i++) {
+        if (samples[i] != NULL) {
+            size_t len = strlen(samples[i]);
+            dfa_profile(dfa, samples[i], len, counts);
+            if (search_dfa != NULL) {
+                dfa_profile(search_dfa, samples[i], len, &counts[n_anchored]);
+            }
+        }
+    }
+
+    int result = dfa_hot_order(dfa, counts, order);
+    if (result == 0 && search_dfa != NULL) {
+        result = dfa_hot_order(search_dfa, &counts[n_anchored], &order[n_anchored]);
+    }
+    if (result == 0) {
+        result = apply_order(regex_buf, order, n_states);
+    }
+
+    if (result == 0 && order_buf != NULL && order_size >= n_states) {
+        memcpy(order_buf, order, sizeof(size_t) * n_states);
+    }
+
+    free(counts);
+    free(order);
+
+    return result < 0 ? -1 : (ssize_t) n_states;
+}
+
+// Whether searches can skip ahead to where matches may start
+static inline bool has_candidates(const Regex* regex_buf) {
+    return regex_buf->prefix.len > 0 || regex_buf->start_scanner != NULL
+        || byte_set_count(&regex_buf->first_bytes) <= REGEX_MAX_SKIP_BYTES;
+}
+
+// Find the first place a match may start, using the literal prefix, the
+// set of strings every match starts with, or the bytes they start with
+static inline ssize_t next_candidate(const Regex* regex_buf, const char* string, size_t len) {
+    if (regex_buf->prefix.len > 0) {
+        return literal_find(&regex_buf->prefix, string, len);
+    }
+
+    if (regex_buf->start_scanner != NULL) {
+        return teddy_find(regex_buf->start_scanner, string, len, NULL);
+    }
+
+    return byte_set_find(&regex_buf->first_bytes, string, len);
+}
+
+// Whether searches find the suffix first, and run the reversed automaton
+// backwards from it, as nothing narrows down where matches start
+static inline bool scans_suffix(const Regex* regex_buf) {
+    NFA* reverse_nfa;
+    return regex_buf->prefix.len == 0 && regex_buf->start_scanner == NULL
+        && regex_buf->suffix.len > 0 && reverse_dfa_of(regex_buf, &reverse_nfa) != NULL;
+}
+
+/**
+ * Find the first non-empty match in the given buffer from the occurrences
+ * of the suffix every match ends with. Each occurrence is checked by running
+ * the reversed automaton backwards from its end, which also finds where the
+ * match starts.
+ *
+ * A backward scan never looks at bytes before the end of the previous
+ * occurrence, which keeps the search linear. If it would have to, the
+ * search gives up, and the caller scans forwards instead.
+ *
+ * @param  start Set to the offset of the first byte of the match
+ * @param  end   Set to the offset just past the last byte of the match
+ *
+ * @return 1 if a match was found, 0 if there is none,
+ *         -1 if the search gave up
+ */
+static int find_by_suffix(const Regex* regex_buf, const char* string, size_t len,
+                          size_t* start, size_t* end) {
+    const Literal* suffix = &regex_buf->suffix;
+    NFA* reverse_nfa;
+    DFA* reverse_dfa = reverse_dfa_of(regex_buf, &reverse_nfa);
+    size_t min_start = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        ssize_t found = literal_find(suffix, &string[pos], len - pos);
+        if (found < 0) {
+            return 0;
+        }
+
+        size_t stop = pos + found + suffix->len;
+        bool exhausted;
+        ssize_t match_start = dfa_find_start_after(reverse_dfa, string,
+                                                   min_start, stop, &exhausted);
+
+        // Reaching the start of the buffer is fine, the previous occurrence
+        // is not
+        if (exhausted && min_start > 0) {
+            return -1;
+        }
+
+        if (match_start >= 0) {
+            *start = match_start;
+            *end = stop;
+            return 1;
+        }
+
+        min_start = stop;
+        pos += found + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Find the end of the first non-empty match in the given buffer.
+ *
+ * If every match ends with a fixed string and nothing is known about how
+ * they start, occurrences of that string are found first. Otherwise, if
+ * every match starts with one of a few strings, the automaton is only
+ * started where they occur, and the search skips to the next occurrence
+ * whenever no match is in progress. It stops once the rest of the buffer
+ * is shorter than the shortest match.
+ *
+ * @param  start If not NULL, set to the offset of the first byte of the
+ *               match when it was found along the way, -1 otherwise
+ *
+ * @return The offset just past the last byte of the match,
+ *         -1 if there is no match
+ */
+static ssize_t find_end(const Regex* regex_buf, const char* string, size_t len,
+                        ssize_t* start) {
+    if (start != NULL) {
+        *start = -1;
+    }
+
+    if (len < regex_buf->min_len) {
+        return -1;
+    }
+
+    if (scans_suffix(regex_buf)) {
+        size_t match_start, match_end;
+        int found = find_by_suffix(regex_buf, string, len, &match_start, &match_end);
+
+        if (found == 0) {
+            return -1;
+        }
+
+        if (found > 0) {
+            if (start != NULL) {
+                *start = match_start;
+            }
+            return match_end;
+        }
+    }
+
+    DFA* search_dfa = search_dfa_of(regex_buf);
+    if (!has_candidates(regex_buf)) {
+        return search_dfa != NULL
+            ? dfa_find_end(search_dfa, string, len)
+            : nfa_find_end(regex_buf->nfa, string, len);
+    }
+
+    size_t pos = 0;
+    while (pos < len) {
+        ssize_t candidate = next_candidate(regex_buf, &string[pos], len - pos);
+        if (candidate < 0) {
+            return -1;
+        }
+
+        pos += candidate;
+
+        if (len - pos < regex_buf->min_len) {
+            return -1;
+        }
+
+        if (search_dfa == NULL) {
+            ssize_t end = nfa_find_end(regex_buf->nfa, &string[pos], len - pos);
+            return end < 0 ? -1 : (ssize_t) pos + end;
+        }
+
+        size_t idle;
+        ssize_t end = dfa_find_end_until_idle(search_dfa, &string[pos],
+                                              len - pos, &idle);
+        if (end >= 0) {
+            return pos + end;
+        }
+
+        pos += idle;
+    }
+
+    return -1;
+}
+
+// Count the non-overlapping occurrences of the given regex in a buffer
+ssize_t regex_count(const Regex* regex_buf, const void* data, size_t len) {
+    if (regex_buf == NULL || data == NULL || !regex_buf->is_compiled) {
+        return -1;
+    }
+
+    if (!may_match(regex_buf, data, len)) {
+        return 0;
+    }
+
+    if (regex_buf->literal != NULL) {
+        const char* string = data;
+        size_t needle_len = regex_buf->literal->needle.len;
+        ssize_t count = 0;
+        ssize_t found;
+
+        while ((found = horspool_find(regex_buf->literal, string, len)) >= 0) {
+            count++;
+            string += found + needle_len;
+            len -= found + needle_len;
+        }
+
+        return count;
+    }
+
+    if (regex_buf->keywords != NULL) {
+        return aho_corasick_count(regex_buf->keywords, data, len);
+    }
+
+    if (regex_buf->dictionary != NULL) {
+        return dawg_count(regex_buf->dictionary, data, len);
+    }
+
+    if (regex_buf->nfa == NULL) {
+        return -1;
+    }
+
+    DFA* search_dfa = search_dfa_of(regex_buf);
+    if (search_dfa != NULL && !has_candidates(regex_buf) && !scans_suffix(regex_buf)) {
+        return dfa_count(search_dfa, data, len);
+    }
+
+    const char* string = data;
+    ssize_t count = 0;
+    ssize_t end;
+
+    while (len > 0 && (end = find_end(regex_buf, string, len, NULL)) > 0) {
+        count++;
+        string += end;
+        len -= end;
+    }
+
+    return count;
+}
+
+/**
+ * Find the first match in the given buffer that starts at or after `from`.
+ *
+ * The match that ends first is located, and extended to start as early as
+ * possible. From that start, the match is then extended to end as late as
+ * possible.
+ *
+ * @param  regex_buf The regex to search for
+ * @param  data      The buffer to search
+ * @param  len       The length of the buffer
+ * @param  from      The offset to start searching from
+ * @param  start     Set to the offset of the first byte of the match
+ * @param  end       Set to the offset just past the last byte of the match
+ *
+ * @return true if a match was found, false otherwise
+ */
+static bool find_match(const Regex* regex_buf, const char* data, size_t len,
+                       size_t from, size_t* start, size_t* end) {
+    const char* string = data + from;
+    size_t remaining = len - from;
+
+    if (remaining < regex_buf->min_len) {
+        return false;
+    }
+
+    if (regex_buf->literal != NULL) {
+        ssize_t found = horspool_find(regex_buf->literal, string, remaining);
+        if (found < 0) {
+            return false;
+        }
+
+        *start = from + found;
+        *end = *start + regex_buf->literal->needle.len;
+        return true;
+    }
+
+    if (regex_buf->keywords != NULL) {
+        if (aho_corasick_find(regex_buf->keywords, string, remaining, start, end) < 0) {
+            return false;
+        }
+
+        *start += from;
+        *end += from;
+        return true;
+    }
+
+    if (regex_buf->dictionary != NULL) {
+        if (dawg_find(regex_buf->dictionary, string, remaining, start, end) <= 0) {
+            return false;
+        }
+
+        *start += from;
+        *end += from;
+        return true;
+    }
+
+    ssize_t match_start;
+    ssize_t match_end = find_end(regex_buf, string, remaining, &match_start);
+
+    if (match_end < 0) {
+        return false;
+    }
+
+    if (match_start < 0) {
+        NFA* reverse_nfa;
+        DFA* reverse_dfa = reverse_dfa_of(regex_buf, &reverse_nfa);
+        match_start = reverse_dfa != NULL
+            ? dfa_find_start(reverse_dfa, string, match_end)
+            : nfa_find_start(reverse_nfa, string, match_end);
+    }
+
+    if (match_start < 0) {
+        return false;
+    }
+
+    ssize_t longest = regex_buf->dfa != NULL
+        ? dfa_longest_match(regex_buf->dfa, &string[match_start], remaining - match_start)
+        : nfa_longest_match(regex_buf->nfa, &string[match_start], remaining - match_start);
+
+    if (longest > match_end - match_start) {
+        match_end = match_start + longest;
+    }
+
+    *start = from + match_start;
+    *end = from + match_end;
+    return true;
+}
+
+// Copy as much of `src` as fits, but always account for all of it
+static inline void emit(char* out_buf, size_t out_cap, size_t* written,
+                        const char* src, size_t n) {
+    if (*written < out_cap) {
+        size_t room = out_cap - *written;
+        memcpy(&out_buf[*written], src, n < room ? n : room);
+    }
+
+    *written += n;
+}
+
+// Replace every match of the given regex in a buffer
+int regex_replace(const Regex* regex_buf, const void* in, size_t in_len,
+                  const char* repl, char* out_buf, size_t out_cap, size_t* out_len) {
+    if (regex_buf == NULL || in == NULL || repl == NULL || out_len == NULL
+        || (out_buf == NULL && out_cap > 0) || !regex_buf->is_compiled
+        || !has_matcher(regex_buf)) {
+        return -1;
+    }
+
+    const char* data = in;
+    size_t repl_len = strlen(repl);
+    size_t written = 0;
+    size_t pos = 0;
+    size_t start, end;
+
+    // Without any of the required strings, the input is copied unchanged
+    bool searching = may_match(regex_buf, data, in_len);
+
+    while (searching && pos < in_len && find_match(regex_buf, data, in_len, pos, &start, &end)) {
+        emit(out_buf, out_cap, &written, &data[pos], start - pos);
+        emit(out_buf, out_cap, &written, repl, repl_len);
+        pos = end;
+    }
+
+    emit(out_buf, out_cap, &written, &data[pos], in_len - pos);
+
+    *out_len = written;
+    return written <= out_cap ? 0 : 1;
+}
+
+// Pass every field between occurrences of the given regex to a callback
+ssize_t regex_split_each(const Regex* regex_buf, const void* in, size_t in_len,
+                         regex_slice_cb cb, void* ctx) {
+    if (regex_buf == NULL || in == NULL || cb == NULL || !regex_buf->is_compiled
+        || !has_matcher(regex_buf)) {
+        return -1;
+    }
+
+    const char* data = in;
+    ssize_t n_fields = 0;
+    size_t pos = 0;
+    size_t start, end;
+
+    // Without any of the required strings, the input is a single field
+    bool searching = may_match(regex_buf, data, in_len);
+
+    while (searching && pos < in_len && find_match(regex_buf, data, in_len, pos, &start, &end)) {
+        n_fields++;
+        if (cb((RegexSlice) {.offset = pos, .length = start - pos}, ctx) != 0) {
+            return n_fields;
+        }
+        pos = end;
+    }
+
+    n_fields++;
+    cb((RegexSlice) {.offset = pos, .length = in_len - pos}, ctx);
+
+    return n_fields;
+}
+
+/**
+ * Destination for the fields found by `regex_split`
+ *
+ * Members
+ *     - slices: The array to store fields in
+ *     - max_slices: The size of the `slices` array
+ *     - n_slices: The number of fields seen so far
+ */
+typedef struct SliceArray {
+    RegexSlice* slices;
+    size_t max_slices;
+    size_t n_slices;
+} SliceArray;
+
+static int store_slice(RegexSlice slice, void* ctx) {
+    SliceArray* array = ctx;
+
+    if (array->n_slices < array->max_slices) {
+        array->slices[array->n_slices] = slice;
+    }
+
+    array->n_slices++;
+    return 0;
+}
+
+// Split a buffer into fields separated by occurrences of the given regex
+ssize_t regex_split(const Regex* regex_buf, const void* in, size_t in_len,
+                    RegexSlice* slices, size_t max_slices) {
+    if (slices == NULL && max_slices > 0) {
+        return -1;
+    }
+
+    SliceArray array = {
+        .slices = slices,
+        .max_slices = max_slices,
+        .n_slices = 0,
+    };
+
+    return regex_split_each(regex_buf, in, in_len, store_slice, &array);
+}
+
+/**
+ * A share of the tiles of a batch match
+ *
+ * Members
+ *     - regexes: The regexes matched against
+ *     - n_regexes: The number of regexes
+ *     - data: The inputs, one after another
+ *     - offsets: Where every input starts, and where the last one ends
+ *     - n_inputs: The number of inputs
+ *     - matrix: The matrix of results
+ *     - first: The first tile this worker matches
+ *     - step: The distance between tiles this worker matches
+ */
+typedef struct MatrixWorker {
+    Regex* const* regexes;
+    size_t n_regexes;
+    const char* data;
+    const size_t* offsets;
+    size_t n_inputs;
+    uint64_t* matrix;
+    size_t first;
+    size_t step;
+} MatrixWorker;
+
+// Fill in the words of the matrix covered by a worker's tiles. Tiles never
+// share a word, so workers do not need to synchronize.
+static void* match_tiles(void* arg) {
+    MatrixWorker* worker = arg;
+    size_t row_words = REGEX_SET_WORDS(worker->n_regexes);
+    size_t n_blocks = (worker->n_inputs + REGEX_MATRIX_BLOCK - 1) / REGEX_MATRIX_BLOCK;
+
+    for (size_t tile = worker->first; tile < n_blocks * row_words; tile += worker->step) {
+        size_t word = tile % row_words;
+        size_t first_input = tile / row_words * REGEX_MATRIX_BLOCK;
+        size_t last_input = first_input + REGEX_MATRIX_BLOCK;
+        if (last_input > worker->n_inputs) {
+            last_input = worker->n_inputs;
+        }
+
+        size_t first_regex = word * 64;
+        size_t last_regex = first_regex + 64;
+        if (last_regex > worker->n_regexes) {
+            last_regex = worker->n_regexes;
+        }
+
+        for (size_t i = first_input; i < last_input; i++) {
+            worker->matrix[i * row_words + word] = 0;
+        }
+
+        for (size_t j = first_regex; j < last_regex; j++) {
+            const Regex* regex_buf = worker->regexes[j];
+            if (regex_buf == NULL || !regex_buf->is_compiled) {
+                continue;
+            }
+
+            uint64_t bit = (uint64_t) 1 << (j - first_regex);
+            for (size_t i = first_input; i < last_input; i++) {
+                size_t start = worker->offsets[i];
+                size_t len = worker->offsets[i + 1] - start;
+                if (match_bytes(regex_buf, &worker->data[start], len)) {
+                    worker->matrix[i * row_words + word] |= bit;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Match every input of a batch against every regex
+int regex_match_matrix(Regex* const* regexes, size_t n_regexes, const char* data,
+                       const size_t* offsets, size_t n_inputs, uint64_t* matrix,
+                       size_t n_threads) {
+    if ((regexes == NULL && n_regexes > 0) || offsets == NULL
+        || (matrix == NULL && n_inputs > 0 && n_regexes > 0)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_inputs; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            return -1;
+        }
+    }
+
+    if (data == NULL && n_inputs > 0 && offsets[n_inputs] > 0) {
+        return -1;
+    }
+
+    size_t n_blocks = (n_inputs + REGEX_MATRIX_BLOCK - 1) / REGEX_MATRIX_BLOCK;
+    size_t n_tiles = n_blocks * REGEX_SET_WORDS(n_regexes);
+    if (n_tiles == 0) {
+        return 0;
+    }
+
+    if (n_threads == 0) {
+        int n_processors = n_processors_online();
+        n_threads = n_processors > 0 ? n_processors : 1;
+    }
+
+    if (n_threads > n_tiles) {
+        n_threads = n_tiles;
+    }
+
+    MatrixWorker* workers = malloc(sizeof(MatrixWorker) * n_threads);
+    if (workers == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        workers[i] = (MatrixWorker) {
+            .regexes = regexes,
+            .n_regexes = n_regexes,
+            .data = data,
+            .offsets = offsets,
+            .n_inputs = n_inputs,
+            .matrix = matrix,
+            .first = i,
+            .step = n_threads,
+        };
+    }
+
+#ifndef WIN32_LEAN_AND_MEAN
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    bool* started = calloc(n_threads, sizeof(bool));
+
+    if (threads == NULL || started == NULL) {
+        free(workers);
+        free(threads);
+        free(started);
+        return -1;
+    }
+
+    // The calling thread takes the first share, and any share a thread
+    // could not be started for
+    for (size_t i = 1; i < n_threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL, match_tiles, &workers[i]) == 0;
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        if (!started[i]) {
+            match_tiles(&workers[i]);
+        }
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    free(threads);
+    free(started);
+#else
+    // Without threads, the shares are matched one after another
+    for (size_t i = 0; i < n_threads; i++) {
+        match_tiles(&workers[i]);
+    }
+#endif
+
+    free(workers);
+    return 0;
+}
+
+// Determinize the pattern of a regex compiled without an anchored DFA, such
+// as plain strings and alternations of them, so it can be compared with
+// other regexes. NULL if the regex has no pattern, or needs too many states.
+static DFA* comparison_dfa(const Regex* regex_buf) {
+    if (regex_buf->pattern == NULL) {
+        return NULL;
+    }
+
+    Lexer lexer;
+    Parser parser;
+    if (lexer_init(&lexer, regex_buf->pattern) < 0) {
+        return NULL;
+    }
+    if (parser_init(&parser, &lexer) < 0) {
+        lexer_free(&lexer);
+        return NULL;
+    }
+
+    ASTNode* root = parse(&parser);
+    parser_free(&parser);
+    lexer_free(&lexer);
+
+    NFA* nfa = convert_ast_to_nfa(root);
+    ast_node_free(root);
+    if (nfa == NULL) {
+        return NULL;
+    }
+
+    DFA* dfa = dfa_create(nfa, DFA_ANCHORED);
+    nfa_free(nfa);
+    free(nfa);
+    return dfa;
+}
+
+// Find the anchored DFAs of the given regexes, determinizing those compiled
+// without one. built[i] is set to whether dfas[i] was created here.
+static void find_dfas(Regex* const* regexes, size_t n, DFA** dfas, bool* built) {
+    for (size_t i = 0; i < n; i++) {
+        dfas[i] = NULL;
+        built[i] = false;
+
+        if (regexes[i] == NULL) {
+            continue;
+        }
+
+        dfas[i] = regexes[i]->dfa;
+        if (dfas[i] == NULL && regexes[i]->nfa == NULL) {
+            dfas[i] = comparison_dfa(regexes[i]);
+            built[i] = dfas[i] != NULL;
+        }
+    }
+}
+
+static void free_dfas(DFA** dfas, const bool* built, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (built[i]) {
+            dfa_free(dfas[i]);
+            free(dfas[i]);
+        }
+    }
+}
+
+// Compare the languages of two regexes with the given DFAs, for a subset,
+// or for equivalence when `both`
+static int compare_languages(const Regex* a, const DFA* dfa_a, const Regex* b,
+                             const DFA* dfa_b, bool both) {
+    if (dfa_a == NULL || dfa_b == NULL) {
+        return -1;
+    }
+
+    // A shorter or longer match than `b` allows rules it out right away
+    if (a->min_len < b->min_len || a->max_len > b->max_len) {
+        return 0;
+    }
+
+    if (both) {
+        if (a->min_len != b->min_len || a->max_len != b->max_len) {
+            return 0;
+        }
+        return dfa_is_equivalent(dfa_a, dfa_b);
+    }
+
+    return dfa_is_subset(dfa_a, dfa_b);
+}
+
+static int regex_compare(const Regex* a, const Regex* b, bool both) {
+    if (a == NULL || b == NULL) {
+        return -1;
+    }
+
+    Regex* const regexes[] = {(Regex*) a, (Regex*) b};
+    DFA* dfas[2];
+    bool built[2];
+    find_dfas(regexes, 2, dfas, built);
+
+    int result = compare_languages(a, dfas[0], b, dfas[1], both);
+
+    free_dfas(dfas, built, 2);
+    return result;
+}
+
+// Check whether every string matched by `a` is matched by `b`
+int regex_is_subset(const Regex* a, const Regex* b) {
+    return regex_compare(a, b, false);
+}
+
+// Check whether two regexes match the same strings
+int regex_is_equivalent(const Regex* a, const Regex* b) {
+    return regex_compare(a, b, true);
+}
+
+// Find the regexes of a set matching nothing another one does not
+ssize_t regex_prune(Regex* const* regexes, size_t n_regexes, bool* keep) {
+    if ((regexes == NULL || keep == NULL) && n_regexes > 0) {
+        return -1;
+    }
+
+    // The regexes kept so far, none of which contains another
+    size_t n = n_regexes > 0 ? n_regexes : 1;
+    size_t* kept = malloc(sizeof(size_t) * n);
+    DFA** dfas = malloc(sizeof(DFA*) * n);
+    bool* built = malloc(sizeof(bool) * n);
+    if (kept == NULL || dfas == NULL || built == NULL) {
+        free(kept);
+        free(dfas);
+        free(built);
+        return -1;
+    }
+
+    // Determinize each regex once, rather than for every comparison
+    find_dfas(regexes, n_regexes, dfas, built);
+
+    ssize_t n_kept = 0;
+
+    for (size_t i = 0; i < n_regexes; i++) {
+        keep[i] = false;
+        if (regexes[i] == NULL) {
+            continue;
+        }
+
+        // Regexes without a DFA are kept without comparing them
+        bool covered = false;
+        for (ssize_t k = 0; k < n_kept && !covered && dfas[i] != NULL; k++) {
+            int subset = compare_languages(regexes[i], dfas[i], regexes[kept[k]],
+                                           dfas[kept[k]], false);
+            if (subset < 0 && dfas[kept[k]] != NULL) {
+                n_kept = -1;
+                goto done;
+            }
+            covered = subset == 1;
+        }
+
+        if (covered) {
+            continue;
+        }
+
+        // Drop the regexes kept so far that this one covers
+        ssize_t n_left = 0;
+        for (ssize_t k = 0; k < n_kept; k++) {
+            int subset = compare_languages(regexes[kept[k]], dfas[kept[k]], regexes[i],
+                                           dfas[i], false);
+            if (subset < 0 && dfas[i] != NULL && dfas[kept[k]] != NULL) {
+                n_kept = -1;
+                goto done;
+            }
+
+            if (subset == 1) {
+                keep[kept[k]] = false;
+            } else {
+                kept[n_left++] = kept[k];
+            }
+        }
+
+        kept[n_left++] = i;
+        keep[i] = true;
+        n_kept = n_left;
+    }
+
+done:
+    free_dfas(dfas, built, n_regexes);
+    free(kept);
+    free(dfas);
+    free(built);
+    return n_kept;
+}
+
+// Release the memory used by the given regex structure
+void regex_free(Regex* regex_buf) {
+    if (regex_buf == NULL) {
+        return;
+    }
+
+    nfa_free(regex_buf->nfa);
+    free(regex_buf->nfa);
+    regex_buf->nfa = NULL;
+
+    dfa_free(regex_buf->dfa);
+    free(regex_buf->dfa);
+    regex_buf->dfa = NULL;
+
+    dfa_free(regex_buf->search_dfa);
+    free(regex_buf->search_dfa);
+    regex_buf->search_dfa = NULL;
+    regex_buf->built = 0;
+
+    nfa_free(regex_buf->reverse_nfa);
+    free(regex_buf->reverse_nfa);
+    regex_buf->reverse_nfa = NULL;
+
+    dfa_free(regex_buf->reverse_dfa);
+    free(regex_buf->reverse_dfa);
+    regex_buf->reverse_dfa = NULL;
+
+    ast_node_free(regex_buf->ast);
+    regex_buf->ast = NULL;
+
+    free(regex_buf->shuffle);
+    regex_buf->shuffle = NULL;
+
+    glushkov_free(regex_buf->glushkov);
+    free(regex_buf->glushkov);
+    regex_buf->glushkov = NULL;
+
+    literal_free(&regex_buf->prefix);
+    literal_free(&regex_buf->suffix);
+    literal_set_free(&regex_buf->required);
+
+    teddy_free(regex_buf->start_scanner);
+    free(regex_buf->start_scanner);
+    regex_buf->start_scanner = NULL;
+
+    teddy_free(regex_buf->required_scanner);
+    free(regex_buf->required_scanner);
+    regex_buf->required_scanner = NULL;
+
+    horspool_free(regex_buf->literal);
+    free(regex_buf->literal);
+    regex_buf->literal = NULL;
+
+    aho_corasick_free(regex_buf->keywords);
+    free(regex_buf->keywords);
+    regex_buf->keywords = NULL;
+
+    perfect_hash_free(regex_buf->exact);
+    free(regex_buf->exact);
+    regex_buf->exact = NULL;
+
+    dawg_free(regex_buf->dictionary);
+    free(regex_buf->dictionary);
+    regex_buf->dictionary = NULL;
 }
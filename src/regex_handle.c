@@ -0,0 +1,197 @@
+#include <stdlib.h>
+
+#include "regex_handle.h"
+
+// Initialize the given handle
+int regex_handle_init(RegexHandle* handle, Regex* regex) {
+    if (handle == NULL) {
+        return -1;
+    }
+
+    // Epochs start past the one marking readers outside of read sections
+    atomic_init(&handle->current, regex);
+    atomic_init(&handle->epoch, REGEX_HANDLE_QUIESCENT + 1);
+    atomic_init(&handle->readers, NULL);
+    handle->retired = NULL;
+    atomic_flag_clear(&handle->writer);
+
+    return 0;
+}
+
+// Release a regex owned by the handle
+static void release_regex(Regex* regex) {
+    regex_free(regex);
+    free(regex);
+}
+
+// Releases the memory used by the given handle
+void regex_handle_free(RegexHandle* handle) {
+    if (handle == NULL) {
+        return;
+    }
+
+    release_regex(atomic_exchange(&handle->current, NULL));
+
+    while (handle->retired != NULL) {
+        RegexRetired* next = handle->retired->next;
+        release_regex(handle->retired->regex);
+        free(handle->retired);
+        handle->retired = next;
+    }
+
+    RegexReader* reader = atomic_exchange(&handle->readers, NULL);
+    while (reader != NULL) {
+        RegexReader* next = reader->next;
+        free(reader);
+        reader = next;
+    }
+}
+
+// Register the calling thread as a reader of the handle
+RegexReader* regex_reader_register(RegexHandle* handle) {
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    // Reuse a reader another thread gave up
+    for (RegexReader* reader = atomic_load(&handle->readers); reader != NULL; reader = reader->next) {
+        bool unused = false;
+        if (atomic_compare_exchange_strong(&reader->in_use, &unused, true)) {
+            return reader;
+        }
+    }
+
+    RegexReader* reader = malloc(sizeof(RegexReader));
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&reader->epoch, REGEX_HANDLE_QUIESCENT);
+    atomic_init(&reader->in_use, true);
+
+    // Readers are only ever added at the front, and removed with the handle
+    reader->next = atomic_load(&handle->readers);
+    while (!atomic_compare_exchange_weak(&handle->readers, &reader->next, reader)) {
+        // Another reader was added first, reader->next now points to it
+    }
+
+    return reader;
+}
+
+// Give up a reader
+void regex_reader_unregister(RegexReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    atomic_store(&reader->epoch, REGEX_HANDLE_QUIESCENT);
+    atomic_store(&reader->in_use, false);
+}
+
+// Enter a read section, and load the current regex
+Regex* regex_reader_enter(RegexHandle* handle, RegexReader* reader) {
+    if (handle == NULL || reader == NULL) {
+        return NULL;
+    }
+
+    // The epoch is published before the regex is loaded. A writer that
+    // swaps the regex after this load sees the epoch, and keeps the old
+    // regex. One that swapped it before may miss the epoch, but then this
+    // load already sees the new regex.
+    atomic_store(&reader->epoch, atomic_load(&handle->epoch));
+    return atomic_load(&handle->current);
+}
+
+// Leave a read section
+void regex_reader_exit(RegexReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    atomic_store(&reader->epoch, REGEX_HANDLE_QUIESCENT);
+}
+
+// Release the replaced regexes no reader can be using, with the writer
+// lock held
+static ssize_t reclaim(RegexHandle* handle) {
+    // Regexes replaced before the oldest epoch a reader is in are safe
+    uint64_t oldest = UINT64_MAX;
+    for (RegexReader* reader = atomic_load(&handle->readers); reader != NULL; reader = reader->next) {
+        uint64_t epoch = atomic_load(&reader->epoch);
+        if (epoch != REGEX_HANDLE_QUIESCENT && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    ssize_t waiting = 0;
+    RegexRetired** link = &handle->retired;
+
+    while (*link != NULL) {
+        RegexRetired* retired = *link;
+        if (retired->epoch < oldest) {
+            *link = retired->next;
+            release_regex(retired->regex);
+            free(retired);
+        } else {
+            link = &retired->next;
+            waiting++;
+        }
+    }
+
+    return waiting;
+}
+
+static void lock_writer(RegexHandle* handle) {
+    while (atomic_flag_test_and_set_explicit(&handle->writer, memory_order_acquire)) {
+        // Writers are rare, and only hold the lock briefly
+    }
+}
+
+static void unlock_writer(RegexHandle* handle) {
+    atomic_flag_clear_explicit(&handle->writer, memory_order_release);
+}
+
+// Replace the regex of the handle
+ssize_t regex_handle_swap(RegexHandle* handle, Regex* regex) {
+    if (handle == NULL) {
+        return -1;
+    }
+
+    // Allocated up front, so the swap cannot fail halfway
+    RegexRetired* retired = malloc(sizeof(RegexRetired));
+    if (retired == NULL) {
+        return -1;
+    }
+
+    lock_writer(handle);
+
+    Regex* old = atomic_exchange(&handle->current, regex);
+
+    // Readers entering from the next epoch on cannot load the old regex
+    uint64_t epoch = atomic_fetch_add(&handle->epoch, 1);
+
+    if (old != NULL) {
+        *retired = (RegexRetired) {.regex = old, .epoch = epoch, .next = handle->retired};
+        handle->retired = retired;
+    } else {
+        free(retired);
+    }
+
+    ssize_t waiting = reclaim(handle);
+
+    unlock_writer(handle);
+    return waiting;
+}
+
+// Release the replaced regexes no reader can still be using
+ssize_t regex_handle_reclaim(RegexHandle* handle) {
+    if (handle == NULL) {
+        return -1;
+    }
+
+    lock_writer(handle);
+    ssize_t waiting = reclaim(handle);
+    unlock_writer(handle);
+
+    return waiting;
+}
@@ -0,0 +1,938 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "converter.h"
+#include "lexer.h"
+#include "parser.h"
+#include "regex_set.h"
+
+// The NFA only has transitions on printable characters
+#define FIRST_PRINTABLE 0x20
+#define LAST_PRINTABLE 0x7E
+
+#define WORD_BITS 64
+#define NO_TAG UINT32_MAX
+
+// The subset construction keeps a bitset of NFA states for every NFA state
+// and every DFA state, so it is only tried for combined NFAs up to this size
+#define REGEX_SET_MAX_DFA_NFA_STATES 8192
+
+// The number of threads sets are determinized on, 0 for one per processor.
+// Threads have not been measured to pay for themselves on any size of set,
+// so sets are determinized serially unless built with a number from
+// `make bench`.
+#ifndef REGEX_SET_DFA_THREADS
+#define REGEX_SET_DFA_THREADS 1
+#endif
+
+// Small sets are redeterminized after updates touching this many states,
+// rather than after every update
+#define REGEX_SET_MIN_CHURN 256
+
+// Create a heap allocated set of the given patterns
+RegexSet* regex_set_create(char** patterns, size_t n_patterns) {
+    RegexSet* set = malloc(sizeof(RegexSet));
+    if (set == NULL) {
+        return NULL;
+    }
+
+    if (regex_set_init(set, patterns, n_patterns) < 0) {
+        free(set);
+        return NULL;
+    }
+
+    return set;
+}
+
+// Parse the given pattern, and convert it to an NFA. The string it matches
+// is stored in `literal` if it is a plain string, which is left empty
+// otherwise.
+static NFA* compile_pattern(char* pattern, Literal* literal) {
+    *literal = (Literal) {.bytes = NULL, .len = 0};
+
+    Lexer lexer;
+    if (lexer_init(&lexer, pattern) < 0) {
+        return NULL;
+    }
+
+    Parser parser;
+    if (parser_init(&parser, &lexer) < 0) {
+        lexer_free(&lexer);
+        return NULL;
+    }
+
+    ASTNode* root = parse(&parser);
+
+    parser_free(&parser);
+    lexer_free(&lexer);
+
+    if (root == NULL) {
+        return NULL;
+    }
+
+    if (literal_is_pure(root) && literal_prefix(root, literal) < 0) {
+        ast_node_free(root);
+        return NULL;
+    }
+
+    NFA* nfa = convert_ast_to_nfa(root);
+    ast_node_free(root);
+    if (nfa == NULL) {
+        literal_free(literal);
+    }
+    return nfa;
+}
+
+static int state_id_cmp(const void* a, const void* b) {
+    const NFAState* x = *(const NFAState**) a;
+    const NFAState* y = *(const NFAState**) b;
+    return (x->ID > y->ID) - (x->ID < y->ID);
+}
+
+// Position of the given NFA state in the sorted state list
+static uint32_t state_index(const NFAStateList* states, NFAState* state) {
+    NFAState** found = bsearch(&state, states->list, states->size,
+                               sizeof(NFAState*), state_id_cmp);
+    return found - states->list;
+}
+
+static inline void set_bit(uint64_t* set, size_t i) {
+    set[i / WORD_BITS] |= (uint64_t) 1 << (i % WORD_BITS);
+}
+
+static inline void clear_bit(uint64_t* set, size_t i) {
+    set[i / WORD_BITS] &= ~((uint64_t) 1 << (i % WORD_BITS));
+}
+
+static inline bool has_bit(const uint64_t* set, size_t i) {
+    return (set[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+// Append a value to a growing array of them
+static int push(uint32_t** list, size_t* size, size_t* capacity, uint32_t value) {
+    if (*size == *capacity) {
+        size_t cap = *capacity == 0 ? 64 : *capacity * 2;
+        uint32_t* grown = realloc(*list, sizeof(uint32_t) * cap);
+        if (grown == NULL) {
+            return -1;
+        }
+        *list = grown;
+        *capacity = cap;
+    }
+
+    (*list)[(*size)++] = value;
+    return 0;
+}
+
+// Make room for at least `n` patterns
+static int reserve_patterns(RegexSet* set, size_t n) {
+    if (n <= set->patterns_cap) {
+        return 0;
+    }
+
+    size_t cap = set->patterns_cap == 0 ? 64 : set->patterns_cap;
+    while (cap < n) {
+        cap *= 2;
+    }
+
+    size_t old_words = REGEX_SET_WORDS(set->patterns_cap);
+    size_t words = REGEX_SET_WORDS(cap);
+
+    // Arrays that did grow are kept, the capacity is only raised once all
+    // of them have
+    NFA** nfas = realloc(set->nfas, sizeof(NFA*) * cap);
+    if (nfas != NULL) {
+        set->nfas = nfas;
+    }
+    uint32_t* free_ids = realloc(set->free_ids, sizeof(uint32_t) * cap);
+    if (free_ids != NULL) {
+        set->free_ids = free_ids;
+    }
+    uint32_t* starts = realloc(set->starts, sizeof(uint32_t) * cap);
+    if (starts != NULL) {
+        set->starts = starts;
+    }
+    uint32_t* sizes = realloc(set->sizes, sizeof(uint32_t) * cap);
+    if (sizes != NULL) {
+        set->sizes = sizes;
+    }
+    Literal* literals = realloc(set->literals, sizeof(Literal) * cap);
+    if (literals != NULL) {
+        set->literals = literals;
+    }
+    uint64_t* covered = realloc(set->covered, sizeof(uint64_t) * words);
+    if (covered != NULL) {
+        set->covered = covered;
+    }
+    uint64_t* pending = realloc(set->pending, sizeof(uint64_t) * words);
+    if (pending != NULL) {
+        set->pending = pending;
+    }
+
+    if (nfas == NULL || free_ids == NULL || starts == NULL || sizes == NULL
+        || literals == NULL || covered == NULL || pending == NULL) {
+        return -1;
+    }
+
+    memset(&covered[old_words], 0, sizeof(uint64_t) * (words - old_words));
+    memset(&pending[old_words], 0, sizeof(uint64_t) * (words - old_words));
+    set->patterns_cap = cap;
+    return 0;
+}
+
+// Make room for at least `n` states
+static int reserve_states(RegexSet* set, size_t n) {
+    if (n <= set->states_cap) {
+        return 0;
+    }
+
+    size_t cap = set->states_cap == 0 ? 64 : set->states_cap;
+    while (cap < n) {
+        cap *= 2;
+    }
+
+    uint32_t* tags = realloc(set->tags, sizeof(uint32_t) * cap);
+    if (tags != NULL) {
+        set->tags = tags;
+    }
+    uint32_t* closure_starts = realloc(set->closure_starts, sizeof(uint32_t) * (cap + 1));
+    if (closure_starts != NULL) {
+        set->closure_starts = closure_starts;
+    }
+    uint32_t* move_starts = realloc(set->move_starts, sizeof(uint32_t) * (cap + 1));
+    if (move_starts != NULL) {
+        set->move_starts = move_starts;
+    }
+
+    if (tags == NULL || closure_starts == NULL || move_starts == NULL) {
+        return -1;
+    }
+
+    set->states_cap = cap;
+    return 0;
+}
+
+// Flatten the epsilon closures of the states of a block
+static int append_closures(RegexSet* set, const NFAStateList* states, uint32_t base) {
+    size_t n = states->size;
+    uint32_t* stack = malloc(sizeof(uint32_t) * n);
+    uint64_t* seen = calloc((n + WORD_BITS - 1) / WORD_BITS, sizeof(uint64_t));
+
+    if (stack == NULL || seen == NULL) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        size_t start = set->n_closures;
+        size_t top = 0;
+
+        set->closure_starts[base + i] = start;
+        set_bit(seen, i);
+        stack[top++] = i;
+        if (push(&set->closures, &set->n_closures, &set->closures_cap, base + i) < 0) {
+            goto fail;
+        }
+
+        while (top > 0) {
+            NFAStateList* epsilon = get_transition(states->list[stack[--top]], '\0');
+            if (epsilon == NULL) {
+                continue;
+            }
+
+            for (size_t j = 0; j < epsilon->size; j++) {
+                uint32_t k = state_index(states, epsilon->list[j]);
+                if (!has_bit(seen, k)) {
+                    set_bit(seen, k);
+                    stack[top++] = k;
+                    if (push(&set->closures, &set->n_closures, &set->closures_cap, base + k) < 0) {
+                        goto fail;
+                    }
+                }
+            }
+        }
+
+        // Only the members of this closure are marked, clear just those
+        for (size_t j = start; j < set->n_closures; j++) {
+            clear_bit(seen, set->closures[j] - base);
+        }
+    }
+    set->closure_starts[base + n] = set->n_closures;
+
+    free(stack);
+    free(seen);
+    return 0;
+
+fail:
+    free(stack);
+    free(seen);
+    return -1;
+}
+
+// Flatten the transitions on bytes of the states of a block
+static int append_moves(RegexSet* set, const NFAStateList* states, uint32_t base) {
+    for (size_t i = 0; i < states->size; i++) {
+        set->move_starts[base + i] = set->n_moves;
+
+        for (int c = FIRST_PRINTABLE; c <= LAST_PRINTABLE; c++) {
+            NFAStateList* targets = get_transition(states->list[i], (char) c);
+            if (targets == NULL) {
+                continue;
+            }
+
+            for (size_t j = 0; j < targets->size; j++) {
+                if (set->n_moves == set->moves_cap) {
+                    size_t cap = set->moves_cap == 0 ? 64 : set->moves_cap * 2;
+                    RegexSetMove* moves = realloc(set->moves, sizeof(RegexSetMove) * cap);
+                    if (moves == NULL) {
+                        return -1;
+                    }
+                    set->moves = moves;
+                    set->moves_cap = cap;
+                }
+
+                set->moves[set->n_moves++] = (RegexSetMove) {
+                    .byte = c,
+                    .target = base + state_index(states, targets->list[j]),
+                };
+            }
+        }
+    }
+    set->move_starts[base + states->size] = set->n_moves;
+
+    return 0;
+}
+
+// Append a block with the states of the given pattern
+static int append_block(RegexSet* set, size_t id) {
+    NFAStateList* states = nfa_states(set->nfas[id]);
+    if (states == NULL) {
+        return -1;
+    }
+
+    uint32_t base = set->n_states;
+    size_t n_closures = set->n_closures;
+    size_t n_moves = set->n_moves;
+
+    qsort(states->list, states->size, sizeof(NFAState*), state_id_cmp);
+
+    if (reserve_states(set, base + states->size) < 0
+        || append_closures(set, states, base) < 0
+        || append_moves(set, states, base) < 0) {
+        // Forget whatever part of the block was written
+        set->n_closures = n_closures;
+        set->n_moves = n_moves;
+        set->closure_starts[base] = n_closures;
+        set->move_starts[base] = n_moves;
+        NFAStateList_free(states, NULL);
+        free(states);
+        return -1;
+    }
+
+    for (size_t i = 0; i < states->size; i++) {
+        set->tags[base + i] = states->list[i]->is_final ? id : NO_TAG;
+    }
+
+    set->starts[id] = base + state_index(states, set->nfas[id]->start_state);
+    set->sizes[id] = states->size;
+    set->n_states += states->size;
+
+    NFAStateList_free(states, NULL);
+    free(states);
+    return 0;
+}
+
+// Release the arrays the blocks are flattened into
+static void free_blocks(RegexSet* set) {
+    free(set->starts);
+    free(set->tags);
+    free(set->closure_starts);
+    free(set->closures);
+    free(set->move_starts);
+    free(set->moves);
+}
+
+// Drop the retired blocks, by flattening the patterns in the set again. The
+// new blocks are built on the side, and only replace the old ones once every
+// pattern is flattened, so the set is left as it was on failure.
+static int compact(RegexSet* set) {
+    // The copy shares everything but the flattened arrays with the set
+    RegexSet side = *set;
+    side.starts = malloc(sizeof(uint32_t) * set->patterns_cap);
+    side.n_states = 0;
+    side.states_cap = 0;
+    side.retired_states = 0;
+    side.tags = NULL;
+    side.closure_starts = NULL;
+    side.closures = NULL;
+    side.n_closures = 0;
+    side.closures_cap = 0;
+    side.move_starts = NULL;
+    side.moves = NULL;
+    side.n_moves = 0;
+    side.moves_cap = 0;
+
+    if (side.starts == NULL
+        || reserve_states(&side, set->n_states - set->retired_states + 1) < 0) {
+        free_blocks(&side);
+        return -1;
+    }
+
+    side.closure_starts[0] = 0;
+    side.move_starts[0] = 0;
+
+    for (size_t id = 0; id < set->n_patterns; id++) {
+        side.starts[id] = NO_TAG;
+        if (set->nfas[id] != NULL && append_block(&side, id) < 0) {
+            free_blocks(&side);
+            return -1;
+        }
+    }
+
+    free_blocks(set);
+    set->starts = side.starts;
+    set->n_states = side.n_states;
+    set->states_cap = side.states_cap;
+    set->retired_states = 0;
+    set->tags = side.tags;
+    set->closure_starts = side.closure_starts;
+    set->closures = side.closures;
+    set->n_closures = side.n_closures;
+    set->closures_cap = side.closures_cap;
+    set->move_starts = side.move_starts;
+    set->moves = side.moves;
+    set->n_moves = side.n_moves;
+    set->moves_cap = side.moves_cap;
+    return 0;
+}
+
+// Release the perfect hash of the set's strings
+static void free_exact(RegexSet* set) {
+    perfect_hash_free(set->exact);
+    free(set->exact);
+    free(set->exact_ids);
+    free(set->exact_next);
+    set->exact = NULL;
+    set->exact_ids = NULL;
+    set->exact_next = NULL;
+}
+
+/**
+ * Build a perfect hash of the strings of the patterns in the set, if every
+ * one of them is a plain string
+ *
+ * @param  set The set to hash the strings of
+ *
+ * @return 0 on success, or if some pattern is not a plain string or no
+ *         perfect hash could be found, -1 on failure
+ */
+static int build_exact(RegexSet* set) {
+    for (size_t id = 0; id < set->n_patterns; id++) {
+        if (set->nfas[id] != NULL && set->literals[id].len == 0) {
+            return 0;
+        }
+    }
+
+    LiteralSet keys = {.literals = malloc(sizeof(Literal) * set->n_live), .n = 0};
+    set->exact_ids = malloc(sizeof(uint32_t) * set->n_live);
+    set->exact_next = malloc(sizeof(uint32_t) * set->n_live);
+    uint32_t* last = malloc(sizeof(uint32_t) * set->n_live);
+
+    if (keys.literals == NULL || set->exact_ids == NULL || set->exact_next == NULL || last == NULL) {
+        free(keys.literals);
+        free(last);
+        free_exact(set);
+        return -1;
+    }
+
+    // The keys only borrow the strings of the patterns
+    for (size_t id = 0; id < set->n_patterns; id++) {
+        if (set->nfas[id] != NULL) {
+            set->exact_ids[keys.n] = id;
+            keys.literals[keys.n++] = set->literals[id];
+        }
+    }
+
+    set->exact = perfect_hash_create(&keys);
+
+    // Chain every key to the next one equal to it, from the first of them
+    // the hash leads to
+    for (size_t i = 0; set->exact != NULL && i < keys.n; i++) {
+        size_t first = perfect_hash_lookup(set->exact, keys.literals[i].bytes, keys.literals[i].len);
+        set->exact_next[i] = UINT32_MAX;
+        if (first != i) {
+            set->exact_next[last[first]] = i;
+        }
+        last[first] = i;
+    }
+
+    free(keys.literals);
+    free(last);
+    if (set->exact == NULL) {
+        free_exact(set);
+    }
+    return 0;
+}
+
+// Determinize the patterns in the set, so none of them is simulated. The
+// DFA is left out if they need too many states. Sets of plain strings are
+// hashed instead.
+static int rebuild_dfa(RegexSet* set) {
+    size_t words = REGEX_SET_WORDS(set->n_patterns);
+    size_t live_states = set->n_states - set->retired_states;
+
+    dfa_free(set->dfa);
+    free(set->dfa);
+    set->dfa = NULL;
+    free_exact(set);
+
+    // Until a new DFA is built, every pattern is simulated
+    for (size_t i = 0; i < words; i++) {
+        set->covered[i] = 0;
+    }
+    for (size_t id = 0; id < set->n_patterns; id++) {
+        if (set->nfas[id] != NULL) {
+            set_bit(set->pending, id);
+        }
+    }
+
+    // Updates pay for the next rebuild once they touch as many states as the
+    // set has now, whether or not this one succeeds
+    set->churn = 0;
+    set->rebuild_at = live_states > REGEX_SET_MIN_CHURN ? live_states : REGEX_SET_MIN_CHURN;
+
+    if (set->n_live == 0) {
+        return 0;
+    }
+
+    // Whole strings are looked up in the hash without running an automaton
+    if (build_exact(set) < 0) {
+        return -1;
+    }
+
+    if (set->exact == NULL && live_states + 1 > REGEX_SET_MAX_DFA_NFA_STATES) {
+        return 0;
+    }
+
+    if (set->exact != NULL) {
+        for (size_t i = 0; i < words; i++) {
+            set->covered[i] = set->pending[i];
+            set->pending[i] = 0;
+        }
+        return 0;
+    }
+
+    // The start state only leads to the patterns in the set
+    state_free(set->nfa.start_state);
+    set->nfa.start_state = state_create(false);
+    if (set->nfa.start_state == NULL) {
+        return -1;
+    }
+
+    for (size_t id = 0; id < set->n_patterns; id++) {
+        if (set->nfas[id] != NULL
+            && add_transition(set->nfa.start_state, set->nfas[id]->start_state, '\0') < 0) {
+            return -1;
+        }
+    }
+
+    set->dfa = dfa_create_set(&set->nfa, set->nfas, set->n_patterns, REGEX_SET_DFA_THREADS);
+    if (set->dfa == NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < words; i++) {
+        set->covered[i] = set->pending[i];
+        set->pending[i] = 0;
+    }
+
+    return 0;
+}
+
+// Compile the given pattern, and give it an id without updating the DFA
+static ssize_t insert_pattern(RegexSet* set, char* pattern) {
+    if (reserve_patterns(set, set->n_patterns + 1) < 0) {
+        return -1;
+    }
+
+    Literal literal;
+    NFA* nfa = compile_pattern(pattern, &literal);
+    if (nfa == NULL) {
+        return -1;
+    }
+
+    size_t id = set->n_free > 0 ? set->free_ids[--set->n_free] : set->n_patterns++;
+    set->nfas[id] = nfa;
+    set->literals[id] = literal;
+
+    if (append_block(set, id) < 0) {
+        nfa_free(nfa);
+        free(nfa);
+        literal_free(&set->literals[id]);
+        set->nfas[id] = NULL;
+        set->starts[id] = NO_TAG;
+        set->free_ids[set->n_free++] = id;
+        return -1;
+    }
+
+    set->n_live++;
+    set->churn += set->sizes[id];
+    set_bit(set->pending, id);
+    return id;
+}
+
+// Compile the given patterns into a set
+int regex_set_init(RegexSet* set, char** patterns, size_t n_patterns) {
+    if (set == NULL || (patterns == NULL && n_patterns > 0)) {
+        return -1;
+    }
+
+    *set = (RegexSet) {
+        .nfas = NULL,
+        .n_patterns = 0,
+        .patterns_cap = 0,
+        .n_live = 0,
+        .free_ids = NULL,
+        .n_free = 0,
+        .nfa = {.start_state = NULL, .final_states = NULL},
+        .dfa = NULL,
+        .literals = NULL,
+        .exact = NULL,
+        .exact_ids = NULL,
+        .exact_next = NULL,
+        .covered = NULL,
+        .pending = NULL,
+        .churn = 0,
+        .rebuild_at = REGEX_SET_MIN_CHURN,
+        .starts = NULL,
+        .sizes = NULL,
+        .n_states = 0,
+        .states_cap = 0,
+        .retired_states = 0,
+        .tags = NULL,
+        .closure_starts = NULL,
+        .closures = NULL,
+        .n_closures = 0,
+        .closures_cap = 0,
+        .move_starts = NULL,
+        .moves = NULL,
+        .n_moves = 0,
+        .moves_cap = 0,
+    };
+
+    set->nfa.final_states = NFAStateList_create(1);
+
+    if (set->nfa.final_states == NULL || reserve_patterns(set, n_patterns > 0 ? n_patterns : 1) < 0
+        || reserve_states(set, 1) < 0) {
+        regex_set_free(set);
+        return -1;
+    }
+
+    set->closure_starts[0] = 0;
+    set->move_starts[0] = 0;
+
+    for (size_t i = 0; i < n_patterns; i++) {
+        if (insert_pattern(set, patterns[i]) < 0) {
+            regex_set_free(set);
+            return -1;
+        }
+    }
+
+    // Determinize the combined NFA when it is small enough. Otherwise, or if
+    // the patterns need too many states, the NFA is simulated instead.
+    if (rebuild_dfa(set) < 0) {
+        regex_set_free(set);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Add a pattern to the set
+ssize_t regex_set_add(RegexSet* set, char* pattern) {
+    if (set == NULL || pattern == NULL || set->nfa.final_states == NULL) {
+        return -1;
+    }
+
+    ssize_t id = insert_pattern(set, pattern);
+    if (id < 0) {
+        return -1;
+    }
+
+    // The pattern is simulated next to the DFA until enough has changed
+    if (set->churn >= set->rebuild_at && rebuild_dfa(set) < 0) {
+        regex_set_remove(set, id);
+        return -1;
+    }
+
+    return id;
+}
+
+// Remove a pattern from the set
+int regex_set_remove(RegexSet* set, size_t id) {
+    if (set == NULL || id >= set->n_patterns || set->nfas[id] == NULL) {
+        return -1;
+    }
+
+    nfa_free(set->nfas[id]);
+    free(set->nfas[id]);
+    set->nfas[id] = NULL;
+    literal_free(&set->literals[id]);
+
+    // The block of the pattern stays in place, but nothing leads to it
+    set->starts[id] = NO_TAG;
+    set->retired_states += set->sizes[id];
+    set->churn += set->sizes[id];
+    clear_bit(set->covered, id);
+    clear_bit(set->pending, id);
+    set->free_ids[set->n_free++] = id;
+    set->n_live--;
+
+    // Retired blocks are dropped once they make up most of the states. The
+    // DFA keeps working for the patterns it covers, removed ones are masked.
+    // Nothing leads to retired blocks, so if they cannot be dropped now, the
+    // set still works with them, and they are dropped by a later removal.
+    if (set->retired_states > set->n_states - set->retired_states) {
+        compact(set);
+    }
+
+    if (set->churn >= set->rebuild_at && rebuild_dfa(set) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Releases the memory used by the given set
+void regex_set_free(RegexSet* set) {
+    if (set == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; set->nfas != NULL && i < set->n_patterns; i++) {
+        nfa_free(set->nfas[i]);
+        free(set->nfas[i]);
+        literal_free(&set->literals[i]);
+    }
+    free(set->nfas);
+    free(set->literals);
+    free(set->free_ids);
+
+    // Only the start state belongs to the combined NFA
+    state_free(set->nfa.start_state);
+    NFAStateList_free(set->nfa.final_states, NULL);
+    free(set->nfa.final_states);
+
+    dfa_free(set->dfa);
+    free(set->dfa);
+    free_exact(set);
+
+    free(set->covered);
+    free(set->pending);
+    free(set->sizes);
+    free_blocks(set);
+
+    *set = (RegexSet) {
+        .nfas = NULL,
+        .n_patterns = 0,
+        .nfa = {.start_state = NULL, .final_states = NULL},
+        .dfa = NULL,
+    };
+}
+
+// Add the closure of a state to a list of states, skipping those in `seen`
+static inline void add_closure(const RegexSet* set, uint32_t state, uint32_t* list,
+                               size_t* size, uint64_t* seen) {
+    for (uint32_t i = set->closure_starts[state]; i < set->closure_starts[state + 1]; i++) {
+        uint32_t member = set->closures[i];
+        if (!has_bit(seen, member)) {
+            set_bit(seen, member);
+            list[(*size)++] = member;
+        }
+    }
+}
+
+// Initialize empty scratch space
+void regex_set_scratch_init(RegexSetScratch* scratch) {
+    if (scratch == NULL) {
+        return;
+    }
+
+    *scratch = (RegexSetScratch) {
+        .current = NULL,
+        .next = NULL,
+        .seen = NULL,
+        .capacity = 0,
+    };
+}
+
+// Releases the memory used by the given scratch space
+void regex_set_scratch_free(RegexSetScratch* scratch) {
+    if (scratch == NULL) {
+        return;
+    }
+
+    free(scratch->current);
+    free(scratch->next);
+    free(scratch->seen);
+    regex_set_scratch_init(scratch);
+}
+
+// Make room for at least `n` states in the scratch space
+static int reserve_scratch(RegexSetScratch* scratch, size_t n) {
+    if (n <= scratch->capacity) {
+        return 0;
+    }
+
+    size_t cap = scratch->capacity == 0 ? 64 : scratch->capacity;
+    while (cap < n) {
+        cap *= 2;
+    }
+
+    // Arrays that did grow are kept, like those of the set
+    uint32_t* current = realloc(scratch->current, sizeof(uint32_t) * cap);
+    if (current != NULL) {
+        scratch->current = current;
+    }
+    uint32_t* next = realloc(scratch->next, sizeof(uint32_t) * cap);
+    if (next != NULL) {
+        scratch->next = next;
+    }
+    size_t old_words = (scratch->capacity + WORD_BITS - 1) / WORD_BITS;
+    size_t words = (cap + WORD_BITS - 1) / WORD_BITS;
+    uint64_t* seen = realloc(scratch->seen, sizeof(uint64_t) * words);
+    if (seen != NULL) {
+        scratch->seen = seen;
+    }
+
+    if (current == NULL || next == NULL || seen == NULL) {
+        return -1;
+    }
+
+    memset(&seen[old_words], 0, sizeof(uint64_t) * (words - old_words));
+    scratch->capacity = cap;
+    return 0;
+}
+
+// Run the NFAs of the pending patterns over the string at once, and tag
+// those whose accepting states are reached
+static int simulate(const RegexSet* set, RegexSetScratch* scratch, const unsigned char* bytes,
+                    size_t len, uint64_t* matched) {
+    if (reserve_scratch(scratch, set->n_states) < 0) {
+        return -1;
+    }
+
+    uint32_t* current = scratch->current;
+    uint32_t* next = scratch->next;
+    uint64_t* seen = scratch->seen;
+
+    size_t n_current = 0;
+    for (size_t w = 0; w < REGEX_SET_WORDS(set->n_patterns); w++) {
+        for (uint64_t bits = set->pending[w]; bits != 0; bits &= bits - 1) {
+            size_t id = w * WORD_BITS + __builtin_ctzll(bits);
+            add_closure(set, set->starts[id], current, &n_current, seen);
+        }
+    }
+    for (size_t i = 0; i < n_current; i++) {
+        clear_bit(seen, current[i]);
+    }
+
+    for (size_t i = 0; i < len && n_current > 0; i++) {
+        size_t n_next = 0;
+
+        for (size_t j = 0; j < n_current; j++) {
+            uint32_t state = current[j];
+            for (uint32_t k = set->move_starts[state]; k < set->move_starts[state + 1]; k++) {
+                if (set->moves[k].byte == bytes[i]) {
+                    add_closure(set, set->moves[k].target, next, &n_next, seen);
+                }
+            }
+        }
+
+        for (size_t j = 0; j < n_next; j++) {
+            clear_bit(seen, next[j]);
+        }
+
+        uint32_t* temp = current;
+        current = next;
+        next = temp;
+        n_current = n_next;
+    }
+
+    for (size_t i = 0; i < n_current; i++) {
+        uint32_t tag = set->tags[current[i]];
+        if (tag != NO_TAG) {
+            set_bit(matched, tag);
+        }
+    }
+
+    return 0;
+}
+
+// Find every pattern of the set matching the whole of the given string
+ssize_t regex_set_match(const RegexSet* set, const char* string, size_t len,
+                        uint64_t* matched) {
+    RegexSetScratch scratch;
+    regex_set_scratch_init(&scratch);
+
+    ssize_t count = regex_set_match_with(set, &scratch, string, len, matched);
+    regex_set_scratch_free(&scratch);
+    return count;
+}
+
+// Find every pattern of the set matching the whole of the given string, with
+// the caller's scratch space
+ssize_t regex_set_match_with(const RegexSet* set, RegexSetScratch* scratch, const char* string,
+                             size_t len, uint64_t* matched) {
+    if (set == NULL || scratch == NULL || string == NULL || matched == NULL) {
+        return -1;
+    }
+
+    size_t words = REGEX_SET_WORDS(set->n_patterns);
+    memset(matched, 0, sizeof(uint64_t) * words);
+
+    const unsigned char* bytes = (const unsigned char*) string;
+
+    // Every pattern equal to the string is reported, unless removed since
+    if (set->exact != NULL) {
+        ssize_t key = perfect_hash_lookup(set->exact, string, len);
+        while (key >= 0) {
+            uint32_t id = set->exact_ids[key];
+            if (has_bit(set->covered, id)) {
+                set_bit(matched, id);
+            }
+            key = set->exact_next[key] != UINT32_MAX ? (ssize_t) set->exact_next[key] : -1;
+        }
+    }
+
+    if (set->dfa != NULL) {
+        const uint32_t* table = set->dfa->table;
+        uint32_t state = set->dfa->start_state;
+
+        for (size_t i = 0; i < len && state != DFA_DEAD_STATE; i++) {
+            state = table[state * DFA_ALPHABET_SIZE + bytes[i]];
+        }
+
+        // Patterns removed since the DFA was built are masked out
+        const uint64_t* accepts = &set->dfa->accepts[state * set->dfa->accept_words];
+        for (size_t i = 0; i < words && i < set->dfa->accept_words; i++) {
+            matched[i] = accepts[i] & set->covered[i];
+        }
+    }
+
+    // Patterns added since the DFA was built are simulated
+    bool any_pending = false;
+    for (size_t i = 0; i < words && !any_pending; i++) {
+        any_pending = set->pending[i] != 0;
+    }
+
+    if (any_pending && simulate(set, scratch, bytes, len, matched) < 0) {
+        return -1;
+    }
+
+    ssize_t count = 0;
+    for (size_t i = 0; i < words; i++) {
+        count += __builtin_popcountll(matched[i]);
+    }
+
+    return count;
+}
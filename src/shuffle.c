@@ -0,0 +1,100 @@
+#include <stdlib.h>
+
+#include "shuffle.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define SHUFFLE_HAVE_SSSE3
+    #include <immintrin.h>
+#endif
+
+// Create a heap allocated shuffle encoding of the given DFA
+ShuffleDFA* shuffle_dfa_create(const DFA* dfa) {
+    if (dfa == NULL || dfa->n_states > SHUFFLE_MAX_STATES) {
+        return NULL;
+    }
+
+    ShuffleDFA* shuffle = malloc(sizeof(ShuffleDFA));
+    if (shuffle == NULL) {
+        return NULL;
+    }
+
+    shuffle->start_state = dfa->start_state;
+    shuffle->accepting = 0;
+
+    for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+        for (size_t s = 0; s < SHUFFLE_MAX_STATES; s++) {
+            // Unused lanes lead to the dead state
+            shuffle->masks[c][s] = s < dfa->n_states
+                ? dfa->table[s * DFA_ALPHABET_SIZE + c]
+                : DFA_DEAD_STATE;
+        }
+    }
+
+    for (size_t s = 0; s < dfa->n_states; s++) {
+        if (dfa->is_final[s]) {
+            shuffle->accepting |= 1 << s;
+        }
+    }
+
+#ifdef SHUFFLE_HAVE_SSSE3
+    shuffle->use_simd = __builtin_cpu_supports("ssse3");
+#else
+    shuffle->use_simd = false;
+#endif
+
+    return shuffle;
+}
+
+#ifdef SHUFFLE_HAVE_SSSE3
+__attribute__((target("ssse3")))
+static uint8_t run_ssse3(const ShuffleDFA* dfa, const unsigned char* bytes, size_t len) {
+    __m128i state = _mm_set1_epi8(dfa->start_state);
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        state = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) dfa->masks[bytes[i]]), state);
+        state = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) dfa->masks[bytes[i + 1]]), state);
+        state = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) dfa->masks[bytes[i + 2]]), state);
+        state = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) dfa->masks[bytes[i + 3]]), state);
+    }
+
+    for (; i < len; i++) {
+        state = _mm_shuffle_epi8(_mm_load_si128((const __m128i*) dfa->masks[bytes[i]]), state);
+    }
+
+    return _mm_cvtsi128_si32(state) & 0xFF;
+}
+#endif // SHUFFLE_HAVE_SSSE3
+
+// Same walk as the vector version, one lane at a time
+static uint8_t run_scalar(const ShuffleDFA* dfa, const unsigned char* bytes, size_t len) {
+    uint8_t state = dfa->start_state;
+
+    for (size_t i = 0; i < len; i++) {
+        state = dfa->masks[bytes[i]][state];
+    }
+
+    return state;
+}
+
+// Perform a regex match using the given shuffle DFA on the given string
+bool shuffle_dfa_match(const ShuffleDFA* dfa, const char* string, size_t len) {
+    if (dfa == NULL || string == NULL) {
+        return false;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+    uint8_t state;
+
+#ifdef SHUFFLE_HAVE_SSSE3
+    if (dfa->use_simd) {
+        state = run_ssse3(dfa, bytes, len);
+    } else {
+        state = run_scalar(dfa, bytes, len);
+    }
+#else
+    state = run_scalar(dfa, bytes, len);
+#endif
+
+    return (dfa->accepting >> state) & 1;
+}
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "teddy.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define TEDDY_HAVE_SSSE3
+    #include <immintrin.h>
+#endif
+
+// Create a heap allocated Teddy searcher for the given literals
+Teddy* teddy_create(const LiteralSet* literals) {
+    if (literals == NULL || literals->n == 0 || literals->n > TEDDY_MAX_LITERALS) {
+        return NULL;
+    }
+
+    Teddy* teddy = calloc(1, sizeof(Teddy));
+    if (teddy == NULL) {
+        return NULL;
+    }
+
+    teddy->literals.literals = calloc(literals->n, sizeof(Literal));
+    if (teddy->literals.literals == NULL) {
+        free(teddy);
+        return NULL;
+    }
+
+    teddy->mask_len = TEDDY_MAX_MASK_LEN;
+
+    for (size_t i = 0; i < literals->n; i++) {
+        const Literal* literal = &literals->literals[i];
+        char* bytes = literal->len > 0 ? malloc(literal->len) : NULL;
+
+        if (bytes == NULL) {
+            teddy_free(teddy);
+            free(teddy);
+            return NULL;
+        }
+
+        memcpy(bytes, literal->bytes, literal->len);
+        teddy->literals.literals[teddy->literals.n++] = (Literal) {.bytes = bytes, .len = literal->len};
+
+        if (literal->len < teddy->mask_len) {
+            teddy->mask_len = literal->len;
+        }
+    }
+
+    for (size_t i = 0; i < literals->n; i++) {
+        const Literal* literal = &teddy->literals.literals[i];
+        size_t bucket = i % TEDDY_BUCKETS;
+
+        teddy->buckets[bucket] |= (uint64_t) 1 << i;
+
+        for (size_t j = 0; j < teddy->mask_len; j++) {
+            unsigned char c = literal->bytes[j];
+            teddy->lo[j][c & 0xF] |= 1 << bucket;
+            teddy->hi[j][c >> 4] |= 1 << bucket;
+        }
+    }
+
+#ifdef TEDDY_HAVE_SSSE3
+    teddy->use_simd = __builtin_cpu_supports("ssse3");
+#else
+    teddy->use_simd = false;
+#endif
+
+    return teddy;
+}
+
+// Releases the memory used by the given Teddy searcher
+void teddy_free(Teddy* teddy) {
+    if (teddy == NULL) {
+        return;
+    }
+
+    literal_set_free(&teddy->literals);
+}
+
+// Check whether a literal from the given buckets starts at `pos`
+static bool verify(const Teddy* teddy, const unsigned char* bytes, size_t len,
+                   size_t pos, uint8_t buckets, size_t* which) {
+    for (size_t b = 0; b < TEDDY_BUCKETS; b++) {
+        if (!(buckets & (1 << b))) {
+            continue;
+        }
+
+        for (uint64_t set = teddy->buckets[b]; set != 0; set &= set - 1) {
+            size_t i = __builtin_ctzll(set);
+            const Literal* literal = &teddy->literals.literals[i];
+
+            if (literal->len <= len - pos && memcmp(&bytes[pos], literal->bytes, literal->len) == 0) {
+                if (which != NULL) {
+                    *which = i;
+                }
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Check positions one at a time with the same tables
+static ssize_t find_scalar(const Teddy* teddy, const unsigned char* bytes,
+                           size_t from, size_t len, size_t* which) {
+    for (size_t pos = from; pos + teddy->mask_len <= len; pos++) {
+        uint8_t buckets = 0xFF;
+
+        for (size_t j = 0; j < teddy->mask_len && buckets != 0; j++) {
+            unsigned char c = bytes[pos + j];
+            buckets &= teddy->lo[j][c & 0xF] & teddy->hi[j][c >> 4];
+        }
+
+        if (buckets != 0 && verify(teddy, bytes, len, pos, buckets, which)) {
+            return pos;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef TEDDY_HAVE_SSSE3
+__attribute__((target("ssse3")))
+static ssize_t find_ssse3(const Teddy* teddy, const unsigned char* bytes,
+                          size_t len, size_t* which) {
+    const __m128i nibble = _mm_set1_epi8(0xF);
+    const __m128i zero = _mm_setzero_si128();
+    size_t mask_len = teddy->mask_len;
+
+    __m128i lo[TEDDY_MAX_MASK_LEN], hi[TEDDY_MAX_MASK_LEN];
+    for (size_t j = 0; j < mask_len; j++) {
+        lo[j] = _mm_load_si128((const __m128i*) teddy->lo[j]);
+        hi[j] = _mm_load_si128((const __m128i*) teddy->hi[j]);
+    }
+
+    // Each block looks at the 16 positions starting at `pos`, which needs
+    // `mask_len - 1` bytes past the block
+    size_t pos = 0;
+    for (; pos + 16 + mask_len - 1 <= len; pos += 16) {
+        __m128i candidates = _mm_set1_epi8((char) 0xFF);
+
+        for (size_t j = 0; j < mask_len; j++) {
+            __m128i block = _mm_loadu_si128((const __m128i*) &bytes[pos + j]);
+            __m128i low = _mm_and_si128(block, nibble);
+            __m128i high = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+
+            candidates = _mm_and_si128(candidates, _mm_and_si128(
+                _mm_shuffle_epi8(lo[j], low), _mm_shuffle_epi8(hi[j], high)));
+        }
+
+        unsigned int found = ~_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, zero)) & 0xFFFF;
+        if (found == 0) {
+            continue;
+        }
+
+        uint8_t lanes[16];
+        _mm_storeu_si128((__m128i*) lanes, candidates);
+
+        for (; found != 0; found &= found - 1) {
+            size_t lane = __builtin_ctz(found);
+            if (verify(teddy, bytes, len, pos + lane, lanes[lane], which)) {
+                return pos + lane;
+            }
+        }
+    }
+
+    return find_scalar(teddy, bytes, pos, len, which);
+}
+#endif // TEDDY_HAVE_SSSE3
+
+// Find the first position in the given string where any literal starts
+ssize_t teddy_find(const Teddy* teddy, const char* string, size_t len, size_t* which) {
+    if (teddy == NULL || string == NULL) {
+        return -1;
+    }
+
+    const unsigned char* bytes = (const unsigned char*) string;
+
+#ifdef TEDDY_HAVE_SSSE3
+    if (teddy->use_simd) {
+        return find_ssse3(teddy, bytes, len, which);
+    }
+#endif
+
+    return find_scalar(teddy, bytes, 0, len, which);
+}
@@ -0,0 +1,1062 @@
+#include "portability.h"
+
+#include "trigram.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// Pack the three bytes starting at `bytes` into a trigram
+static inline uint32_t trigram_at(const char* bytes) {
+    const unsigned char* b = (const unsigned char*) bytes;
+    return (uint32_t) b[0] << 16 | (uint32_t) b[1] << 8 | b[2];
+}
+
+// Allocate an empty query of the given type
+static TrigramQuery* query_create(TrigramQueryType type) {
+    TrigramQuery* query = malloc(sizeof(TrigramQuery));
+    if (query == NULL) {
+        return NULL;
+    }
+
+    *query = (TrigramQuery) {
+        .type = type,
+        .trigrams = NULL,
+        .n_trigrams = 0,
+        .subqueries = NULL,
+        .n_subqueries = 0,
+    };
+
+    return query;
+}
+
+// Releases the memory used by the given query, and its subqueries
+void trigram_query_free(TrigramQuery* query) {
+    if (query == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < query->n_subqueries; i++) {
+        trigram_query_free(query->subqueries[i]);
+        free(query->subqueries[i]);
+    }
+
+    free(query->subqueries);
+    free(query->trigrams);
+
+    query->subqueries = NULL;
+    query->trigrams = NULL;
+    query->n_subqueries = 0;
+    query->n_trigrams = 0;
+}
+
+// Release a query and the struct holding it
+static void query_destroy(TrigramQuery* query) {
+    trigram_query_free(query);
+    free(query);
+}
+
+// Add a trigram to a query, unless it is in it already
+static bool query_add_trigram(TrigramQuery* query, uint32_t trigram) {
+    for (size_t i = 0; i < query->n_trigrams; i++) {
+        if (query->trigrams[i] == trigram) {
+            return true;
+        }
+    }
+
+    uint32_t* trigrams = realloc(query->trigrams, sizeof(uint32_t) * (query->n_trigrams + 1));
+    if (trigrams == NULL) {
+        return false;
+    }
+
+    trigrams[query->n_trigrams++] = trigram;
+    query->trigrams = trigrams;
+    return true;
+}
+
+// Nest a query in another, which takes ownership of it
+static bool query_add_subquery(TrigramQuery* query, TrigramQuery* subquery) {
+    TrigramQuery** subqueries = realloc(query->subqueries,
+                                        sizeof(TrigramQuery*) * (query->n_subqueries + 1));
+    if (subqueries == NULL) {
+        return false;
+    }
+
+    subqueries[query->n_subqueries++] = subquery;
+    query->subqueries = subqueries;
+    return true;
+}
+
+/*
+ * While planning, a NULL query stands for TRIGRAM_ALL. Running out of memory
+ * only ever drops conditions from a query, which is always safe, as it can
+ * only let more documents through.
+ */
+
+// Require both queries, taking ownership of them
+static TrigramQuery* query_and(TrigramQuery* a, TrigramQuery* b) {
+    if (a == NULL) {
+        return b;
+    }
+
+    if (b == NULL) {
+        return a;
+    }
+
+    if (a->type != TRIGRAM_AND) {
+        TrigramQuery* temp = a;
+        a = b;
+        b = temp;
+    }
+
+    if (a->type != TRIGRAM_AND) {
+        TrigramQuery* and = query_create(TRIGRAM_AND);
+        if (and == NULL || !query_add_subquery(and, a)) {
+            query_destroy(and);
+            query_destroy(b);
+            return a;
+        }
+        a = and;
+    }
+
+    if (b->type == TRIGRAM_AND && b->n_subqueries == 0) {
+        for (size_t i = 0; i < b->n_trigrams; i++) {
+            query_add_trigram(a, b->trigrams[i]);
+        }
+        query_destroy(b);
+    } else if (!query_add_subquery(a, b)) {
+        query_destroy(b);
+    }
+
+    return a;
+}
+
+// Require either query, taking ownership of them
+static TrigramQuery* query_or(TrigramQuery* a, TrigramQuery* b) {
+    if (a == NULL || b == NULL) {
+        query_destroy(a);
+        query_destroy(b);
+        return NULL;
+    }
+
+    TrigramQuery* or = a->type == TRIGRAM_OR ? a : query_create(TRIGRAM_OR);
+    if (or == NULL || (or != a && !query_add_subquery(or, a))) {
+        query_destroy(or);
+        query_destroy(a);
+        query_destroy(b);
+        return NULL;
+    }
+
+    if (!query_add_subquery(or, b)) {
+        query_destroy(or);
+        query_destroy(b);
+        return NULL;
+    }
+
+    return or;
+}
+
+// The query for strings that contain one of the literals in the set
+static TrigramQuery* query_any_literal(const LiteralSet* set) {
+    TrigramQuery* query = NULL;
+
+    // Short literals may be anywhere, as may literals of an unknown set
+    if (set->n == 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < set->n; i++) {
+        if (set->literals[i].len < 3) {
+            return NULL;
+        }
+    }
+
+    for (size_t i = 0; i < set->n; i++) {
+        const Literal* literal = &set->literals[i];
+
+        TrigramQuery* all = query_create(TRIGRAM_AND);
+        if (all == NULL) {
+            query_destroy(query);
+            return NULL;
+        }
+
+        for (size_t j = 0; j + 3 <= literal->len; j++) {
+            if (!query_add_trigram(all, trigram_at(&literal->bytes[j]))) {
+                break;
+            }
+        }
+
+        query = i == 0 ? all : query_or(query, all);
+        if (query == NULL) {
+            return NULL;
+        }
+    }
+
+    return query;
+}
+
+/**
+ * What is known about the strings matched by a sub-pattern.
+ *
+ * A set holding the empty string says nothing, as every string starts and
+ * ends with it. So does an empty set, which is only left behind when memory
+ * runs out.
+ *
+ * Members
+ *     - exact_known: Whether `exact` holds every string the sub-pattern
+ *                    matches
+ *     - exact: The strings the sub-pattern matches, if known
+ *     - prefix: Strings one of which every match starts with, if the exact
+ *               strings are not known
+ *     - suffix: Strings one of which every match ends with, if the exact
+ *               strings are not known
+ *     - match: A query every string containing a match satisfies
+ */
+typedef struct Info {
+    bool exact_known;
+    LiteralSet exact;
+    LiteralSet prefix;
+    LiteralSet suffix;
+    TrigramQuery* match;
+} Info;
+
+// Forget everything but that the strings exist
+static void set_unknown(LiteralSet* set) {
+    literal_set_free(set);
+    literal_set_add(set, "", 0);
+}
+
+// Releases the memory used by the info
+static void info_free(Info* info) {
+    literal_set_free(&info->exact);
+    literal_set_free(&info->prefix);
+    literal_set_free(&info->suffix);
+    query_destroy(info->match);
+    info->match = NULL;
+}
+
+// Stop tracking the exact strings, keeping what they say as the prefix,
+// suffix and query
+static void weaken(Info* info) {
+    if (!info->exact_known) {
+        return;
+    }
+
+    info->match = query_and(info->match, query_any_literal(&info->exact));
+
+    literal_set_free(&info->prefix);
+    literal_set_free(&info->suffix);
+
+    if (!literal_set_union(&info->prefix, &info->exact)) {
+        set_unknown(&info->prefix);
+    }
+
+    if (!literal_set_union(&info->suffix, &info->exact)) {
+        set_unknown(&info->suffix);
+    }
+
+    literal_set_free(&info->exact);
+    info->exact_known = false;
+}
+
+static void plan(const ASTNode* node, Info* out);
+
+// Plan a concatenation, which matches strings spanning both operands too
+static void plan_concat(const ASTNode* node, Info* out) {
+    Info left, right;
+    plan(node->child1, &left);
+    plan(node->extra.child2, &right);
+
+    out->match = query_and(left.match, right.match);
+    left.match = NULL;
+    right.match = NULL;
+
+    if (left.exact_known && right.exact_known) {
+        out->exact_known = literal_set_product(&out->exact, &left.exact, &right.exact);
+        if (out->exact_known) {
+            info_free(&left);
+            info_free(&right);
+            return;
+        }
+
+        literal_set_free(&out->exact);
+    }
+
+    bool left_exact = left.exact_known;
+    bool right_exact = right.exact_known;
+    weaken(&left);
+    weaken(&right);
+
+    // The end of the left operand followed by the start of the right one
+    LiteralSet cross = {.literals = NULL, .n = 0};
+    bool cross_known = literal_set_product(&cross, &left.suffix, &right.prefix);
+
+    if (cross_known) {
+        out->match = query_and(out->match, query_any_literal(&cross));
+    }
+
+    // Matches start with the start of the left operand, and with the right
+    // operand's start after it when the left one is known exactly
+    if (left_exact && cross_known) {
+        if (!literal_set_union(&out->prefix, &cross)) {
+            set_unknown(&out->prefix);
+        }
+    } else {
+        out->prefix = left.prefix;
+        left.prefix = (LiteralSet) {.literals = NULL, .n = 0};
+    }
+
+    if (right_exact && cross_known) {
+        if (!literal_set_union(&out->suffix, &cross)) {
+            set_unknown(&out->suffix);
+        }
+    } else {
+        out->suffix = right.suffix;
+        right.suffix = (LiteralSet) {.literals = NULL, .n = 0};
+    }
+
+    literal_set_free(&cross);
+    info_free(&left);
+    info_free(&right);
+}
+
+// Plan an alternation, which matches what either operand matches
+static void plan_or(const ASTNode* node, Info* out) {
+    Info left, right;
+    plan(node->child1, &left);
+    plan(node->extra.child2, &right);
+
+    if (left.exact_known && right.exact_known) {
+        out->exact_known = literal_set_union(&out->exact, &left.exact)
+            && literal_set_union(&out->exact, &right.exact);
+        if (out->exact_known) {
+            info_free(&left);
+            info_free(&right);
+            return;
+        }
+
+        literal_set_free(&out->exact);
+    }
+
+    weaken(&left);
+    weaken(&right);
+
+    if (left.prefix.n == 0 || right.prefix.n == 0
+        || !literal_set_union(&out->prefix, &left.prefix)
+        || !literal_set_union(&out->prefix, &right.prefix)) {
+        set_unknown(&out->prefix);
+    }
+
+    if (left.suffix.n == 0 || right.suffix.n == 0
+        || !literal_set_union(&out->suffix, &left.suffix)
+        || !literal_set_union(&out->suffix, &right.suffix)) {
+        set_unknown(&out->suffix);
+    }
+
+    out->match = query_or(left.match, right.match);
+    left.match = NULL;
+    right.match = NULL;
+
+    info_free(&left);
+    info_free(&right);
+}
+
+// Compute what is known about a node from what is known about its children
+static void plan(const ASTNode* node, Info* out) {
+    Info child;
+    *out = (Info) {
+        .exact_known = false,
+        .exact = {.literals = NULL, .n = 0},
+        .prefix = {.literals = NULL, .n = 0},
+        .suffix = {.literals = NULL, .n = 0},
+        .match = NULL,
+    };
+
+    switch (node->type) {
+    case CHAR_NODE:
+        out->exact_known = literal_set_add(&out->exact, &node->extra.character, 1);
+        break;
+
+    case CONCAT_NODE:
+        plan_concat(node, out);
+        return;
+
+    case OR_NODE:
+        plan_or(node, out);
+        return;
+
+    case QUESTION_NODE:
+        plan(node->child1, &child);
+        out->exact_known = child.exact_known && literal_set_union(&out->exact, &child.exact)
+            && literal_set_add(&out->exact, "", 0);
+        info_free(&child);
+        break;
+
+    case PLUS_NODE:
+        // Every match starts and ends with a match of the child
+        plan(node->child1, &child);
+        weaken(&child);
+        *out = child;
+        return;
+
+    default:
+        break;
+    }
+
+    if (!out->exact_known) {
+        literal_set_free(&out->exact);
+        set_unknown(&out->prefix);
+        set_unknown(&out->suffix);
+    }
+}
+
+// Plan the trigram query for the pattern of the given AST
+TrigramQuery* trigram_query_create(const ASTNode* root) {
+    if (root == NULL) {
+        return NULL;
+    }
+
+    Info info;
+    plan(root, &info);
+    weaken(&info);
+
+    TrigramQuery* query = info.match;
+    info.match = NULL;
+    info_free(&info);
+
+    return query != NULL ? query : query_create(TRIGRAM_ALL);
+}
+
+/**
+ * A list of document ids in increasing order, used to evaluate queries
+ *
+ * Members
+ *     - ids: The ids of the documents. Unused if `all` is set.
+ *     - n: The number of documents
+ *     - all: Whether the list holds every document
+ */
+typedef struct DocList {
+    uint32_t* ids;
+    size_t n;
+    bool all;
+} DocList;
+
+// The documents in both lists, replacing the first
+static int intersect(DocList* a, const uint32_t* ids, size_t n) {
+    if (a->all) {
+        a->ids = malloc(sizeof(uint32_t) * (n > 0 ? n : 1));
+        if (a->ids == NULL) {
+            return -1;
+        }
+
+        if (n > 0) {
+            memcpy(a->ids, ids, sizeof(uint32_t) * n);
+        }
+        a->n = n;
+        a->all = false;
+        return 0;
+    }
+
+    size_t i = 0, j = 0, k = 0;
+    while (i < a->n && j < n) {
+        if (a->ids[i] < ids[j]) {
+            i++;
+        } else if (a->ids[i] > ids[j]) {
+            j++;
+        } else {
+            a->ids[k++] = a->ids[i];
+            i++;
+            j++;
+        }
+    }
+
+    a->n = k;
+    return 0;
+}
+
+// The documents in either list, replacing the first
+static int unite(DocList* a, const uint32_t* ids, size_t n) {
+    if (a->all) {
+        return 0;
+    }
+
+    uint32_t* merged = malloc(sizeof(uint32_t) * (a->n + n > 0 ? a->n + n : 1));
+    if (merged == NULL) {
+        return -1;
+    }
+
+    size_t i = 0, j = 0, k = 0;
+    while (i < a->n || j < n) {
+        if (j == n || (i < a->n && a->ids[i] < ids[j])) {
+            merged[k++] = a->ids[i++];
+        } else if (i == a->n || ids[j] < a->ids[i]) {
+            merged[k++] = ids[j++];
+        } else {
+            merged[k++] = a->ids[i];
+            i++;
+            j++;
+        }
+    }
+
+    free(a->ids);
+    a->ids = merged;
+    a->n = k;
+    return 0;
+}
+
+// Find the posting list of a trigram
+static const uint32_t* postings_of(const TrigramIndex* index, uint32_t trigram, size_t* n) {
+    size_t low = 0, high = index->header->n_trigrams;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const TrigramEntry* entry = &index->entries[mid];
+
+        if (entry->trigram == trigram) {
+            *n = entry->n_docs;
+            return &index->postings[entry->postings];
+        }
+
+        if (entry->trigram < trigram) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    *n = 0;
+    return NULL;
+}
+
+// Find the documents satisfying the query
+static int evaluate(const TrigramIndex* index, const TrigramQuery* query, DocList* out) {
+    *out = (DocList) {.ids = NULL, .n = 0, .all = query->type != TRIGRAM_OR};
+
+    if (query->type == TRIGRAM_ALL) {
+        return 0;
+    }
+
+    bool and = query->type == TRIGRAM_AND;
+
+    for (size_t i = 0; i < query->n_trigrams; i++) {
+        size_t n;
+        const uint32_t* ids = postings_of(index, query->trigrams[i], &n);
+
+        if ((and ? intersect(out, ids, n) : unite(out, ids, n)) < 0) {
+            free(out->ids);
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; i < query->n_subqueries; i++) {
+        DocList sub;
+        if (evaluate(index, query->subqueries[i], &sub) < 0) {
+            free(out->ids);
+            return -1;
+        }
+
+        int result;
+        if (sub.all) {
+            result = 0;
+            if (!and) {
+                free(out->ids);
+                *out = (DocList) {.ids = NULL, .n = 0, .all = true};
+            }
+        } else {
+            result = and ? intersect(out, sub.ids, sub.n) : unite(out, sub.ids, sub.n);
+        }
+
+        free(sub.ids);
+
+        if (result < 0) {
+            free(out->ids);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Find the documents that satisfy the given query
+ssize_t trigram_index_candidates(const TrigramIndex* index, const TrigramQuery* query,
+                                 uint32_t** docs) {
+    if (index == NULL || query == NULL || docs == NULL) {
+        return -1;
+    }
+
+    DocList list;
+    if (evaluate(index, query, &list) < 0) {
+        return -1;
+    }
+
+    if (list.all) {
+        size_t n_docs = index->header->n_docs;
+
+        list.ids = malloc(sizeof(uint32_t) * (n_docs > 0 ? n_docs : 1));
+        if (list.ids == NULL) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < n_docs; i++) {
+            list.ids[i] = i;
+        }
+        list.n = n_docs;
+    }
+
+    *docs = list.ids;
+    return list.n;
+}
+
+// Get the name of a document in the index
+const char* trigram_index_doc_name(const TrigramIndex* index, uint32_t doc) {
+    if (index == NULL || doc >= index->header->n_docs) {
+        return NULL;
+    }
+
+    return &index->names[index->docs[doc].name];
+}
+
+#ifndef WIN32_LEAN_AND_MEAN
+
+/**
+ * The trigrams found in a share of the files, as (trigram, document) pairs
+ * packed into integers with the trigram in the high half
+ *
+ * Members
+ *     - files: The paths of all files being indexed
+ *     - n_files: The number of files
+ *     - first: The first file this worker reads
+ *     - step: The distance between files this worker reads
+ *     - pairs: The pairs found, sorted once the worker is done
+ *     - n_pairs: The number of pairs found
+ *     - cap: The capacity of `pairs`
+ *     - status: 0 if every file was read, -1 otherwise
+ */
+typedef struct IndexWorker {
+    char* const* files;
+    size_t n_files;
+    size_t first;
+    size_t step;
+    uint64_t* pairs;
+    size_t n_pairs;
+    size_t cap;
+    int status;
+} IndexWorker;
+
+// Used to sort the pairs found by a worker
+static int pair_cmp(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Record the distinct trigrams of one file, using `seen` to skip repeats
+static int index_file(IndexWorker* worker, uint32_t doc, uint64_t* seen) {
+    int fd = open(worker->files[doc], O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size < 3) {
+        close(fd);
+        return 0;
+    }
+
+    size_t len = st.st_size;
+    const unsigned char* bytes = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (bytes == MAP_FAILED) {
+        return -1;
+    }
+
+    size_t start = worker->n_pairs;
+    uint32_t trigram = (uint32_t) bytes[0] << 8 | bytes[1];
+    int result = 0;
+
+    for (size_t i = 2; i < len; i++) {
+        trigram = (trigram << 8 | bytes[i]) & (TRIGRAM_COUNT - 1);
+
+        uint64_t bit = (uint64_t) 1 << (trigram & 63);
+        if (seen[trigram >> 6] & bit) {
+            continue;
+        }
+        seen[trigram >> 6] |= bit;
+
+        if (worker->n_pairs == worker->cap) {
+            size_t cap = worker->cap > 0 ? worker->cap * 2 : 4096;
+            uint64_t* pairs = realloc(worker->pairs, sizeof(uint64_t) * cap);
+            if (pairs == NULL) {
+                result = -1;
+                break;
+            }
+            worker->pairs = pairs;
+            worker->cap = cap;
+        }
+
+        worker->pairs[worker->n_pairs++] = (uint64_t) trigram << 32 | doc;
+    }
+
+    // Only the bits set for this file need clearing
+    for (size_t i = start; i < worker->n_pairs; i++) {
+        uint32_t t = worker->pairs[i] >> 32;
+        seen[t >> 6] = 0;
+    }
+
+    munmap((void*) bytes, len);
+    return result;
+}
+
+// Collect the trigrams of every file in the worker's share
+static void* index_files(void* arg) {
+    IndexWorker* worker = arg;
+
+    uint64_t* seen = calloc(TRIGRAM_COUNT / 64, sizeof(uint64_t));
+    if (seen == NULL) {
+        worker->status = -1;
+        return NULL;
+    }
+
+    for (size_t doc = worker->first; doc < worker->n_files; doc += worker->step) {
+        if (index_file(worker, doc, seen) < 0) {
+            worker->status = -1;
+            break;
+        }
+    }
+
+    free(seen);
+
+    if (worker->status == 0 && worker->n_pairs > 0) {
+        qsort(worker->pairs, worker->n_pairs, sizeof(uint64_t), pair_cmp);
+    }
+
+    return NULL;
+}
+
+/**
+ * Merge the sorted pairs of every worker into the trigram table and the
+ * posting lists
+ *
+ * @return The number of distinct trigrams, -1 on failure
+ */
+static ssize_t merge_pairs(IndexWorker* workers, size_t n_workers,
+                           TrigramEntry** entries_out, uint32_t** postings_out) {
+    size_t n_pairs = 0;
+    for (size_t i = 0; i < n_workers; i++) {
+        n_pairs += workers[i].n_pairs;
+    }
+
+    size_t* heads = calloc(n_workers, sizeof(size_t));
+    uint32_t* postings = malloc(sizeof(uint32_t) * (n_pairs > 0 ? n_pairs : 1));
+    TrigramEntry* entries = NULL;
+    size_t n_entries = 0, cap = 0;
+
+    if (heads == NULL || postings == NULL) {
+        free(heads);
+        free(postings);
+        return -1;
+    }
+
+    for (size_t k = 0; k < n_pairs; k++) {
+        // Take the smallest pair at the head of any worker's list
+        size_t best = n_workers;
+        for (size_t i = 0; i < n_workers; i++) {
+            if (heads[i] < workers[i].n_pairs
+                && (best == n_workers
+                    || workers[i].pairs[heads[i]] < workers[best].pairs[heads[best]])) {
+                best = i;
+            }
+        }
+
+        uint64_t pair = workers[best].pairs[heads[best]++];
+        uint32_t trigram = pair >> 32;
+
+        if (n_entries == 0 || entries[n_entries - 1].trigram != trigram) {
+            if (n_entries == cap) {
+                cap = cap > 0 ? cap * 2 : 1024;
+                TrigramEntry* grown = realloc(entries, sizeof(TrigramEntry) * cap);
+                if (grown == NULL) {
+                    free(entries);
+                    free(heads);
+                    free(postings);
+                    return -1;
+                }
+                entries = grown;
+            }
+
+            entries[n_entries++] = (TrigramEntry) {.trigram = trigram, .n_docs = 0, .postings = k};
+        }
+
+        entries[n_entries - 1].n_docs++;
+        postings[k] = (uint32_t) pair;
+    }
+
+    free(heads);
+
+    *entries_out = entries;
+    *postings_out = postings;
+    return n_entries;
+}
+
+// Write the index to the given path
+static int write_index(const char* path, char* const* files, size_t n_files,
+                       const TrigramEntry* entries, size_t n_entries,
+                       const uint32_t* postings, size_t n_postings) {
+    TrigramDoc* docs = malloc(sizeof(TrigramDoc) * (n_files > 0 ? n_files : 1));
+    if (docs == NULL) {
+        return -1;
+    }
+
+    uint64_t names_len = 0;
+    for (size_t i = 0; i < n_files; i++) {
+        docs[i] = (TrigramDoc) {.name = names_len, .name_len = strlen(files[i])};
+        names_len += docs[i].name_len + 1;
+    }
+
+    TrigramIndexHeader header = {
+        .magic = {0},
+        .version = TRIGRAM_INDEX_VERSION,
+        .n_docs = n_files,
+        .n_trigrams = n_entries,
+    };
+    memcpy(header.magic, TRIGRAM_INDEX_MAGIC, sizeof(header.magic));
+    header.docs_offset = sizeof(header) + sizeof(TrigramEntry) * n_entries;
+    header.postings_offset = header.docs_offset + sizeof(TrigramDoc) * n_files;
+    header.names_offset = header.postings_offset + sizeof(uint32_t) * n_postings;
+    header.size = header.names_offset + names_len;
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        free(docs);
+        return -1;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(entries, sizeof(TrigramEntry), n_entries, file) == n_entries
+        && fwrite(docs, sizeof(TrigramDoc), n_files, file) == n_files
+        && fwrite(postings, sizeof(uint32_t), n_postings, file) == n_postings;
+
+    for (size_t i = 0; ok && i < n_files; i++) {
+        ok = fwrite(files[i], 1, docs[i].name_len + 1, file) == docs[i].name_len + 1;
+    }
+
+    free(docs);
+    return fclose(file) == 0 && ok ? 0 : -1;
+}
+
+// Build an index of the trigrams in the given files, and write it to a file
+int trigram_index_build(const char* path, char* const* files, size_t n_files,
+                        size_t n_threads) {
+    if (path == NULL || (files == NULL && n_files > 0) || n_files > UINT32_MAX) {
+        return -1;
+    }
+
+    if (n_threads == 0) {
+        int n_processors = n_processors_online();
+        n_threads = n_processors > 0 ? n_processors : 1;
+    }
+
+    if (n_threads > n_files) {
+        n_threads = n_files > 0 ? n_files : 1;
+    }
+
+    IndexWorker* workers = calloc(n_threads, sizeof(IndexWorker));
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    bool* started = calloc(n_threads, sizeof(bool));
+
+    if (workers == NULL || threads == NULL || started == NULL) {
+        free(workers);
+        free(threads);
+        free(started);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        workers[i] = (IndexWorker) {
+            .files = files,
+            .n_files = n_files,
+            .first = i,
+            .step = n_threads,
+            .pairs = NULL,
+            .n_pairs = 0,
+            .cap = 0,
+            .status = 0,
+        };
+    }
+
+    // The calling thread takes the first share, and any share a thread
+    // could not be started for
+    for (size_t i = 1; i < n_threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL, index_files, &workers[i]) == 0;
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        if (!started[i]) {
+            index_files(&workers[i]);
+        }
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < n_threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+
+        if (workers[i].status < 0) {
+            result = -1;
+        }
+    }
+
+    TrigramEntry* entries = NULL;
+    uint32_t* postings = NULL;
+    ssize_t n_entries = -1;
+
+    if (result == 0) {
+        n_entries = merge_pairs(workers, n_threads, &entries, &postings);
+    }
+
+    if (n_entries >= 0) {
+        size_t n_postings = 0;
+        for (size_t i = 0; i < n_threads; i++) {
+            n_postings += workers[i].n_pairs;
+        }
+
+        result = write_index(path, files, n_files, entries, n_entries, postings, n_postings);
+    } else {
+        result = -1;
+    }
+
+    for (size_t i = 0; i < n_threads; i++) {
+        free(workers[i].pairs);
+    }
+
+    free(entries);
+    free(postings);
+    free(workers);
+    free(threads);
+    free(started);
+
+    return result;
+}
+
+// Map the index in the given file into memory
+TrigramIndex* trigram_index_open(const char* path) {
+    if (path == NULL) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(TrigramIndexHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    const TrigramIndexHeader* header = map;
+    const char* bytes = map;
+
+    // Every section must lie inside the file, in order
+    bool valid = memcmp(header->magic, TRIGRAM_INDEX_MAGIC, sizeof(header->magic)) == 0
+        && header->version == TRIGRAM_INDEX_VERSION
+        && header->size == size
+        && header->docs_offset == sizeof(TrigramIndexHeader)
+            + (uint64_t) sizeof(TrigramEntry) * header->n_trigrams
+        && header->postings_offset == header->docs_offset
+            + (uint64_t) sizeof(TrigramDoc) * header->n_docs
+        && header->postings_offset <= header->names_offset
+        && header->names_offset <= size
+        && (header->names_offset - header->postings_offset) % sizeof(uint32_t) == 0;
+
+    TrigramIndex* index = valid ? malloc(sizeof(TrigramIndex)) : NULL;
+    if (index == NULL) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    *index = (TrigramIndex) {
+        .map = map,
+        .size = size,
+        .header = header,
+        .entries = (const TrigramEntry*) &bytes[sizeof(TrigramIndexHeader)],
+        .docs = (const TrigramDoc*) &bytes[header->docs_offset],
+        .postings = (const uint32_t*) &bytes[header->postings_offset],
+        .names = &bytes[header->names_offset],
+    };
+
+    // Posting lists and names must lie inside their sections too
+    uint64_t n_postings = (header->names_offset - header->postings_offset) / sizeof(uint32_t);
+    uint64_t names_len = size - header->names_offset;
+
+    for (size_t i = 0; valid && i < header->n_trigrams; i++) {
+        valid = index->entries[i].postings + index->entries[i].n_docs <= n_postings;
+    }
+
+    for (size_t i = 0; valid && i < header->n_docs; i++) {
+        const TrigramDoc* doc = &index->docs[i];
+        valid = doc->name < names_len && doc->name_len < names_len - doc->name
+            && index->names[doc->name + doc->name_len] == '\0';
+    }
+
+    if (!valid) {
+        trigram_index_free(index);
+        free(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+// Unmaps the given index
+void trigram_index_free(TrigramIndex* index) {
+    if (index == NULL || index->map == NULL) {
+        return;
+    }
+
+    munmap(index->map, index->size);
+    index->map = NULL;
+}
+
+#else // WIN32_LEAN_AND_MEAN
+
+// Building and mapping index files needs POSIX threads and mmap
+
+int trigram_index_build(const char* path, char* const* files, size_t n_files,
+                        size_t n_threads) {
+    (void) path;
+    (void) files;
+    (void) n_files;
+    (void) n_threads;
+    return -1;
+}
+
+TrigramIndex* trigram_index_open(const char* path) {
+    (void) path;
+    return NULL;
+}
+
+void trigram_index_free(TrigramIndex* index) {
+    (void) index;
+}
+
+#endif // WIN32_LEAN_AND_MEAN
@@ -0,0 +1,132 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "aho_corasick.h"
+
+AhoCorasick* ac;
+
+// Build the automaton for the given NULL terminated list of strings
+void build(char** strings) {
+    Literal literals[16];
+    size_t n = 0;
+
+    for (; strings[n] != NULL; n++) {
+        literals[n] = (Literal) {.bytes = strings[n], .len = strlen(strings[n])};
+    }
+
+    LiteralSet set = {.literals = literals, .n = n};
+    ac = aho_corasick_create(&set);
+}
+
+void release() {
+    aho_corasick_free(ac);
+    free(ac);
+    ac = NULL;
+}
+
+#define AC_MATCH(s) aho_corasick_match(ac, (s), strlen((s)))
+#define AC_COUNT(s) aho_corasick_count(ac, (s), strlen((s)))
+
+int test_aho_corasick_create() {
+    TEST_BEGIN;
+
+    char* strings[] = {"he", "she", "his", "hers", NULL};
+    build(strings);
+    assert_is_not_null(ac);
+
+    // root, h, he, her, hers, hi, his, s, sh, she
+    assert_equals_int(ac->n_states, 10);
+
+    // e, h, i, r, s and everything else
+    assert_equals_int(ac->n_classes, 6);
+    assert_equals_int(ac->classes['x'], 0);
+    assert_equals_int(ac->classes['\0'], 0);
+
+    // Every transition on an unused byte leads back to the root
+    for (size_t s = 0; s < ac->n_states; s++) {
+        assert_equals_int(ac->table[s * ac->n_classes], AHO_CORASICK_ROOT);
+    }
+
+    release();
+
+    LiteralSet empty = {.literals = NULL, .n = 0};
+    assert_is_null(aho_corasick_create(&empty));
+    assert_is_null(aho_corasick_create(NULL));
+
+    Literal blank = {.bytes = NULL, .len = 0};
+    LiteralSet with_blank = {.literals = &blank, .n = 1};
+    assert_is_null(aho_corasick_create(&with_blank));
+
+    TEST_END;
+}
+
+int test_aho_corasick_match() {
+    TEST_BEGIN;
+
+    char* strings[] = {"he", "she", "his", "hers", "she", NULL};
+    build(strings);
+
+    assert_equals_int(AC_MATCH("he"), 0);
+    assert_equals_int(AC_MATCH("she"), 1);
+    assert_equals_int(AC_MATCH("his"), 2);
+    assert_equals_int(AC_MATCH("hers"), 3);
+
+    assert_equals_int(AC_MATCH(""), -1);
+    assert_equals_int(AC_MATCH("h"), -1);
+    assert_equals_int(AC_MATCH("her"), -1);
+    assert_equals_int(AC_MATCH("ahe"), -1);
+    assert_equals_int(AC_MATCH("shers"), -1);
+    assert_equals_int(aho_corasick_match(NULL, "he", 2), -1);
+
+    release();
+
+    TEST_END;
+}
+
+int test_aho_corasick_search() {
+    TEST_BEGIN;
+
+    char* strings[] = {"he", "she", "his", "hers", NULL};
+    build(strings);
+
+    // "she" ends first, and contains "he"
+    assert_equals_int(AC_COUNT("ushers"), 1);
+    assert_equals_int(AC_COUNT("his hers she"), 3);
+    assert_equals_int(AC_COUNT("xyz"), 0);
+    assert_equals_int(aho_corasick_count(NULL, "he", 2), 0);
+
+    size_t start, end;
+    assert_equals_int(aho_corasick_find(ac, "ushers", 6, &start, &end), 1);
+    assert_equals_int(start, 1);
+    assert_equals_int(end, 4);
+
+    // The longest literal from the same start is taken
+    assert_equals_int(aho_corasick_find(ac, "xhersx", 6, &start, &end), 3);
+    assert_equals_int(start, 1);
+    assert_equals_int(end, 5);
+
+    assert_equals_int(aho_corasick_find(ac, "xherx", 5, &start, &end), 0);
+    assert_equals_int(start, 1);
+    assert_equals_int(end, 3);
+
+    assert_equals_int(aho_corasick_find(ac, "hxsx", 4, &start, &end), -1);
+    assert_equals_int(aho_corasick_find(NULL, "he", 2, &start, &end), -1);
+
+    release();
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_aho_corasick_create", .func=test_aho_corasick_create},
+    {.name="test_aho_corasick_match", .func=test_aho_corasick_match},
+    {.name="test_aho_corasick_search", .func=test_aho_corasick_search},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
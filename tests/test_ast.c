@@ -46,10 +46,148 @@ int test_ast_init() {
     TEST_END;
 }
 
+// Test mirroring an AST
+int test_ast_reverse() {
+    TEST_BEGIN;
+
+    // (ab)|c*
+    ASTNode* a = ast_node_create(CHAR_NODE);
+    ASTNode* b = ast_node_create(CHAR_NODE);
+    ASTNode* c = ast_node_create(CHAR_NODE);
+    a->extra.character = 'a';
+    b->extra.character = 'b';
+    c->extra.character = 'c';
+
+    ASTNode* concat = ast_node_create(CONCAT_NODE);
+    concat->child1 = a;
+    concat->extra.child2 = b;
+
+    ASTNode* star = ast_node_create(STAR_NODE);
+    star->child1 = c;
+
+    ASTNode* or = ast_node_create(OR_NODE);
+    or->child1 = concat;
+    or->extra.child2 = star;
+
+    ast_reverse(or);
+
+    // Only the concatenation is mirrored
+    assert_equals_ptr(or->child1, concat, ASTNode*);
+    assert_equals_ptr(or->extra.child2, star, ASTNode*);
+    assert_equals_ptr(concat->child1, b, ASTNode*);
+    assert_equals_ptr(concat->extra.child2, a, ASTNode*);
+    assert_equals_ptr(star->child1, c, ASTNode*);
+
+    // Mirroring twice restores the AST
+    ast_reverse(or);
+    assert_equals_ptr(concat->child1, a, ASTNode*);
+    assert_equals_ptr(concat->extra.child2, b, ASTNode*);
+
+    ast_reverse(NULL);  // Should not crash
+    ast_node_free(or);
+
+    TEST_END;
+}
+
+// Test copying an AST
+int test_ast_copy() {
+    TEST_BEGIN;
+
+    // (ab)*
+    ASTNode* a = ast_node_create(CHAR_NODE);
+    ASTNode* b = ast_node_create(CHAR_NODE);
+    a->extra.character = 'a';
+    b->extra.character = 'b';
+
+    ASTNode* concat = ast_node_create(CONCAT_NODE);
+    concat->child1 = a;
+    concat->extra.child2 = b;
+
+    ASTNode* star = ast_node_create(STAR_NODE);
+    star->child1 = concat;
+
+    ASTNode* copy = ast_copy(star);
+    assert_is_not_null(copy);
+    assert_equals_int(copy != star && copy->child1 != concat, 1);
+    assert_equals_int(copy->type, STAR_NODE);
+    assert_equals_int(copy->child1->type, CONCAT_NODE);
+    assert_equals_int(copy->child1->child1->extra.character, 'a');
+    assert_equals_int(copy->child1->extra.child2->extra.character, 'b');
+
+    // Changing the copy leaves the original as it was
+    ast_reverse(copy);
+    assert_equals_int(copy->child1->child1->extra.character, 'b');
+    assert_equals_ptr(concat->child1, a, ASTNode*);
+    assert_equals_ptr(concat->extra.child2, b, ASTNode*);
+
+    assert_is_null(ast_copy(NULL));
+
+    ast_node_free(copy);
+    ast_node_free(star);
+
+    TEST_END;
+}
+
+int test_ast_length_bounds() {
+    TEST_BEGIN;
+
+    // (ab|c?)d+
+    ASTNode* a = ast_node_create(CHAR_NODE);
+    ASTNode* b = ast_node_create(CHAR_NODE);
+    ASTNode* c = ast_node_create(CHAR_NODE);
+    ASTNode* d = ast_node_create(CHAR_NODE);
+
+    ASTNode* concat = ast_node_create(CONCAT_NODE);
+    concat->child1 = a;
+    concat->extra.child2 = b;
+
+    ASTNode* question = ast_node_create(QUESTION_NODE);
+    question->child1 = c;
+
+    ASTNode* or = ast_node_create(OR_NODE);
+    or->child1 = concat;
+    or->extra.child2 = question;
+
+    ASTNode* plus = ast_node_create(PLUS_NODE);
+    plus->child1 = d;
+
+    ASTNode* root = ast_node_create(CONCAT_NODE);
+    root->child1 = or;
+    root->extra.child2 = plus;
+
+    size_t min, max;
+    assert_equals_int(ast_length_bounds(a, &min, &max), 0);
+    assert_equals_int(min, 1);
+    assert_equals_int(max, 1);
+
+    assert_equals_int(ast_length_bounds(or, &min, &max), 0);
+    assert_equals_int(min, 0);
+    assert_equals_int(max, 2);
+
+    assert_equals_int(ast_length_bounds(root, &min, &max), 0);
+    assert_equals_int(min, 1);
+    assert_equals_int(max, AST_UNBOUNDED);
+
+    // Unbounded lengths stay unbounded when added to
+    ASTNode* star = ast_node_create(STAR_NODE);
+    star->child1 = root;
+    assert_equals_int(ast_length_bounds(star, &min, &max), 0);
+    assert_equals_int(min, 0);
+    assert_equals_int(max, AST_UNBOUNDED);
+
+    assert_equals_int(ast_length_bounds(NULL, &min, &max), -1);
+    assert_equals_int(ast_length_bounds(star, NULL, &max), -1);
+    ast_node_free(star);
+
+    TEST_END;
+}
 
 Test tests[] = {
     {.name="test_ast_create", .func=test_ast_create},
     {.name="test_ast_init", .func=test_ast_init},
+    {.name="test_ast_reverse", .func=test_ast_reverse},
+    {.name="test_ast_copy", .func=test_ast_copy},
+    {.name="test_ast_length_bounds", .func=test_ast_length_bounds},
     {.name=NULL},
 };
 
@@ -0,0 +1,83 @@
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "byte_set.h"
+#include "lexer.h"
+#include "parser.h"
+
+// Whether the bytes matches of the pattern start with are exactly `expected`
+bool first_is(char* pattern, char* expected) {
+    Lexer lexer;
+    Parser parser;
+    lexer_init(&lexer, pattern);
+    parser_init(&parser, &lexer);
+
+    ASTNode* root = parse(&parser);
+
+    parser_free(&parser);
+    lexer_free(&lexer);
+
+    ByteSet set;
+    bool result = byte_set_first(root, &set) == 0 && byte_set_count(&set) == strlen(expected);
+
+    for (size_t i = 0; result && expected[i] != '\0'; i++) {
+        result = byte_set_contains(&set, expected[i]);
+    }
+
+    ast_node_free(root);
+    return result;
+}
+
+int test_byte_set() {
+    TEST_BEGIN;
+
+    ByteSet set = {.bits = {0}};
+    assert_equals_int(byte_set_count(&set), 0);
+
+    byte_set_add(&set, 'a');
+    byte_set_add(&set, 0);
+    byte_set_add(&set, 255);
+    byte_set_add(&set, 'a');
+    assert_equals_int(byte_set_count(&set), 3);
+    assert_equals_int(byte_set_contains(&set, 'a'), true);
+    assert_equals_int(byte_set_contains(&set, 255), true);
+    assert_equals_int(byte_set_contains(&set, 'b'), false);
+    assert_equals_int(byte_set_contains(&set, 'a' + 64), false);
+
+    assert_equals_int(byte_set_find(&set, "xyzzya", 6), 5);
+    assert_equals_int(byte_set_find(&set, "xyz\xff", 4), 3);
+    assert_equals_int(byte_set_find(&set, "xyzzy", 5), -1);
+    assert_equals_int(byte_set_find(&set, "", 0), -1);
+    assert_equals_int(byte_set_find(NULL, "a", 1), -1);
+
+    TEST_END;
+}
+
+int test_byte_set_first() {
+    TEST_BEGIN;
+
+    assert_equals_int(first_is("abc", "a"), true);
+    assert_equals_int(first_is("a|b|cd", "abc"), true);
+
+    // Operands that may be empty let the next one start a match
+    assert_equals_int(first_is("a*b?c+d", "abc"), true);
+    assert_equals_int(first_is("(a|b*)(c?|d)e", "abcde"), true);
+    assert_equals_int(first_is("(ab)+c", "a"), true);
+
+    ByteSet set;
+    assert_equals_int(byte_set_first(NULL, &set), -1);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_byte_set", .func=test_byte_set},
+    {.name="test_byte_set_first", .func=test_byte_set_first},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
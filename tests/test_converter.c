@@ -213,6 +213,15 @@ int test_convert_concat_node() {
     nfa = convert_ast_to_nfa(root);
 
     assert_is_not_null(nfa);
+
+    // The concatenation has no states of its own, and every state of the
+    // children is in the arena of the NFA
+    assert_equals_int(nfa->arena.n_states, 4);
+    NFAStateList* states = nfa_states(nfa);
+    assert_is_not_null(states);
+    assert_equals_int(states->size, 4);
+    NFAStateList_free(states, NULL);
+    free(states);
     
     bool match = nfa_match(nfa, "ab");
     assert_equals_int(match, true);
@@ -0,0 +1,146 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "dawg.h"
+
+int test_dawg_create() {
+    TEST_BEGIN;
+
+    // Shared prefixes and suffixes share states: t, {a, o}, p, s
+    char* keywords[] = {"tap", "taps", "top", "tops"};
+    Dawg* dawg = dawg_create(keywords, 4);
+    assert_is_not_null(dawg);
+    assert_equals_int(dawg->n_states, 5);
+    assert_equals_int(dawg->n_edges, 5);
+    assert_equals_int(dawg->n_keywords, 4);
+    assert_equals_int(dawg->min_len, 3);
+    assert_equals_int(dawg->max_len, 4);
+
+    assert_equals_int(dawg_contains(dawg, "tap", 3), true);
+    assert_equals_int(dawg_contains(dawg, "tops", 4), true);
+    assert_equals_int(dawg_contains(dawg, "taps", 3), true);
+    assert_equals_int(dawg_contains(dawg, "ta", 2), false);
+    assert_equals_int(dawg_contains(dawg, "tip", 3), false);
+    assert_equals_int(dawg_contains(dawg, "topss", 5), false);
+    assert_equals_int(dawg_contains(dawg, "", 0), false);
+    assert_equals_int(dawg_contains(NULL, "tap", 3), false);
+
+    dawg_free(dawg);
+    free(dawg);
+
+    // Keywords must be sorted, and repeating the last one is ignored
+    char* unsorted[] = {"b", "a"};
+    assert_is_null(dawg_create(unsorted, 2));
+
+    char* prefix_last[] = {"ab", "a"};
+    assert_is_null(dawg_create(prefix_last, 2));
+
+    char* repeated[] = {"", "a", "a", "b"};
+    dawg = dawg_create(repeated, 4);
+    assert_is_not_null(dawg);
+    assert_equals_int(dawg->n_keywords, 3);
+    assert_equals_int(dawg_contains(dawg, "", 0), true);
+    assert_equals_int(dawg_contains(dawg, "b", 1), true);
+    dawg_free(dawg);
+    free(dawg);
+
+    dawg = dawg_create(NULL, 0);
+    assert_is_not_null(dawg);
+    assert_equals_int(dawg_contains(dawg, "", 0), false);
+    dawg_free(dawg);
+    free(dawg);
+
+    TEST_END;
+}
+
+int test_dawg_builder() {
+    TEST_BEGIN;
+
+    // Every number from 0 to 9999, with its digits spelled in different
+    // ways. The keywords are not NUL terminated, and may contain any byte.
+    DawgBuilder builder;
+    assert_equals_int(dawg_builder_init(&builder), 0);
+
+    char keyword[4];
+    bool added = true;
+    for (int i = 0; i < 10000; i++) {
+        keyword[0] = '0' + i / 1000;
+        keyword[1] = '0' + i / 100 % 10;
+        keyword[2] = (char) (i / 10 % 10);
+        keyword[3] = (char) (0xF0 + i % 10);
+        added = added && dawg_builder_add(&builder, keyword, 4) == 0;
+    }
+    assert_equals_int(added, true);
+
+    // Out of order keywords are rejected, and do not change the automaton
+    assert_equals_int(dawg_builder_add(&builder, "00", 2), -1);
+
+    Dawg* dawg = dawg_builder_finish(&builder);
+    assert_is_not_null(dawg);
+    assert_equals_int(dawg->n_keywords, 10000);
+
+    // Every position only needs one state
+    assert_equals_int(dawg->n_states, 5);
+    assert_equals_int(dawg->n_edges, 40);
+    assert_equals_int(dawg_contains(dawg, "42\0\xF7", 4), true);
+    assert_equals_int(dawg_contains(dawg, "42\0\xFA", 4), false);
+
+    dawg_free(dawg);
+    free(dawg);
+
+    TEST_END;
+}
+
+int test_dawg_find() {
+    TEST_BEGIN;
+
+    char* keywords[] = {"", "abcd", "b", "bc", "bcde", "cdef", "x"};
+    Dawg* dawg = dawg_create(keywords, 7);
+    assert_is_not_null(dawg);
+
+    size_t start, end;
+
+    // The first keyword to end is taken, then extended from its start
+    assert_equals_int(dawg_find(dawg, "zabcdefg", 8, &start, &end), 1);
+    assert_equals_int(start, 2);
+    assert_equals_int(end, 6);
+
+    // A keyword inside a longer one ends first
+    assert_equals_int(dawg_find(dawg, "abcd", 4, &start, &end), 1);
+    assert_equals_int(start, 1);
+    assert_equals_int(end, 3);
+
+    assert_equals_int(dawg_find(dawg, "zzx", 3, &start, &end), 1);
+    assert_equals_int(start, 2);
+    assert_equals_int(end, 3);
+
+    // The empty keyword is never found
+    assert_equals_int(dawg_find(dawg, "zzz", 3, &start, &end), 0);
+    assert_equals_int(dawg_find(dawg, "", 0, &start, &end), 0);
+    assert_equals_int(dawg_find(NULL, "x", 1, &start, &end), -1);
+
+    // Occurrences are counted as soon as they end
+    assert_equals_int(dawg_count(dawg, "bcbxbcde", 8), 4);
+    assert_equals_int(dawg_count(dawg, "abcdef", 6), 2);
+    assert_equals_int(dawg_count(dawg, "zzz", 3), 0);
+    assert_equals_int(dawg_count(NULL, "zzz", 3), -1);
+
+    dawg_free(dawg);
+    free(dawg);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_dawg_create", .func=test_dawg_create},
+    {.name="test_dawg_builder", .func=test_dawg_builder},
+    {.name="test_dawg_find", .func=test_dawg_find},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,389 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "converter.h"
+#include "dfa.h"
+#include "lexer.h"
+#include "nfa.h"
+#include "parser.h"
+
+NFA* nfa;
+DFA* dfa;
+
+// Build the NFA and DFA for the given pattern
+void build(char* pattern) {
+    Lexer lexer;
+    Parser parser;
+    lexer_init(&lexer, pattern);
+    parser_init(&parser, &lexer);
+
+    ASTNode* root = parse(&parser);
+    nfa = convert_ast_to_nfa(root);
+    dfa = dfa_create(nfa, DFA_ANCHORED);
+
+    ast_node_free(root);
+    parser_free(&parser);
+    lexer_free(&lexer);
+}
+
+void release() {
+    nfa_free(nfa);
+    free(nfa);
+    dfa_free(dfa);
+    free(dfa);
+    nfa = NULL;
+    dfa = NULL;
+}
+
+#define DFA_MATCH(s) dfa_match(dfa, (s), strlen((s)))
+
+int test_dfa_create() {
+    TEST_BEGIN;
+
+    build("ab");
+    assert_is_not_null(dfa);
+
+    // dead, {start}, {after a}, {after b}
+    assert_equals_int(dfa->n_states, 4);
+    assert_equals_int(dfa->is_final[DFA_DEAD_STATE], false);
+    assert_equals_int(dfa->is_final[dfa->start_state], false);
+
+    // Every transition out of the dead state leads back to it
+    for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+        assert_equals_int(dfa->table[c], DFA_DEAD_STATE);
+    }
+
+    release();
+
+    assert_is_null(dfa_create(NULL, DFA_ANCHORED));
+
+    TEST_END;
+}
+
+int test_dfa_match() {
+    TEST_BEGIN;
+
+    build("a(b|c)*d");
+    assert_is_not_null(dfa);
+
+    assert_equals_int(DFA_MATCH("ad"), true);
+    assert_equals_int(DFA_MATCH("abbbcd"), true);
+    assert_equals_int(DFA_MATCH("abcbcbd"), true);
+
+    assert_equals_int(DFA_MATCH(""), false);
+    assert_equals_int(DFA_MATCH("a"), false);
+    assert_equals_int(DFA_MATCH("abba"), false);
+    assert_equals_int(DFA_MATCH("ade"), false);
+
+    // Bytes the NFA cannot transition on never match
+    assert_equals_int(dfa_match(dfa, "a\0d", 3), false);
+    assert_equals_int(DFA_MATCH("a\x1f" "d"), false);
+    assert_equals_int(DFA_MATCH("a\xff" "d"), false);
+
+    assert_equals_int(dfa_match(NULL, "ad", 2), false);
+    assert_equals_int(dfa_match(dfa, NULL, 0), false);
+
+    release();
+
+    // Nullable patterns accept the empty string
+    build("a*b?");
+    assert_equals_int(DFA_MATCH(""), true);
+    assert_equals_int(DFA_MATCH("aaab"), true);
+    assert_equals_int(DFA_MATCH("bb"), false);
+    release();
+
+    TEST_END;
+}
+
+int test_dfa_unanchored() {
+    TEST_BEGIN;
+
+    build("ab|b");
+    DFA* search = dfa_create(nfa, DFA_UNANCHORED);
+    assert_is_not_null(search);
+
+    // No match is in progress at the start
+    assert_equals_int(search->start_state, DFA_DEAD_STATE);
+    assert_equals_int(search->is_final[DFA_DEAD_STATE], false);
+
+    // A match ends on the `b`, wherever it started
+    uint32_t state = search->table['x'];
+    assert_equals_int(search->is_final[state], false);
+    state = search->table[state * DFA_ALPHABET_SIZE + 'a'];
+    assert_equals_int(search->is_final[state], false);
+    state = search->table[state * DFA_ALPHABET_SIZE + 'b'];
+    assert_equals_int(search->is_final[state], true);
+
+    assert_equals_int(dfa_count(search, "xxabxbbab", 9), 4);
+    assert_equals_int(dfa_count(search, "xxabxbbab", 3), 0);
+    assert_equals_int(dfa_count(search, "", 0), 0);
+    assert_equals_int(dfa_count(NULL, "b", 1), 0);
+
+    assert_equals_int(dfa_find_end(search, "xxabxb", 6), 4);
+    assert_equals_int(dfa_find_end(search, "xxabxb", 3), -1);
+    assert_equals_int(dfa_find_end(NULL, "b", 1), -1);
+
+    dfa_free(search);
+    free(search);
+    release();
+
+    TEST_END;
+}
+
+int test_dfa_find_end_until_idle() {
+    TEST_BEGIN;
+
+    build("ab");
+    DFA* search = dfa_create(nfa, DFA_UNANCHORED);
+    assert_is_not_null(search);
+
+    // Gives up on the first byte that cannot continue a match
+    size_t idle = 0;
+    assert_equals_int(dfa_find_end_until_idle(search, "axb", 3, &idle), -1);
+    assert_equals_int(idle, 2);
+    assert_equals_int(dfa_find_end_until_idle(search, "xab", 3, &idle), -1);
+    assert_equals_int(idle, 1);
+
+    idle = 0;
+    assert_equals_int(dfa_find_end_until_idle(search, "aab", 3, &idle), 3);
+    assert_equals_int(idle, 0);
+    assert_equals_int(dfa_find_end_until_idle(search, "aa", 2, &idle), -1);
+    assert_equals_int(idle, 2);
+
+    assert_equals_int(dfa_find_end_until_idle(search, "aa", 2, NULL), -1);
+    assert_equals_int(dfa_find_end_until_idle(NULL, "aa", 2, &idle), -1);
+
+    dfa_free(search);
+    free(search);
+    release();
+
+    TEST_END;
+}
+
+int test_dfa_find_start() {
+    TEST_BEGIN;
+
+    // Used backwards, the DFA for "a+b" matches the reversed string
+    build("ba+");
+    assert_equals_int(dfa_find_start(dfa, "xaaab", 5), 1);
+    assert_equals_int(dfa_find_start(dfa, "aaab", 4), 0);
+    assert_equals_int(dfa_find_start(dfa, "xaaabz", 5), 1);
+    assert_equals_int(dfa_find_start(dfa, "aaab", 3), -1);
+    assert_equals_int(dfa_find_start(dfa, "b", 1), -1);
+    assert_equals_int(dfa_find_start(NULL, "ab", 2), -1);
+
+    // Bounded scans report when the match could start earlier still
+    bool exhausted = true;
+    assert_equals_int(dfa_find_start_after(dfa, "xaaab", 0, 5, &exhausted), 1);
+    assert_equals_int(exhausted, false);
+    assert_equals_int(dfa_find_start_after(dfa, "xaaab", 2, 5, &exhausted), 2);
+    assert_equals_int(exhausted, true);
+    assert_equals_int(dfa_find_start_after(dfa, "aaab", 0, 4, &exhausted), 0);
+    assert_equals_int(exhausted, true);
+    assert_equals_int(dfa_find_start_after(dfa, "aaab", 3, 4, &exhausted), -1);
+    assert_equals_int(exhausted, true);
+    assert_equals_int(dfa_find_start_after(dfa, "xab", 0, 2, &exhausted), -1);
+    assert_equals_int(exhausted, false);
+    assert_equals_int(dfa_find_start_after(dfa, "ab", 3, 2, &exhausted), -1);
+    assert_equals_int(dfa_find_start_after(dfa, "ab", 0, 2, NULL), -1);
+
+    assert_equals_int(dfa_longest_match(dfa, "baaax", 5), 4);
+    assert_equals_int(dfa_longest_match(dfa, "baaa", 2), 2);
+    assert_equals_int(dfa_longest_match(dfa, "b", 1), -1);
+    assert_equals_int(dfa_longest_match(dfa, "xba", 3), -1);
+    assert_equals_int(dfa_longest_match(NULL, "ba", 2), -1);
+    release();
+
+    TEST_END;
+}
+
+int test_dfa_minimize() {
+    TEST_BEGIN;
+
+    // Each alternative is a separate NFA path, but they all merge
+    // dead, start, between the characters, accepting
+    build("(a|b|c)(a|b|c)");
+    assert_is_not_null(dfa);
+    assert_equals_int(dfa->n_states, 4);
+    assert_equals_int(dfa->start_state, 1);
+    assert_equals_int(DFA_MATCH("ac"), true);
+    assert_equals_int(DFA_MATCH("cb"), true);
+    assert_equals_int(DFA_MATCH("a"), false);
+    assert_equals_int(DFA_MATCH("abc"), false);
+    release();
+
+    // Hex digits in a loop need only dead, start and accepting states
+    build("(0|1|2|3|4|5|6|7|8|9|a|b|c|d|e|f)+");
+    assert_equals_int(dfa->n_states, 3);
+    assert_equals_int(DFA_MATCH("deadbeef"), true);
+    assert_equals_int(DFA_MATCH("deadbeefg"), false);
+    release();
+
+    assert_equals_int(dfa_minimize(NULL), -1);
+
+    TEST_END;
+}
+
+int test_dfa_renumber() {
+    TEST_BEGIN;
+
+    build("(ab|cd)+e");
+    assert_is_not_null(dfa);
+
+    size_t n = dfa->n_states;
+    size_t* counts = calloc(n, sizeof(size_t));
+    size_t* order = malloc(sizeof(size_t) * n);
+
+    for (int i = 0; i < 10; i++) {
+        dfa_profile(dfa, "cdcdcdcde", 9, counts);
+    }
+
+    assert_equals_int(dfa_hot_order(dfa, counts, order), 0);
+    assert_equals_int(order[0], DFA_DEAD_STATE);
+
+    // Visits never increase along the order
+    for (size_t i = 2; i < n; i++) {
+        assert_equals_int(counts[order[i - 1]] >= counts[order[i]], true);
+    }
+
+    assert_equals_int(dfa_renumber(dfa, order), 0);
+    for (size_t i = 0; i < n; i++) {
+        assert_equals_int(dfa->origin[i], order[i]);
+    }
+
+    // Renumbering does not change what the DFA accepts
+    assert_equals_int(DFA_MATCH("abe"), true);
+    assert_equals_int(DFA_MATCH("cdabcde"), true);
+    assert_equals_int(DFA_MATCH("e"), false);
+    assert_equals_int(DFA_MATCH("abc"), false);
+
+    // Orders that are not permutations are rejected
+    order[1] = order[2];
+    assert_equals_int(dfa_renumber(dfa, order), -1);
+    order[0] = 1;
+    assert_equals_int(dfa_renumber(dfa, order), -1);
+
+    free(counts);
+    free(order);
+    release();
+
+    TEST_END;
+}
+
+// Compare the DFAs of two patterns, checking for a subset, or for
+// equivalence when `both`
+int compare(char* a, char* b, bool both) {
+    build(a);
+    NFA* nfa_a = nfa;
+    DFA* dfa_a = dfa;
+    build(b);
+
+    int result = both ? dfa_is_equivalent(dfa_a, dfa) : dfa_is_subset(dfa_a, dfa);
+
+    release();
+    nfa_free(nfa_a);
+    free(nfa_a);
+    dfa_free(dfa_a);
+    free(dfa_a);
+
+    return result;
+}
+
+int test_dfa_is_subset() {
+    TEST_BEGIN;
+
+    assert_equals_int(compare("ab", "a*b*", false), 1);
+    assert_equals_int(compare("a*b*", "ab", false), 0);
+    assert_equals_int(compare("(a|b)*", "(a*b*)*", false), 1);
+    assert_equals_int(compare("(ab)+", "a(ba)*b", false), 1);
+    assert_equals_int(compare("a(b|c)d", "abd|acd|aed", false), 1);
+    assert_equals_int(compare("a(b|c)d", "abd|aed", false), 0);
+
+    // Only a string longer than both DFAs tells them apart
+    assert_equals_int(compare("(aaa)*", "(aa)*|(aaa)*", false), 1);
+    assert_equals_int(compare("(aa)*|(aaa)*", "(aaa)*", false), 0);
+
+    assert_equals_int(compare("a?", "a", false), 0);
+    assert_equals_int(dfa_is_subset(NULL, NULL), -1);
+
+    TEST_END;
+}
+
+int test_dfa_is_equivalent() {
+    TEST_BEGIN;
+
+    assert_equals_int(compare("(a|b)*", "(a*b*)*", true), 1);
+    assert_equals_int(compare("(ab)+", "a(ba)*b", true), 1);
+    assert_equals_int(compare("a(b|c)d", "abd|acd", true), 1);
+    assert_equals_int(compare("a+", "aa*", true), 1);
+    assert_equals_int(compare("ab", "a*b*", true), 0);
+    assert_equals_int(compare("a*b*", "ab", true), 0);
+    assert_equals_int(compare("a", "b", true), 0);
+    assert_equals_int(dfa_is_equivalent(NULL, NULL), -1);
+
+    TEST_END;
+}
+
+// Whether the two DFAs have exactly the same states and transitions
+bool same_dfa(DFA* a, DFA* b) {
+    return a->n_states == b->n_states
+        && a->start_state == b->start_state
+        && memcmp(a->table, b->table, sizeof(uint32_t) * DFA_ALPHABET_SIZE * a->n_states) == 0
+        && memcmp(a->is_final, b->is_final, sizeof(bool) * a->n_states) == 0;
+}
+
+int test_dfa_create_parallel() {
+    TEST_BEGIN;
+
+    // The threads find states in any order, but the result is the same
+    char* patterns[] = {"ab", "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)",
+                        "(ab|ba)*(c|d)+x?", "((a|b)(c|d))*e|a*"};
+    DFAMode modes[] = {DFA_ANCHORED, DFA_UNANCHORED};
+
+    for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        for (size_t m = 0; m < 2; m++) {
+            build(patterns[i]);
+            DFA* serial = dfa_create(nfa, modes[m]);
+            DFA* parallel = dfa_create_parallel(nfa, modes[m], 4);
+            assert_is_not_null(serial);
+            assert_is_not_null(parallel);
+            assert_equals_int(same_dfa(serial, parallel), true);
+
+            dfa_free(serial);
+            free(serial);
+            dfa_free(parallel);
+            free(parallel);
+            release();
+        }
+    }
+
+    // Running out of states fails on every thread
+    build("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)");
+    assert_is_null(dfa_create_parallel(nfa, DFA_ANCHORED, 4));
+    release();
+
+    assert_is_null(dfa_create_parallel(NULL, DFA_ANCHORED, 4));
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_dfa_create", .func=test_dfa_create},
+    {.name="test_dfa_create_parallel", .func=test_dfa_create_parallel},
+    {.name="test_dfa_match", .func=test_dfa_match},
+    {.name="test_dfa_unanchored", .func=test_dfa_unanchored},
+    {.name="test_dfa_find_end_until_idle", .func=test_dfa_find_end_until_idle},
+    {.name="test_dfa_find_start", .func=test_dfa_find_start},
+    {.name="test_dfa_minimize", .func=test_dfa_minimize},
+    {.name="test_dfa_renumber", .func=test_dfa_renumber},
+    {.name="test_dfa_is_subset", .func=test_dfa_is_subset},
+    {.name="test_dfa_is_equivalent", .func=test_dfa_is_equivalent},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,125 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "glushkov.h"
+#include "lexer.h"
+#include "parser.h"
+
+Glushkov* glushkov;
+
+// Build the Glushkov automaton for the given pattern
+void build(char* pattern) {
+    Lexer lexer;
+    Parser parser;
+    lexer_init(&lexer, pattern);
+    parser_init(&parser, &lexer);
+
+    ASTNode* root = parse(&parser);
+    glushkov = glushkov_create(root);
+
+    ast_node_free(root);
+    parser_free(&parser);
+    lexer_free(&lexer);
+}
+
+void release() {
+    glushkov_free(glushkov);
+    free(glushkov);
+    glushkov = NULL;
+}
+
+#define APPROX(s, k) glushkov_match_approx(glushkov, (s), strlen((s)), (k))
+
+int test_glushkov_create() {
+    TEST_BEGIN;
+
+    build("a(b|c)*d");
+    assert_is_not_null(glushkov);
+    assert_equals_int(glushkov->n_positions, 4);
+
+    // Positions are numbered from left to right, starting at 1
+    assert_equals_int(glushkov->masks['a'], 1 << 1);
+    assert_equals_int(glushkov->masks['b'], 1 << 2);
+    assert_equals_int(glushkov->masks['c'], 1 << 3);
+    assert_equals_int(glushkov->masks['d'], 1 << 4);
+
+    assert_equals_int(glushkov->follow[0], 1 << 1);
+    assert_equals_int(glushkov->follow[1], (1 << 2) | (1 << 3) | (1 << 4));
+    assert_equals_int(glushkov->follow[2], (1 << 2) | (1 << 3) | (1 << 4));
+    assert_equals_int(glushkov->follow[4], 0);
+    assert_equals_int(glushkov->accepting, 1 << 4);
+
+    assert_equals_int(glushkov_step(glushkov, (1 << 0) | (1 << 4)), 1 << 1);
+    release();
+
+    // Nullable patterns accept in the initial state
+    build("a*");
+    assert_equals_int(glushkov->accepting, (1 << 0) | (1 << 1));
+    release();
+
+    // Patterns with too many characters don't fit in a word
+    build("0123456789012345678901234567890123456789012345678901234567890123");
+    assert_is_null(glushkov);
+
+    assert_is_null(glushkov_create(NULL));
+
+    TEST_END;
+}
+
+int test_glushkov_match_approx() {
+    TEST_BEGIN;
+
+    build("hello");
+
+    assert_equals_int(APPROX("hello", 0), true);
+    assert_equals_int(APPROX("hallo", 0), false);
+
+    // Substitution, insertion and deletion each cost one error
+    assert_equals_int(APPROX("hallo", 1), true);
+    assert_equals_int(APPROX("helllo", 1), true);
+    assert_equals_int(APPROX("helo", 1), true);
+    assert_equals_int(APPROX("xhello", 1), true);
+    assert_equals_int(APPROX("ello", 1), true);
+
+    assert_equals_int(APPROX("hxlo", 1), false);
+    assert_equals_int(APPROX("hxlo", 2), true);
+    assert_equals_int(APPROX("", 4), false);
+    assert_equals_int(APPROX("", 5), true);
+
+    assert_equals_int(APPROX("hello", GLUSHKOV_MAX_ERRORS + 1), false);
+    assert_equals_int(glushkov_match_approx(NULL, "hello", 5, 0), false);
+    assert_equals_int(glushkov_match_approx(glushkov, NULL, 0, 0), false);
+    release();
+
+    // Errors are counted against the closest string the pattern accepts
+    build("ab(cd)*e");
+    assert_equals_int(APPROX("abcdcde", 0), true);
+    assert_equals_int(APPROX("abcdcxe", 1), true);
+    assert_equals_int(APPROX("abcdce", 1), true);
+    assert_equals_int(APPROX("abxcdxe", 1), false);
+    assert_equals_int(APPROX("abxcdxe", 2), true);
+    release();
+
+    build("(cat|dog)s?");
+    assert_equals_int(APPROX("cot", 1), true);
+    assert_equals_int(APPROX("dogz", 1), true);
+    assert_equals_int(APPROX("cog", 1), true);
+    assert_equals_int(APPROX("cxx", 1), false);
+    assert_equals_int(APPROX("cxx", 2), true);
+    release();
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_glushkov_create", .func=test_glushkov_create},
+    {.name="test_glushkov_match_approx", .func=test_glushkov_match_approx},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,302 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "lexer.h"
+#include "literal.h"
+#include "parser.h"
+
+// Parse the given pattern into an AST
+ASTNode* build(char* pattern) {
+    Lexer lexer;
+    Parser parser;
+    lexer_init(&lexer, pattern);
+    parser_init(&parser, &lexer);
+
+    ASTNode* root = parse(&parser);
+
+    parser_free(&parser);
+    lexer_free(&lexer);
+    return root;
+}
+
+// Compute the prefix of the given pattern, and compare it to the expected one
+bool prefix_is(char* pattern, char* expected) {
+    ASTNode* root = build(pattern);
+    Literal prefix;
+
+    bool result = literal_prefix(root, &prefix) == 0
+        && prefix.len == strlen(expected)
+        && (prefix.len == 0 || memcmp(prefix.bytes, expected, prefix.len) == 0);
+
+    literal_free(&prefix);
+    ast_node_free(root);
+    return result;
+}
+
+// Whether the set of required strings of the pattern is exactly `expected`
+bool required_is(char* pattern, char** expected, size_t n) {
+    ASTNode* root = build(pattern);
+    LiteralSet required;
+
+    bool result = literal_required(root, &required) == 0 && required.n == n;
+
+    for (size_t i = 0; result && i < n; i++) {
+        bool found = false;
+        for (size_t j = 0; j < required.n; j++) {
+            found = found || (required.literals[j].len == strlen(expected[i])
+                && memcmp(required.literals[j].bytes, expected[i], strlen(expected[i])) == 0);
+        }
+        result = found;
+    }
+
+    literal_set_free(&required);
+    ast_node_free(root);
+    return result;
+}
+
+int test_literal_prefix() {
+    TEST_BEGIN;
+
+    assert_equals_int(prefix_is("abc", "abc"), true);
+    assert_equals_int(prefix_is("GET /api(v1|v2)", "GET /apiv"), true);
+    assert_equals_int(prefix_is("ab(cd|ce)f", "abc"), true);
+    assert_equals_int(prefix_is("(ab|ab)c", "abc"), true);
+    assert_equals_int(prefix_is("(ab|abc)d", "ab"), true);
+    assert_equals_int(prefix_is("ab+c", "ab"), true);
+    assert_equals_int(prefix_is("(ab)+c", "ab"), true);
+    assert_equals_int(prefix_is("ab*c", "a"), true);
+    assert_equals_int(prefix_is("ab?", "a"), true);
+
+    // Matches may start differently
+    assert_equals_int(prefix_is("a*b", ""), true);
+    assert_equals_int(prefix_is("a|b", ""), true);
+    assert_equals_int(prefix_is("(a|b)c", ""), true);
+
+    Literal prefix;
+    assert_equals_int(literal_prefix(NULL, &prefix), -1);
+
+    TEST_END;
+}
+
+int test_literal_is_pure() {
+    TEST_BEGIN;
+
+    char* pure[] = {"a", "abc", "GET /index"};
+    char* not_pure[] = {"a*", "ab|c", "a(bc)?", "ab+c"};
+
+    for (int i = 0; i < 3; i++) {
+        ASTNode* root = build(pure[i]);
+        assert_equals_int(literal_is_pure(root), true);
+        ast_node_free(root);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        ASTNode* root = build(not_pure[i]);
+        assert_equals_int(literal_is_pure(root), false);
+        ast_node_free(root);
+    }
+
+    assert_equals_int(literal_is_pure(NULL), false);
+
+    TEST_END;
+}
+
+int test_literal_branches() {
+    TEST_BEGIN;
+
+    ASTNode* root = build("foo|bar|(ba|bz)");
+    LiteralSet branches;
+    assert_equals_int(literal_branches(root, &branches), 0);
+    assert_equals_int(branches.n, 4);
+
+    char* expected[] = {"foo", "bar", "ba", "bz"};
+    for (int i = 0; i < 4; i++) {
+        assert_equals_int(branches.literals[i].len, strlen(expected[i]));
+        assert_equals_int(memcmp(branches.literals[i].bytes, expected[i], strlen(expected[i])), 0);
+    }
+
+    literal_set_free(&branches);
+    ast_node_free(root);
+
+    // Single strings, and branches that are not plain strings
+    char* others[] = {"foo", "foo|ba+r", "(foo|bar)x"};
+    for (int i = 0; i < 3; i++) {
+        root = build(others[i]);
+        assert_equals_int(literal_branches(root, &branches), 0);
+        assert_equals_int(branches.n, 0);
+        ast_node_free(root);
+    }
+
+    assert_equals_int(literal_branches(NULL, &branches), -1);
+
+    TEST_END;
+}
+
+// Whether the set of start strings of the pattern is exactly `expected`
+bool starts_are(char* pattern, char** expected, size_t n) {
+    ASTNode* root = build(pattern);
+    LiteralSet starts;
+
+    bool result = literal_starts(root, &starts) == 0 && starts.n == n;
+
+    for (size_t i = 0; result && i < n; i++) {
+        bool found = false;
+        for (size_t j = 0; j < starts.n; j++) {
+            found = found || (starts.literals[j].len == strlen(expected[i])
+                && memcmp(starts.literals[j].bytes, expected[i], strlen(expected[i])) == 0);
+        }
+        result = found;
+    }
+
+    literal_set_free(&starts);
+    ast_node_free(root);
+    return result;
+}
+
+int test_literal_starts() {
+    TEST_BEGIN;
+
+    char* levels[] = {"ERROR:", "WARN:"};
+    assert_equals_int(starts_are("(ERROR|WARN):(a|b)*", levels, 2), true);
+
+    char* optional[] = {"ab", "b"};
+    assert_equals_int(starts_are("a?b+c", optional, 2), true);
+
+    char* expanded[] = {"xa", "xb", "ya", "yb"};
+    assert_equals_int(starts_are("(x|y)(a|b)", expanded, 4), true);
+
+    // Strings stop growing at the first operand that is not exact
+    char* repeated[] = {"ab", "cd"};
+    assert_equals_int(starts_are("(ab|cd)+e", repeated, 2), true);
+
+    // Nothing is known when matches may start anywhere
+    assert_equals_int(starts_are("a*b", NULL, 0), true);
+    assert_equals_int(starts_are("(a|b*)c", NULL, 0), true);
+    assert_equals_int(starts_are("(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q)x", NULL, 0), true);
+
+    LiteralSet starts;
+    assert_equals_int(literal_starts(NULL, &starts), -1);
+
+    TEST_END;
+}
+
+int test_literal_required() {
+    TEST_BEGIN;
+
+    // The longest of the mandatory strings is kept
+    char* timeout[] = {"timeout"};
+    assert_equals_int(required_is("(x|y)*ERROR(x|y)*timeout", timeout, 1), true);
+
+    // Small sets of alternatives are expanded
+    char* abd[] = {"abd", "acd"};
+    assert_equals_int(required_is("a(b|c)d", abd, 2), true);
+    char* ac[] = {"ac", "abc"};
+    assert_equals_int(required_is("x*ab?c", ac, 2), true);
+    char* foo[] = {"foo", "bar"};
+    assert_equals_int(required_is("(foo|bar)+z*", foo, 2), true);
+    char* err[] = {"ERR", "WARN"};
+    assert_equals_int(required_is("(ERR|WARN(x|y)*)!", err, 2), true);
+
+    // Nothing is required when the pattern may match without any string
+    assert_equals_int(required_is("(a|b)*", NULL, 0), true);
+    assert_equals_int(required_is("a?b?", NULL, 0), true);
+    assert_equals_int(required_is("abc|d*", NULL, 0), true);
+
+    // Too many alternatives to scan for
+    assert_equals_int(required_is("(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q)+", NULL, 0), true);
+
+    // Joining stops before the set grows too large
+    char* x[] = {"x"};
+    assert_equals_int(required_is("(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q)x", x, 1), true);
+
+    LiteralSet required;
+    assert_equals_int(literal_required(NULL, &required), -1);
+
+    TEST_END;
+}
+
+int test_literal_find() {
+    TEST_BEGIN;
+
+    Literal literal = {.bytes = "needle", .len = 6};
+    assert_equals_int(literal_find(&literal, "haystack needle hay", 19), 9);
+    assert_equals_int(literal_find(&literal, "needle", 6), 0);
+    assert_equals_int(literal_find(&literal, "needl", 5), -1);
+    assert_equals_int(literal_find(&literal, "haystack needle", 14), -1);
+
+    // Single bytes, including ones that end strings
+    literal = (Literal) {.bytes = "\0", .len = 1};
+    assert_equals_int(literal_find(&literal, "ab\0c", 4), 2);
+    assert_equals_int(literal_find(&literal, "abc", 3), -1);
+
+    // The empty string occurs everywhere
+    literal = (Literal) {.bytes = NULL, .len = 0};
+    assert_equals_int(literal_find(&literal, "abc", 3), 0);
+
+    assert_equals_int(literal_find(NULL, "abc", 3), -1);
+    assert_equals_int(literal_find(&literal, NULL, 0), -1);
+
+    // The earliest occurrence of any literal in a set
+    Literal literals[] = {{.bytes = "world", .len = 5}, {.bytes = "lo w", .len = 4}};
+    LiteralSet set = {.literals = literals, .n = 2};
+    assert_equals_int(literal_set_find(&set, "hello world", 11), 3);
+    assert_equals_int(literal_set_find(&set, "hello_world", 11), 6);
+    assert_equals_int(literal_set_find(&set, "hello", 5), -1);
+
+    set.n = 0;
+    assert_equals_int(literal_set_find(&set, "hello world", 11), -1);
+    assert_equals_int(literal_set_find(NULL, "hello world", 11), -1);
+
+    TEST_END;
+}
+
+int test_horspool() {
+    TEST_BEGIN;
+
+    Literal needle = {.bytes = "abcab", .len = 5};
+    Horspool* horspool = horspool_create(&needle);
+    assert_is_not_null(horspool);
+
+    // The window moves by the distance to the last occurrence of its last
+    // byte in the needle, not counting the needle's last byte
+    assert_equals_int(horspool->shift['a'], 1);
+    assert_equals_int(horspool->shift['b'], 3);
+    assert_equals_int(horspool->shift['c'], 2);
+    assert_equals_int(horspool->shift['z'], 5);
+
+    assert_equals_int(horspool_find(horspool, "abcab", 5), 0);
+    assert_equals_int(horspool_find(horspool, "ababcabcab", 10), 2);
+    assert_equals_int(horspool_find(horspool, "zzzzzzzabcab", 12), 7);
+    assert_equals_int(horspool_find(horspool, "abcabcab", 4), -1);
+    assert_equals_int(horspool_find(horspool, "abcba abcb", 10), -1);
+    assert_equals_int(horspool_find(horspool, "", 0), -1);
+    assert_equals_int(horspool_find(NULL, "abcab", 5), -1);
+    assert_equals_int(horspool_find(horspool, NULL, 0), -1);
+
+    horspool_free(horspool);
+    free(horspool);
+
+    needle = (Literal) {.bytes = NULL, .len = 0};
+    assert_is_null(horspool_create(&needle));
+    assert_is_null(horspool_create(NULL));
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_literal_prefix", .func=test_literal_prefix},
+    {.name="test_literal_is_pure", .func=test_literal_is_pure},
+    {.name="test_literal_branches", .func=test_literal_branches},
+    {.name="test_literal_starts", .func=test_literal_starts},
+    {.name="test_literal_required", .func=test_literal_required},
+    {.name="test_literal_find", .func=test_literal_find},
+    {.name="test_horspool", .func=test_horspool},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -84,11 +84,99 @@ int test_nfa_match_edge_cases() {
     TEST_END;
 }
 
+int test_nfa_match_len() {
+    TEST_BEGIN;
+
+    assert_equals_int(nfa_match_len(nfa, "abc", 2), true);
+    assert_equals_int(nfa_match_len(nfa, "abc", 3), false);
+
+    // NUL is a byte like any other, not an epsilon transition
+    assert_equals_int(nfa_match_len(nfa, "a\0b", 3), false);
+    assert_equals_int(nfa_match_len(nfa, "ab\0", 3), false);
+    assert_equals_int(nfa_match_len(NULL, "ab", 2), false);
+
+    TEST_END;
+}
+
+int test_nfa_find_end() {
+    TEST_BEGIN;
+
+    assert_equals_int(nfa_find_end(nfa, "ab", 2), 2);
+    assert_equals_int(nfa_find_end(nfa, "aab", 3), 3);
+    assert_equals_int(nfa_find_end(nfa, "xxabab", 6), 4);
+
+    assert_equals_int(nfa_find_end(nfa, "a", 1), -1);
+    assert_equals_int(nfa_find_end(nfa, "ab", 1), -1);
+    assert_equals_int(nfa_find_end(nfa, "a\nb", 3), -1);
+    assert_equals_int(nfa_find_end(NULL, "ab", 2), -1);
+    assert_equals_int(nfa_find_end(nfa, NULL, 0), -1);
+
+    TEST_END;
+}
+
+int test_nfa_find_start() {
+    TEST_BEGIN;
+
+    // Used backwards, the NFA for "ab" matches "ba"
+    assert_equals_int(nfa_find_start(nfa, "ba", 2), 0);
+    assert_equals_int(nfa_find_start(nfa, "xxba", 4), 2);
+    assert_equals_int(nfa_find_start(nfa, "xxbay", 4), 2);
+
+    assert_equals_int(nfa_find_start(nfa, "ab", 2), -1);
+    assert_equals_int(nfa_find_start(nfa, "ba", 1), -1);
+    assert_equals_int(nfa_find_start(NULL, "ba", 2), -1);
+    assert_equals_int(nfa_find_start(nfa, NULL, 0), -1);
+
+    TEST_END;
+}
+
+int test_nfa_longest_match() {
+    TEST_BEGIN;
+
+    assert_equals_int(nfa_longest_match(nfa, "ab", 2), 2);
+    assert_equals_int(nfa_longest_match(nfa, "abab", 4), 2);
+    assert_equals_int(nfa_longest_match(nfa, "ab", 1), -1);
+    assert_equals_int(nfa_longest_match(nfa, "xab", 3), -1);
+    assert_equals_int(nfa_longest_match(NULL, "ab", 2), -1);
+
+    TEST_END;
+}
+
+int test_nfa_states() {
+    TEST_BEGIN;
+
+    // Every state is found once, and the walk can be repeated
+    for (int round = 0; round < 2; round++) {
+        NFAStateList* states = nfa_states(nfa);
+        assert_is_not_null(states);
+        assert_equals_int(states->size, 3);
+
+        size_t found = 0;
+        for (size_t i = 0; i < states->size; i++) {
+            found += states->list[i] == &start_state || states->list[i] == &intermediate_state
+                     || states->list[i] == &final_state;
+        }
+        assert_equals_int(found, 3);
+
+        NFAStateList_free(states, NULL);
+        free(states);
+    }
+
+    assert_is_null(nfa_states(NULL));
+
+    TEST_END;
+}
+
 Test tests[] = {
     {.name="test_nfa_create", .func=test_nfa_create},
     {.name="test_nfa_match_positive", .func=test_nfa_match_positive},
     {.name="test_nfa_match_negative", .func=test_nfa_match_negative},
     {.name="test_nfa_match_edge_cases", .func=test_nfa_match_edge_cases},
+    {.name="test_nfa_match_len", .func=test_nfa_match_len},
+    {.name="test_nfa_find_end", .func=test_nfa_find_end},
+    {.name="test_nfa_find_start", .func=test_nfa_find_start},
+    {.name="test_nfa_longest_match", .func=test_nfa_longest_match},
+    {.name="test_nfa_states", .func=test_nfa_states},
     {.name=NULL, .func=NULL}
 };
 
@@ -1,3 +1,6 @@
+#include <pthread.h>
+#include <stdlib.h>
+
 #define FAIL_FAST
 #include "testlib/asserts.h"
 #include "testlib/tests.h"
@@ -92,10 +95,116 @@ int test_state_free() {
     TEST_END;
 }
 
+int test_arena() {
+    TEST_BEGIN;
+
+    NFAArena arena;
+    assert_equals_int(nfa_arena_init(&arena), 0);
+    assert_equals_int(nfa_arena_init(NULL), -1);
+    assert_is_null(arena_state_create(NULL, false));
+
+    // Enough states to need several blocks
+    NFAState* states[200];
+    for (size_t i = 0; i < 200; i++) {
+        states[i] = arena_state_create(&arena, i == 199);
+        assert_is_not_null(states[i]);
+    }
+    assert_equals_int(arena.n_states, 200);
+    assert_equals_int(states[199]->is_final, true);
+
+    // States of one block are laid out next to each other
+    assert_equals_ptr(states[1], states[0] + 1, NFAState*);
+
+    // Lists of transitions grow past their first array
+    for (size_t i = 1; i < 200; i++) {
+        assert_equals_int(arena_add_transition(&arena, states[0], states[i], 'a'), (int) i);
+    }
+    assert_equals_int(arena_add_transition(&arena, states[0], states[1], '\0'), 1);
+
+    NFAStateList* list = get_transition(states[0], 'a');
+    assert_is_not_null(list);
+    bool in_order = list->size == 199;
+    for (size_t i = 0; in_order && i < list->size; i++) {
+        in_order = list->list[i] == states[i + 1];
+    }
+    assert_equals_int(in_order, true);
+
+    // Test invalid transitions
+    assert_equals_int(arena_add_transition(NULL, states[0], states[1], 'a'), -1);
+    assert_equals_int(arena_add_transition(&arena, states[0], NULL, 'a'), -1);
+    assert_equals_int(arena_add_transition(&arena, states[0], states[1], '\n'), -1);
+
+    // Everything goes at once
+    nfa_arena_free(&arena);
+    assert_is_null(arena.blocks);
+    assert_equals_int(arena.n_states, 0);
+
+    TEST_END;
+}
+
+#define N_ID_THREADS 4
+#define N_IDS 5000
+
+// Take IDs from another thread
+static void* take_ids(void* arg) {
+    unsigned long long int* ids = arg;
+    NFAState taken;
+
+    for (size_t i = 0; i < N_IDS; i++) {
+        state_init(&taken, false);
+        ids[i] = taken.ID;
+    }
+
+    return NULL;
+}
+
+static int id_cmp(const void* a, const void* b) {
+    unsigned long long int x = *(const unsigned long long int*) a;
+    unsigned long long int y = *(const unsigned long long int*) b;
+    return (x > y) - (x < y);
+}
+
+int test_state_init_threads() {
+    TEST_BEGIN;
+
+    unsigned long long int* ids = malloc(sizeof(unsigned long long int) * N_IDS * N_ID_THREADS);
+    assert_is_not_null(ids);
+
+    pthread_t threads[N_ID_THREADS];
+    for (size_t i = 0; i < N_ID_THREADS; i++) {
+        assert_equals_int(pthread_create(&threads[i], NULL, take_ids, &ids[i * N_IDS]), 0);
+    }
+    for (size_t i = 0; i < N_ID_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Each thread's IDs keep increasing, and no ID is given out twice
+    bool increasing = true;
+    for (size_t i = 0; i < N_ID_THREADS; i++) {
+        for (size_t j = 1; j < N_IDS; j++) {
+            increasing = increasing && ids[i * N_IDS + j - 1] < ids[i * N_IDS + j];
+        }
+    }
+    assert_equals_int(increasing, true);
+
+    qsort(ids, N_IDS * N_ID_THREADS, sizeof(unsigned long long int), id_cmp);
+    bool unique = true;
+    for (size_t i = 1; i < N_IDS * N_ID_THREADS; i++) {
+        unique = unique && ids[i - 1] != ids[i];
+    }
+    assert_equals_int(unique, true);
+
+    free(ids);
+
+    TEST_END;
+}
+
 Test tests[] = {
     {.name="test_state_init", .func=test_state_init},
     {.name="test_add_transition", .func=test_add_transition},
     {.name="test_state_free", .func=test_state_free},
+    {.name="test_state_init_threads", .func=test_state_init_threads},
+    {.name="test_arena", .func=test_arena},
     {.name=NULL, .func=NULL}
 };
 
@@ -0,0 +1,83 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "perfect_hash.h"
+
+int test_perfect_hash_create() {
+    TEST_BEGIN;
+
+    // Equal keys share the slot of the first, and the empty key is allowed
+    Literal literals[] = {{"get", 3}, {"post", 4}, {NULL, 0}, {"get", 3}, {"g\0t", 3}};
+    LiteralSet keys = {.literals = literals, .n = 5};
+    PerfectHash* hash = perfect_hash_create(&keys);
+    assert_is_not_null(hash);
+    assert_equals_int(hash->n_slots, 4);
+
+    assert_equals_int(perfect_hash_lookup(hash, "get", 3), 0);
+    assert_equals_int(perfect_hash_lookup(hash, "post", 4), 1);
+    assert_equals_int(perfect_hash_lookup(hash, "", 0), 2);
+    assert_equals_int(perfect_hash_lookup(hash, "g\0t", 3), 4);
+    assert_equals_int(perfect_hash_lookup(hash, "ge", 2), -1);
+    assert_equals_int(perfect_hash_lookup(hash, "gets", 4), -1);
+    assert_equals_int(perfect_hash_lookup(hash, "put", 3), -1);
+    assert_equals_int(perfect_hash_lookup(hash, NULL, 0), -1);
+    assert_equals_int(perfect_hash_lookup(NULL, "get", 3), -1);
+
+    perfect_hash_free(hash);
+    free(hash);
+
+    keys.n = 0;
+    assert_is_null(perfect_hash_create(&keys));
+    assert_is_null(perfect_hash_create(NULL));
+
+    TEST_END;
+}
+
+int test_perfect_hash_many() {
+    TEST_BEGIN;
+
+    // Every key gets its own slot, with no slot left over
+    size_t n = 20000;
+    char (*storage)[24] = malloc(sizeof(*storage) * n);
+    Literal* literals = malloc(sizeof(Literal) * n);
+    for (size_t i = 0; i < n; i++) {
+        literals[i].len = snprintf(storage[i], sizeof(storage[i]), "host%zu.example", i);
+        literals[i].bytes = storage[i];
+    }
+
+    LiteralSet keys = {.literals = literals, .n = n};
+    PerfectHash* hash = perfect_hash_create(&keys);
+    assert_is_not_null(hash);
+    assert_equals_int(hash->n_slots, n);
+    assert_equals_int(hash->n_buckets, n / PERFECT_HASH_BUCKET_SIZE);
+
+    bool found = true;
+    for (size_t i = 0; i < n; i++) {
+        found = found && perfect_hash_lookup(hash, literals[i].bytes, literals[i].len) == (ssize_t) i;
+    }
+    assert_equals_int(found, true);
+
+    assert_equals_int(perfect_hash_lookup(hash, "host20000.example", 17), -1);
+    assert_equals_int(perfect_hash_lookup(hash, "host1.exampl", 12), -1);
+
+    perfect_hash_free(hash);
+    free(hash);
+    free(literals);
+    free(storage);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_perfect_hash_create", .func=test_perfect_hash_create},
+    {.name="test_perfect_hash_many", .func=test_perfect_hash_many},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
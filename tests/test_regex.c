@@ -52,7 +52,7 @@ int test_regex_compile() {
     int result = regex_compile(&regex_buf, "a|b");
     assert_equals_int(result, 0);
     assert_equals_int(true, regex_buf.is_compiled);
-    assert_is_not_null(regex_buf.nfa);
+    assert_is_not_null(regex_buf.keywords);
     assert_equals_str(regex_buf.pattern, "a|b");
 
     // Test recompiling with the same pattern
@@ -100,6 +100,10 @@ int test_regex_match() {
     assert_equals_int(false, regex_match(regex, "ac"));
     assert_equals_int(false, regex_match(regex, "bca"));
 
+    // Strings missing the required `b` are rejected before matching
+    assert_equals_int(1, regex->required.n);
+    assert_equals_int(false, regex_match(regex, "aaaac"));
+
     // Test with NULL regex
     assert_equals_int(false, regex_match(NULL, "abc"));
 
@@ -117,15 +121,855 @@ int test_regex_match() {
     TEST_END;
 }
 
+// Test compiling many patterns at once across threads
+int test_regex_compile_all() {
+    TEST_BEGIN;
+
+    // Plain strings, automata too large to determinize, and invalid
+    // patterns, which are spread across the threads
+    char* kinds[] = {"GET /index", "(a|b)*a(b|c)+", "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)",
+                     "(ab", "x|yz|w+"};
+    char* patterns[100];
+    for (size_t i = 0; i < 100; i++) {
+        patterns[i] = kinds[i % 5];
+    }
+
+    Regex* regexes[100];
+    assert_equals_int(regex_compile_all(patterns, 100, regexes, 4), 20);
+
+    bool agreed = true;
+    for (size_t i = 0; i < 100; i++) {
+        if (i % 5 == 3) {
+            agreed = agreed && regexes[i] == NULL;
+            continue;
+        }
+
+        agreed = agreed && regexes[i] != NULL && regexes[i]->pattern == patterns[i];
+        agreed = agreed && regex_match(regexes[i], "GET /index") == (i % 5 == 0);
+        agreed = agreed && regex_match(regexes[i], "abab") == (i % 5 == 1);
+        agreed = agreed && regex_match(regexes[i], "baaaaaaaaaaaaa") == (i % 5 == 2);
+        agreed = agreed && regex_match(regexes[i], "ww") == (i % 5 == 4);
+        regex_free(regexes[i]);
+        free(regexes[i]);
+    }
+    assert_equals_int(agreed, true);
+
+    // More threads than patterns, and the default number of threads
+    assert_equals_int(regex_compile_all(patterns, 2, regexes, 64), 0);
+    assert_equals_int(regex_compile_all(&patterns[3], 1, &regexes[2], 0), 1);
+    assert_is_null(regexes[2]);
+    for (size_t i = 0; i < 2; i++) {
+        regex_free(regexes[i]);
+        free(regexes[i]);
+    }
+
+    assert_equals_int(regex_compile_all(NULL, 0, NULL, 0), 0);
+    assert_equals_int(regex_compile_all(NULL, 1, regexes, 0), -1);
+
+    TEST_END;
+}
+
+// Test matching plain strings without any automaton
+int test_regex_match_literal() {
+    TEST_BEGIN;
+
+    // Plain strings are compiled without any automaton
+    Regex* regex = regex_create("needle");
+    assert_is_not_null(regex);
+    assert_is_not_null(regex->literal);
+    assert_is_null(regex->nfa);
+    assert_is_null(regex->dfa);
+    assert_is_null(regex->search_dfa);
+
+    assert_equals_int(true, regex_match(regex, "needle"));
+    assert_equals_int(false, regex_match(regex, "needles"));
+    assert_equals_int(false, regex_match(regex, "needl"));
+    assert_equals_int(false, regex_match(regex, "noodle"));
+    assert_equals_int(false, regex_match(regex, ""));
+
+    char* text = "needle in a needleneedle stack";
+    assert_equals_int(regex_count(regex, text, strlen(text)), 3);
+
+    char out[64];
+    size_t out_len;
+    assert_equals_int(regex_replace(regex, text, strlen(text), "pin", out, sizeof(out), &out_len), 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "pin in a pinpin stack");
+
+    RegexSlice slices[4];
+    assert_equals_int(regex_split(regex, text, strlen(text), slices, 4), 4);
+    assert_equals_int(slices[1].offset, 6);
+    assert_equals_int(slices[1].length, 6);
+    assert_equals_int(slices[3].offset, 24);
+
+    assert_equals_int(1, regex_match_approx(regex, "noodle", 2));
+
+    regex_free(regex);
+    assert_is_null(regex->literal);
+    free(regex);
+
+    // Non-overlapping occurrences
+    regex = regex_create("aa");
+    assert_equals_int(regex_count(regex, "aaaaa", 5), 2);
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test rejecting inputs by their first and last bytes
+int test_regex_match_edges() {
+    TEST_BEGIN;
+
+    Regex* regex = regex_create("GET /(a|b|c)+(x|y)*.html");
+    assert_is_not_null(regex);
+    assert_equals_int(regex->prefix.len, 5);
+    assert_equals_int(regex->suffix.len, 5);
+    assert_equals_int(memcmp(regex->suffix.bytes, ".html", 5), 0);
+    assert_equals_int(byte_set_count(&regex->first_bytes), 1);
+    assert_equals_int(byte_set_count(&regex->last_bytes), 1);
+
+    assert_equals_int(true, regex_match(regex, "GET /abcxy.html"));
+    assert_equals_int(false, regex_match(regex, "PUT /abcxy.html"));
+    assert_equals_int(false, regex_match(regex, "GET /abcxy.htm"));
+    assert_equals_int(false, regex_match(regex, "GET /abcxy.xhtml"));
+    regex_free(regex);
+    free(regex);
+
+    // Without a fixed prefix or suffix, the first and last bytes still are
+    regex = regex_create("(a|b)(x|y)*(c|d)");
+    assert_equals_int(regex->prefix.len, 0);
+    assert_equals_int(regex->suffix.len, 0);
+    assert_equals_int(byte_set_contains(&regex->first_bytes, 'a'), true);
+    assert_equals_int(byte_set_contains(&regex->first_bytes, 'x'), false);
+    assert_equals_int(byte_set_contains(&regex->last_bytes, 'd'), true);
+    assert_equals_int(byte_set_contains(&regex->last_bytes, 'y'), false);
+
+    assert_equals_int(true, regex_match(regex, "bxyxd"));
+    assert_equals_int(false, regex_match(regex, "xxyxd"));
+    assert_equals_int(false, regex_match(regex, "bxyxy"));
+
+    // Searches skip to the bytes matches may start with
+    char* text = "zzzz ac zzz bxxd zz a";
+    assert_equals_int(regex_count(regex, text, strlen(text)), 2);
+
+    Regex unfiltered = *regex;
+    memset(&unfiltered.first_bytes, 0xFF, sizeof(ByteSet));
+    assert_equals_int(regex_count(&unfiltered, text, strlen(text)), 2);
+    regex_free(regex);
+    free(regex);
+
+    // Patterns matching the empty string accept empty inputs
+    regex = regex_create("(ab)*");
+    assert_equals_int(true, regex_match(regex, ""));
+    assert_equals_int(true, regex_match(regex, "abab"));
+    assert_equals_int(false, regex_match(regex, "aba"));
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test rejecting inputs outside the length bounds of the pattern
+int test_regex_match_bounds() {
+    TEST_BEGIN;
+
+    // A zip code, optionally followed by four more digits
+    Regex* regex = regex_create("(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9)"
+                                "(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9)"
+                                "(-(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9)"
+                                "(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9))?");
+    assert_is_not_null(regex);
+    assert_equals_int(regex->min_len, 5);
+    assert_equals_int(regex->max_len, 10);
+
+    assert_equals_int(true, regex_match(regex, "12345"));
+    assert_equals_int(true, regex_match(regex, "12345-6789"));
+    assert_equals_int(false, regex_match(regex, "1234"));
+    assert_equals_int(false, regex_match(regex, "12345-67890"));
+    assert_equals_int(false, regex_match(regex, ""));
+
+    // Searches stop once the rest of the buffer is too short
+    char* text = "zip 12345, po 1234";
+    assert_equals_int(regex_count(regex, text, strlen(text)), 1);
+    assert_equals_int(regex_count(regex, "1234", 4), 0);
+    regex_free(regex);
+    free(regex);
+
+    // Repetitions make the longest match unbounded
+    regex = regex_create("ab+c?");
+    assert_equals_int(regex->min_len, 2);
+    assert_equals_int(regex->max_len, AST_UNBOUNDED);
+    assert_equals_int(false, regex_match(regex, "a"));
+    assert_equals_int(true, regex_match(regex, "abbbbbbbbbbbbbbbbbbbbbbc"));
+    regex_free(regex);
+    free(regex);
+
+    // Plain strings and alternations of them are bounded too
+    regex = regex_create("cat|horse");
+    assert_equals_int(regex->min_len, 3);
+    assert_equals_int(regex->max_len, 5);
+    assert_equals_int(false, regex_match(regex, "ca"));
+    assert_equals_int(regex_count(regex, "ca", 2), 0);
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test matching alternations of plain strings and reporting the branch
+int test_regex_match_branch() {
+    TEST_BEGIN;
+
+    // Alternations of plain strings are compiled to Aho-Corasick
+    Regex* regex = regex_create("GET|POST|PUT|DELETE|PATCH");
+    assert_is_not_null(regex->keywords);
+    assert_is_not_null(regex->exact);
+    assert_is_null(regex->nfa);
+
+    assert_equals_int(true, regex_match(regex, "PUT"));
+    assert_equals_int(false, regex_match(regex, "PU"));
+    assert_equals_int(false, regex_match(regex, "PUTS"));
+
+    assert_equals_int(0, regex_match_branch(regex, "GET"));
+    assert_equals_int(3, regex_match_branch(regex, "DELETE"));
+    assert_equals_int(4, regex_match_branch(regex, "PATCH"));
+    assert_equals_int(-1, regex_match_branch(regex, "HEAD"));
+    assert_equals_int(-1, regex_match_branch(NULL, "GET"));
+
+    char* text = "GET / POST /x PUTPATCH HEAD";
+    assert_equals_int(regex_count(regex, text, strlen(text)), 4);
+
+    char out[64];
+    size_t out_len;
+    assert_equals_int(regex_replace(regex, text, strlen(text), "_", out, sizeof(out), &out_len), 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "_ / _ /x __ HEAD");
+
+    regex_free(regex);
+    free(regex);
+
+    // Whole inputs are looked up in the perfect hash, and a repeated branch
+    // is reported as its first occurrence
+    regex = regex_create("ab|b|abc|b|(a)(b)c");
+    assert_is_not_null(regex->exact);
+    assert_equals_int(regex->exact->n_slots, 3);
+    assert_equals_int(1, regex_match_branch(regex, "b"));
+    assert_equals_int(2, regex_match_branch(regex, "abc"));
+    assert_equals_int(-1, regex_match_branch(regex, "a"));
+    assert_equals_int(true, regex_match(regex, "ab"));
+    assert_equals_int(false, regex_match(regex, "abcb"));
+    regex_free(regex);
+    free(regex);
+
+    // Branches are only reported for alternations of plain strings
+    regex = regex_create("GET|POST+");
+    assert_is_null(regex->keywords);
+    assert_is_null(regex->exact);
+    assert_equals_int(true, regex_match(regex, "POSTT"));
+    assert_equals_int(-1, regex_match_branch(regex, "GET"));
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test matching with up to a given number of edits
+int test_regex_match_approx() {
+    TEST_BEGIN;
+
+    // The position automaton is only built by the first approximate match
+    Regex* regex = regex_create("colou?r");
+    assert_is_not_null(regex);
+    assert_is_null(regex->glushkov);
+
+    assert_equals_int(1, regex_match_approx(regex, "color", 0));
+    assert_is_not_null(regex->glushkov);
+    assert_equals_int(0, regex_match_approx(regex, "colr", 0));
+    assert_equals_int(1, regex_match_approx(regex, "colr", 1));
+    assert_equals_int(1, regex_match_approx(regex, "kolour", 1));
+    assert_equals_int(0, regex_match_approx(regex, "kolr", 1));
+    assert_equals_int(1, regex_match_approx(regex, "kolr", 2));
+
+    assert_equals_int(-1, regex_match_approx(regex, "color", GLUSHKOV_MAX_ERRORS + 1));
+    assert_equals_int(-1, regex_match_approx(NULL, "color", 0));
+    assert_equals_int(-1, regex_match_approx(regex, NULL, 0));
+
+    regex_free(regex);
+    assert_is_null(regex->glushkov);
+    free(regex);
+
+    // Plain strings keep their AST to build the automaton from
+    regex = regex_create("color|colour");
+    assert_is_not_null(regex->keywords);
+    assert_equals_int(1, regex_match_approx(regex, "colr", 1));
+    assert_equals_int(0, regex_match_approx(regex, "kolr", 1));
+    regex_free(regex);
+    free(regex);
+
+    // Patterns too long for the position automaton still match exactly
+    regex = regex_create("0123456789012345678901234567890123456789012345678901234567890123");
+    assert_is_not_null(regex);
+    assert_equals_int(-1, regex_match_approx(regex, "0123", 1));
+    assert_is_null(regex->glushkov);
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test filling a match matrix of strings by patterns
+int test_regex_match_matrix() {
+    TEST_BEGIN;
+
+    // Enough regexes and inputs for several tiles in both directions
+    char* patterns[] = {"ab", "a|b", "(a|b)*c", "a+b?", "(ab)*", "c", "(a|b|c)+"};
+    Regex* regexes[70];
+    for (size_t j = 0; j < 70; j++) {
+        regexes[j] = j == 3 ? NULL : regex_create(patterns[j % 7]);
+    }
+
+    char data[600 * 8];
+    char strings[600][9];
+    size_t offsets[601] = {0};
+    unsigned int seed = 1;
+
+    for (size_t i = 0; i < 600; i++) {
+        size_t len = i % 8;
+        for (size_t k = 0; k < len; k++) {
+            seed = seed * 1103515245 + 12345;
+            strings[i][k] = "abc"[(seed >> 16) % 3];
+        }
+        strings[i][len] = '\0';
+
+        memcpy(&data[offsets[i]], strings[i], len);
+        offsets[i + 1] = offsets[i] + len;
+    }
+
+    uint64_t matrix[600 * 2], serial[600 * 2];
+    assert_equals_int(regex_match_matrix(regexes, 70, data, offsets, 600, matrix, 4), 0);
+    assert_equals_int(regex_match_matrix(regexes, 70, data, offsets, 600, serial, 1), 0);
+    assert_equals_int(memcmp(matrix, serial, sizeof(matrix)), 0);
+
+    bool agrees = true;
+    for (size_t i = 0; i < 600; i++) {
+        for (size_t j = 0; j < 70; j++) {
+            bool expected = regexes[j] != NULL && regex_match(regexes[j], strings[i]);
+            agrees = agrees && ((matrix[i * 2 + j / 64] >> (j % 64)) & 1) == expected;
+        }
+    }
+    assert_equals_int(agrees, true);
+
+    // Inputs are not NUL terminated, and may contain NUL
+    size_t nul_offsets[] = {0, 2, 5};
+    assert_equals_int(regex_match_matrix(regexes, 7, "abab\0c", nul_offsets, 2, matrix, 0), 0);
+    assert_equals_int(matrix[0], 0x51);
+    assert_equals_int(matrix[1], 0);
+
+    size_t bad_offsets[] = {0, 2, 1};
+    assert_equals_int(regex_match_matrix(regexes, 7, "abab", bad_offsets, 2, matrix, 0), -1);
+    assert_equals_int(regex_match_matrix(NULL, 7, "abab", nul_offsets, 2, matrix, 0), -1);
+    assert_equals_int(regex_match_matrix(regexes, 0, "abab", nul_offsets, 2, NULL, 0), 0);
+
+    for (size_t j = 0; j < 70; j++) {
+        regex_free(regexes[j]);
+        free(regexes[j]);
+    }
+
+    TEST_END;
+}
+
+// Test profile guided state renumbering
+int test_regex_profile() {
+    TEST_BEGIN;
+
+    char* samples[] = {"aaaaaaab", "aab", "ac", "b"};
+
+    Regex* regex = regex_create("a*(b|c)");
+    assert_is_not_null(regex);
+    assert_is_not_null(regex->dfa);
+    assert_is_not_null(regex->shuffle);
+
+    // The search automaton is only built by the first search
+    assert_is_null(regex->search_dfa);
+    assert_equals_int(regex_count(regex, "ab", 2), 1);
+    assert_is_not_null(regex->search_dfa);
+
+    // The order of the search automaton follows the anchored one
+    size_t n_states = regex->dfa->n_states;
+    size_t n_search = regex->search_dfa->n_states;
+    size_t order[16];
+
+    ssize_t result = regex_profile(regex, samples, 4, order, 16);
+    assert_equals_int(result, (ssize_t) (n_states + n_search));
+    assert_equals_int(order[0], DFA_DEAD_STATE);
+    assert_equals_int(order[n_states], DFA_DEAD_STATE);
+
+    // The state looping on `a` is visited the most, so it comes first
+    uint32_t start = regex->dfa->start_state;
+    assert_equals_int(regex->dfa->table[start * DFA_ALPHABET_SIZE + 'a'], 1);
+
+    // The shuffle masks are rebuilt from the renumbered automaton
+    assert_is_not_null(regex->shuffle);
+    assert_equals_int(true, regex_match(regex, "aaab"));
+    assert_equals_int(true, regex_match(regex, "c"));
+    assert_equals_int(false, regex_match(regex, "aa"));
+    assert_equals_int(regex_count(regex, "xaab ac b aa", 12), 3);
+
+    // The saved order can be fed back to the compiler
+    Regex ordered;
+    regex_init(&ordered, NULL);
+    result = regex_compile_with_order(&ordered, "a*(b|c)", order, n_states + n_search);
+    assert_equals_int(result, 0);
+    assert_equals_int(ordered.dfa->start_state, regex->dfa->start_state);
+    assert_equals_int(memcmp(ordered.dfa->table, regex->dfa->table,
+                             sizeof(uint32_t) * DFA_ALPHABET_SIZE * n_states), 0);
+    assert_equals_int(ordered.search_dfa->start_state, regex->search_dfa->start_state);
+    assert_equals_int(memcmp(ordered.search_dfa->table, regex->search_dfa->table,
+                             sizeof(uint32_t) * DFA_ALPHABET_SIZE * n_search), 0);
+    assert_equals_int(true, regex_match(&ordered, "ac"));
+    assert_equals_int(regex_count(&ordered, "xaab ac b aa", 12), 3);
+    regex_free(&ordered);
+
+    // An order of the anchored automaton alone is still accepted
+    regex_init(&ordered, NULL);
+    result = regex_compile_with_order(&ordered, "a*(b|c)", order, n_states);
+    assert_equals_int(result, 0);
+    assert_equals_int(ordered.dfa->start_state, regex->dfa->start_state);
+    regex_free(&ordered);
+
+    // Orders that do not fit the pattern are rejected
+    result = regex_compile_with_order(&ordered, "a*", order, n_states);
+    assert_equals_int(result, -1);
+    assert_is_null(ordered.dfa);
+
+    regex_free(regex);
+    free(regex);
+
+    // Samples mostly made of the second branch move the state looping on
+    // `c` in the search automaton ahead of the one looping on `a`
+    char* skewed[] = {"cccd cd xcccccd", "ab ccd"};
+    regex = regex_create("a+b|c+d");
+    assert_equals_int(regex_count(regex, "ab", 2), 1);
+    uint32_t on_a = regex->search_dfa->table['a'];
+    assert_equals_int(on_a < regex->search_dfa->table['c'], true);
+
+    result = regex_profile(regex, skewed, 2, order, 16);
+    assert_equals_int(result > 0, true);
+    assert_equals_int(regex->search_dfa->table['c'], on_a);
+    assert_equals_int(regex->search_dfa->table['a'] > on_a, true);
+    assert_equals_int(regex_count(regex, "xaab cd ccd aa", 14), 3);
+
+    // Invalid input
+    assert_equals_int(regex_profile(NULL, samples, 4, NULL, 0), -1);
+    assert_equals_int(regex_profile(regex, NULL, 4, NULL, 0), -1);
+
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test counting matches
+int test_regex_count() {
+    TEST_BEGIN;
+
+    char* text = "ERROR: disk, WARN: fan, ERROR: cpu, ERRORS: 2";
+
+    Regex* regex = regex_create("ERROR|WARNI*");
+    assert_equals_int(regex_count(regex, text, strlen(text)), 4);
+    assert_is_not_null(regex->search_dfa);
+
+    // Count the same matches with the NFA. The copy is made after the first
+    // search, so it does not build a search automaton of its own
+    Regex fallback = *regex;
+    fallback.search_dfa = NULL;
+    assert_equals_int(regex_count(&fallback, text, strlen(text)), 4);
+
+    // Only the given length is searched
+    assert_equals_int(regex_count(regex, text, 5), 1);
+    assert_equals_int(regex_count(regex, text, 4), 0);
+    assert_equals_int(regex_count(&fallback, text, 5), 1);
+
+    regex_free(regex);
+    free(regex);
+
+    // Matches are counted as soon as they end
+    regex = regex_create("a+");
+    assert_equals_int(regex_count(regex, "aaa", 3), 3);
+    fallback = *regex;
+    fallback.search_dfa = NULL;
+    assert_equals_int(regex_count(&fallback, "aaa", 3), 3);
+    assert_equals_int(regex_count(regex, "bab\0aa", 7), 3);
+    assert_equals_int(regex_count(&fallback, "bab\0aa", 7), 3);
+
+    // Unlike counting, replacing and splitting take the longest match, so
+    // "aaa" holds a single one
+    char pinned[8];
+    size_t pinned_len;
+    RegexSlice pinned_fields[4];
+    assert_equals_int(regex_replace(regex, "aaa", 3, "x", pinned, sizeof(pinned), &pinned_len), 0);
+    assert_equals_int(pinned_len, 1);
+    assert_equals_int(pinned[0], 'x');
+    assert_equals_int(regex_split(regex, "aaa", 3, pinned_fields, 4), 2);
+    assert_equals_int(pinned_fields[0].length, 0);
+    assert_equals_int(pinned_fields[1].offset, 3);
+    regex_free(regex);
+    free(regex);
+
+    // Matches do not overlap, and empty matches are not counted
+    regex = regex_create("aba|b*");
+    assert_equals_int(regex_count(regex, "ababa", 5), 2);
+    fallback = *regex;
+    fallback.search_dfa = NULL;
+    assert_equals_int(regex_count(&fallback, "ababa", 5), 2);
+    assert_equals_int(regex_count(regex, "", 0), 0);
+    assert_equals_int(regex_count(&fallback, "", 0), 0);
+
+    regex_free(regex);
+    free(regex);
+
+    // Only positions where the literal prefix occurs are searched from
+    text = "GET /index GET /apiv3 GET /apiv1 GET /apiv2 GET /apv1";
+    regex = regex_create("GET /api(v1|v2)");
+    assert_equals_int(regex->prefix.len, 9);
+    assert_equals_int(regex_count(regex, text, strlen(text)), 2);
+
+    Regex unfiltered = *regex;
+    unfiltered.prefix.len = 0;
+    assert_equals_int(regex_count(&unfiltered, text, strlen(text)), 2);
+
+    fallback = *regex;
+    fallback.search_dfa = NULL;
+    assert_equals_int(regex_count(&fallback, text, strlen(text)), 2);
+
+    // Matches starting with one of a few strings are found by scanning for
+    // all of them at once
+    regex_free(regex);
+    free(regex);
+    text = "info: ok; WARN: disk; info: ok; ERROR: fan; ERR: x";
+    regex = regex_create("(ERROR|WARN): (a|b|c|d|e|f|i|k|n|s)+");
+    assert_equals_int(regex->prefix.len, 0);
+    assert_is_not_null(regex->start_scanner);
+    assert_equals_int(regex_count(regex, text, strlen(text)), 2);
+
+    unfiltered = *regex;
+    unfiltered.start_scanner = NULL;
+    assert_equals_int(regex_count(&unfiltered, text, strlen(text)), 2);
+
+    // Matches ending with a fixed string are found from where it occurs,
+    // running the reversed automaton backwards to find where they start
+    regex_free(regex);
+    free(regex);
+    text = "to abc-example-com and ba-example-org, -example-com cab-example-com";
+    regex = regex_create("(a|b|c)+-example-com");
+    assert_equals_int(regex->prefix.len, 0);
+    assert_equals_int(regex->suffix.len, 12);
+    assert_equals_int(regex_count(regex, text, strlen(text)), 2);
+
+    char out[128];
+    size_t out_len;
+    assert_equals_int(regex_replace(regex, text, strlen(text), "<host>", out, sizeof(out), &out_len), 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "to <host> and ba-example-org, -example-com <host>");
+
+    unfiltered = *regex;
+    unfiltered.suffix.len = 0;
+    assert_equals_int(regex_count(&unfiltered, text, strlen(text)), 2);
+
+    // Backward scans that would overlap fall back to scanning forwards
+    text = "aa-example-com-example-comb-example-com";
+    assert_equals_int(regex_replace(regex, text, strlen(text), "<host>", out, sizeof(out), &out_len), 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "<host>-example-com<host>");
+
+    // Buffers without the required string have no matches
+    regex_free(regex);
+    free(regex);
+    regex = regex_create("(x|y)*ERROR");
+    assert_equals_int(regex->required.n, 1);
+    assert_equals_int(regex_count(regex, "xyxy ERRO xy", 12), 0);
+    assert_equals_int(regex_count(regex, "xyxy ERROR xy", 13), 1);
+
+    // Occurrences of the prefix may overlap the match before them
+    regex_free(regex);
+    free(regex);
+    regex = regex_create("aab");
+    assert_equals_int(regex_count(regex, "aaab aab aaaab", 14), 3);
+    assert_equals_int(regex_count(regex, "aaa", 3), 0);
+
+    // Invalid input
+    assert_equals_int(regex_count(NULL, "a", 1), -1);
+    assert_equals_int(regex_count(regex, NULL, 1), -1);
+
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test replacing matches
+int test_regex_replace() {
+    TEST_BEGIN;
+
+    char* text = "user=bob; pass=hunter2; user=al";
+    char out[64];
+    size_t out_len;
+
+    // The reversed automaton is only built once a match needs its start
+    Regex* regex = regex_create("pass=(e|h|n|r|t|u)+(0|1|2)");
+    assert_is_null(regex->reverse_dfa);
+    int result = regex_replace(regex, text, strlen(text), "pass=*", out, sizeof(out), &out_len);
+    assert_equals_int(result, 0);
+    assert_is_not_null(regex->reverse_dfa);
+    out[out_len] = '\0';
+    assert_equals_str(out, "user=bob; pass=*; user=al");
+
+    // Find the same matches with the NFAs. The NFA of the reversed pattern
+    // is borrowed from a regex compiled from the reversed pattern string
+    Regex* reversed = regex_create("(0|1|2)(e|h|n|r|t|u)+=ssap");
+    Regex fallback = *regex;
+    fallback.search_dfa = NULL;
+    fallback.reverse_dfa = NULL;
+    fallback.reverse_nfa = reversed->nfa;
+
+    result = regex_replace(&fallback, text, strlen(text), "pass=*", out, sizeof(out), &out_len);
+    assert_equals_int(result, 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "user=bob; pass=*; user=al");
+
+    regex_free(reversed);
+    free(reversed);
+    regex_free(regex);
+    free(regex);
+
+    regex = regex_create("(b|c)o(b|d)");
+    text = "bob cod bod bo";
+
+    result = regex_replace(regex, text, strlen(text), "<>", out, sizeof(out), &out_len);
+    assert_equals_int(result, 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "<> <> <> bo");
+
+    // Matches can be deleted
+    result = regex_replace(regex, text, strlen(text), "", out, sizeof(out), &out_len);
+    assert_equals_int(result, 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "   bo");
+
+    // Without room for the result, the required size is reported
+    result = regex_replace(regex, text, strlen(text), "<>", NULL, 0, &out_len);
+    assert_equals_int(result, 1);
+    assert_equals_int(out_len, 11);
+
+    memset(out, 0, sizeof(out));
+    result = regex_replace(regex, text, strlen(text), "<>", out, 4, &out_len);
+    assert_equals_int(result, 1);
+    assert_equals_int(out_len, 11);
+    assert_equals_str(out, "<> <");
+
+    // Exactly enough room
+    result = regex_replace(regex, text, strlen(text), "<>", out, 11, &out_len);
+    assert_equals_int(result, 0);
+    assert_equals_int(out_len, 11);
+
+    regex_free(regex);
+    free(regex);
+
+    // Matches extend as far as they can
+    regex = regex_create("a+");
+    result = regex_replace(regex, "baaab aa", 8, "X", out, sizeof(out), &out_len);
+    assert_equals_int(result, 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "bXb X");
+
+    // Invalid input
+    assert_equals_int(regex_replace(NULL, text, 1, "", out, 1, &out_len), -1);
+    assert_equals_int(regex_replace(regex, NULL, 1, "", out, 1, &out_len), -1);
+    assert_equals_int(regex_replace(regex, text, 1, NULL, out, 1, &out_len), -1);
+    assert_equals_int(regex_replace(regex, text, 1, "", NULL, 1, &out_len), -1);
+    assert_equals_int(regex_replace(regex, text, 1, "", out, 1, NULL), -1);
+
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Collects fields for test_regex_split, stopping after the third one
+int collect_slice(RegexSlice slice, void* ctx) {
+    RegexSlice* slices = ctx;
+    size_t i = 0;
+    while (slices[i].length != (size_t) -1) {
+        i++;
+    }
+    slices[i] = slice;
+    slices[i + 1].length = (size_t) -1;
+    return i == 2;
+}
+
+// Test splitting on matches
+int test_regex_split() {
+    TEST_BEGIN;
+
+    char* line = "a, b,,  c ,d";
+    RegexSlice slices[8];
+
+    Regex* regex = regex_create(" *, *");
+
+    ssize_t n = regex_split(regex, line, strlen(line), slices, 8);
+    assert_equals_int(n, 5);
+
+    char* expected[] = {"a", "b", "", "c", "d"};
+    for (int i = 0; i < 5; i++) {
+        assert_equals_int(slices[i].length, strlen(expected[i]));
+        assert_equals_int(strncmp(&line[slices[i].offset], expected[i], slices[i].length), 0);
+    }
+
+    // Slices point into the original buffer
+    assert_equals_int(slices[1].offset, 3);
+    assert_equals_int(slices[4].offset, 11);
+
+    // Fields that do not fit are still counted
+    n = regex_split(regex, line, strlen(line), slices, 2);
+    assert_equals_int(n, 5);
+    n = regex_split(regex, line, strlen(line), NULL, 0);
+    assert_equals_int(n, 5);
+
+    // Without separators, the whole buffer is a field
+    n = regex_split(regex, "abc", 3, slices, 8);
+    assert_equals_int(n, 1);
+    assert_equals_int(slices[0].offset, 0);
+    assert_equals_int(slices[0].length, 3);
+
+    n = regex_split(regex, "", 0, slices, 8);
+    assert_equals_int(n, 1);
+    assert_equals_int(slices[0].length, 0);
+
+    n = regex_split(regex, ",", 1, slices, 8);
+    assert_equals_int(n, 2);
+
+    // The callback can stop the split early
+    slices[0].length = (size_t) -1;
+    n = regex_split_each(regex, line, strlen(line), collect_slice, slices);
+    assert_equals_int(n, 3);
+    assert_equals_int(slices[2].length, 0);
+    assert_equals_int(slices[3].length, (size_t) -1);
+
+    // Invalid input
+    assert_equals_int(regex_split(NULL, line, 1, slices, 8), -1);
+    assert_equals_int(regex_split(regex, NULL, 1, slices, 8), -1);
+    assert_equals_int(regex_split(regex, line, 1, NULL, 8), -1);
+    assert_equals_int(regex_split_each(regex, line, 1, NULL, NULL), -1);
+
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+// Test matching sorted keyword lists through a minimal DAWG
+int test_regex_compile_dictionary() {
+    TEST_BEGIN;
+
+    char* keywords[] = {"cat", "cats", "dog", "dogs", "do"};
+    char* sorted[] = {"cat", "cats", "do", "dog", "dogs"};
+    Regex* alternation = regex_create("cat|cats|dog|dogs|do");
+    Regex regex = {.is_compiled = false};
+    assert_equals_int(regex_compile_dictionary(&regex, dawg_create(sorted, 5)), 0);
+    assert_is_null(regex.pattern);
+    assert_equals_int(regex.min_len, 2);
+    assert_equals_int(regex.max_len, 4);
+
+    for (size_t i = 0; i < 5; i++) {
+        assert_equals_int(regex_match(&regex, keywords[i]), true);
+    }
+    assert_equals_int(regex_match(&regex, "ca"), false);
+    assert_equals_int(regex_match(&regex, "dogss"), false);
+
+    // Searching finds the same matches as the alternation
+    char* text = "hotdogs, cats and a dodo";
+    assert_equals_int(regex_count(&regex, text, strlen(text)), 4);
+    assert_equals_int(regex_count(alternation, text, strlen(text)), 4);
+
+    char out[64];
+    size_t out_len;
+    assert_equals_int(regex_replace(&regex, text, strlen(text), "*", out, sizeof(out), &out_len), 0);
+    out[out_len] = '\0';
+    assert_equals_str(out, "hot*, * and a **");
+
+    assert_equals_int(regex_compile_dictionary(&regex, NULL), -1);
+
+    regex_free(&regex);
+    regex_free(alternation);
+    free(alternation);
+
+    TEST_END;
+}
+
+// Test finding patterns subsumed by or equivalent to others
+int test_regex_prune() {
+    TEST_BEGIN;
+
+    char* patterns[] = {"GET /api/v1/users/(0|1|2)+", "GET /api/v1/users/1",
+                        "GET /api/(v1|v2)/users/(0|1|2)*", "POST /login", "POST /login",
+                        "(POST|PUT) /login", "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"};
+    size_t n = sizeof(patterns) / sizeof(patterns[0]);
+    Regex* regexes[8];
+    for (size_t i = 0; i < n; i++) {
+        regexes[i] = regex_create(patterns[i]);
+    }
+    regexes[n] = NULL;
+
+    assert_equals_int(regex_is_subset(regexes[1], regexes[0]), 1);
+    assert_equals_int(regex_is_subset(regexes[0], regexes[1]), 0);
+    assert_equals_int(regex_is_subset(regexes[0], regexes[2]), 1);
+    assert_equals_int(regex_is_equivalent(regexes[3], regexes[4]), 1);
+    assert_equals_int(regex_is_equivalent(regexes[3], regexes[5]), 0);
+
+    // Regexes without an anchored DFA cannot be compared
+    assert_is_null(regexes[6]->dfa);
+    assert_equals_int(regex_is_subset(regexes[6], regexes[6]), -1);
+    assert_equals_int(regex_is_equivalent(regexes[0], regexes[6]), -1);
+
+    // Only the broadest regexes are needed, and they are kept in order
+    bool keep[8];
+    assert_equals_int(regex_prune(regexes, n + 1, keep), 3);
+    assert_equals_int(keep[0], false);
+    assert_equals_int(keep[1], false);
+    assert_equals_int(keep[2], true);
+    assert_equals_int(keep[3], false);
+    assert_equals_int(keep[4], false);
+    assert_equals_int(keep[5], true);
+    assert_equals_int(keep[6], true);
+    assert_equals_int(keep[7], false);
+
+    // Of equivalent regexes, the first is kept
+    assert_equals_int(regex_prune(&regexes[3], 2, keep), 1);
+    assert_equals_int(keep[0], true);
+    assert_equals_int(keep[1], false);
+
+    assert_equals_int(regex_prune(NULL, 1, keep), -1);
+    assert_equals_int(regex_prune(NULL, 0, NULL), 0);
+
+    for (size_t i = 0; i < n; i++) {
+        regex_free(regexes[i]);
+        free(regexes[i]);
+    }
+
+    TEST_END;
+}
+
 // Test regex freeing
 int test_regex_free() {
     TEST_BEGIN;
 
     Regex* regex = regex_create("a|b");
     assert_is_not_null(regex);
-    assert_is_not_null(regex->nfa);
+    assert_is_not_null(regex->keywords);
 
     regex_free(regex);
+    assert_is_null(regex->keywords);
     free(regex);
 
     // Test freeing NULL regex
@@ -138,6 +982,19 @@ Test tests[] = {
     {.name="test_regex_create_and_init", .func=test_regex_create_and_init},
     {.name="test_regex_compile", .func=test_regex_compile},
     {.name="test_regex_match", .func=test_regex_match},
+    {.name="test_regex_compile_all", .func=test_regex_compile_all},
+    {.name="test_regex_match_literal", .func=test_regex_match_literal},
+    {.name="test_regex_match_edges", .func=test_regex_match_edges},
+    {.name="test_regex_match_bounds", .func=test_regex_match_bounds},
+    {.name="test_regex_match_branch", .func=test_regex_match_branch},
+    {.name="test_regex_match_approx", .func=test_regex_match_approx},
+    {.name="test_regex_match_matrix", .func=test_regex_match_matrix},
+    {.name="test_regex_profile", .func=test_regex_profile},
+    {.name="test_regex_count", .func=test_regex_count},
+    {.name="test_regex_replace", .func=test_regex_replace},
+    {.name="test_regex_split", .func=test_regex_split},
+    {.name="test_regex_compile_dictionary", .func=test_regex_compile_dictionary},
+    {.name="test_regex_prune", .func=test_regex_prune},
     {.name="test_regex_free", .func=test_regex_free},
     {.name=NULL},
 };
@@ -0,0 +1,132 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "regex_handle.h"
+
+int test_regex_handle_swap() {
+    TEST_BEGIN;
+
+    RegexHandle handle;
+    assert_equals_int(regex_handle_init(&handle, regex_create("a+")), 0);
+
+    RegexReader* reader = regex_reader_register(&handle);
+    assert_is_not_null(reader);
+
+    // The regex loaded stays valid until the read section ends
+    Regex* regex = regex_reader_enter(&handle, reader);
+    assert_is_not_null(regex);
+    assert_equals_int(regex_match(regex, "aaa"), true);
+
+    assert_equals_int(regex_handle_swap(&handle, regex_create("b+")), 1);
+    assert_equals_int(regex_match(regex, "aaa"), true);
+    assert_equals_int(regex_handle_reclaim(&handle), 1);
+
+    regex_reader_exit(reader);
+    assert_equals_int(regex_handle_reclaim(&handle), 0);
+
+    // Read sections entered after the swap see the new regex
+    regex = regex_reader_enter(&handle, reader);
+    assert_equals_int(regex_match(regex, "bbb"), true);
+    assert_equals_int(regex_match(regex, "aaa"), false);
+    regex_reader_exit(reader);
+
+    // Without readers in a read section, the old regex goes right away
+    assert_equals_int(regex_handle_swap(&handle, NULL), 0);
+    assert_is_null(regex_reader_enter(&handle, reader));
+    regex_reader_exit(reader);
+
+    // Readers given up are reused
+    regex_reader_unregister(reader);
+    assert_equals_ptr(regex_reader_register(&handle), reader, RegexReader*);
+    RegexReader* other = regex_reader_register(&handle);
+    assert_is_not_null(other);
+    assert_equals_int(other != reader, true);
+
+    assert_equals_int(regex_handle_swap(NULL, NULL), -1);
+    assert_equals_int(regex_handle_reclaim(NULL), -1);
+    assert_is_null(regex_reader_enter(NULL, reader));
+
+    regex_handle_free(&handle);
+
+    TEST_END;
+}
+
+#define N_READERS 4
+#define N_SWAPS 200
+
+typedef struct Stress {
+    RegexHandle* handle;
+    atomic_bool* done;
+    bool agreed;
+} Stress;
+
+// Match batches through the handle until the writer is done. Every regex
+// swapped in matches "ab" and not "ba", so a regex released too early
+// shows up as a wrong answer, or as a use after free.
+static void* read_batches(void* arg) {
+    Stress* stress = arg;
+    RegexReader* reader = regex_reader_register(stress->handle);
+    stress->agreed = reader != NULL;
+
+    while (reader != NULL && !atomic_load(stress->done)) {
+        Regex* regex = regex_reader_enter(stress->handle, reader);
+        for (int i = 0; i < 16; i++) {
+            stress->agreed = stress->agreed && regex_match(regex, "ab") && !regex_match(regex, "ba");
+        }
+        regex_reader_exit(reader);
+    }
+
+    regex_reader_unregister(reader);
+    return NULL;
+}
+
+int test_regex_handle_concurrent() {
+    TEST_BEGIN;
+
+    char* patterns[] = {"ab", "a+b", "(a|c)b", "ab*", "a?b+"};
+    RegexHandle handle;
+    assert_equals_int(regex_handle_init(&handle, regex_create(patterns[0])), 0);
+
+    atomic_bool done;
+    atomic_init(&done, false);
+
+    Stress stress[N_READERS];
+    pthread_t threads[N_READERS];
+    for (size_t i = 0; i < N_READERS; i++) {
+        stress[i] = (Stress) {.handle = &handle, .done = &done, .agreed = false};
+        assert_equals_int(pthread_create(&threads[i], NULL, read_batches, &stress[i]), 0);
+    }
+
+    bool swapped = true;
+    for (size_t i = 1; i <= N_SWAPS; i++) {
+        swapped = swapped && regex_handle_swap(&handle, regex_create(patterns[i % 5])) >= 0;
+    }
+
+    atomic_store(&done, true);
+    for (size_t i = 0; i < N_READERS; i++) {
+        pthread_join(threads[i], NULL);
+        assert_equals_int(stress[i].agreed, true);
+    }
+    assert_equals_int(swapped, true);
+
+    // Once every reader has left, nothing is kept back
+    assert_equals_int(regex_handle_reclaim(&handle), 0);
+
+    regex_handle_free(&handle);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_regex_handle_swap", .func=test_regex_handle_swap},
+    {.name="test_regex_handle_concurrent", .func=test_regex_handle_concurrent},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,374 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "regex.h"
+
+#define DIGIT "(0|1|2|3|4|5|6|7|8|9)"
+
+#define N_MATCH_THREADS 4
+#define N_THREAD_STRINGS 8
+
+// Whether the set reports exactly the patterns that match on their own
+bool agrees(RegexSet* set, char** patterns, char* string) {
+    uint64_t matched[REGEX_SET_WORDS(64)];
+    ssize_t count = regex_set_match(set, string, strlen(string), matched);
+    ssize_t expected = 0;
+
+    for (size_t i = 0; i < set->n_patterns; i++) {
+        // Removed patterns match nothing
+        if (patterns[i] == NULL) {
+            if ((matched[i / 64] >> (i % 64)) & 1) {
+                return false;
+            }
+            continue;
+        }
+
+        Regex* regex = regex_create(patterns[i]);
+        bool match = regex_match(regex, string);
+        regex_free(regex);
+        free(regex);
+
+        if (match != ((matched[i / 64] >> (i % 64)) & 1)) {
+            return false;
+        }
+        expected += match;
+    }
+
+    return count == expected;
+}
+
+int test_regex_set_match() {
+    TEST_BEGIN;
+
+    char* patterns[] = {"/api/v1/users/" DIGIT "+", "/api/v1/users/(" DIGIT "|m|e)*",
+                        "/api/v2/x*", "/static/(a|b)*.css", "(/|a|p|i|v|1|u|s|e|r|m)*",
+                        "/api/v1/users/me", "/api/v1/users/me"};
+    RegexSet* set = regex_set_create(patterns, 7);
+    assert_is_not_null(set);
+    assert_is_not_null(set->dfa);
+    assert_equals_int(set->dfa->accept_words, 1);
+
+    uint64_t matched[1];
+    assert_equals_int(regex_set_match(set, "/api/v1/users/42", 16, matched), 2);
+    assert_equals_int(matched[0], 0x3);
+
+    assert_equals_int(regex_set_match(set, "/api/v1/users/me", 16, matched), 4);
+    assert_equals_int(matched[0], 0x72);
+
+    assert_equals_int(regex_set_match(set, "/static/ab.css", 14, matched), 1);
+    assert_equals_int(matched[0], 0x8);
+
+    assert_equals_int(regex_set_match(set, "", 0, matched), 1);
+    assert_equals_int(matched[0], 0x10);
+
+    // Bytes no pattern has transitions on match nothing
+    assert_equals_int(regex_set_match(set, "/api/v2/\n", 9, matched), 0);
+    assert_equals_int(matched[0], 0);
+
+    char* strings[] = {"/api/v1/users/", "/api/v2/x", "/api/v1/users/12a", "/static/.css",
+                       "/static/a.cs", "api/v1/users/me", "/api/v1/users/m1e"};
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        assert_equals_int(agrees(set, patterns, strings[i]), true);
+    }
+
+    assert_equals_int(regex_set_match(NULL, "", 0, matched), -1);
+    assert_equals_int(regex_set_match(set, NULL, 0, matched), -1);
+    assert_equals_int(regex_set_match(set, "", 0, NULL), -1);
+
+    regex_set_free(set);
+    free(set);
+
+    // Invalid patterns make the whole set invalid
+    char* invalid[] = {"abc", "(abc"};
+    assert_is_null(regex_set_create(invalid, 2));
+
+    // An empty set matches nothing
+    set = regex_set_create(NULL, 0);
+    assert_is_not_null(set);
+    assert_equals_int(regex_set_match(set, "abc", 3, matched), 0);
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+int test_regex_set_many() {
+    TEST_BEGIN;
+
+    // Bits past the first word are reported
+    char* patterns[130];
+    char storage[130][16];
+    for (size_t i = 0; i < 130; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "k%zu(x)*", i);
+        patterns[i] = storage[i];
+    }
+
+    RegexSet* set = regex_set_create(patterns, 130);
+    assert_is_not_null(set);
+
+    uint64_t matched[REGEX_SET_WORDS(130)];
+    assert_equals_int(REGEX_SET_WORDS(130), 3);
+    assert_equals_int(regex_set_match(set, "k129xx", 6, matched), 1);
+    assert_equals_int(matched[0], 0);
+    assert_equals_int(matched[1], 0);
+    assert_equals_int(matched[2], 2);
+
+    assert_equals_int(regex_set_match(set, "k64", 3, matched), 1);
+    assert_equals_int(matched[1], 1);
+
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+int test_regex_set_without_dfa() {
+    TEST_BEGIN;
+
+    // The last pattern needs more than DFA_MAX_STATES states, so the
+    // combined NFA is simulated instead
+    char* patterns[] = {"(a|b)*a", "ab*", "b+", "a?", "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"};
+    RegexSet* set = regex_set_create(patterns, 5);
+    assert_is_not_null(set);
+    assert_is_null(set->dfa);
+
+    uint64_t matched[1];
+    assert_equals_int(regex_set_match(set, "abbbbbbbbbbbb", 13, matched), 2);
+    assert_equals_int(matched[0], 0x12);
+
+    assert_equals_int(regex_set_match(set, "", 0, matched), 1);
+    assert_equals_int(matched[0], 0x8);
+
+    char* strings[] = {"", "a", "b", "ab", "ba", "bbb", "abab", "aaaaaaaaaaaaa", "bbbbbbbbbbbbba",
+                       "c", "abc"};
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        assert_equals_int(agrees(set, patterns, strings[i]), true);
+    }
+
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+typedef struct SetMatcher {
+    const RegexSet* set;
+    char** strings;
+    const uint64_t* expected;
+    bool agreed;
+} SetMatcher;
+
+// Match every string many times over, with scratch space of this thread's own
+static void* match_strings(void* arg) {
+    SetMatcher* matcher = arg;
+    RegexSetScratch scratch;
+    regex_set_scratch_init(&scratch);
+    matcher->agreed = true;
+
+    for (int round = 0; round < 200; round++) {
+        for (size_t i = 0; i < N_THREAD_STRINGS; i++) {
+            uint64_t matched[1];
+            char* string = matcher->strings[i];
+            matcher->agreed = matcher->agreed
+                && regex_set_match_with(matcher->set, &scratch, string, strlen(string), matched) >= 0
+                && matched[0] == matcher->expected[i];
+        }
+    }
+
+    // The scratch space is left clear for the next match
+    for (size_t w = 0; w < (scratch.capacity + 63) / 64; w++) {
+        matcher->agreed = matcher->agreed && scratch.seen[w] == 0;
+    }
+
+    regex_set_scratch_free(&scratch);
+    return NULL;
+}
+
+int test_regex_set_threads() {
+    TEST_BEGIN;
+
+    // Without a DFA, every pattern is simulated, from several threads at once
+    char* patterns[] = {"(a|b)*a", "ab*", "b+", "a?", "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"};
+    const RegexSet* set = regex_set_create(patterns, 5);
+    assert_is_not_null(set);
+    assert_is_null(set->dfa);
+
+    char* strings[N_THREAD_STRINGS] = {"", "a", "b", "ab", "abbb", "bbbbbbbbbbbbba", "abababababababab", "c"};
+    uint64_t expected[N_THREAD_STRINGS];
+    for (size_t i = 0; i < N_THREAD_STRINGS; i++) {
+        assert_equals_int(regex_set_match(set, strings[i], strlen(strings[i]), &expected[i]) >= 0, true);
+    }
+
+    SetMatcher matchers[N_MATCH_THREADS];
+    pthread_t threads[N_MATCH_THREADS];
+    for (size_t i = 0; i < N_MATCH_THREADS; i++) {
+        matchers[i] = (SetMatcher) {.set = set, .strings = strings, .expected = expected, .agreed = false};
+        assert_equals_int(pthread_create(&threads[i], NULL, match_strings, &matchers[i]), 0);
+    }
+    for (size_t i = 0; i < N_MATCH_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        assert_equals_int(matchers[i].agreed, true);
+    }
+
+    // Scratch space is required
+    uint64_t matched[1];
+    assert_equals_int(regex_set_match_with(set, NULL, "a", 1, matched), -1);
+
+    regex_set_free((RegexSet*) set);
+    free((RegexSet*) set);
+
+    TEST_END;
+}
+
+int test_regex_set_update() {
+    TEST_BEGIN;
+
+    char* patterns[8] = {"ab*", "(a|b)+", "b*"};
+    RegexSet* set = regex_set_create(patterns, 3);
+    assert_is_not_null(set);
+    assert_is_not_null(set->dfa);
+    DFA* dfa = set->dfa;
+
+    // Small updates keep the DFA, and simulate the new patterns next to it
+    assert_equals_int(regex_set_add(set, "a(a|b)a"), 3);
+    patterns[3] = "a(a|b)a";
+    assert_equals_ptr(set->dfa, dfa, DFA*);
+    assert_equals_int(set->pending[0], 0x8);
+
+    uint64_t matched[1];
+    assert_equals_int(regex_set_match(set, "aba", 3, matched), 2);
+    assert_equals_int(matched[0], 0xA);
+
+    // Removed patterns are masked out of what the DFA reports
+    assert_equals_int(regex_set_remove(set, 1), 0);
+    patterns[1] = NULL;
+    assert_equals_ptr(set->dfa, dfa, DFA*);
+    assert_equals_int(set->covered[0], 0x5);
+    assert_equals_int(regex_set_match(set, "aba", 3, matched), 1);
+    assert_equals_int(matched[0], 0x8);
+
+    assert_equals_int(regex_set_remove(set, 1), -1);
+    assert_equals_int(regex_set_remove(set, 8), -1);
+
+    // The id of a removed pattern is reused
+    assert_equals_int(regex_set_add(set, "ba"), 1);
+    patterns[1] = "ba";
+    assert_equals_int(regex_set_add(set, "(ab"), -1);
+    assert_equals_int(set->n_live, 4);
+
+    char* strings[] = {"", "a", "b", "ab", "ba", "abb", "aba", "aaa", "bbb", "c"};
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        assert_equals_int(agrees(set, patterns, strings[i]), true);
+    }
+
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+int test_regex_set_churn() {
+    TEST_BEGIN;
+
+    // Patterns are added and removed one at a time, starting from nothing
+    char* patterns[64] = {NULL};
+    char storage[64][32];
+    RegexSet* set = regex_set_create(NULL, 0);
+    assert_is_not_null(set);
+    assert_is_null(set->dfa);
+
+    size_t rebuilds = 0;
+
+    for (size_t round = 0; round < 200; round++) {
+        size_t i = round * 7 % 64;
+
+        if (patterns[i] != NULL) {
+            assert_equals_int(regex_set_remove(set, i), 0);
+            patterns[i] = NULL;
+        } else {
+            // Ids are reused, so a free one may differ from `i`
+            snprintf(storage[i], sizeof(storage[i]), "(a|b)*a%zub*", round);
+            ssize_t id = regex_set_add(set, storage[i]);
+            assert_equals_int(id >= 0, true);
+            if ((size_t) id != i) {
+                memcpy(storage[id], storage[i], sizeof(storage[i]));
+            }
+            patterns[id] = storage[id];
+        }
+
+        // Every update adds to the churn, which only a rebuild resets. A new
+        // DFA may reuse the address of the one it replaces.
+        rebuilds += set->churn == 0;
+
+        // Retired blocks never make up most of the states
+        assert_equals_int(set->retired_states * 2 <= set->n_states, true);
+    }
+
+    // The DFA is rebuilt now and then, not after every update
+    assert_equals_int(rebuilds > 1 && rebuilds < 20, true);
+
+    char* strings[] = {"", "a", "aba17", "a0", "ba3bb", "a63b", "aa99", "a199"};
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        assert_equals_int(agrees(set, patterns, strings[i]), true);
+    }
+
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+int test_regex_set_exact() {
+    TEST_BEGIN;
+
+    // Sets of plain strings are hashed rather than determinized
+    char* patterns[8] = {"/health", "/login", "/logout", "/login", "/static/app.css"};
+    RegexSet* set = regex_set_create(patterns, 5);
+    assert_is_not_null(set);
+    assert_is_not_null(set->exact);
+    assert_is_null(set->dfa);
+
+    uint64_t matched[1];
+    assert_equals_int(regex_set_match(set, "/login", 6, matched), 2);
+    assert_equals_int(matched[0], 0xA);
+    assert_equals_int(regex_set_match(set, "/log", 4, matched), 0);
+    assert_equals_int(matched[0], 0);
+
+    // Removed strings are masked out, and added patterns simulated
+    assert_equals_int(regex_set_remove(set, 1), 0);
+    patterns[1] = NULL;
+    assert_equals_int(regex_set_add(set, "/user/(0|1)+"), 1);
+    patterns[1] = "/user/(0|1)+";
+    assert_is_not_null(set->exact);
+
+    char* strings[] = {"", "/health", "/login", "/logout", "/static/app.css", "/user/01",
+                       "/user/", "/static/app.cs"};
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        assert_equals_int(agrees(set, patterns, strings[i]), true);
+    }
+
+    regex_set_free(set);
+    free(set);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_regex_set_match", .func=test_regex_set_match},
+    {.name="test_regex_set_many", .func=test_regex_set_many},
+    {.name="test_regex_set_without_dfa", .func=test_regex_set_without_dfa},
+    {.name="test_regex_set_threads", .func=test_regex_set_threads},
+    {.name="test_regex_set_update", .func=test_regex_set_update},
+    {.name="test_regex_set_churn", .func=test_regex_set_churn},
+    {.name="test_regex_set_exact", .func=test_regex_set_exact},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,91 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "regex.h"
+
+#define SHUFFLE_MATCH(s) shuffle_dfa_match(shuffle, (s), strlen((s)))
+
+int test_shuffle_dfa_create() {
+    TEST_BEGIN;
+
+    Regex* regex = regex_create("(0|1|2|3)+-(a|b)?");
+    assert_is_not_null(regex->dfa);
+
+    ShuffleDFA* shuffle = shuffle_dfa_create(regex->dfa);
+    assert_is_not_null(shuffle);
+    assert_equals_int(shuffle->start_state, regex->dfa->start_state);
+
+    // Every lane agrees with the transition table
+    for (int c = 0; c < DFA_ALPHABET_SIZE; c++) {
+        for (size_t s = 0; s < regex->dfa->n_states; s++) {
+            assert_equals_int(shuffle->masks[c][s], regex->dfa->table[s * DFA_ALPHABET_SIZE + c]);
+        }
+    }
+
+    free(shuffle);
+    regex_free(regex);
+    free(regex);
+
+    // Automata with too many states are not encoded
+    regex = regex_create("abcdefghijklmnopqrstuvwxyz+");
+    assert_is_not_null(regex->dfa);
+    assert_equals_int(regex->dfa->n_states > SHUFFLE_MAX_STATES, true);
+    assert_is_null(shuffle_dfa_create(regex->dfa));
+    assert_is_null(regex->shuffle);
+    regex_free(regex);
+    free(regex);
+
+    assert_is_null(shuffle_dfa_create(NULL));
+
+    TEST_END;
+}
+
+int test_shuffle_dfa_match() {
+    TEST_BEGIN;
+
+    // The compiler picks the shuffle encoding for small automata
+    Regex* regex = regex_create("(0|1|2|3)+-(a|b)?");
+    ShuffleDFA* shuffle = regex->shuffle;
+    assert_is_not_null(shuffle);
+
+    // Run both the vector and the scalar walks, where available
+    bool use_simd = shuffle->use_simd;
+    for (int pass = 0; pass < 2; pass++) {
+        shuffle->use_simd = pass == 0 ? use_simd : false;
+
+        assert_equals_int(SHUFFLE_MATCH("0-"), true);
+        assert_equals_int(SHUFFLE_MATCH("0123-a"), true);
+        assert_equals_int(SHUFFLE_MATCH("3210321032103210-b"), true);
+
+        assert_equals_int(SHUFFLE_MATCH(""), false);
+        assert_equals_int(SHUFFLE_MATCH("-a"), false);
+        assert_equals_int(SHUFFLE_MATCH("0123-ab"), false);
+        assert_equals_int(SHUFFLE_MATCH("01234-a"), false);
+        assert_equals_int(SHUFFLE_MATCH("012\xf0-a"), false);
+
+        assert_equals_int(shuffle_dfa_match(NULL, "0-", 2), false);
+        assert_equals_int(shuffle_dfa_match(shuffle, NULL, 0), false);
+    }
+
+    // regex_match goes through the shuffle encoding
+    assert_equals_int(regex_match(regex, "12-a"), true);
+    assert_equals_int(regex_match(regex, "12-c"), false);
+
+    regex_free(regex);
+    free(regex);
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_shuffle_dfa_create", .func=test_shuffle_dfa_create},
+    {.name="test_shuffle_dfa_match", .func=test_shuffle_dfa_match},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,127 @@
+#include <stdbool.h>
+#include <string.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "teddy.h"
+
+Teddy* teddy;
+
+// Build the searcher for the given NULL terminated list of strings
+void build(char** strings) {
+    Literal literals[TEDDY_MAX_LITERALS + 1];
+    size_t n = 0;
+
+    for (; strings[n] != NULL; n++) {
+        literals[n] = (Literal) {.bytes = strings[n], .len = strlen(strings[n])};
+    }
+
+    LiteralSet set = {.literals = literals, .n = n};
+    teddy = teddy_create(&set);
+}
+
+void release() {
+    teddy_free(teddy);
+    free(teddy);
+    teddy = NULL;
+}
+
+// Search with both the vector and the scalar versions, which must agree
+ssize_t find(const char* string, size_t len, size_t* which) {
+    ssize_t result = teddy_find(teddy, string, len, which);
+
+    bool use_simd = teddy->use_simd;
+    teddy->use_simd = false;
+    ssize_t scalar = teddy_find(teddy, string, len, NULL);
+    teddy->use_simd = use_simd;
+
+    return result == scalar ? result : -2;
+}
+
+#define FIND(s, w) find((s), strlen((s)), (w))
+
+int test_teddy_create() {
+    TEST_BEGIN;
+
+    char* strings[] = {"foo", "bar", "quux", NULL};
+    build(strings);
+    assert_is_not_null(teddy);
+    assert_equals_int(teddy->mask_len, 3);
+    assert_equals_int(teddy->literals.n, 3);
+
+    // `f` is 0x66, and only the first literal starts with it
+    assert_equals_int(teddy->lo[0][0x6], 1 << 0);
+    assert_equals_int(teddy->hi[0][0x6], (1 << 0) | (1 << 1));
+    assert_equals_int(teddy->buckets[2], 1 << 2);
+    release();
+
+    // Only as many bytes as the shortest literal are compared
+    char* short_strings[] = {"ab", "x", NULL};
+    build(short_strings);
+    assert_equals_int(teddy->mask_len, 1);
+    release();
+
+    char* empty[] = {"ab", "", NULL};
+    build(empty);
+    assert_is_null(teddy);
+
+    LiteralSet none = {.literals = NULL, .n = 0};
+    assert_is_null(teddy_create(&none));
+    assert_is_null(teddy_create(NULL));
+
+    TEST_END;
+}
+
+int test_teddy_find() {
+    TEST_BEGIN;
+
+    char* strings[] = {"ERROR", "WARN", "FATAL", NULL};
+    build(strings);
+
+    size_t which = 99;
+    assert_equals_int(FIND("ok ok ok WARN ok ERROR", &which), 9);
+    assert_equals_int(which, 1);
+    assert_equals_int(FIND("ERROR", &which), 0);
+    assert_equals_int(which, 0);
+
+    // Candidates that fail verification are skipped
+    assert_equals_int(FIND("ERRAND WARM FATE ERRO", NULL), -1);
+    assert_equals_int(FIND("", NULL), -1);
+
+    // Occurrences in the tail after the last full block, and across blocks
+    char text[100];
+    memset(text, '.', sizeof(text));
+    memcpy(&text[95], "FATAL", 5);
+    assert_equals_int(find(text, 100, &which), 95);
+    assert_equals_int(which, 2);
+    assert_equals_int(find(text, 99, NULL), -1);
+
+    memcpy(&text[14], "WARN", 4);
+    assert_equals_int(find(text, 100, &which), 14);
+    assert_equals_int(which, 1);
+
+    assert_equals_int(teddy_find(NULL, "WARN", 4, NULL), -1);
+    assert_equals_int(teddy_find(teddy, NULL, 0, NULL), -1);
+    release();
+
+    // More literals than buckets share them
+    char* many[] = {"a0", "b1", "c2", "d3", "e4", "f5", "g6", "h7", "i8", "j9", NULL};
+    build(many);
+    assert_equals_int(FIND("zzzzzzzzzzzzzzzzzzzzzzzj9", &which), 23);
+    assert_equals_int(which, 9);
+    assert_equals_int(FIND("zzzzzzzzzzzzzzzzzzzzzzzj8", NULL), -1);
+    release();
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_teddy_create", .func=test_teddy_create},
+    {.name="test_teddy_find", .func=test_teddy_find},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FAIL_FAST
+#include "testlib/asserts.h"
+#include "testlib/tests.h"
+#include "lexer.h"
+#include "parser.h"
+#include "regex.h"
+#include "trigram.h"
+
+// Plan the query for the given pattern
+TrigramQuery* plan_for(char* pattern) {
+    Lexer lexer;
+    Parser parser;
+    lexer_init(&lexer, pattern);
+    parser_init(&parser, &lexer);
+
+    ASTNode* root = parse(&parser);
+
+    parser_free(&parser);
+    lexer_free(&lexer);
+
+    TrigramQuery* query = trigram_query_create(root);
+    ast_node_free(root);
+    return query;
+}
+
+void release(TrigramQuery* query) {
+    trigram_query_free(query);
+    free(query);
+}
+
+// Whether the query requires exactly the trigrams of the given string
+bool requires(TrigramQuery* query, char* string) {
+    size_t n = strlen(string) - 2;
+    if (query->type != TRIGRAM_AND || query->n_subqueries != 0 || query->n_trigrams != n) {
+        return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t trigram = (uint32_t) (unsigned char) string[i] << 16
+            | (uint32_t) (unsigned char) string[i + 1] << 8 | (unsigned char) string[i + 2];
+
+        bool found = false;
+        for (size_t j = 0; j < query->n_trigrams; j++) {
+            found = found || query->trigrams[j] == trigram;
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int test_trigram_query() {
+    TEST_BEGIN;
+
+    TrigramQuery* query = plan_for("hello");
+    assert_equals_int(requires(query, "hello"), true);
+    release(query);
+
+    // Trigrams spanning repetitions and their neighbours are required too
+    query = plan_for("a+bcd");
+    assert_equals_int(requires(query, "abcd"), true);
+    release(query);
+
+    query = plan_for("(ab|xy)z");
+    assert_equals_int(query->type, TRIGRAM_OR);
+    assert_equals_int(query->n_subqueries, 2);
+    assert_equals_int(requires(query->subqueries[0], "abz"), true);
+    assert_equals_int(requires(query->subqueries[1], "xyz"), true);
+    release(query);
+
+    // Optional parts make either string possible
+    query = plan_for("abc(de)?f");
+    assert_equals_int(query->type, TRIGRAM_OR);
+    release(query);
+
+    // Nothing is required of short or repeated patterns
+    char* anything[] = {"ab", "(abc)*", "a(b|c)*d", "x?"};
+    for (size_t i = 0; i < sizeof(anything) / sizeof(anything[0]); i++) {
+        query = plan_for(anything[i]);
+        assert_equals_int(query->type, TRIGRAM_ALL);
+        release(query);
+    }
+
+    // Repetitions break exact strings, but each side is still required
+    query = plan_for("abc(x|y)*def");
+    assert_equals_int(query->type, TRIGRAM_AND);
+    assert_equals_int(query->n_trigrams, 2);
+    release(query);
+
+    assert_is_null(trigram_query_create(NULL));
+
+    TEST_END;
+}
+
+char dir[] = "/tmp/test_trigram_XXXXXX";
+char paths[6][64];
+char* files[6];
+char index_path[64];
+
+char* contents[] = {
+    "GET /index.html 200",
+    "POST /api/login 401",
+    "GET /api/users 200",
+    "",
+    "ab",
+    "ERROR disk full on /var, GET /health 500",
+};
+
+// Write the documents of the corpus into a temporary directory
+void write_corpus() {
+    mkdtemp(dir);
+
+    for (size_t i = 0; i < 6; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/doc%zu", dir, i);
+        files[i] = paths[i];
+
+        FILE* file = fopen(paths[i], "w");
+        fputs(contents[i], file);
+        fclose(file);
+    }
+
+    snprintf(index_path, sizeof(index_path), "%s/index", dir);
+}
+
+void remove_corpus() {
+    for (size_t i = 0; i < 6; i++) {
+        unlink(paths[i]);
+    }
+
+    unlink(index_path);
+    rmdir(dir);
+}
+
+// Find the candidates for the given pattern, as a bitmask of documents
+long candidates_for(TrigramIndex* index, char* pattern) {
+    TrigramQuery* query = plan_for(pattern);
+    uint32_t* docs;
+    ssize_t n = trigram_index_candidates(index, query, &docs);
+    release(query);
+
+    long mask = 0;
+    for (ssize_t i = 0; i < n; i++) {
+        mask |= 1L << docs[i];
+    }
+
+    free(docs);
+    return n < 0 ? -1 : mask;
+}
+
+int test_trigram_index() {
+    TEST_BEGIN;
+
+    write_corpus();
+
+    for (size_t n_threads = 0; n_threads <= 8; n_threads += 4) {
+        assert_equals_int(trigram_index_build(index_path, files, 6, n_threads), 0);
+
+        TrigramIndex* index = trigram_index_open(index_path);
+        assert_is_not_null(index);
+        assert_equals_int(index->header->n_docs, 6);
+        assert_equals_str(trigram_index_doc_name(index, 2), paths[2]);
+        assert_is_null(trigram_index_doc_name(index, 6));
+
+        assert_equals_int(candidates_for(index, "GET"), 0x25);
+        assert_equals_int(candidates_for(index, "GET /api"), 0x4);
+        assert_equals_int(candidates_for(index, "(GET|POST) /api"), 0x6);
+        assert_equals_int(candidates_for(index, "200+"), 0x5);
+        assert_equals_int(candidates_for(index, "x*ab"), 0x3F);
+        assert_equals_int(candidates_for(index, "PUT"), 0);
+
+        // Every document containing a match is a candidate
+        char* patterns[] = {"/(a|i)(p|n)(i|d)", "(0|1|2|3|4|5)+0", "/ap*i/l?u", "ab"};
+        for (size_t p = 0; p < 4; p++) {
+            Regex* regex = regex_create(patterns[p]);
+            long candidates = candidates_for(index, patterns[p]);
+
+            for (size_t i = 0; i < 6; i++) {
+                if (regex_count(regex, contents[i], strlen(contents[i])) > 0) {
+                    assert_equals_int((candidates >> i) & 1, 1);
+                }
+            }
+
+            regex_free(regex);
+            free(regex);
+        }
+
+        trigram_index_free(index);
+        free(index);
+    }
+
+    // Unreadable documents and invalid index files are rejected
+    char* missing[] = {files[0], "/nonexistent/file"};
+    assert_equals_int(trigram_index_build(index_path, missing, 2, 1), -1);
+    assert_is_null(trigram_index_open(paths[5]));
+    assert_is_null(trigram_index_open("/nonexistent/index"));
+
+    remove_corpus();
+
+    TEST_END;
+}
+
+Test tests[] = {
+    {.name="test_trigram_query", .func=test_trigram_query},
+    {.name="test_trigram_index", .func=test_trigram_index},
+    {.name=NULL, .func=NULL}
+};
+
+int main(int argc, char* argv[]) {
+    return default_main(&argv[1], argc - 1);
+}
@@ -0,0 +1,198 @@
+/*
+ * Time the parallel paths of the library against their serial versions.
+ *
+ * Usage
+ *     regex_bench [max_threads]
+ *
+ * Every benchmark is run with 1, 2, 4, ... threads, up to max_threads, or
+ * up to the number of processors if it is not given. The best of a few runs
+ * is printed for each, along with the speedup over one thread. Sets of
+ * growing size are determinized to find where threads start to pay for
+ * themselves, which is what REGEX_SET_DFA_THREADS should be set from.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "portability.h"
+#include "regex.h"
+#include "regex_set.h"
+
+// Each timing is the best of this many runs
+#define RUNS 5
+
+// Patterns in the list compiled by `regex_compile_all`
+#define N_PATTERNS 4096
+
+// A pattern whose DFA has about 2^10 states, as it must remember the last
+// 10 bytes
+#define WIDE_PATTERN "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+
+static int usage(const char* program) {
+    fprintf(stderr, "usage: %s [max_threads]\n", program);
+    return 2;
+}
+
+// The current time in milliseconds
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void print_timing(const char* name, size_t n_threads, double ms, double serial_ms) {
+    printf("%-24s %3zu threads %10.2f ms %6.2fx\n", name, n_threads, ms, serial_ms / ms);
+}
+
+// Compile a list of patterns, each with a few states of its own
+static int bench_compile_all(size_t max_threads) {
+    char (*storage)[40] = malloc(sizeof(*storage) * N_PATTERNS);
+    char** patterns = malloc(sizeof(char*) * N_PATTERNS);
+    Regex** regexes = malloc(sizeof(Regex*) * N_PATTERNS);
+    int status = 0;
+
+    if (storage == NULL || patterns == NULL || regexes == NULL) {
+        status = 1;
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < N_PATTERNS; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "(a|b)*c%zu(d|e)+(f|g)?h", i);
+        patterns[i] = storage[i];
+    }
+
+    double serial_ms = 0;
+    for (size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        double best = -1;
+
+        for (int run = 0; run < RUNS; run++) {
+            double start = now_ms();
+            ssize_t failed = regex_compile_all(patterns, N_PATTERNS, regexes, n_threads);
+            double ms = now_ms() - start;
+
+            for (size_t i = 0; failed >= 0 && i < N_PATTERNS; i++) {
+                regex_free(regexes[i]);
+                free(regexes[i]);
+            }
+
+            if (failed != 0) {
+                status = 1;
+                goto cleanup;
+            }
+
+            best = best < 0 || ms < best ? ms : best;
+        }
+
+        serial_ms = n_threads == 1 ? best : serial_ms;
+        print_timing("regex_compile_all", n_threads, best, serial_ms);
+    }
+
+cleanup:
+    free(storage);
+    free(patterns);
+    free(regexes);
+    return status;
+}
+
+// Determinize an NFA with 1, 2, 4, ... threads. Sets are determinized with
+// their parts when `parts` is not NULL.
+static int bench_dfa(const char* name, NFA* nfa, NFA* const* parts, size_t n_parts,
+                     size_t max_threads) {
+    double serial_ms = 0;
+    for (size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        double best = -1;
+
+        for (int run = 0; run < RUNS; run++) {
+            double start = now_ms();
+            DFA* dfa = parts != NULL
+                ? dfa_create_set(nfa, parts, n_parts, n_threads)
+                : dfa_create_parallel(nfa, DFA_ANCHORED, n_threads);
+            double ms = now_ms() - start;
+
+            if (dfa == NULL) {
+                return 1;
+            }
+            dfa_free(dfa);
+            free(dfa);
+
+            best = best < 0 || ms < best ? ms : best;
+        }
+
+        serial_ms = n_threads == 1 ? best : serial_ms;
+        print_timing(name, n_threads, best, serial_ms);
+    }
+
+    return 0;
+}
+
+// Determinize one pattern with many states, and sets of growing size
+static int bench_dfas(size_t max_threads) {
+    Regex* regex = regex_create(WIDE_PATTERN);
+    if (regex == NULL) {
+        return 1;
+    }
+
+    int status = bench_dfa("dfa_create_parallel", regex->nfa, NULL, 0, max_threads);
+    regex_free(regex);
+    free(regex);
+
+    char storage[256][40];
+    char* patterns[256];
+    for (size_t i = 0; i < 256; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "(a|b)*c%zu(d|e)+(f|g)?h", i);
+        patterns[i] = storage[i];
+    }
+
+    for (size_t n = 16; status == 0 && n <= 256; n *= 2) {
+        RegexSet* set = regex_set_create(patterns, n);
+        if (set == NULL) {
+            return 1;
+        }
+
+        // Larger sets are simulated rather than determinized
+        if (set->dfa == NULL) {
+            regex_set_free(set);
+            free(set);
+            break;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "dfa_create_set %zu", set->n_states);
+        status = bench_dfa(name, &set->nfa, set->nfas, set->n_patterns, max_threads);
+
+        regex_set_free(set);
+        free(set);
+    }
+
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        return usage(argv[0]);
+    }
+
+    int n_processors = n_processors_online();
+    size_t max_threads = n_processors > 0 ? n_processors : 1;
+    if (argc == 2) {
+        max_threads = strtoul(argv[1], NULL, 10);
+        if (max_threads == 0) {
+            return usage(argv[0]);
+        }
+    }
+
+    printf("%d processors online\n", n_processors);
+
+    if (bench_compile_all(max_threads) != 0) {
+        fprintf(stderr, "compiling the patterns failed\n");
+        return 1;
+    }
+
+    if (bench_dfas(max_threads) != 0) {
+        fprintf(stderr, "determinizing the patterns failed\n");
+        return 1;
+    }
+
+    return 0;
+}
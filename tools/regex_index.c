@@ -0,0 +1,147 @@
+/*
+ * Index a corpus of files by trigram, and search it with a regex.
+ *
+ * Usage
+ *     regex_index build [-j threads] <index> <file>...
+ *     regex_index search <index> <pattern>
+ *
+ * Searching only runs the regex over the files the index says may contain
+ * a match, and prints the name of each file that does.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "regex.h"
+#include "trigram.h"
+
+static int usage(const char* program) {
+    fprintf(stderr, "usage: %s build [-j threads] <index> <file>...\n", program);
+    fprintf(stderr, "       %s search <index> <pattern>\n", program);
+    return 2;
+}
+
+// Whether the file at the given path contains a match of the regex
+static int file_matches(const Regex* regex, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return regex_count(regex, "", 0) > 0;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    int result = regex_count(regex, data, st.st_size) > 0;
+    munmap(data, st.st_size);
+    return result;
+}
+
+static int build(int argc, char* argv[]) {
+    size_t n_threads = 0;
+
+    if (argc >= 2 && strcmp(argv[0], "-j") == 0) {
+        n_threads = strtoul(argv[1], NULL, 10);
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 1) {
+        return -1;
+    }
+
+    if (trigram_index_build(argv[0], &argv[1], argc - 1, n_threads) < 0) {
+        fprintf(stderr, "could not build the index\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static int search(const char* index_path, char* pattern) {
+    Lexer lexer;
+    Parser parser;
+    if (lexer_init(&lexer, pattern) < 0 || parser_init(&parser, &lexer) < 0) {
+        return 1;
+    }
+
+    ASTNode* root = parse(&parser);
+    parser_free(&parser);
+    lexer_free(&lexer);
+
+    Regex* regex = regex_create(pattern);
+    if (root == NULL || regex == NULL) {
+        fprintf(stderr, "invalid pattern\n");
+        ast_node_free(root);
+        free(regex);
+        return 1;
+    }
+
+    TrigramQuery* query = trigram_query_create(root);
+    ast_node_free(root);
+
+    TrigramIndex* index = trigram_index_open(index_path);
+    uint32_t* docs = NULL;
+    ssize_t n_docs = -1;
+
+    if (index == NULL) {
+        fprintf(stderr, "could not open the index\n");
+    } else if (query != NULL) {
+        n_docs = trigram_index_candidates(index, query, &docs);
+    }
+
+    int status = n_docs < 0 ? 1 : 0;
+
+    for (ssize_t i = 0; i < n_docs; i++) {
+        const char* name = trigram_index_doc_name(index, docs[i]);
+        int matches = file_matches(regex, name);
+
+        if (matches < 0) {
+            fprintf(stderr, "could not read %s\n", name);
+            status = 1;
+        } else if (matches) {
+            puts(name);
+        }
+    }
+
+    free(docs);
+    trigram_index_free(index);
+    free(index);
+    trigram_query_free(query);
+    free(query);
+    regex_free(regex);
+    free(regex);
+
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "build") == 0) {
+        int status = build(argc - 2, &argv[2]);
+        return status < 0 ? usage(argv[0]) : status;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "search") == 0) {
+        return search(argv[2], argv[3]);
+    }
+
+    return usage(argv[0]);
+}
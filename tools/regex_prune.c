@@ -0,0 +1,129 @@
+/*
+ * Remove the redundant patterns from a list, before compiling it into a set.
+ *
+ * Usage
+ *     regex_prune [file]
+ *
+ * Patterns are read one per line, from the file or from standard input. A
+ * pattern is redundant when every string it matches is matched by another
+ * pattern of the list, and of several equivalent patterns only the first is
+ * kept. The patterns kept are printed in their original order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regex.h"
+
+static int usage(const char* program) {
+    fprintf(stderr, "usage: %s [file]\n", program);
+    return 2;
+}
+
+// Release the given regexes, and the patterns they were compiled from
+static void free_all(Regex** regexes, char** patterns, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        regex_free(regexes[i]);
+        free(regexes[i]);
+        free(patterns[i]);
+    }
+
+    free(regexes);
+    free(patterns);
+}
+
+static int prune(FILE* in) {
+    size_t n = 0;
+    size_t cap = 64;
+    char** patterns = malloc(sizeof(char*) * cap);
+    Regex** regexes = malloc(sizeof(Regex*) * cap);
+    if (patterns == NULL || regexes == NULL) {
+        free(patterns);
+        free(regexes);
+        return 1;
+    }
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    int status = 0;
+
+    while ((len = getline(&line, &line_cap, in)) >= 0) {
+        if (len > 0 && line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+
+        if (n == cap) {
+            cap *= 2;
+            char** grown_patterns = realloc(patterns, sizeof(char*) * cap);
+            if (grown_patterns != NULL) {
+                patterns = grown_patterns;
+            }
+            Regex** grown_regexes = realloc(regexes, sizeof(Regex*) * cap);
+            if (grown_regexes != NULL) {
+                regexes = grown_regexes;
+            }
+            if (grown_patterns == NULL || grown_regexes == NULL) {
+                status = 1;
+                break;
+            }
+        }
+
+        // The regex keeps pointing at its pattern, so it is compiled from
+        // the copy rather than the line buffer
+        patterns[n] = strdup(line);
+        regexes[n] = patterns[n] != NULL ? regex_create(patterns[n]) : NULL;
+        n++;
+
+        if (patterns[n - 1] == NULL || regexes[n - 1] == NULL) {
+            fprintf(stderr, "invalid pattern on line %zu\n", n);
+            status = 1;
+            break;
+        }
+    }
+    free(line);
+
+    bool* keep = malloc(sizeof(bool) * (n > 0 ? n : 1));
+    ssize_t n_kept = -1;
+    if (status == 0 && keep != NULL) {
+        n_kept = regex_prune(regexes, n, keep);
+    }
+
+    if (status == 0 && n_kept < 0) {
+        fprintf(stderr, "could not compare the patterns\n");
+        status = 1;
+    }
+
+    if (status == 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (keep[i]) {
+                puts(patterns[i]);
+            }
+        }
+        fprintf(stderr, "kept %zd of %zu patterns\n", n_kept, n);
+    }
+
+    free(keep);
+    free_all(regexes, patterns, n);
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        return usage(argv[0]);
+    }
+
+    if (argc == 1) {
+        return prune(stdin);
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (in == NULL) {
+        fprintf(stderr, "could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    int status = prune(in);
+    fclose(in);
+    return status;
+}